@@ -1,2 +1,181 @@
 #include "helpers.hpp"
 
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "gloo/debug/Tracer.hpp"
+
+namespace GLOO {
+
+namespace {
+std::atomic<unsigned int> worker_override(0);
+thread_local bool in_parallel_region = false;
+}  // namespace
+
+namespace {
+// Marks the calling thread as running a parallel chunk while alive
+class ParallelRegionScope {
+ public:
+  ParallelRegionScope() : was_in_region_(in_parallel_region) {
+    in_parallel_region = true;
+  }
+  ~ParallelRegionScope() { in_parallel_region = was_in_region_; }
+
+ private:
+  bool was_in_region_;
+};
+
+// Threads that run the chunks of ParallelChunks calls, started on first use
+// and kept for the rest of the process, so a call costs a wake-up rather
+// than a thread creation per chunk. Callers run their own unclaimed chunks
+// too, so a call completes even while every worker is busy with another.
+class WorkerPool {
+ public:
+  ~WorkerPool() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stopping_ = true;
+    }
+    work_ready_.notify_all();
+    for (auto& worker : workers_) {
+      worker.join();
+    }
+  }
+
+  // chunks >= 2
+  void Run(size_t chunks, size_t count, helpers_internal::ChunkFunction run,
+           const void* body) {
+    Job job(run, body, chunks, count);
+    job.next = 1;  // Chunk 0 is the caller's
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      StartWorkers(chunks - 1);
+      jobs_.push_back(&job);
+    }
+    work_ready_.notify_all();
+    RunChunk(job, 0);
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    job.finished++;
+    size_t chunk;
+    while (Claim(&job, &chunk)) {
+      lock.unlock();
+      RunChunk(job, chunk);
+      lock.lock();
+      job.finished++;
+    }
+    // Workers touch the job only under the lock, so it may go out of scope
+    // once the last one has reported
+    job_done_.wait(lock, [&] { return job.finished == chunks; });
+  }
+
+ private:
+  struct Job {
+    Job(helpers_internal::ChunkFunction run, const void* body, size_t chunks,
+        size_t count)
+        : run(run), body(body), chunks(chunks), count(count) {}
+
+    helpers_internal::ChunkFunction run;
+    const void* body;
+    size_t chunks;
+    size_t count;
+    size_t next = 0;      // First unclaimed chunk
+    size_t finished = 0;  // Chunks run to completion
+  };
+
+  static void RunChunk(const Job& job, size_t chunk) {
+    // Each chunk shows up as a "ParallelChunk" slice in traces
+    GLOO_TRACE_SCOPE("ParallelChunk");
+    ParallelRegionScope region;
+    job.run(job.body, chunk, job.count * chunk / job.chunks,
+            job.count * (chunk + 1) / job.chunks);
+  }
+
+  // Callers hold mutex_. Takes the next chunk of job, dropping the job from
+  // the queue once all of its chunks are taken.
+  bool Claim(Job* job, size_t* chunk) {
+    if (job->next == job->chunks) {
+      return false;
+    }
+    *chunk = job->next++;
+    if (job->next == job->chunks) {
+      jobs_.erase(std::find(jobs_.begin(), jobs_.end(), job));
+    }
+    return true;
+  }
+
+  // Callers hold mutex_
+  void StartWorkers(size_t count) {
+    while (workers_.size() < count) {
+      const size_t index = workers_.size();
+      workers_.emplace_back([this, index] {
+        Tracer::SetThreadName("worker " + std::to_string(index + 1));
+        WorkerLoop();
+      });
+    }
+  }
+
+  void WorkerLoop() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+      work_ready_.wait(lock, [&] { return stopping_ || !jobs_.empty(); });
+      if (stopping_) {
+        return;
+      }
+      Job* job = jobs_.front();
+      size_t chunk;
+      Claim(job, &chunk);
+      lock.unlock();
+      RunChunk(*job, chunk);
+      lock.lock();
+      if (++job->finished == job->chunks) {
+        job_done_.notify_all();
+      }
+    }
+  }
+
+  std::mutex mutex_;
+  std::condition_variable work_ready_;
+  std::condition_variable job_done_;
+  std::deque<Job*> jobs_;  // Jobs with unclaimed chunks, oldest first
+  std::vector<std::thread> workers_;
+  bool stopping_ = false;
+};
+}  // namespace
+
+namespace helpers_internal {
+void RunChunks(size_t chunks, size_t count, ChunkFunction run,
+               const void* body) {
+  static WorkerPool pool;
+  pool.Run(chunks, count, run, body);
+}
+}  // namespace helpers_internal
+
+unsigned int GetParallelWorkerCount() {
+  unsigned int count = worker_override.load();
+  if (count == 0) {
+    count = std::thread::hardware_concurrency();
+  }
+  return count == 0 ? 1 : count;
+}
+
+void SetParallelWorkerCount(unsigned int count) {
+  worker_override.store(count);
+}
+
+size_t GetParallelChunkCount(size_t count, size_t grain_size) {
+  grain_size = std::max<size_t>(grain_size, 1);
+  if (count < grain_size || in_parallel_region) {
+    return 1;
+  }
+  size_t chunks = count / grain_size;
+  size_t workers = GetParallelWorkerCount();
+  return chunks < workers ? chunks : workers;
+}
+
+}  // namespace GLOO
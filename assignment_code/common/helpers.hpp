@@ -4,5 +4,271 @@
 // Implement your own helpers functions here that may be used across
 // assignments.
 
-#endif
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace GLOO {
+
+// Parallel primitives
+// -------------------
+// Small data-parallel building blocks (radix sort, scan, compaction and
+// segmented reduction) for the hot loops of the simplifiers. Every primitive
+// splits its input into contiguous chunks, one per worker, so the memory
+// traffic stays sequential. Inputs below kParallelGrainSize run on the
+// calling thread only. The number of chunks depends on the number of
+// workers: sorts, compactions and integer scans give the same result for
+// any worker count, but per-chunk partial sums of floating-point values
+// (an ExclusiveScan of floats, or a caller's own chunked reduction) are
+// rounded differently when it changes.
+
+// Inputs smaller than this are processed on the calling thread.
+const size_t kParallelGrainSize = size_t(1) << 15;
+
+// Number of threads the primitives may use (always >= 1).
+unsigned int GetParallelWorkerCount();
+
+// Overrides the worker count; 0 restores the hardware default.
+void SetParallelWorkerCount(unsigned int count);
+
+// Number of chunks [0, count) is split into by ParallelChunks: one per
+// grain_size items, at most one per worker. Always 1 inside the body of a
+// ParallelChunks call that runs on several threads, so nested primitives
+// (e.g. a simplifier running on one block of a partitioned mesh) stay on
+// their worker instead of oversubscribing the cores.
+size_t GetParallelChunkCount(size_t count,
+                             size_t grain_size = kParallelGrainSize);
+
+namespace helpers_internal {
+typedef void (*ChunkFunction)(const void* body, size_t chunk, size_t begin,
+                              size_t end);
+// Runs run(body, c, begin, end) for chunks c = 0..chunks-1 of [0, count),
+// on a pool of worker threads that persists between calls and on the calling
+// thread. Kept out of line so the threading and tracing stay in helpers.cpp.
+void RunChunks(size_t chunks, size_t count, ChunkFunction run,
+               const void* body);
+}  // namespace helpers_internal
+
+// Runs body(chunk, begin, end) for every chunk of [0, count). Chunk 0 runs on
+// the calling thread, the rest on pooled workers (or on the calling thread
+// too, if it gets to them first). Each chunk shows up as a "ParallelChunk" slice in
+// traces. Loops whose items are expensive on their own (whole collapses,
+// sub-meshes) pass a smaller grain_size.
+template <typename Body>
+void ParallelChunks(size_t count, const Body& body,
+                    size_t grain_size = kParallelGrainSize) {
+  const size_t chunks = GetParallelChunkCount(count, grain_size);
+  if (chunks <= 1) {
+    body(size_t(0), size_t(0), count);
+    return;
+  }
+  helpers_internal::RunChunks(
+      chunks, count,
+      [](const void* erased, size_t c, size_t begin, size_t end) {
+        (*static_cast<const Body*>(erased))(c, begin, end);
+      },
+      &body);
+}
+
+// Runs body(i) for every i in [0, count).
+template <typename Body>
+void ParallelFor(size_t count, const Body& body,
+                 size_t grain_size = kParallelGrainSize) {
+  ParallelChunks(count,
+                 [&body](size_t, size_t begin, size_t end) {
+                   for (size_t i = begin; i < end; i++) {
+                     body(i);
+                   }
+                 },
+                 grain_size);
+}
+
+namespace helpers_internal {
+template <typename Key, typename Value, bool kHasValues>
+void RadixSortImpl(std::vector<Key>& keys, std::vector<Value>* values) {
+  static_assert(std::is_unsigned<Key>::value,
+                "Radix sort keys must be unsigned integers");
+  const size_t n = keys.size();
+  if (n < 2) {
+    return;
+  }
+
+  const size_t chunks = GetParallelChunkCount(n);
+  std::vector<Key> key_scratch(n);
+  std::vector<Value> value_scratch(kHasValues ? n : 0);
+  std::vector<size_t> offsets(chunks * 256);
+
+  Key* src_keys = keys.data();
+  Key* dst_keys = key_scratch.data();
+  Value* src_values = kHasValues ? values->data() : nullptr;
+  Value* dst_values = kHasValues ? value_scratch.data() : nullptr;
+  bool in_scratch = false;
+
+  for (unsigned int shift = 0; shift < sizeof(Key) * 8; shift += 8) {
+    // Per-chunk digit histograms.
+    ParallelChunks(n, [&](size_t c, size_t begin, size_t end) {
+      size_t* histogram = &offsets[c * 256];
+      std::fill(histogram, histogram + 256, size_t(0));
+      for (size_t i = begin; i < end; i++) {
+        histogram[(src_keys[i] >> shift) & 0xFF]++;
+      }
+    });
+
+    // Digit-major, chunk-minor offsets keep the scatter stable. A pass where
+    // every key shares the same digit would be the identity, so skip it.
+    bool identity_pass = false;
+    size_t running = 0;
+    for (size_t d = 0; d < 256; d++) {
+      size_t digit_total = 0;
+      for (size_t c = 0; c < chunks; c++) {
+        size_t count = offsets[c * 256 + d];
+        offsets[c * 256 + d] = running + digit_total;
+        digit_total += count;
+      }
+      if (digit_total == n) {
+        identity_pass = true;
+        break;
+      }
+      running += digit_total;
+    }
+    if (identity_pass) {
+      continue;
+    }
 
+    ParallelChunks(n, [&](size_t c, size_t begin, size_t end) {
+      size_t* offset = &offsets[c * 256];
+      for (size_t i = begin; i < end; i++) {
+        size_t dst = offset[(src_keys[i] >> shift) & 0xFF]++;
+        dst_keys[dst] = src_keys[i];
+        if (kHasValues) {
+          dst_values[dst] = src_values[i];
+        }
+      }
+    });
+
+    std::swap(src_keys, dst_keys);
+    std::swap(src_values, dst_values);
+    in_scratch = !in_scratch;
+  }
+
+  if (in_scratch) {
+    keys.swap(key_scratch);
+    if (kHasValues) {
+      values->swap(value_scratch);
+    }
+  }
+}
+}  // namespace helpers_internal
+
+// Stable LSD radix sort on unsigned 32/64-bit keys, permuting the payload
+// values alongside. Byte passes on which all keys agree are skipped, so
+// keys that only use their low bits (vertex ids, packed edges) are cheap.
+template <typename Key, typename Value>
+void RadixSortPairs(std::vector<Key>& keys, std::vector<Value>& values) {
+  helpers_internal::RadixSortImpl<Key, Value, true>(keys, &values);
+}
+
+// Key-only variant of RadixSortPairs.
+template <typename Key>
+void RadixSort(std::vector<Key>& keys) {
+  helpers_internal::RadixSortImpl<Key, char, false>(keys, nullptr);
+}
+
+// Writes the exclusive prefix sum of input into output (which may be the same
+// vector) and returns the total.
+template <typename T>
+T ExclusiveScan(const std::vector<T>& input, std::vector<T>& output) {
+  const size_t n = input.size();
+  output.resize(n);
+  std::vector<T> partial(GetParallelChunkCount(n) + 1, T(0));
+
+  ParallelChunks(n, [&](size_t c, size_t begin, size_t end) {
+    T sum = T(0);
+    for (size_t i = begin; i < end; i++) {
+      sum += input[i];
+    }
+    partial[c + 1] = sum;
+  });
+  for (size_t c = 1; c < partial.size(); c++) {
+    partial[c] += partial[c - 1];
+  }
+  ParallelChunks(n, [&](size_t c, size_t begin, size_t end) {
+    T running = partial[c];
+    for (size_t i = begin; i < end; i++) {
+      T value = input[i];
+      output[i] = running;
+      running += value;
+    }
+  });
+  return partial.back();
+}
+
+// Stable filtered compaction: output receives input[i] for every i where
+// keep(i) is true, in the original order. keep is called once per element.
+// output must not alias input.
+template <typename T, typename Pred>
+void CompactIf(const std::vector<T>& input, std::vector<T>& output,
+               const Pred& keep) {
+  const size_t n = input.size();
+  std::vector<uint8_t> flags(n);
+  std::vector<size_t> partial(GetParallelChunkCount(n) + 1, 0);
+
+  ParallelChunks(n, [&](size_t c, size_t begin, size_t end) {
+    size_t kept = 0;
+    for (size_t i = begin; i < end; i++) {
+      flags[i] = keep(i) ? 1 : 0;
+      kept += flags[i];
+    }
+    partial[c + 1] = kept;
+  });
+  for (size_t c = 1; c < partial.size(); c++) {
+    partial[c] += partial[c - 1];
+  }
+
+  output.resize(partial.back());
+  ParallelChunks(n, [&](size_t c, size_t begin, size_t end) {
+    size_t dst = partial[c];
+    for (size_t i = begin; i < end; i++) {
+      if (flags[i]) {
+        output[dst++] = input[i];
+      }
+    }
+  });
+}
+
+// Reduces every run of equal adjacent keys (e.g. after RadixSortPairs) to a
+// single entry: out_keys gets the run's key and out_values the left fold of
+// its values with op.
+template <typename Key, typename Value, typename Op>
+void SegmentedReduce(const std::vector<Key>& keys,
+                     const std::vector<Value>& values,
+                     const Op& op,
+                     std::vector<Key>& out_keys,
+                     std::vector<Value>& out_values) {
+  const size_t n = keys.size();
+  std::vector<size_t> all(n);
+  ParallelFor(n, [&](size_t i) { all[i] = i; });
+  std::vector<size_t> heads;
+  CompactIf(all, heads,
+            [&](size_t i) { return i == 0 || keys[i] != keys[i - 1]; });
+  heads.push_back(n);
+
+  const size_t segments = heads.size() - 1;
+  out_keys.resize(segments);
+  out_values.resize(segments);
+  ParallelFor(segments, [&](size_t s) {
+    Value acc = values[heads[s]];
+    for (size_t i = heads[s] + 1; i < heads[s + 1]; i++) {
+      acc = op(acc, values[i]);
+    }
+    out_keys[s] = keys[heads[s]];
+    out_values[s] = acc;
+  });
+}
+
+}  // namespace GLOO
+
+#endif
@@ -1,14 +1,303 @@
 #include "MeshIO.hpp"
 #include "gloo/MeshLoader.hpp"
+#include "gloo/utils.hpp"
+#include "Profiler.hpp"
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <unordered_map>
 
 namespace GLOO {
+namespace {
+const char kBinaryMagic[4] = {'D', 'M', 'S', 'H'};
+const uint32_t kBinaryVersion = 1;
+
+struct BinaryHeader {
+  char magic[4];
+  uint32_t version;
+  uint64_t vertex_count;
+  uint64_t face_count;
+  uint64_t normal_count;
+  uint64_t color_count;
+  uint64_t texcoord_count;
+};
+
+template <typename T>
+void WriteArray(std::ostream& os, const std::vector<T>& values) {
+  if (!values.empty()) {
+    os.write(reinterpret_cast<const char*>(values.data()),
+             static_cast<std::streamsize>(values.size() * sizeof(T)));
+  }
+}
+
+template <typename T>
+bool ReadArray(std::istream& is, uint64_t count, std::vector<T>& values) {
+  values.resize(static_cast<size_t>(count));
+  if (count > 0) {
+    is.read(reinterpret_cast<char*>(values.data()),
+            static_cast<std::streamsize>(count * sizeof(T)));
+  }
+  return static_cast<bool>(is);
+}
+
+bool SeekTo(std::FILE* file, uint64_t offset) {
+#if defined(_WIN32)
+  return _fseeki64(file, static_cast<__int64>(offset), SEEK_SET) == 0;
+#else
+  return fseeko(file, static_cast<off_t>(offset), SEEK_SET) == 0;
+#endif
+}
+
+// Positions stored as consecutive raw glm::vec3s from offset on, read
+// through a least-recently-used cache of fixed-size pages. Meshes are
+// usually stored with some locality, so most lookups hit.
+class VertexPageCache {
+ public:
+  VertexPageCache() = default;
+  VertexPageCache(std::FILE* file, uint64_t offset, uint64_t count)
+      : file_(file), offset_(offset), count_(count) {}
+
+  // False if index is out of range or the page can't be read
+  bool Get(uint64_t index, glm::vec3& position) {
+    if (index >= count_) {
+      return false;
+    }
+    const uint64_t page_number = index / kPageVertices;
+    auto slot = slots_.find(page_number);
+    if (slot == slots_.end()) {
+      if (!Load(page_number)) {
+        return false;
+      }
+      slot = slots_.find(page_number);
+    }
+    Page& page = pages_[slot->second];
+    page.last_use = ++clock_;
+    position = page.positions[index % kPageVertices];
+    return true;
+  }
+
+ private:
+  static const size_t kPageVertices = 4096;
+  static const size_t kMaxPages = 256;  // 12 MB of positions
+
+  struct Page {
+    uint64_t number;
+    uint64_t last_use;
+    std::vector<glm::vec3> positions;
+  };
+
+  std::FILE* file_ = nullptr;
+  uint64_t offset_ = 0;
+  uint64_t count_ = 0;
+  std::vector<Page> pages_;
+  std::unordered_map<uint64_t, size_t> slots_;  // Page number -> pages_
+  uint64_t clock_ = 0;
+
+  bool Load(uint64_t page_number) {
+    size_t slot = pages_.size();
+    if (pages_.size() < kMaxPages) {
+      pages_.emplace_back();
+    } else {
+      slot = 0;
+      for (size_t i = 1; i < pages_.size(); i++) {
+        if (pages_[i].last_use < pages_[slot].last_use) {
+          slot = i;
+        }
+      }
+      slots_.erase(pages_[slot].number);
+    }
+    Page& page = pages_[slot];
+    const uint64_t first = page_number * kPageVertices;
+    page.number = page_number;
+    page.positions.resize(static_cast<size_t>(
+        std::min<uint64_t>(kPageVertices, count_ - first)));
+    if (!SeekTo(file_, offset_ + first * sizeof(glm::vec3)) ||
+        std::fread(page.positions.data(), sizeof(glm::vec3),
+                   page.positions.size(),
+                   file_) != page.positions.size()) {
+      pages_.erase(pages_.begin() + slot);
+      slots_.clear();
+      for (size_t i = 0; i < pages_.size(); i++) {
+        slots_[pages_[i].number] = i;
+      }
+      return false;
+    }
+    slots_[page_number] = slot;
+    return true;
+  }
+};
+
+// Triangles of a .dmesh file: faces read in order, corners through the
+// page cache on a second handle
+class BinaryMeshTriangleSource : public TriangleSource {
+ public:
+  ~BinaryMeshTriangleSource() override {
+    if (faces_file_ != nullptr) {
+      std::fclose(faces_file_);
+    }
+    if (vertices_file_ != nullptr) {
+      std::fclose(vertices_file_);
+    }
+  }
+
+  bool Open(const std::string& filepath) {
+    faces_file_ = std::fopen(filepath.c_str(), "rb");
+    vertices_file_ = std::fopen(filepath.c_str(), "rb");
+    BinaryHeader header;
+    if (faces_file_ == nullptr || vertices_file_ == nullptr ||
+        std::fread(&header, sizeof(header), 1, faces_file_) != 1 ||
+        std::memcmp(header.magic, kBinaryMagic, sizeof(kBinaryMagic)) != 0 ||
+        header.version != kBinaryVersion) {
+      return false;
+    }
+    face_count_ = header.face_count;
+    faces_offset_ = sizeof(header) + header.vertex_count * sizeof(glm::vec3);
+    vertices_ =
+        VertexPageCache(vertices_file_, sizeof(header), header.vertex_count);
+    return true;
+  }
+
+  bool Rewind() override {
+    next_face_ = 0;
+    failed_ = !SeekTo(faces_file_, faces_offset_);
+    return !failed_;
+  }
+
+  size_t Read(glm::vec3* corners, size_t max_triangles) override {
+    if (failed_) {
+      return 0;
+    }
+    faces_.resize(static_cast<size_t>(
+        std::min<uint64_t>(max_triangles, face_count_ - next_face_)));
+    if (std::fread(faces_.data(), sizeof(glm::uvec3), faces_.size(),
+                   faces_file_) != faces_.size()) {
+      failed_ = true;
+      return 0;
+    }
+    for (size_t t = 0; t < faces_.size(); t++) {
+      for (int k = 0; k < 3; k++) {
+        if (!vertices_.Get(faces_[t][k], corners[3 * t + k])) {
+          failed_ = true;
+          return 0;
+        }
+      }
+    }
+    next_face_ += faces_.size();
+    return faces_.size();
+  }
+
+  bool HasFailed() const override { return failed_; }
+
+ private:
+  std::FILE* faces_file_ = nullptr;
+  std::FILE* vertices_file_ = nullptr;
+  uint64_t face_count_ = 0;
+  uint64_t faces_offset_ = 0;
+  uint64_t next_face_ = 0;
+  VertexPageCache vertices_;
+  std::vector<glm::uvec3> faces_;
+  bool failed_ = false;
+};
+
+// Triangles of an OBJ file. Opening copies the positions to a temporary
+// binary file for the page cache; reading then parses the face lines.
+class ObjTriangleSource : public TriangleSource {
+ public:
+  typedef bool (*VertexParser)(const std::string&, glm::vec3&);
+  typedef bool (*FaceParser)(const std::string&, std::vector<glm::uvec3>&);
+
+  ObjTriangleSource(VertexParser parse_vertex, FaceParser parse_face)
+      : parse_vertex_(parse_vertex), parse_face_(parse_face) {}
+  ~ObjTriangleSource() override {
+    if (positions_file_ != nullptr) {
+      std::fclose(positions_file_);
+    }
+  }
+
+  bool Open(const std::string& filepath) {
+    file_.open(filepath);
+    positions_file_ = std::tmpfile();
+    if (!file_.is_open() || positions_file_ == nullptr) {
+      return false;
+    }
+    std::string line;
+    uint64_t count = 0;
+    glm::vec3 position;
+    while (std::getline(file_, line)) {
+      if (IsLine(line, 'v') && parse_vertex_(line, position)) {
+        if (std::fwrite(&position, sizeof(position), 1, positions_file_) !=
+            1) {
+          return false;
+        }
+        count++;
+      }
+    }
+    vertices_ = VertexPageCache(positions_file_, 0, count);
+    return std::fflush(positions_file_) == 0;
+  }
+
+  bool Rewind() override {
+    file_.clear();
+    file_.seekg(0);
+    pending_.clear();
+    next_pending_ = 0;
+    failed_ = !file_;
+    return !failed_;
+  }
+
+  size_t Read(glm::vec3* corners, size_t max_triangles) override {
+    size_t count = 0;
+    std::string line;
+    while (count < max_triangles && !failed_) {
+      if (next_pending_ < pending_.size()) {
+        const glm::uvec3& face = pending_[next_pending_++];
+        for (int k = 0; k < 3; k++) {
+          if (!vertices_.Get(face[k], corners[3 * count + k])) {
+            failed_ = true;
+            return 0;
+          }
+        }
+        count++;
+      } else if (std::getline(file_, line)) {
+        if (IsLine(line, 'f')) {
+          pending_.clear();
+          next_pending_ = 0;
+          parse_face_(line, pending_);
+        }
+      } else {
+        break;
+      }
+    }
+    return count;
+  }
+
+  bool HasFailed() const override { return failed_; }
+
+ private:
+  VertexParser parse_vertex_;
+  FaceParser parse_face_;
+  std::ifstream file_;
+  std::FILE* positions_file_ = nullptr;
+  VertexPageCache vertices_;
+  std::vector<glm::uvec3> pending_;  // Triangles of the current face line
+  size_t next_pending_ = 0;
+  bool failed_ = false;
+
+  // Whether line starts with the one-letter element type
+  static bool IsLine(const std::string& line, char type) {
+    return line.size() > 1 && line[0] == type &&
+           (line[1] == ' ' || line[1] == '\t');
+  }
+};
+}  // namespace
 
 std::shared_ptr<SimplificationMesh> MeshIO::LoadOBJ(const std::string& filepath) {
   // TODO: Implement OBJ file loading
   // Parse vertex positions, normals, texture coordinates, and faces
+  DECIMATOR_PROFILE_SCOPE("MeshIO.LoadOBJ");
   
   auto mesh = std::make_shared<SimplificationMesh>();
   std::ifstream file(filepath);
@@ -19,7 +308,9 @@ std::shared_ptr<SimplificationMesh> MeshIO::LoadOBJ(const std::string& filepath)
   }
   
   std::string line;
+  size_t line_count = 0;
   while (std::getline(file, line)) {
+    line_count++;
     if (line.empty() || line[0] == '#') continue;
     
     std::istringstream iss(line);
@@ -56,6 +347,8 @@ std::shared_ptr<SimplificationMesh> MeshIO::LoadOBJ(const std::string& filepath)
   }
   
   file.close();
+  DECIMATOR_COUNT("MeshIO.lines_parsed", line_count);
+  DECIMATOR_COUNT("MeshIO.faces_read", mesh->faces.size());
   
   // Compute normals if not provided
   if (mesh->normals.empty()) {
@@ -67,6 +360,7 @@ std::shared_ptr<SimplificationMesh> MeshIO::LoadOBJ(const std::string& filepath)
 
 bool MeshIO::SaveOBJ(const std::string& filepath, const SimplificationMesh& mesh) {
   // TODO: Implement OBJ file saving
+  DECIMATOR_PROFILE_SCOPE("MeshIO.SaveOBJ");
   std::ofstream file(filepath);
   
   if (!file.is_open()) {
@@ -107,10 +401,12 @@ bool MeshIO::SaveOBJ(const std::string& filepath, const SimplificationMesh& mesh
   }
   
   file.close();
+  DECIMATOR_COUNT("MeshIO.faces_written", mesh.faces.size());
   return true;
 }
 
 std::shared_ptr<SimplificationMesh> MeshIO::LoadMesh(const std::string& filepath) {
+  DECIMATOR_PROFILE_SCOPE("MeshIO.LoadMesh");
   auto mesh_result = MeshLoader::Import(filepath);
   
   if (mesh_result.vertex_obj == nullptr) {
@@ -125,6 +421,120 @@ std::shared_ptr<SimplificationMesh> MeshIO::LoadMesh(const std::string& filepath
   return mesh;
 }
 
+bool MeshIO::SaveBinary(const std::string& filepath,
+                        const SimplificationMesh& mesh) {
+  std::ofstream file(filepath, std::ios::binary);
+  if (!file.is_open()) {
+    std::cerr << "Failed to open file for writing: " << filepath << std::endl;
+    return false;
+  }
+  return WriteBinary(file, mesh);
+}
+
+std::shared_ptr<SimplificationMesh> MeshIO::LoadBinary(
+    const std::string& filepath) {
+  std::ifstream file(filepath, std::ios::binary);
+  if (!file.is_open()) {
+    std::cerr << "Failed to open binary mesh: " << filepath << std::endl;
+    return nullptr;
+  }
+  auto mesh = ReadBinary(file);
+  if (!mesh) {
+    std::cerr << "Invalid binary mesh: " << filepath << std::endl;
+  }
+  return mesh;
+}
+
+bool MeshIO::WriteBinary(std::ostream& os, const SimplificationMesh& mesh) {
+  DECIMATOR_PROFILE_SCOPE("MeshIO.WriteBinary");
+  BinaryHeader header;
+  std::memcpy(header.magic, kBinaryMagic, sizeof(kBinaryMagic));
+  header.version = kBinaryVersion;
+  header.vertex_count = mesh.vertices.size();
+  header.face_count = mesh.faces.size();
+  header.normal_count = mesh.normals.size();
+  header.color_count = mesh.colors.size();
+  header.texcoord_count = mesh.texcoords.size();
+  os.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  WriteArray(os, mesh.vertices);
+  WriteArray(os, mesh.faces);
+  WriteArray(os, mesh.normals);
+  WriteArray(os, mesh.colors);
+  WriteArray(os, mesh.texcoords);
+  DECIMATOR_COUNT("MeshIO.faces_written", mesh.faces.size());
+  return static_cast<bool>(os);
+}
+
+std::shared_ptr<SimplificationMesh> MeshIO::ReadBinary(std::istream& is) {
+  DECIMATOR_PROFILE_SCOPE("MeshIO.ReadBinary");
+  BinaryHeader header;
+  if (!is.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+      std::memcmp(header.magic, kBinaryMagic, sizeof(kBinaryMagic)) != 0 ||
+      header.version != kBinaryVersion) {
+    return nullptr;
+  }
+
+  // Reject truncated or corrupt files before allocating for their counts
+  const std::streampos start = is.tellg();
+  if (start != std::streampos(-1)) {
+    is.seekg(0, std::ios::end);
+    uint64_t available = static_cast<uint64_t>(is.tellg() - start);
+    is.seekg(start);
+    const uint64_t counts[5] = {header.vertex_count, header.face_count,
+                                header.normal_count, header.color_count,
+                                header.texcoord_count};
+    const uint64_t sizes[5] = {sizeof(glm::vec3), sizeof(glm::uvec3),
+                               sizeof(glm::vec3), sizeof(glm::vec3),
+                               sizeof(glm::vec2)};
+    for (int i = 0; i < 5; i++) {
+      if (counts[i] > available / sizes[i]) {
+        return nullptr;
+      }
+      available -= counts[i] * sizes[i];
+    }
+  }
+
+  auto mesh = std::make_shared<SimplificationMesh>();
+  if (!ReadArray(is, header.vertex_count, mesh->vertices) ||
+      !ReadArray(is, header.face_count, mesh->faces) ||
+      !ReadArray(is, header.normal_count, mesh->normals) ||
+      !ReadArray(is, header.color_count, mesh->colors) ||
+      !ReadArray(is, header.texcoord_count, mesh->texcoords)) {
+    return nullptr;
+  }
+  DECIMATOR_COUNT("MeshIO.faces_read", mesh->faces.size());
+  return mesh;
+}
+
+std::unique_ptr<TriangleSource> MeshIO::OpenTriangleStream(
+    const std::string& filepath) {
+  char magic[sizeof(kBinaryMagic)] = {};
+  {
+    std::ifstream file(filepath, std::ios::binary);
+    if (!file.is_open()) {
+      std::cerr << "Failed to open mesh: " << filepath << std::endl;
+      return nullptr;
+    }
+    file.read(magic, sizeof(magic));
+  }
+
+  if (std::memcmp(magic, kBinaryMagic, sizeof(kBinaryMagic)) == 0) {
+    auto source = make_unique<BinaryMeshTriangleSource>();
+    if (!source->Open(filepath)) {
+      std::cerr << "Invalid binary mesh: " << filepath << std::endl;
+      return nullptr;
+    }
+    return std::move(source);
+  }
+  auto source = make_unique<ObjTriangleSource>(&MeshIO::ParseVertex,
+                                               &MeshIO::ParseFace);
+  if (!source->Open(filepath)) {
+    std::cerr << "Failed to stream OBJ file: " << filepath << std::endl;
+    return nullptr;
+  }
+  return std::move(source);
+}
+
 bool MeshIO::ParseVertex(const std::string& line, glm::vec3& vertex) {
   // TODO: Parse "v x y z"
   std::istringstream iss(line);
@@ -1,9 +1,11 @@
 #ifndef MESH_IO_H_
 #define MESH_IO_H_
 
+#include <iosfwd>
 #include <string>
 #include <memory>
 #include "simplification/SimplificationMesh.hpp"
+#include "simplification/TriangleSource.hpp"
 
 namespace GLOO {
 
@@ -19,6 +21,26 @@ class MeshIO {
   // Load mesh using GLOO's MeshLoader (supports multiple formats)
   static std::shared_ptr<SimplificationMesh> LoadMesh(const std::string& filepath);
 
+  // Binary mesh format (.dmesh): a small header with the element counts,
+  // then every array as raw native-endian data. Loading is a few bulk
+  // reads, so it is far faster than OBJ, but files aren't portable across
+  // endianness.
+  static bool SaveBinary(const std::string& filepath,
+                         const SimplificationMesh& mesh);
+  static std::shared_ptr<SimplificationMesh> LoadBinary(
+      const std::string& filepath);
+  // Stream versions, for embedding a mesh in another file
+  static bool WriteBinary(std::ostream& os, const SimplificationMesh& mesh);
+  static std::shared_ptr<SimplificationMesh> ReadBinary(std::istream& is);
+
+  // Streams the triangles of a binary (.dmesh) or OBJ file without loading
+  // the mesh, e.g. for OutOfCoreClustering. Faces are read sequentially and
+  // their corners through a fixed-size cache of vertex pages (OBJ positions
+  // are first copied to a temporary binary file), so memory stays bounded
+  // however large the file is. Returns nullptr if the file can't be opened.
+  static std::unique_ptr<TriangleSource> OpenTriangleStream(
+      const std::string& filepath);
+
  private:
   // Helper for parsing OBJ lines
   static bool ParseVertex(const std::string& line, glm::vec3& vertex);
@@ -1,5 +1,7 @@
 #include "MeshSimplifierNode.hpp"
 #include "MeshIO.hpp"
+#include "Profiler.hpp"
+#include "helpers.hpp"
 
 #include "gloo/MeshLoader.hpp"
 #include "gloo/InputManager.hpp"
@@ -7,21 +9,40 @@
 #include "gloo/components/RenderingComponent.hpp"
 #include "gloo/components/ShadingComponent.hpp"
 #include "gloo/components/MaterialComponent.hpp"
+#include "gloo/debug/Tracer.hpp"
 
 // ImGui
 #include "imgui.h"
 #include <glm/gtc/quaternion.hpp>
 #include <glm/gtx/euler_angles.hpp>
 #include <glm/gtc/matrix_transform.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
 #include <iostream>
-#include <set>
 
 namespace GLOO {
+namespace {
+// Per-frame time budget for time-sliced simplification
+const std::chrono::milliseconds kFrameBudget(4);
+// How often a running session's partial result is shown. Each refresh
+// copies and uploads the whole mesh outside kFrameBudget, so it isn't done
+// every frame.
+const std::chrono::milliseconds kSessionDisplayInterval(500);
+}  // namespace
+
 MeshSimplifierNode::MeshSimplifierNode() {
   // Constructor - initialize simplification algorithms
   edge_collapse_ = make_unique<EdgeCollapse>();
   vertex_decimation_ = make_unique<VertexDecimation>();
   vertex_clustering_ = make_unique<VertexClustering>();
+
+  // DECIMATOR_CACHE_DIR=path (an existing directory) keeps results across
+  // sessions
+  const char* cache_directory = std::getenv("DECIMATOR_CACHE_DIR");
+  if (cache_directory != nullptr) {
+    result_cache_.SetDiskDirectory(cache_directory);
+  }
   
   // Initialize selection system
   selection_ = make_unique<MeshSelection>();
@@ -35,6 +56,7 @@ MeshSimplifierNode::MeshSimplifierNode() {
 }
 
 void MeshSimplifierNode::LoadMesh(const std::string& path) {
+  GLOO_TRACE_SCOPE("MeshSimplifierNode::LoadMesh");
   // Load mesh using MeshIO
   original_mesh_ = MeshIO::LoadMesh(path);
   
@@ -45,6 +67,9 @@ void MeshSimplifierNode::LoadMesh(const std::string& path) {
   
   // Set mesh for selection system
   selection_->SetMesh(original_mesh_);
+  progressive_mesh_.reset();
+  decimation_session_.reset();
+  original_hash_ = SimplificationCache::HashMesh(*original_mesh_);
   
   // Initialize simplified meshes to nullptr
   for (int i = 0; i < 3; i++) {
@@ -55,28 +80,12 @@ void MeshSimplifierNode::LoadMesh(const std::string& path) {
 }
 
 void MeshSimplifierNode::SimplifyWithCurrentMethod() {
+  GLOO_TRACE_SCOPE("MeshSimplifierNode::SimplifyWithCurrentMethod");
   if (!original_mesh_) {
     return;
   }
   
-  int method_idx = static_cast<int>(current_method_);
-  
-  // Apply the selected simplification method
-  switch (current_method_) {
-    case SimplificationMethod::EDGE_COLLAPSE:
-      simplified_meshes_[method_idx] = 
-          edge_collapse_->SimplifyByFactor(*original_mesh_, target_reduction_);
-      break;
-    case SimplificationMethod::VERTEX_DECIMATION:
-      simplified_meshes_[method_idx] = 
-          vertex_decimation_->SimplifyByFactor(*original_mesh_, target_reduction_);
-      break;
-    case SimplificationMethod::VERTEX_CLUSTERING:
-      // Use grid resolution directly for Vertex Clustering
-      simplified_meshes_[method_idx] = 
-          vertex_clustering_->Simplify(*original_mesh_, grid_resolution_);
-      break;
-  }
+  SimplifyMethod(current_method_);
   
   // Automatically switch to showing simplified mesh after simplification
   show_original_ = false;
@@ -84,24 +93,130 @@ void MeshSimplifierNode::SimplifyWithCurrentMethod() {
 }
 
 void MeshSimplifierNode::SimplifyAllMethods() {
+  GLOO_TRACE_SCOPE("MeshSimplifierNode::SimplifyAllMethods");
   if (!original_mesh_) {
     return;
   }
   
-  simplified_meshes_[0] = 
-      edge_collapse_->SimplifyByFactor(*original_mesh_, target_reduction_);
-  simplified_meshes_[1] = 
-      vertex_decimation_->SimplifyByFactor(*original_mesh_, target_reduction_);
-  // Use grid resolution directly for Vertex Clustering
-  simplified_meshes_[2] = 
-      vertex_clustering_->Simplify(*original_mesh_, grid_resolution_);
+  SimplifyMethod(SimplificationMethod::EDGE_COLLAPSE);
+  SimplifyMethod(SimplificationMethod::VERTEX_DECIMATION);
+  SimplifyMethod(SimplificationMethod::VERTEX_CLUSTERING);
   
   // Automatically switch to showing simplified mesh after simplification
   show_original_ = false;
   UpdateMeshDisplay();
 }
 
+void MeshSimplifierNode::SimplifyMethod(SimplificationMethod method) {
+  const int method_idx = static_cast<int>(method);
+  const std::string key = GetCacheKey(method);
+  auto cached = result_cache_.Get(key);
+  if (cached) {
+    if (method == SimplificationMethod::VERTEX_DECIMATION) {
+      decimation_session_.reset();
+    }
+    simplified_meshes_[method_idx] = cached;
+    return;
+  }
+
+  // Apply the simplification method
+  switch (method) {
+    case SimplificationMethod::EDGE_COLLAPSE:
+      simplified_meshes_[method_idx] = ExtractEdgeCollapseLOD();
+      break;
+    case SimplificationMethod::VERTEX_DECIMATION:
+      SimplifyVertexDecimation();
+      if (decimation_session_) {
+        // Cached by StepDecimationSession once it finishes
+        decimation_cache_key_ = key;
+        return;
+      }
+      break;
+    case SimplificationMethod::VERTEX_CLUSTERING:
+      // Use grid resolution directly for Vertex Clustering
+      simplified_meshes_[method_idx] = 
+          vertex_clustering_->Simplify(*original_mesh_, grid_resolution_);
+      break;
+  }
+  result_cache_.Put(key, simplified_meshes_[method_idx]);
+}
+
+std::string MeshSimplifierNode::GetCacheKey(SimplificationMethod method) const {
+  // Targets match SimplifyByFactor
+  const int target_vertex_count =
+      static_cast<int>(original_mesh_->vertices.size() * target_reduction_);
+  switch (method) {
+    case SimplificationMethod::EDGE_COLLAPSE:
+      return SimplificationCache::MakeKey(
+          original_hash_, "EdgeCollapse",
+          "vertices=" + std::to_string(target_vertex_count) + " " +
+              edge_collapse_->GetSettingsKey());
+    case SimplificationMethod::VERTEX_DECIMATION:
+      return SimplificationCache::MakeKey(
+          original_hash_, "VertexDecimation",
+          "vertices=" + std::to_string(target_vertex_count) + " " +
+              vertex_decimation_->GetSettingsKey());
+    case SimplificationMethod::VERTEX_CLUSTERING:
+    default:
+      return SimplificationCache::MakeKey(
+          original_hash_, "VertexClustering",
+          "grid=" + std::to_string(grid_resolution_) + " " +
+              vertex_clustering_->GetSettingsKey());
+  }
+}
+
+std::shared_ptr<SimplificationMesh> MeshSimplifierNode::ExtractEdgeCollapseLOD() {
+  if (!progressive_mesh_) {
+    progressive_mesh_ = edge_collapse_->BuildProgressiveMesh(*original_mesh_);
+  }
+  // Same target as EdgeCollapse::SimplifyByFactor
+  progressive_mesh_->SetVertexCount(static_cast<size_t>(
+      original_mesh_->vertices.size() * target_reduction_));
+  return std::make_shared<SimplificationMesh>(progressive_mesh_->Extract());
+}
+
+void MeshSimplifierNode::SimplifyVertexDecimation() {
+  const int method_idx = static_cast<int>(SimplificationMethod::VERTEX_DECIMATION);
+  if (!time_sliced_) {
+    decimation_session_.reset();
+    simplified_meshes_[method_idx] =
+        vertex_decimation_->SimplifyByFactor(*original_mesh_, target_reduction_);
+    return;
+  }
+  // Same target as VertexDecimation::SimplifyByFactor; Update() advances it
+  decimation_session_ = vertex_decimation_->BeginSession(
+      *original_mesh_,
+      static_cast<int>(original_mesh_->vertices.size() * target_reduction_));
+  simplified_meshes_[method_idx] = decimation_session_->GetResult();
+  session_display_time_ = std::chrono::steady_clock::now();
+}
+
+void MeshSimplifierNode::StepDecimationSession() {
+  GLOO_TRACE_SCOPE("MeshSimplifierNode::StepDecimationSession");
+  decimation_session_->Step(std::chrono::steady_clock::now() + kFrameBudget);
+  // Show the partial result now and then so progress is visible while it
+  // runs, and the final one as soon as it is done
+  const auto now = std::chrono::steady_clock::now();
+  if (!decimation_session_->IsDone() &&
+      now - session_display_time_ < kSessionDisplayInterval) {
+    return;
+  }
+  session_display_time_ = now;
+  simplified_meshes_[static_cast<int>(SimplificationMethod::VERTEX_DECIMATION)] =
+      decimation_session_->GetResult();
+  if (current_method_ == SimplificationMethod::VERTEX_DECIMATION) {
+    UpdateMeshDisplay();
+  }
+  if (decimation_session_->IsDone()) {
+    result_cache_.Put(decimation_cache_key_,
+                      simplified_meshes_[static_cast<int>(
+                          SimplificationMethod::VERTEX_DECIMATION)]);
+    decimation_session_.reset();
+  }
+}
+
 void MeshSimplifierNode::UpdateMeshDisplay() {
+  GLOO_TRACE_SCOPE("MeshSimplifierNode::UpdateMeshDisplay");
   auto current_mesh = GetCurrentDisplayMesh();
   
   if (!current_mesh || current_mesh->IsEmpty()) {
@@ -111,30 +226,16 @@ void MeshSimplifierNode::UpdateMeshDisplay() {
   // Create a VertexObject with lines for edges (wireframe)
   auto vertex_obj = std::make_shared<VertexObject>();
   
-  // Extract all edges from faces and create line list
-  auto positions = make_unique<PositionArray>();
-  std::set<std::pair<int, int>> edges;
-  
-  // Build unique edge list
-  for (const auto& face : current_mesh->faces) {
-    auto add_edge = [&](int v1, int v2) {
-      if (v1 > v2) std::swap(v1, v2);
-      edges.insert({v1, v2});
-    };
-    add_edge(face.x, face.y);
-    add_edge(face.y, face.z);
-    add_edge(face.z, face.x);
-  }
-  
-  // Create line list (2 vertices per edge)
-  auto indices = make_unique<IndexArray>();
-  for (const auto& edge : edges) {
-    unsigned int idx = positions->size();
-    positions->push_back(current_mesh->vertices[edge.first]);
-    positions->push_back(current_mesh->vertices[edge.second]);
-    indices->push_back(idx);
-    indices->push_back(idx + 1);
-  }
+  // Extract all edges from faces and create line list (2 vertices per edge)
+  std::vector<MeshEdge> edges = current_mesh->GetUniqueEdges();
+  auto positions = make_unique<PositionArray>(edges.size() * 2);
+  auto indices = make_unique<IndexArray>(edges.size() * 2);
+  ParallelFor(edges.size(), [&](size_t i) {
+    (*positions)[2 * i] = current_mesh->vertices[edges[i].v1];
+    (*positions)[2 * i + 1] = current_mesh->vertices[edges[i].v2];
+    (*indices)[2 * i] = static_cast<unsigned int>(2 * i);
+    (*indices)[2 * i + 1] = static_cast<unsigned int>(2 * i + 1);
+  });
   
   if (positions->empty()) {
     return;
@@ -189,9 +290,14 @@ void MeshSimplifierNode::Update(double delta_time) {
   if (enable_selection_) {
     HandleMouseSelection();
   }
+
+  if (decimation_session_) {
+    StepDecimationSession();
+  }
   
   // Render ImGui controls
   RenderUI();
+  RenderProfilerUI();
 }
 
 void MeshSimplifierNode::HandleKeyInput() {
@@ -287,6 +393,91 @@ void MeshSimplifierNode::RenderUI() {
   ImGui::End();
 }
 
+void MeshSimplifierNode::RenderProfilerUI() {
+  // Opens beside the controls window the first time; ImGui remembers it
+  ImGui::SetNextWindowPos(ImVec2(480.0f, 60.0f), ImGuiCond_FirstUseEver);
+  if (ImGui::Begin("Profiler")) {
+    // Timeline tracing works regardless of the profiling build flag
+    if (ImGui::Button(Tracer::IsRecording() ? "Stop Trace" : "Start Trace")) {
+      if (Tracer::IsRecording()) {
+        Tracer::Stop();
+      } else {
+        Tracer::Start();
+      }
+    }
+    ImGui::SameLine();
+    if (ImGui::Button("Write trace.json")) {
+      if (Tracer::WriteJson("trace.json")) {
+        std::cout << "Wrote trace.json" << std::endl;
+      }
+    }
+    ImGui::Separator();
+
+    if (!Profiler::IsEnabled()) {
+      ImGui::TextUnformatted("Profiling is compiled out.");
+      ImGui::TextUnformatted("Reconfigure with -DDECIMATOR_PROFILING=ON.");
+      ImGui::End();
+      return;
+    }
+
+    if (ImGui::Button("Reset")) {
+      Profiler::Reset();
+    }
+    ImGui::SameLine();
+    if (ImGui::Button("Dump JSON")) {
+      if (Profiler::WriteJson("profile.json")) {
+        std::cout << "Wrote profile.json" << std::endl;
+      }
+    }
+
+    Profiler::Snapshot snapshot = Profiler::GetSnapshot();
+    ImGui::Text("Threads seen: %zu", snapshot.thread_slots);
+
+    ImGui::Separator();
+    ImGui::Columns(5, "profiler_timers");
+    ImGui::TextUnformatted("Timer");
+    ImGui::NextColumn();
+    ImGui::TextUnformatted("Calls");
+    ImGui::NextColumn();
+    ImGui::TextUnformatted("Total ms");
+    ImGui::NextColumn();
+    ImGui::TextUnformatted("Avg ms");
+    ImGui::NextColumn();
+    ImGui::TextUnformatted("Max ms");
+    ImGui::NextColumn();
+    ImGui::Separator();
+    for (const auto& timer : snapshot.timers) {
+      ImGui::TextUnformatted(timer.name.c_str());
+      ImGui::NextColumn();
+      ImGui::Text("%llu", static_cast<unsigned long long>(timer.calls));
+      ImGui::NextColumn();
+      ImGui::Text("%.3f", timer.total_ms);
+      ImGui::NextColumn();
+      ImGui::Text("%.3f", timer.calls ? timer.total_ms / timer.calls : 0.0);
+      ImGui::NextColumn();
+      ImGui::Text("%.3f", timer.max_ms);
+      ImGui::NextColumn();
+    }
+    ImGui::Columns(1);
+
+    ImGui::Separator();
+    ImGui::Columns(2, "profiler_counters");
+    ImGui::TextUnformatted("Counter");
+    ImGui::NextColumn();
+    ImGui::TextUnformatted("Value");
+    ImGui::NextColumn();
+    ImGui::Separator();
+    for (const auto& counter : snapshot.counters) {
+      ImGui::TextUnformatted(counter.name.c_str());
+      ImGui::NextColumn();
+      ImGui::Text("%llu", static_cast<unsigned long long>(counter.value));
+      ImGui::NextColumn();
+    }
+    ImGui::Columns(1);
+  }
+  ImGui::End();
+}
+
 void MeshSimplifierNode::RenderMethodControls() {
   ImGui::TextUnformatted("Simplification Method");
   
@@ -309,8 +500,21 @@ void MeshSimplifierNode::RenderMethodControls() {
                 grid_resolution_, grid_resolution_, grid_resolution_,
                 grid_resolution_ * grid_resolution_ * grid_resolution_);
   } else {
-    ImGui::SliderFloat("Target Reduction", &target_reduction_, 0.01f, 0.99f);
+    if (ImGui::SliderFloat("Target Reduction", &target_reduction_, 0.01f, 0.99f) &&
+        current_method_ == SimplificationMethod::EDGE_COLLAPSE &&
+        progressive_mesh_) {
+      // Scrub the recorded collapse sequence instead of re-simplifying
+      simplified_meshes_[0] = ExtractEdgeCollapseLOD();
+      UpdateMeshDisplay();
+    }
     ImGui::Text("Keep %.1f%% of vertices", target_reduction_ * 100.0f);
+    if (current_method_ == SimplificationMethod::VERTEX_DECIMATION) {
+      ImGui::Checkbox("Time-sliced (4 ms/frame)", &time_sliced_);
+      if (decimation_session_) {
+        ImGui::Text("Decimating... %d vertices left",
+                    decimation_session_->GetVertexCount());
+      }
+    }
   }
   
   if (ImGui::Button("Simplify Current Method (R)")) {
@@ -335,6 +539,8 @@ void MeshSimplifierNode::RenderMethodControls() {
                 simplified_meshes_[method_idx]->GetVertexCount(),
                 simplified_meshes_[method_idx]->GetFaceCount());
   }
+  ImGui::Text("Cached results: %zu (%.1f MB)", result_cache_.GetEntryCount(),
+              result_cache_.GetSizeBytes() / (1024.0 * 1024.0));
 }
 
 void MeshSimplifierNode::RenderDisplayControls() {
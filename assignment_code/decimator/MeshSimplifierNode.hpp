@@ -7,7 +7,9 @@
 #include "simplification/VertexDecimation.hpp"
 #include "simplification/VertexClustering.hpp"
 #include "MeshSelection.hpp"
+#include "SimplificationCache.hpp"
 #include "WireframeRenderer.hpp"
+#include <chrono>
 #include <memory>
 
 namespace GLOO {
@@ -28,6 +30,18 @@ class MeshSimplifierNode : public SceneNode {
   std::shared_ptr<SimplificationMesh> original_mesh_;
   std::shared_ptr<SimplificationMesh> simplified_meshes_[3];  // One for each method
   SimplificationMethod current_method_ = SimplificationMethod::EDGE_COLLAPSE;
+  // Full edge collapse sequence of original_mesh_, recorded on the first
+  // edge collapse so the reduction slider can scrub LODs without re-running
+  std::shared_ptr<ProgressiveMesh> progressive_mesh_;
+  // In-progress time-sliced vertex decimation, advanced once per frame
+  std::unique_ptr<VertexDecimation::Session> decimation_session_;
+  std::string decimation_cache_key_;  // Where the session's result goes
+  // When the session's partial result was last shown
+  std::chrono::steady_clock::time_point session_display_time_;
+  // Finished results by mesh content and parameters, so re-running a
+  // method with unchanged settings is a lookup
+  SimplificationCache result_cache_;
+  uint64_t original_hash_ = 0;  // SimplificationCache::HashMesh of original
   
   // Simplification algorithms
   std::unique_ptr<EdgeCollapse> edge_collapse_;
@@ -43,6 +57,7 @@ class MeshSimplifierNode : public SceneNode {
   bool enable_selection_ = false;
   float target_reduction_ = 0.5f;
   int grid_resolution_ = 10;  // For Vertex Clustering method
+  bool time_sliced_ = false;  // Spread vertex decimation over frames
   
   // UI state
   glm::vec3 ui_pos_ = glm::vec3(0.0f);
@@ -57,6 +72,11 @@ class MeshSimplifierNode : public SceneNode {
   void LoadMesh(const std::string& path);
   void SimplifyWithCurrentMethod();
   void SimplifyAllMethods();
+  void SimplifyMethod(SimplificationMethod method);
+  std::string GetCacheKey(SimplificationMethod method) const;
+  std::shared_ptr<SimplificationMesh> ExtractEdgeCollapseLOD();
+  void SimplifyVertexDecimation();
+  void StepDecimationSession();
   void UpdateMeshDisplay();
   void SyncFromTransform();
   
@@ -70,6 +90,7 @@ class MeshSimplifierNode : public SceneNode {
   void RenderDisplayControls();
   void RenderSelectionControls();
   void RenderFileControls();
+  void RenderProfilerUI();
   
   // File operations
   void SaveCurrentMesh();
@@ -0,0 +1,221 @@
+#include "Profiler.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+
+namespace GLOO {
+
+namespace {
+
+// Written only by the owning thread; atomics (with relaxed loads/stores)
+// just make concurrent snapshots well-defined.
+struct ThreadSlots {
+  std::atomic<uint64_t> timer_ns[Profiler::kMaxTimers];
+  std::atomic<uint64_t> timer_calls[Profiler::kMaxTimers];
+  std::atomic<uint64_t> timer_max_ns[Profiler::kMaxTimers];
+  std::atomic<uint64_t> counters[Profiler::kMaxCounters];
+
+  ThreadSlots() { Clear(); }
+
+  void Clear() {
+    for (int i = 0; i < Profiler::kMaxTimers; i++) {
+      timer_ns[i].store(0, std::memory_order_relaxed);
+      timer_calls[i].store(0, std::memory_order_relaxed);
+      timer_max_ns[i].store(0, std::memory_order_relaxed);
+    }
+    for (int i = 0; i < Profiler::kMaxCounters; i++) {
+      counters[i].store(0, std::memory_order_relaxed);
+    }
+  }
+};
+
+struct Registry {
+  std::mutex mutex;
+  std::vector<std::string> timer_names;
+  std::vector<std::string> counter_names;
+  std::vector<std::unique_ptr<ThreadSlots>> slots;
+  std::vector<ThreadSlots*> free_slots;
+};
+
+// Intentionally leaked so thread-exit handlers can run after static
+// destruction has started.
+Registry& GetRegistry() {
+  static Registry* registry = new Registry();
+  return *registry;
+}
+
+// Hands the thread's slots back to the registry when the thread exits.
+struct SlotHandle {
+  ThreadSlots* slots = nullptr;
+
+  ~SlotHandle() {
+    if (slots != nullptr) {
+      Registry& registry = GetRegistry();
+      std::lock_guard<std::mutex> lock(registry.mutex);
+      registry.free_slots.push_back(slots);
+    }
+  }
+};
+
+thread_local SlotHandle local_handle;
+
+ThreadSlots& LocalSlots() {
+  if (local_handle.slots == nullptr) {
+    Registry& registry = GetRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    if (!registry.free_slots.empty()) {
+      local_handle.slots = registry.free_slots.back();
+      registry.free_slots.pop_back();
+    } else {
+      registry.slots.emplace_back(new ThreadSlots());
+      local_handle.slots = registry.slots.back().get();
+    }
+  }
+  return *local_handle.slots;
+}
+
+void Accumulate(std::atomic<uint64_t>& slot, uint64_t amount) {
+  slot.store(slot.load(std::memory_order_relaxed) + amount,
+             std::memory_order_relaxed);
+}
+
+int Register(std::vector<std::string>& names, const char* name, int capacity) {
+  std::lock_guard<std::mutex> lock(GetRegistry().mutex);
+  for (size_t i = 0; i < names.size(); i++) {
+    if (names[i] == name) {
+      return static_cast<int>(i);
+    }
+  }
+  if (static_cast<int>(names.size()) >= capacity) {
+    std::cerr << "Profiler: too many entries, ignoring " << name << std::endl;
+    return -1;
+  }
+  names.push_back(name);
+  return static_cast<int>(names.size() - 1);
+}
+
+}  // namespace
+
+int Profiler::RegisterTimer(const char* name) {
+  return Register(GetRegistry().timer_names, name, kMaxTimers);
+}
+
+int Profiler::RegisterCounter(const char* name) {
+  return Register(GetRegistry().counter_names, name, kMaxCounters);
+}
+
+void Profiler::AddTime(int timer_id, uint64_t nanoseconds) {
+  if (timer_id < 0) {
+    return;
+  }
+  ThreadSlots& slots = LocalSlots();
+  Accumulate(slots.timer_ns[timer_id], nanoseconds);
+  Accumulate(slots.timer_calls[timer_id], 1);
+  if (nanoseconds > slots.timer_max_ns[timer_id].load(std::memory_order_relaxed)) {
+    slots.timer_max_ns[timer_id].store(nanoseconds, std::memory_order_relaxed);
+  }
+}
+
+void Profiler::AddCount(int counter_id, uint64_t amount) {
+  if (counter_id < 0) {
+    return;
+  }
+  Accumulate(LocalSlots().counters[counter_id], amount);
+}
+
+Profiler::Snapshot Profiler::GetSnapshot() {
+  Registry& registry = GetRegistry();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+
+  Snapshot snapshot;
+  snapshot.thread_slots = registry.slots.size();
+  for (size_t t = 0; t < registry.timer_names.size(); t++) {
+    TimerStats stats = {registry.timer_names[t], 0, 0.0, 0.0};
+    uint64_t total_ns = 0;
+    uint64_t max_ns = 0;
+    for (const auto& slots : registry.slots) {
+      total_ns += slots->timer_ns[t].load(std::memory_order_relaxed);
+      stats.calls += slots->timer_calls[t].load(std::memory_order_relaxed);
+      max_ns = std::max<uint64_t>(
+          max_ns, slots->timer_max_ns[t].load(std::memory_order_relaxed));
+    }
+    stats.total_ms = total_ns / 1e6;
+    stats.max_ms = max_ns / 1e6;
+    snapshot.timers.push_back(stats);
+  }
+  for (size_t c = 0; c < registry.counter_names.size(); c++) {
+    CounterStats stats = {registry.counter_names[c], 0};
+    for (const auto& slots : registry.slots) {
+      stats.value += slots->counters[c].load(std::memory_order_relaxed);
+    }
+    snapshot.counters.push_back(stats);
+  }
+
+  std::sort(snapshot.timers.begin(), snapshot.timers.end(),
+            [](const TimerStats& a, const TimerStats& b) {
+              return a.name < b.name;
+            });
+  std::sort(snapshot.counters.begin(), snapshot.counters.end(),
+            [](const CounterStats& a, const CounterStats& b) {
+              return a.name < b.name;
+            });
+  return snapshot;
+}
+
+void Profiler::Reset() {
+  Registry& registry = GetRegistry();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+  for (const auto& slots : registry.slots) {
+    slots->Clear();
+  }
+}
+
+bool Profiler::IsEnabled() {
+#ifdef DECIMATOR_PROFILING
+  return true;
+#else
+  return false;
+#endif
+}
+
+std::string Profiler::ToJson() {
+  Snapshot snapshot = GetSnapshot();
+  std::ostringstream os;
+  os << "{\n";
+  os << "  \"enabled\": " << (IsEnabled() ? "true" : "false") << ",\n";
+  os << "  \"thread_slots\": " << snapshot.thread_slots << ",\n";
+  os << "  \"timers\": [";
+  for (size_t i = 0; i < snapshot.timers.size(); i++) {
+    const TimerStats& t = snapshot.timers[i];
+    os << (i ? ",\n" : "\n") << "    {\"name\": \"" << t.name
+       << "\", \"calls\": " << t.calls << ", \"total_ms\": " << t.total_ms
+       << ", \"avg_ms\": " << (t.calls ? t.total_ms / t.calls : 0.0)
+       << ", \"max_ms\": " << t.max_ms << "}";
+  }
+  os << "\n  ],\n";
+  os << "  \"counters\": [";
+  for (size_t i = 0; i < snapshot.counters.size(); i++) {
+    const CounterStats& c = snapshot.counters[i];
+    os << (i ? ",\n" : "\n") << "    {\"name\": \"" << c.name
+       << "\", \"value\": " << c.value << "}";
+  }
+  os << "\n  ]\n}\n";
+  return os.str();
+}
+
+bool Profiler::WriteJson(const std::string& filepath) {
+  std::ofstream file(filepath);
+  if (!file.is_open()) {
+    std::cerr << "Failed to open file for writing: " << filepath << std::endl;
+    return false;
+  }
+  file << ToJson();
+  return true;
+}
+
+}  // namespace GLOO
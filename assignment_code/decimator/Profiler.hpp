@@ -0,0 +1,116 @@
+#ifndef PROFILER_H_
+#define PROFILER_H_
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "gloo/debug/Tracer.hpp"
+
+namespace GLOO {
+
+// Lightweight hot-path instrumentation: named scoped timers and counters.
+//
+// Each thread accumulates into its own slot array (plain relaxed stores, no
+// locking or contended atomics on the hot path); GetSnapshot() sums all
+// slots. Slots of exited threads are recycled, so short-lived workers keep
+// contributing to the totals without growing the registry.
+//
+// Use the DECIMATOR_PROFILE_SCOPE / DECIMATOR_COUNT macros rather than the
+// class directly: they compile to nothing unless DECIMATOR_PROFILING is
+// defined (see the CMake option of the same name). Profiled scopes are also
+// recorded as slices while the Tracer is running.
+class Profiler {
+ public:
+  static const int kMaxTimers = 64;
+  static const int kMaxCounters = 128;
+
+  struct TimerStats {
+    std::string name;
+    uint64_t calls;
+    double total_ms;
+    double max_ms;
+  };
+
+  struct CounterStats {
+    std::string name;
+    uint64_t value;
+  };
+
+  struct Snapshot {
+    std::vector<TimerStats> timers;      // Sorted by name
+    std::vector<CounterStats> counters;  // Sorted by name
+    size_t thread_slots;
+  };
+
+  // Returns the id for name, registering it on first use (-1 when full).
+  static int RegisterTimer(const char* name);
+  static int RegisterCounter(const char* name);
+
+  static void AddTime(int timer_id, uint64_t nanoseconds);
+  static void AddCount(int counter_id, uint64_t amount);
+
+  // Totals over all threads.
+  static Snapshot GetSnapshot();
+  static void Reset();
+
+  static bool IsEnabled();
+  static std::string ToJson();
+  static bool WriteJson(const std::string& filepath);
+};
+
+class ScopedTimer {
+ public:
+  ScopedTimer(int timer_id, const char* name)
+      : timer_id_(timer_id), name_(name),
+        start_(std::chrono::steady_clock::now()) {
+    Tracer::Begin(name_);
+  }
+  ~ScopedTimer() {
+    Tracer::End(name_);
+    auto elapsed = std::chrono::steady_clock::now() - start_;
+    Profiler::AddTime(
+        timer_id_,
+        std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+  }
+
+  ScopedTimer(const ScopedTimer&) = delete;
+  ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+ private:
+  int timer_id_;
+  const char* name_;
+  std::chrono::steady_clock::time_point start_;
+};
+
+}  // namespace GLOO
+
+#define DECIMATOR_PROFILE_CONCAT_INNER(a, b) a##b
+#define DECIMATOR_PROFILE_CONCAT(a, b) DECIMATOR_PROFILE_CONCAT_INNER(a, b)
+
+#ifdef DECIMATOR_PROFILING
+// Times the rest of the enclosing scope under `name` (a string literal).
+#define DECIMATOR_PROFILE_SCOPE(name)                                   \
+  static const int DECIMATOR_PROFILE_CONCAT(profile_timer_id_, __LINE__) = \
+      ::GLOO::Profiler::RegisterTimer(name);                            \
+  ::GLOO::ScopedTimer DECIMATOR_PROFILE_CONCAT(profile_timer_, __LINE__)( \
+      DECIMATOR_PROFILE_CONCAT(profile_timer_id_, __LINE__), name)
+// Adds `amount` to the counter `name` (a string literal).
+#define DECIMATOR_COUNT(name, amount)                                      \
+  do {                                                                     \
+    static const int profile_counter_id =                                  \
+        ::GLOO::Profiler::RegisterCounter(name);                           \
+    ::GLOO::Profiler::AddCount(profile_counter_id,                         \
+                               static_cast<uint64_t>(amount));             \
+  } while (0)
+#else
+#define DECIMATOR_PROFILE_SCOPE(name) \
+  do {                                \
+  } while (0)
+#define DECIMATOR_COUNT(name, amount) \
+  do {                                \
+  } while (0)
+#endif
+
+#endif
@@ -0,0 +1,313 @@
+#include "SimplificationCache.hpp"
+#include "MeshIO.hpp"
+#include "Profiler.hpp"
+#include "helpers.hpp"
+
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <random>
+
+namespace GLOO {
+namespace {
+const uint64_t kHashSeed = 0xcbf29ce484222325ULL;
+const size_t kHashBlockBytes = size_t(1) << 20;
+// Salts the keys of the disk tier. Bump it whenever a simplifier's output
+// or the cache file layout changes, so files written by older builds are
+// no longer found.
+const int kDiskCacheVersion = 2;
+
+uint64_t Mix(uint64_t hash, uint64_t word) {
+  hash = (hash ^ word) * 0x9e3779b97f4a7c15ULL;
+  return hash ^ (hash >> 29);
+}
+
+uint64_t HashBytes(const unsigned char* data, size_t size, uint64_t hash) {
+  size_t i = 0;
+  for (; i + 8 <= size; i += 8) {
+    uint64_t word;
+    std::memcpy(&word, data + i, 8);
+    hash = Mix(hash, word);
+  }
+  // data may be null when size is 0 (an empty attribute array)
+  uint64_t tail = 0;
+  if (i < size) {
+    std::memcpy(&tail, data + i, size - i);
+  }
+  return Mix(hash, tail ^ size);
+}
+
+// Block hashes are computed in parallel, then hashed in order
+template <typename T>
+uint64_t HashArray(const std::vector<T>& values, uint64_t hash) {
+  const auto* data = reinterpret_cast<const unsigned char*>(values.data());
+  const size_t size = values.size() * sizeof(T);
+  const size_t block_count = (size + kHashBlockBytes - 1) / kHashBlockBytes;
+  std::vector<uint64_t> block_hashes(block_count);
+  ParallelFor(block_count, [&](size_t b) {
+    const size_t begin = b * kHashBlockBytes;
+    block_hashes[b] = HashBytes(
+        data + begin, std::min(kHashBlockBytes, size - begin), kHashSeed);
+  });
+  return HashBytes(reinterpret_cast<const unsigned char*>(block_hashes.data()),
+                   block_count * sizeof(uint64_t), Mix(hash, size));
+}
+
+std::string ToHex(uint64_t value) {
+  char buffer[17];
+  std::snprintf(buffer, sizeof(buffer), "%016llx",
+                static_cast<unsigned long long>(value));
+  return buffer;
+}
+
+// Temporary file suffix no other writer uses: a per-process random id
+// (batch jobs may share the directory) plus a per-write counter
+std::string GetUniqueTempSuffix() {
+  static const uint64_t process_id = [] {
+    std::random_device device;
+    return (static_cast<uint64_t>(device()) << 32) ^ device();
+  }();
+  static std::atomic<uint64_t> write_count(0);
+  return ToHex(process_id) + "-" + std::to_string(write_count++);
+}
+
+// Key a result is stored under on disk
+std::string GetDiskKey(const std::string& key) {
+  return "v" + std::to_string(kDiskCacheVersion) + " " + key;
+}
+}  // namespace
+
+SimplificationCache::SimplificationCache(size_t capacity_bytes)
+    : capacity_bytes_(capacity_bytes) {}
+
+uint64_t SimplificationCache::HashMesh(const SimplificationMesh& mesh) {
+  DECIMATOR_PROFILE_SCOPE("SimplificationCache.HashMesh");
+  uint64_t hash = kHashSeed;
+  hash = HashArray(mesh.vertices, hash);
+  hash = HashArray(mesh.faces, hash);
+  hash = HashArray(mesh.normals, hash);
+  hash = HashArray(mesh.colors, hash);
+  hash = HashArray(mesh.texcoords, hash);
+  return hash;
+}
+
+std::string SimplificationCache::MakeKey(uint64_t mesh_hash,
+                                         const std::string& method,
+                                         const std::string& parameters) {
+  return ToHex(mesh_hash) + " " + method + " " + parameters;
+}
+
+std::shared_ptr<SimplificationMesh> SimplificationCache::Get(
+    const std::string& key) {
+  std::string disk_directory;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = index_.find(key);
+    if (it != index_.end()) {
+      entries_.splice(entries_.begin(), entries_, it->second);
+      DECIMATOR_COUNT("SimplificationCache.memory_hits", 1);
+      return it->second->mesh;
+    }
+    disk_directory = disk_directory_;
+  }
+  if (disk_directory.empty()) {
+    DECIMATOR_COUNT("SimplificationCache.misses", 1);
+    return nullptr;
+  }
+
+  // Read without holding the lock; another thread may insert the same key
+  // meanwhile, in which case Insert keeps the newer copy
+  auto mesh = LoadFromDisk(key);
+  if (!mesh) {
+    DECIMATOR_COUNT("SimplificationCache.misses", 1);
+    return nullptr;
+  }
+  DECIMATOR_COUNT("SimplificationCache.disk_hits", 1);
+  std::lock_guard<std::mutex> lock(mutex_);
+  Insert(key, mesh);
+  return mesh;
+}
+
+void SimplificationCache::Put(
+    const std::string& key, const std::shared_ptr<SimplificationMesh>& mesh) {
+  if (!mesh) {
+    return;
+  }
+  std::string disk_directory;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Insert(key, mesh);
+    disk_directory = disk_directory_;
+  }
+  if (!disk_directory.empty()) {
+    SaveToDisk(key, *mesh);
+  }
+}
+
+std::shared_ptr<SimplificationMesh> SimplificationCache::GetOrCompute(
+    const std::string& key,
+    const std::function<std::shared_ptr<SimplificationMesh>()>& compute) {
+  auto mesh = Get(key);
+  if (!mesh) {
+    mesh = compute();
+    Put(key, mesh);
+  }
+  return mesh;
+}
+
+void SimplificationCache::Remove(const std::string& key) {
+  std::string path;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = index_.find(key);
+    if (it != index_.end()) {
+      size_bytes_ -= it->second->bytes;
+      entries_.erase(it->second);
+      index_.erase(it);
+    }
+    if (!disk_directory_.empty()) {
+      path = GetDiskPath(key);
+    }
+  }
+  if (!path.empty()) {
+    std::remove(path.c_str());
+  }
+}
+
+void SimplificationCache::SetDiskDirectory(const std::string& directory) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  disk_directory_ = directory;
+}
+
+void SimplificationCache::SetCapacity(size_t capacity_bytes) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  capacity_bytes_ = capacity_bytes;
+  Evict();
+}
+
+void SimplificationCache::Clear() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  entries_.clear();
+  index_.clear();
+  size_bytes_ = 0;
+}
+
+size_t SimplificationCache::GetEntryCount() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return entries_.size();
+}
+
+size_t SimplificationCache::GetSizeBytes() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return size_bytes_;
+}
+
+size_t SimplificationCache::GetMeshBytes(const SimplificationMesh& mesh) {
+  return mesh.vertices.size() * sizeof(glm::vec3) +
+         mesh.faces.size() * sizeof(glm::uvec3) +
+         mesh.normals.size() * sizeof(glm::vec3) +
+         mesh.colors.size() * sizeof(glm::vec3) +
+         mesh.texcoords.size() * sizeof(glm::vec2);
+}
+
+std::string SimplificationCache::GetDiskPath(const std::string& key) const {
+  // Keys hold arbitrary parameter text, so files are named by its hash
+  const std::string disk_key = GetDiskKey(key);
+  std::vector<char> bytes(disk_key.begin(), disk_key.end());
+  uint64_t hash = HashArray(bytes, kHashSeed);
+  return disk_directory_ + "/" + ToHex(hash) + ".dmesh";
+}
+
+std::shared_ptr<SimplificationMesh> SimplificationCache::LoadFromDisk(
+    const std::string& key) const {
+  std::string path;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    path = GetDiskPath(key);
+  }
+  std::ifstream file(path, std::ios::binary);
+  if (!file.is_open()) {
+    return nullptr;
+  }
+  // The full key precedes the mesh, so file name collisions (and files of
+  // other cache versions) are detected
+  const std::string disk_key = GetDiskKey(key);
+  uint64_t key_size = 0;
+  if (!file.read(reinterpret_cast<char*>(&key_size), sizeof(key_size)) ||
+      key_size != disk_key.size()) {
+    return nullptr;
+  }
+  std::string stored_key(disk_key.size(), '\0');
+  if (!file.read(&stored_key[0],
+                 static_cast<std::streamsize>(disk_key.size())) ||
+      stored_key != disk_key) {
+    return nullptr;
+  }
+  return MeshIO::ReadBinary(file);
+}
+
+void SimplificationCache::SaveToDisk(const std::string& key,
+                                     const SimplificationMesh& mesh) const {
+  std::string path;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    path = GetDiskPath(key);
+  }
+  // Written under a temporary name of its own and renamed, so readers never
+  // see a partial file and concurrent writers of the same key don't write
+  // into one file
+  const std::string temp_path = path + "." + GetUniqueTempSuffix() + ".tmp";
+  {
+    std::ofstream file(temp_path, std::ios::binary);
+    if (!file.is_open()) {
+      std::cerr << "Failed to open file for writing: " << temp_path
+                << std::endl;
+      return;
+    }
+    const std::string disk_key = GetDiskKey(key);
+    const uint64_t key_size = disk_key.size();
+    file.write(reinterpret_cast<const char*>(&key_size), sizeof(key_size));
+    file.write(disk_key.data(), static_cast<std::streamsize>(disk_key.size()));
+    if (!MeshIO::WriteBinary(file, mesh)) {
+      std::cerr << "Failed to write cache file: " << temp_path << std::endl;
+      file.close();
+      std::remove(temp_path.c_str());
+      return;
+    }
+  }
+  if (std::rename(temp_path.c_str(), path.c_str()) != 0) {
+    std::remove(temp_path.c_str());
+  }
+}
+
+void SimplificationCache::Insert(
+    const std::string& key, const std::shared_ptr<SimplificationMesh>& mesh) {
+  auto it = index_.find(key);
+  if (it != index_.end()) {
+    size_bytes_ -= it->second->bytes;
+    entries_.erase(it->second);
+    index_.erase(it);
+  }
+  const size_t bytes = GetMeshBytes(*mesh);
+  if (bytes > capacity_bytes_) {
+    // Would evict everything else; only the disk tier keeps it
+    return;
+  }
+  entries_.push_front(Entry{key, mesh, bytes});
+  index_[key] = entries_.begin();
+  size_bytes_ += bytes;
+  Evict();
+}
+
+void SimplificationCache::Evict() {
+  while (size_bytes_ > capacity_bytes_ && !entries_.empty()) {
+    size_bytes_ -= entries_.back().bytes;
+    index_.erase(entries_.back().key);
+    entries_.pop_back();
+    DECIMATOR_COUNT("SimplificationCache.evictions", 1);
+  }
+}
+
+}  // namespace GLOO
@@ -0,0 +1,87 @@
+#ifndef SIMPLIFICATION_CACHE_H_
+#define SIMPLIFICATION_CACHE_H_
+
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include "simplification/SimplificationMesh.hpp"
+
+namespace GLOO {
+
+// Results of simplification runs, keyed by the content of the input mesh
+// plus the algorithm and its parameters (see MakeKey). Recently used
+// results are kept in memory up to a byte budget, least recently used
+// first out. With a disk directory set, every stored result is also
+// written there in the binary mesh format (MeshIO::SaveBinary), so later
+// sessions and batch runs find it too. Disk keys carry a cache version, so
+// results of builds with a different one are ignored.
+//
+// Cached meshes are shared between callers and must be treated as
+// read-only.
+class SimplificationCache {
+ public:
+  explicit SimplificationCache(size_t capacity_bytes = size_t(256) << 20);
+
+  // Content hash of positions, faces, normals, colors and texture
+  // coordinates (input normals feed the attribute quadrics, so they are
+  // part of the input). Hashes fixed-size blocks in parallel; the result
+  // doesn't depend on the worker count.
+  static uint64_t HashMesh(const SimplificationMesh& mesh);
+  // parameters must name every setting that affects the output.
+  static std::string MakeKey(uint64_t mesh_hash, const std::string& method,
+                             const std::string& parameters);
+
+  // Returns nullptr on a miss. Memory is checked first, then disk; disk
+  // hits are promoted to memory.
+  std::shared_ptr<SimplificationMesh> Get(const std::string& key);
+  void Put(const std::string& key,
+           const std::shared_ptr<SimplificationMesh>& mesh);
+  std::shared_ptr<SimplificationMesh> GetOrCompute(
+      const std::string& key,
+      const std::function<std::shared_ptr<SimplificationMesh>()>& compute);
+
+  // Drops key from memory and, with a disk directory set, from disk
+  void Remove(const std::string& key);
+
+  // Existing directory for the disk tier; empty (the default) disables it.
+  void SetDiskDirectory(const std::string& directory);
+  void SetCapacity(size_t capacity_bytes);
+  // Empties the memory tier (files on disk are kept)
+  void Clear();
+
+  size_t GetEntryCount() const;
+  size_t GetSizeBytes() const;
+
+ private:
+  struct Entry {
+    std::string key;
+    std::shared_ptr<SimplificationMesh> mesh;
+    size_t bytes;
+  };
+
+  static size_t GetMeshBytes(const SimplificationMesh& mesh);
+  std::string GetDiskPath(const std::string& key) const;
+  std::shared_ptr<SimplificationMesh> LoadFromDisk(
+      const std::string& key) const;
+  void SaveToDisk(const std::string& key,
+                  const SimplificationMesh& mesh) const;
+  // Callers hold mutex_
+  void Insert(const std::string& key,
+              const std::shared_ptr<SimplificationMesh>& mesh);
+  void Evict();
+
+  mutable std::mutex mutex_;
+  std::list<Entry> entries_;  // Most recently used first
+  std::unordered_map<std::string, std::list<Entry>::iterator> index_;
+  size_t capacity_bytes_;
+  size_t size_bytes_ = 0;
+  std::string disk_directory_;
+};
+
+}  // namespace GLOO
+
+#endif
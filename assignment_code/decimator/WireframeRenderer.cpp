@@ -4,7 +4,7 @@
 #include "gloo/shaders/SimpleShader.hpp"
 #include "gloo/shaders/PhongShader.hpp"
 #include "gloo/gl_wrapper/BindGuard.hpp"
-#include <unordered_set>
+#include "helpers.hpp"
 
 namespace GLOO {
 
@@ -74,34 +74,15 @@ void WireframeRenderer::UpdateSolidMesh() {
 
 void WireframeRenderer::CreateEdgeList(const SimplificationMesh& mesh,
                                         std::vector<glm::vec3>& edge_vertices) {
-  // TODO: Extract edges from faces
-  // Use a set to avoid duplicates
-  struct EdgeHash {
-    size_t operator()(const std::pair<int, int>& e) const {
-      return std::hash<int>()(e.first) ^ (std::hash<int>()(e.second) << 1);
-    }
-  };
-  
-  std::unordered_set<std::pair<int, int>, EdgeHash> edges;
-  
-  for (const auto& face : mesh.faces) {
-    // Add three edges of the triangle
-    auto add_edge = [&](int v1, int v2) {
-      if (v1 > v2) std::swap(v1, v2);
-      edges.insert({v1, v2});
-    };
-    
-    add_edge(face.x, face.y);
-    add_edge(face.y, face.z);
-    add_edge(face.z, face.x);
-  }
+  // Unique edges come sorted from a radix sort over packed edge keys
+  std::vector<MeshEdge> edges = mesh.GetUniqueEdges();
   
   // Convert edges to line segments (each edge = 2 vertices)
-  edge_vertices.reserve(edges.size() * 2);
-  for (const auto& edge : edges) {
-    edge_vertices.push_back(mesh.vertices[edge.first]);
-    edge_vertices.push_back(mesh.vertices[edge.second]);
-  }
+  edge_vertices.resize(edges.size() * 2);
+  ParallelFor(edges.size(), [&](size_t i) {
+    edge_vertices[2 * i] = mesh.vertices[edges[i].v1];
+    edge_vertices[2 * i + 1] = mesh.vertices[edges[i].v2];
+  });
 }
 
 void WireframeRenderer::SetSelectedVertices(const std::vector<int>& indices) {
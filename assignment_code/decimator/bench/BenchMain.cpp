@@ -0,0 +1,1095 @@
+// decimator_bench: headless benchmark for the simplifiers and mesh I/O.
+//
+// Runs every phase over a ladder of synthetic meshes built by MeshGenerator
+// (1k to 10M triangles by default, for each requested shape), repeats each
+// measurement and writes wall time (median / p95), throughput, peak RSS and
+// output size per phase as JSON, so results can be diffed across commits.
+//
+// Usage:
+//   decimator_bench [--sizes 1000,10000,...] [--shapes icosphere,terrain,...]
+//                   [--seed N] [--runs N] [--reduction F]
+//                   [--grid N]
+//                   [--phases save,load,edge,edge_parallel,decimation,...]
+//                   (also edge_memoryless, edge_multiple_choice,
+//                   edge_virtual_pairs, edge_attributes,
+//                   edge_dary_heap, edge_radix_heap, decimation_dary_heap,
+//                   decimation_radix_heap, edge_partitioned,
+//                   decimation_partitioned, out_of_core)
+//                   [--cap phase=max_faces] [--no-caps] [--out file.json]
+//                   [--threads N] [--label text] [--profile file.json]
+//                   [--simd scalar|sse2|avx2]
+//
+// --profile dumps the Profiler totals (per-phase timers and counters inside
+// the simplifiers) accumulated over the whole run; it needs a build with
+// DECIMATOR_PROFILING. --simd caps the GeometryKernels level (the default
+// is the best the CPU supports) to compare the kernel versions.
+//
+// A phase that fails (e.g. its output or input file can't be written or read
+// back) is reported, left out of the JSON, and makes the exit status 1.
+//
+// The check_* phases (not run by default) fail when results that should
+// agree don't:
+//   check_parallel_workers  edge_parallel with 1 worker and with 4
+//   check_queue_backends    edge and decimation on every queue backend
+//                           (on a slightly jittered copy of the mesh, as
+//                           the backends may break exact cost ties
+//                           differently)
+//   check_progressive_mesh  edge's LOD from a progressive mesh (after
+//                           going down to the coarsest LOD and back) and
+//                           edge itself
+//   check_session_resume    edge and decimation, and the same runs as
+//                           sessions stepped with expired deadlines
+//   check_cache             edge, and its SimplificationCache hits from
+//                           memory and (in the working directory) disk
+//   check_partitioned_manifold
+//                           edge_partitioned and decimation_partitioned
+//                           with 2, 4 and 16 blocks add no edge used by
+//                           more than two faces
+//   check_decimation_error  decimation with no target and tolerances of
+//                           0.01 and 0.002 stays within them of every input
+//                           vertex (brute force, so capped at 100k faces)
+
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <random>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#if defined(_WIN32)
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+#include "helpers.hpp"
+#include "MeshIO.hpp"
+#include "Profiler.hpp"
+#include "SimplificationCache.hpp"
+#include "simplification/SimplificationMesh.hpp"
+#include "simplification/MeshGenerator.hpp"
+#include "simplification/EdgeCollapse.hpp"
+#include "simplification/VertexDecimation.hpp"
+#include "simplification/VertexClustering.hpp"
+#include "simplification/PartitionedSimplifier.hpp"
+#include "simplification/OutOfCoreClustering.hpp"
+#include "simplification/GeometryKernels.hpp"
+#include "simplification/OneRing.hpp"
+
+using namespace GLOO;
+
+namespace {
+
+// Edges sampled per step by edge_multiple_choice (as in [WK02])
+const int kMultipleChoiceCandidates = 8;
+// Pair distance of edge_virtual_pairs, in MeshGenerator units (shapes are
+// about 2 across)
+const float kVirtualPairDistance = 0.01f;
+// Attribute weight of edge_attributes
+const float kAttributeWeight = 0.01f;
+// Worker counts check_parallel_workers compares
+const unsigned int kCheckWorkerCounts[] = {1, 4};
+// Largest vertex offset check_queue_backends adds, in MeshGenerator units
+const float kCheckJitter = 1e-4f;
+// Block counts check_partitioned_manifold tries (capped by the mesh size)
+const int kCheckBlockCounts[] = {2, 4, 16};
+// Tolerances check_decimation_error runs decimation with, and the float
+// rounding of the bounds and distances it allows on top, relative to the
+// tolerance
+const float kCheckMaxDistances[] = {0.01f, 0.002f};
+const float kCheckDistanceSlack = 1e-3f;
+
+// Phases that differ only in the simplifier's queue backend; the fastest
+// one per simplifier, shape and size is summarized after the run
+struct QueuePhase {
+  const char* phase;
+  const char* simplifier;
+  const char* backend;
+};
+const QueuePhase kQueuePhases[] = {
+    {"edge", "edge", "binary_heap"},
+    {"edge_dary_heap", "edge", "dary_heap"},
+    {"edge_radix_heap", "edge", "radix_heap"},
+    {"decimation", "decimation", "binary_heap"},
+    {"decimation_dary_heap", "decimation", "dary_heap"},
+    {"decimation_radix_heap", "decimation", "radix_heap"},
+};
+
+struct BenchOptions {
+  std::vector<size_t> sizes = {1000, 10000, 100000, 1000000, 10000000};
+  std::vector<MeshGenerator::Shape> shapes = {MeshGenerator::Shape::ICOSPHERE};
+  uint32_t seed = 1;
+  std::vector<std::string> phases = {"save",       "load",
+                                     "edge",       "edge_parallel",
+                                     "decimation", "clustering"};
+  // Largest input (in faces) each phase is run on. The queue-driven
+  // simplifiers are serial and take minutes at 10M; edge_parallel isn't.
+  std::map<std::string, size_t> caps = {{"decimation", 1000000},
+                                        {"edge", 1000000},
+                                        {"edge_memoryless", 1000000},
+                                        {"edge_multiple_choice", 1000000},
+                                        {"edge_virtual_pairs", 1000000},
+                                        {"edge_attributes", 1000000},
+                                        {"edge_dary_heap", 1000000},
+                                        {"edge_radix_heap", 1000000},
+                                        {"decimation_dary_heap", 1000000},
+                                        {"decimation_radix_heap", 1000000},
+                                        {"check_parallel_workers", 1000000},
+                                        {"check_queue_backends", 1000000},
+                                        {"check_progressive_mesh", 1000000},
+                                        {"check_session_resume", 1000000},
+                                        {"check_cache", 1000000},
+                                        {"check_partitioned_manifold",
+                                         1000000},
+                                        {"check_decimation_error", 100000}};
+  int runs = 5;
+  float reduction = 0.5f;
+  int grid_resolution = 32;
+  unsigned int threads = 0;
+  GeometryKernels::SimdLevel simd_level =
+      GeometryKernels::GetSupportedSimdLevel();
+  std::string out_path = "bench_results.json";
+  std::string label;
+  std::string profile_path;
+};
+
+struct PhaseResult {
+  std::string phase;
+  std::string shape;
+  size_t input_vertices = 0;
+  size_t input_faces = 0;
+  std::vector<double> samples_ms;
+  double median_ms = 0.0;
+  double p95_ms = 0.0;
+  double min_ms = 0.0;
+  double faces_per_second = 0.0;
+  size_t peak_rss_bytes = 0;
+  size_t output_vertices = 0;
+  size_t output_faces = 0;
+  size_t output_bytes = 0;
+  float max_error = 0.0f;
+  bool failed = false;  // A run could not produce its output
+};
+
+// Fastest queue backend of one simplifier on one input
+struct FastestQueue {
+  std::string simplifier;
+  std::string shape;
+  size_t input_faces = 0;
+  std::string backend;
+  double median_ms = 0.0;
+  int backends_run = 0;
+};
+
+// Output of a single run of a phase.
+struct PhaseOutput {
+  size_t vertices = 0;
+  size_t faces = 0;
+  size_t bytes = 0;
+  float max_error = 0.0f;  // Simplifier's report, if the phase has one
+  bool failed = false;     // E.g. its input file could not be opened
+};
+
+// Peak RSS is process-wide. On Linux the high-water mark can be reset
+// between phases through /proc/self/clear_refs, which makes it per-phase;
+// elsewhere it is the peak since process start.
+void ResetPeakRSS() {
+#if defined(__linux__)
+  std::ofstream clear_refs("/proc/self/clear_refs");
+  if (clear_refs.is_open()) {
+    clear_refs << "5";
+  }
+#endif
+}
+
+size_t GetPeakRSSBytes() {
+#if defined(_WIN32)
+  PROCESS_MEMORY_COUNTERS counters;
+  if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+    return static_cast<size_t>(counters.PeakWorkingSetSize);
+  }
+  return 0;
+#else
+#if defined(__linux__)
+  std::ifstream status("/proc/self/status");
+  std::string line;
+  while (std::getline(status, line)) {
+    if (line.compare(0, 6, "VmHWM:") == 0) {
+      return static_cast<size_t>(std::atoll(line.c_str() + 6)) * 1024;
+    }
+  }
+#endif
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+#if defined(__APPLE__)
+  return static_cast<size_t>(usage.ru_maxrss);
+#else
+  return static_cast<size_t>(usage.ru_maxrss) * 1024;
+#endif
+#endif
+}
+
+size_t FileSize(const std::string& path) {
+  std::ifstream file(path, std::ios::binary | std::ios::ate);
+  return file.is_open() ? static_cast<size_t>(file.tellg()) : 0;
+}
+
+PhaseResult RunPhase(const std::string& phase,
+                     const SimplificationMesh& mesh,
+                     int runs,
+                     const std::function<PhaseOutput()>& body) {
+  PhaseResult result;
+  result.phase = phase;
+  result.input_vertices = mesh.GetVertexCount();
+  result.input_faces = mesh.GetFaceCount();
+
+  ResetPeakRSS();
+  for (int run = 0; run < runs; run++) {
+    auto start = std::chrono::steady_clock::now();
+    PhaseOutput output = body();
+    auto end = std::chrono::steady_clock::now();
+    if (output.failed) {
+      result.failed = true;
+      return result;
+    }
+    result.samples_ms.push_back(
+        std::chrono::duration<double, std::milli>(end - start).count());
+    result.output_vertices = output.vertices;
+    result.output_faces = output.faces;
+    result.output_bytes = output.bytes;
+    result.max_error = output.max_error;
+  }
+  result.peak_rss_bytes = GetPeakRSSBytes();
+
+  std::vector<double> sorted = result.samples_ms;
+  std::sort(sorted.begin(), sorted.end());
+  size_t n = sorted.size();
+  result.min_ms = sorted.front();
+  result.median_ms = n % 2 ? sorted[n / 2]
+                           : 0.5 * (sorted[n / 2 - 1] + sorted[n / 2]);
+  // Nearest-rank percentile.
+  size_t p95_rank = static_cast<size_t>(std::ceil(0.95 * n));
+  result.p95_ms = sorted[std::max<size_t>(p95_rank, 1) - 1];
+  if (result.median_ms > 0.0) {
+    result.faces_per_second = result.input_faces / (result.median_ms / 1000.0);
+  }
+  return result;
+}
+
+PhaseOutput Describe(const std::shared_ptr<SimplificationMesh>& mesh,
+                     const SimplificationReport* report = nullptr) {
+  PhaseOutput output;
+  if (mesh) {
+    output.vertices = mesh->GetVertexCount();
+    output.faces = mesh->GetFaceCount();
+    output.bytes = output.vertices * sizeof(glm::vec3) +
+                   output.faces * sizeof(glm::uvec3);
+  }
+  if (report != nullptr) {
+    output.max_error = report->max_error;
+  }
+  return output;
+}
+
+// Output of a check_* phase: the compared result, or a failure naming what
+// didn't match
+PhaseOutput CheckResult(const std::shared_ptr<SimplificationMesh>& expected,
+                        const std::shared_ptr<SimplificationMesh>& actual,
+                        const std::string& what) {
+  if (!expected || !actual || expected->vertices != actual->vertices ||
+      expected->faces != actual->faces) {
+    std::cerr << "  mismatch: " << what << std::endl;
+    PhaseOutput output;
+    output.failed = true;
+    return output;
+  }
+  return Describe(actual);
+}
+
+// Faces of mesh as corner positions, each rotated to start at its smallest
+// corner (keeping the winding) and sorted, for comparing meshes whose
+// vertices are numbered differently
+std::vector<std::array<float, 9>> GetFaceCorners(
+    const SimplificationMesh& mesh) {
+  std::vector<std::array<float, 9>> corners;
+  corners.reserve(mesh.faces.size());
+  for (const glm::uvec3& face : mesh.faces) {
+    std::array<std::array<float, 3>, 3> points;
+    for (int c = 0; c < 3; c++) {
+      const glm::vec3& v = mesh.vertices[face[c]];
+      points[c] = {{v.x, v.y, v.z}};
+    }
+    std::rotate(points.begin(),
+                std::min_element(points.begin(), points.end()),
+                points.end());
+    std::array<float, 9> flat;
+    for (int c = 0; c < 3; c++) {
+      std::copy(points[c].begin(), points[c].end(), flat.begin() + 3 * c);
+    }
+    corners.push_back(flat);
+  }
+  std::sort(corners.begin(), corners.end());
+  return corners;
+}
+
+// Like CheckResult, for meshes that may number their vertices differently
+PhaseOutput CheckFaces(const std::shared_ptr<SimplificationMesh>& expected,
+                       const std::shared_ptr<SimplificationMesh>& actual,
+                       const std::string& what) {
+  if (!expected || !actual ||
+      expected->vertices.size() != actual->vertices.size() ||
+      GetFaceCorners(*expected) != GetFaceCorners(*actual)) {
+    std::cerr << "  mismatch: " << what << std::endl;
+    PhaseOutput output;
+    output.failed = true;
+    return output;
+  }
+  return Describe(actual);
+}
+
+// Number of edges of mesh used by more than two faces
+size_t CountNonManifoldEdges(const SimplificationMesh& mesh) {
+  std::vector<std::pair<unsigned int, unsigned int>> edges;
+  edges.reserve(3 * mesh.faces.size());
+  for (const glm::uvec3& face : mesh.faces) {
+    for (int c = 0; c < 3; c++) {
+      const unsigned int a = face[c];
+      const unsigned int b = face[(c + 1) % 3];
+      edges.emplace_back(std::min(a, b), std::max(a, b));
+    }
+  }
+  std::sort(edges.begin(), edges.end());
+  size_t count = 0;
+  for (size_t i = 0; i < edges.size();) {
+    size_t end = i + 1;
+    while (end < edges.size() && edges[end] == edges[i]) {
+      end++;
+    }
+    if (end - i > 2) {
+      count++;
+    }
+    i = end;
+  }
+  return count;
+}
+
+// Largest distance from a vertex of input's faces to the nearest face of
+// output, by brute force. Only distances above limit are exact: a vertex
+// first tries the faces whose bounds, grown by limit, share its grid cell,
+// and stops at one within limit; the others test every face.
+float GetMaxDistanceToSurface(const SimplificationMesh& input,
+                              const SimplificationMesh& output, float limit) {
+  std::vector<uint8_t> used(input.vertices.size(), 0);
+  for (const glm::uvec3& face : input.faces) {
+    used[face.x] = used[face.y] = used[face.z] = 1;
+  }
+  const size_t face_count = output.faces.size();
+  std::vector<glm::vec3> min_bounds(face_count);
+  std::vector<glm::vec3> max_bounds(face_count);
+  glm::vec3 grid_min(std::numeric_limits<float>::max());
+  glm::vec3 grid_max(-std::numeric_limits<float>::max());
+  float mean_extent = 0.0f;
+  for (size_t f = 0; f < face_count; f++) {
+    const glm::uvec3& face = output.faces[f];
+    const glm::vec3& a = output.vertices[face.x];
+    const glm::vec3& b = output.vertices[face.y];
+    const glm::vec3& c = output.vertices[face.z];
+    min_bounds[f] = glm::min(glm::min(a, b), c) - glm::vec3(limit);
+    max_bounds[f] = glm::max(glm::max(a, b), c) + glm::vec3(limit);
+    grid_min = glm::min(grid_min, min_bounds[f]);
+    grid_max = glm::max(grid_max, max_bounds[f]);
+    const glm::vec3 extent = max_bounds[f] - min_bounds[f];
+    mean_extent += std::max(extent.x, std::max(extent.y, extent.z));
+  }
+
+  // Cells about the size of a face, at most kCells a side
+  const int kCells = 128;
+  const float cell_size =
+      face_count > 0 ? std::max(mean_extent / face_count,
+                                glm::length(grid_max - grid_min) / kCells)
+                     : 1.0f;
+  glm::ivec3 dims(1);
+  for (int axis = 0; axis < 3 && face_count > 0; axis++) {
+    dims[axis] = std::min(
+        kCells, static_cast<int>((grid_max[axis] - grid_min[axis]) /
+                                 cell_size) + 1);
+  }
+  auto get_cell = [&](const glm::vec3& p) {
+    glm::ivec3 cell = glm::ivec3((p - grid_min) / cell_size);
+    return glm::clamp(cell, glm::ivec3(0), dims - 1);
+  };
+  std::vector<std::vector<uint32_t>> cells(
+      static_cast<size_t>(dims.x) * dims.y * dims.z);
+  for (size_t f = 0; f < face_count; f++) {
+    const glm::ivec3 lo = get_cell(min_bounds[f]);
+    const glm::ivec3 hi = get_cell(max_bounds[f]);
+    for (int z = lo.z; z <= hi.z; z++) {
+      for (int y = lo.y; y <= hi.y; y++) {
+        for (int x = lo.x; x <= hi.x; x++) {
+          cells[(static_cast<size_t>(z) * dims.y + y) * dims.x + x].push_back(
+              static_cast<uint32_t>(f));
+        }
+      }
+    }
+  }
+
+  auto get_distance = [&](const glm::vec3& p, size_t f) {
+    const glm::uvec3& face = output.faces[f];
+    return PointTriangleDistance(p, output.vertices[face.x],
+                                 output.vertices[face.y],
+                                 output.vertices[face.z]);
+  };
+  std::vector<float> distances(input.vertices.size(), 0.0f);
+  ParallelFor(input.vertices.size(), [&](size_t v) {
+    if (!used[v]) return;
+    const glm::vec3& p = input.vertices[v];
+    const glm::ivec3 cell = get_cell(p);
+    for (uint32_t f :
+         cells[(static_cast<size_t>(cell.z) * dims.y + cell.y) * dims.x +
+               cell.x]) {
+      if (glm::all(glm::greaterThanEqual(p, min_bounds[f])) &&
+          glm::all(glm::lessThanEqual(p, max_bounds[f]))) {
+        const float distance = get_distance(p, f);
+        if (distance <= limit) {
+          distances[v] = distance;
+          return;
+        }
+      }
+    }
+    float nearest = std::numeric_limits<float>::max();
+    for (size_t f = 0; f < face_count; f++) {
+      nearest = std::min(nearest, get_distance(p, f));
+    }
+    distances[v] = nearest;
+  });
+  return distances.empty()
+             ? 0.0f
+             : *std::max_element(distances.begin(), distances.end());
+}
+
+// Same target as SimplifyByFactor, so phases can also get a report
+SimplificationBudget ReductionBudget(const SimplificationMesh& mesh,
+                                     float reduction) {
+  return SimplificationBudget::Vertices(
+      static_cast<int>(mesh.vertices.size() * reduction));
+}
+
+// Groups the kQueuePhases results by simplifier, shape and input size;
+// only groups where more than one backend ran are returned
+std::vector<FastestQueue> FindFastestQueues(
+    const std::vector<PhaseResult>& results) {
+  std::vector<FastestQueue> groups;
+  for (const PhaseResult& r : results) {
+    for (const QueuePhase& queue_phase : kQueuePhases) {
+      if (r.phase != queue_phase.phase) {
+        continue;
+      }
+      FastestQueue* group = nullptr;
+      for (FastestQueue& g : groups) {
+        if (g.simplifier == queue_phase.simplifier && g.shape == r.shape &&
+            g.input_faces == r.input_faces) {
+          group = &g;
+        }
+      }
+      if (group == nullptr) {
+        groups.emplace_back();
+        group = &groups.back();
+        group->simplifier = queue_phase.simplifier;
+        group->shape = r.shape;
+        group->input_faces = r.input_faces;
+      }
+      if (group->backends_run == 0 || r.median_ms < group->median_ms) {
+        group->backend = queue_phase.backend;
+        group->median_ms = r.median_ms;
+      }
+      group->backends_run++;
+    }
+  }
+  std::vector<FastestQueue> fastest;
+  for (const FastestQueue& g : groups) {
+    if (g.backends_run > 1) {
+      fastest.push_back(g);
+    }
+  }
+  return fastest;
+}
+
+std::string JsonEscape(const std::string& s) {
+  std::string out;
+  for (char c : s) {
+    if (c == '"' || c == '\\') out += '\\';
+    out += c;
+  }
+  return out;
+}
+
+void WriteJson(std::ostream& os, const BenchOptions& options,
+               const std::vector<PhaseResult>& results,
+               const std::vector<FastestQueue>& fastest_queues) {
+  char date[64];
+  std::time_t now = std::time(nullptr);
+  std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%SZ", std::gmtime(&now));
+
+  os << "{\n";
+  os << "  \"benchmark\": \"decimator_bench\",\n";
+  os << "  \"label\": \"" << JsonEscape(options.label) << "\",\n";
+  os << "  \"timestamp\": \"" << date << "\",\n";
+  os << "  \"threads\": " << GetParallelWorkerCount() << ",\n";
+  os << "  \"simd\": \""
+     << GeometryKernels::GetSimdLevelName(GeometryKernels::GetSimdLevel())
+     << "\",\n";
+  os << "  \"seed\": " << options.seed << ",\n";
+  os << "  \"runs\": " << options.runs << ",\n";
+  os << "  \"reduction\": " << options.reduction << ",\n";
+  os << "  \"grid_resolution\": " << options.grid_resolution << ",\n";
+  os << "  \"results\": [";
+  for (size_t i = 0; i < results.size(); i++) {
+    const PhaseResult& r = results[i];
+    os << (i ? ",\n" : "\n") << "    {";
+    os << "\"phase\": \"" << r.phase << "\", ";
+    os << "\"shape\": \"" << r.shape << "\", ";
+    os << "\"input_vertices\": " << r.input_vertices << ", ";
+    os << "\"input_faces\": " << r.input_faces << ", ";
+    os << "\"median_ms\": " << r.median_ms << ", ";
+    os << "\"p95_ms\": " << r.p95_ms << ", ";
+    os << "\"min_ms\": " << r.min_ms << ", ";
+    os << "\"faces_per_second\": " << r.faces_per_second << ", ";
+    os << "\"peak_rss_bytes\": " << r.peak_rss_bytes << ", ";
+    os << "\"output_vertices\": " << r.output_vertices << ", ";
+    os << "\"output_faces\": " << r.output_faces << ", ";
+    os << "\"output_bytes\": " << r.output_bytes << ", ";
+    os << "\"max_error\": " << r.max_error << ", ";
+    os << "\"samples_ms\": [";
+    for (size_t s = 0; s < r.samples_ms.size(); s++) {
+      os << (s ? ", " : "") << r.samples_ms[s];
+    }
+    os << "]}";
+  }
+  os << "\n  ],\n";
+  os << "  \"fastest_queues\": [";
+  for (size_t i = 0; i < fastest_queues.size(); i++) {
+    const FastestQueue& f = fastest_queues[i];
+    os << (i ? ",\n" : "\n") << "    {";
+    os << "\"simplifier\": \"" << f.simplifier << "\", ";
+    os << "\"shape\": \"" << f.shape << "\", ";
+    os << "\"input_faces\": " << f.input_faces << ", ";
+    os << "\"backend\": \"" << f.backend << "\", ";
+    os << "\"median_ms\": " << f.median_ms << "}";
+  }
+  os << "\n  ]\n}\n";
+}
+
+std::vector<std::string> SplitList(const std::string& s) {
+  std::vector<std::string> items;
+  std::stringstream ss(s);
+  std::string item;
+  while (std::getline(ss, item, ',')) {
+    if (!item.empty()) items.push_back(item);
+  }
+  return items;
+}
+
+bool ParseOptions(int argc, char** argv, BenchOptions& options) {
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    auto next = [&](std::string& value) {
+      if (i + 1 >= argc) {
+        std::cerr << "Missing value for " << arg << std::endl;
+        return false;
+      }
+      value = argv[++i];
+      return true;
+    };
+    std::string value;
+    if (arg == "--sizes") {
+      if (!next(value)) return false;
+      options.sizes.clear();
+      for (const auto& item : SplitList(value)) {
+        options.sizes.push_back(static_cast<size_t>(std::atoll(item.c_str())));
+      }
+    } else if (arg == "--shapes") {
+      if (!next(value)) return false;
+      options.shapes.clear();
+      for (const auto& item : SplitList(value)) {
+        MeshGenerator::Shape shape;
+        if (!MeshGenerator::ParseShapeName(item, shape)) {
+          std::cerr << "Unknown shape: " << item << std::endl;
+          return false;
+        }
+        options.shapes.push_back(shape);
+      }
+    } else if (arg == "--seed") {
+      if (!next(value)) return false;
+      options.seed = static_cast<uint32_t>(std::atol(value.c_str()));
+    } else if (arg == "--phases") {
+      if (!next(value)) return false;
+      options.phases = SplitList(value);
+    } else if (arg == "--cap") {
+      if (!next(value)) return false;
+      size_t eq = value.find('=');
+      if (eq == std::string::npos) {
+        std::cerr << "--cap expects phase=max_faces" << std::endl;
+        return false;
+      }
+      options.caps[value.substr(0, eq)] =
+          static_cast<size_t>(std::atoll(value.c_str() + eq + 1));
+    } else if (arg == "--no-caps") {
+      options.caps.clear();
+    } else if (arg == "--runs") {
+      if (!next(value)) return false;
+      options.runs = std::max(1, std::atoi(value.c_str()));
+    } else if (arg == "--reduction") {
+      if (!next(value)) return false;
+      options.reduction = static_cast<float>(std::atof(value.c_str()));
+    } else if (arg == "--grid") {
+      if (!next(value)) return false;
+      options.grid_resolution = std::max(2, std::atoi(value.c_str()));
+    } else if (arg == "--threads") {
+      if (!next(value)) return false;
+      options.threads = static_cast<unsigned int>(std::atoi(value.c_str()));
+    } else if (arg == "--simd") {
+      if (!next(value)) return false;
+      bool found = false;
+      const int max_level =
+          static_cast<int>(GeometryKernels::SimdLevel::AVX2);
+      for (int level = 0; level <= max_level && !found; level++) {
+        auto simd_level = static_cast<GeometryKernels::SimdLevel>(level);
+        if (value == GeometryKernels::GetSimdLevelName(simd_level)) {
+          options.simd_level = simd_level;
+          found = true;
+        }
+      }
+      if (!found) {
+        std::cerr << "Unknown SIMD level: " << value << std::endl;
+        return false;
+      }
+    } else if (arg == "--out") {
+      if (!next(value)) return false;
+      options.out_path = value;
+    } else if (arg == "--label") {
+      if (!next(value)) return false;
+      options.label = value;
+    } else if (arg == "--profile") {
+      if (!next(value)) return false;
+      options.profile_path = value;
+    } else {
+      std::cerr << "Unknown option: " << arg << std::endl;
+      return false;
+    }
+  }
+  return true;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  BenchOptions options;
+  if (!ParseOptions(argc, argv, options)) {
+    return 1;
+  }
+  SetParallelWorkerCount(options.threads);
+  GeometryKernels::SetSimdLevel(options.simd_level);
+
+  EdgeCollapse edge_collapse;
+  EdgeCollapse parallel_edge_collapse;
+  parallel_edge_collapse.SetParallelCollapse(true);
+  EdgeCollapse memoryless_edge_collapse;
+  memoryless_edge_collapse.SetMemoryless(true);
+  EdgeCollapse multiple_choice_edge_collapse;
+  multiple_choice_edge_collapse.SetMultipleChoice(
+      kMultipleChoiceCandidates, options.seed);
+  EdgeCollapse virtual_pair_edge_collapse;
+  virtual_pair_edge_collapse.SetPairDistance(kVirtualPairDistance);
+  EdgeCollapse attribute_edge_collapse;
+  attribute_edge_collapse.SetAttributeWeight(kAttributeWeight);
+  EdgeCollapse dary_edge_collapse;
+  dary_edge_collapse.SetQueueBackend(QueueBackend::DARY_HEAP);
+  EdgeCollapse radix_edge_collapse;
+  radix_edge_collapse.SetQueueBackend(QueueBackend::RADIX_HEAP);
+  VertexDecimation vertex_decimation;
+  VertexDecimation dary_decimation;
+  dary_decimation.SetQueueBackend(QueueBackend::DARY_HEAP);
+  VertexDecimation radix_decimation;
+  radix_decimation.SetQueueBackend(QueueBackend::RADIX_HEAP);
+  VertexClustering vertex_clustering;
+  PartitionedSimplifier partitioned_edge_collapse(
+      PartitionedSimplifier::Method::EDGE_COLLAPSE);
+  PartitionedSimplifier partitioned_decimation(
+      PartitionedSimplifier::Method::VERTEX_DECIMATION);
+  OutOfCoreClustering out_of_core_clustering;
+  out_of_core_clustering.SetGridResolution(options.grid_resolution);
+  const std::string obj_path = "decimator_bench_tmp.obj";
+  const std::string binary_path = "decimator_bench_tmp.dmesh";
+
+  std::map<std::string, std::function<PhaseOutput(const SimplificationMesh&)>>
+      phase_bodies;
+  phase_bodies["save"] = [&](const SimplificationMesh& mesh) {
+    PhaseOutput output;
+    if (!MeshIO::SaveOBJ(obj_path, mesh)) {
+      // Don't leave a partial file for load to read
+      std::remove(obj_path.c_str());
+      output.failed = true;
+      return output;
+    }
+    output.vertices = mesh.GetVertexCount();
+    output.faces = mesh.GetFaceCount();
+    output.bytes = FileSize(obj_path);
+    return output;
+  };
+  phase_bodies["load"] = [&](const SimplificationMesh& mesh) {
+    // A missing, partial or stale file doesn't give the mesh back
+    auto loaded = MeshIO::LoadOBJ(obj_path);
+    if (!loaded || loaded->GetVertexCount() != mesh.GetVertexCount() ||
+        loaded->GetFaceCount() != mesh.GetFaceCount()) {
+      PhaseOutput output;
+      output.failed = true;
+      return output;
+    }
+    return Describe(loaded);
+  };
+  // The simplifier phases report their max_error for quality comparisons
+  SimplificationReport report;
+  phase_bodies["edge"] = [&](const SimplificationMesh& mesh) {
+    auto result = edge_collapse.Simplify(
+        mesh, ReductionBudget(mesh, options.reduction), &report);
+    return Describe(result, &report);
+  };
+  phase_bodies["edge_parallel"] = [&](const SimplificationMesh& mesh) {
+    auto result = parallel_edge_collapse.Simplify(
+        mesh, ReductionBudget(mesh, options.reduction), &report);
+    return Describe(result, &report);
+  };
+  phase_bodies["check_parallel_workers"] = [&](const SimplificationMesh& mesh) {
+    std::shared_ptr<SimplificationMesh> results[2];
+    for (int i = 0; i < 2; i++) {
+      SetParallelWorkerCount(kCheckWorkerCounts[i]);
+      results[i] = parallel_edge_collapse.Simplify(
+          mesh, ReductionBudget(mesh, options.reduction));
+    }
+    SetParallelWorkerCount(options.threads);
+    return CheckResult(results[0], results[1],
+                       "edge_parallel depends on the worker count");
+  };
+  phase_bodies["check_queue_backends"] = [&](const SimplificationMesh& input) {
+    SimplificationMesh mesh = input;
+    std::mt19937 rng(options.seed);
+    std::uniform_real_distribution<float> jitter(-kCheckJitter, kCheckJitter);
+    for (glm::vec3& v : mesh.vertices) {
+      v += glm::vec3(jitter(rng), jitter(rng), jitter(rng));
+    }
+    const SimplificationBudget budget = ReductionBudget(mesh, options.reduction);
+    auto edge = edge_collapse.Simplify(mesh, budget);
+    auto decimation = vertex_decimation.Simplify(mesh, budget);
+    PhaseOutput output = CheckResult(
+        edge, dary_edge_collapse.Simplify(mesh, budget), "edge_dary_heap");
+    if (!output.failed) {
+      output = CheckResult(edge, radix_edge_collapse.Simplify(mesh, budget),
+                           "edge_radix_heap");
+    }
+    if (!output.failed) {
+      output = CheckResult(decimation, dary_decimation.Simplify(mesh, budget),
+                           "decimation_dary_heap");
+    }
+    if (!output.failed) {
+      output = CheckResult(decimation,
+                           radix_decimation.Simplify(mesh, budget),
+                           "decimation_radix_heap");
+    }
+    return output;
+  };
+  phase_bodies["check_progressive_mesh"] = [&](const SimplificationMesh& mesh) {
+    const SimplificationBudget budget = ReductionBudget(mesh, options.reduction);
+    auto progressive_mesh = edge_collapse.BuildProgressiveMesh(mesh);
+    progressive_mesh->SetVertexCount(progressive_mesh->GetMinVertexCount());
+    progressive_mesh->SetVertexCount(budget.target_vertex_count);
+    return CheckFaces(
+        edge_collapse.Simplify(mesh, budget),
+        std::make_shared<SimplificationMesh>(progressive_mesh->Extract()),
+        "progressive mesh LOD differs from edge");
+  };
+  phase_bodies["check_session_resume"] = [&](const SimplificationMesh& mesh) {
+    const SimplificationBudget budget = ReductionBudget(mesh, options.reduction);
+    // An expired deadline still lets every step make some progress, so
+    // these sessions are resumed as often as they can be
+    auto edge_session = edge_collapse.BeginSession(mesh, budget);
+    while (!edge_session->Step(std::chrono::steady_clock::now())) {
+    }
+    PhaseOutput output =
+        CheckResult(edge_collapse.Simplify(mesh, budget),
+                    edge_session->GetResult(), "resumed edge session");
+    if (output.failed) {
+      return output;
+    }
+    auto decimation_session = vertex_decimation.BeginSession(mesh, budget);
+    while (!decimation_session->Step(std::chrono::steady_clock::now())) {
+    }
+    return CheckResult(vertex_decimation.Simplify(mesh, budget),
+                       decimation_session->GetResult(),
+                       "resumed decimation session");
+  };
+  phase_bodies["check_cache"] = [&](const SimplificationMesh& mesh) {
+    const SimplificationBudget budget = ReductionBudget(mesh, options.reduction);
+    auto fresh = edge_collapse.Simplify(mesh, budget);
+    // Keys as MeshSimplifierNode builds them; the disk lookup hashes the
+    // mesh with one worker, as the hash must not depend on the count
+    auto get_key = [&]() {
+      return SimplificationCache::MakeKey(
+          SimplificationCache::HashMesh(mesh), "EdgeCollapse",
+          "vertices=" + std::to_string(budget.target_vertex_count) + " " +
+              edge_collapse.GetSettingsKey());
+    };
+    const std::string key = get_key();
+    SimplificationCache cache;
+    cache.SetDiskDirectory(".");
+    cache.Put(key, fresh);
+    PhaseOutput output = CheckResult(fresh, cache.Get(key), "memory hit");
+    if (output.failed) {
+      cache.Remove(key);
+      return output;
+    }
+    SetParallelWorkerCount(1);
+    const std::string disk_key = get_key();
+    SetParallelWorkerCount(options.threads);
+    SimplificationCache disk_cache;
+    disk_cache.SetDiskDirectory(".");
+    output = CheckResult(fresh, disk_cache.Get(disk_key), "disk hit");
+    cache.Remove(key);
+    return output;
+  };
+  phase_bodies["check_partitioned_manifold"] =
+      [&](const SimplificationMesh& mesh) {
+        const SimplificationBudget budget =
+            ReductionBudget(mesh, options.reduction);
+        // Inputs may be non-manifold already; the blocks must not add any
+        const size_t input_count = CountNonManifoldEdges(mesh);
+        PhaseOutput output;
+        for (int block_count : kCheckBlockCounts) {
+          PartitionedSimplifier* simplifiers[] = {&partitioned_edge_collapse,
+                                                  &partitioned_decimation};
+          const char* names[] = {"edge_partitioned", "decimation_partitioned"};
+          for (int i = 0; i < 2; i++) {
+            simplifiers[i]->SetBlockCount(block_count);
+            auto result = simplifiers[i]->Simplify(mesh, budget);
+            simplifiers[i]->SetBlockCount(0);
+            const size_t count = CountNonManifoldEdges(*result);
+            if (count > input_count) {
+              std::cerr << "  mismatch: " << names[i] << " with "
+                        << block_count << " blocks uses " << count
+                        << " edges by more than two faces (input: "
+                        << input_count << ")" << std::endl;
+              output.failed = true;
+              return output;
+            }
+            output = Describe(result);
+          }
+        }
+        return output;
+      };
+  phase_bodies["check_decimation_error"] =
+      [&](const SimplificationMesh& mesh) {
+        PhaseOutput output;
+        for (float max_distance : kCheckMaxDistances) {
+          VertexDecimation decimation;
+          decimation.SetMaxDistance(max_distance);
+          SimplificationReport check_report;
+          auto result = decimation.Simplify(mesh, SimplificationBudget(),
+                                            &check_report);
+          const float allowed = max_distance * (1.0f + kCheckDistanceSlack);
+          const float distance =
+              GetMaxDistanceToSurface(mesh, *result, allowed);
+          if (distance > allowed || check_report.max_error > allowed) {
+            std::cerr << "  mismatch: decimation with tolerance "
+                      << max_distance << " strays " << distance
+                      << " from the input (reports " << check_report.max_error
+                      << ")" << std::endl;
+            output.failed = true;
+            return output;
+          }
+          output = Describe(result, &check_report);
+        }
+        return output;
+      };
+  phase_bodies["edge_memoryless"] = [&](const SimplificationMesh& mesh) {
+    auto result = memoryless_edge_collapse.Simplify(
+        mesh, ReductionBudget(mesh, options.reduction), &report);
+    return Describe(result, &report);
+  };
+  phase_bodies["edge_multiple_choice"] = [&](const SimplificationMesh& mesh) {
+    auto result = multiple_choice_edge_collapse.Simplify(
+        mesh, ReductionBudget(mesh, options.reduction), &report);
+    return Describe(result, &report);
+  };
+  phase_bodies["edge_virtual_pairs"] = [&](const SimplificationMesh& mesh) {
+    auto result = virtual_pair_edge_collapse.Simplify(
+        mesh, ReductionBudget(mesh, options.reduction), &report);
+    return Describe(result, &report);
+  };
+  phase_bodies["edge_attributes"] = [&](const SimplificationMesh& mesh) {
+    auto result = attribute_edge_collapse.Simplify(
+        mesh, ReductionBudget(mesh, options.reduction), &report);
+    return Describe(result, &report);
+  };
+  phase_bodies["edge_dary_heap"] = [&](const SimplificationMesh& mesh) {
+    auto result = dary_edge_collapse.Simplify(
+        mesh, ReductionBudget(mesh, options.reduction), &report);
+    return Describe(result, &report);
+  };
+  phase_bodies["edge_radix_heap"] = [&](const SimplificationMesh& mesh) {
+    auto result = radix_edge_collapse.Simplify(
+        mesh, ReductionBudget(mesh, options.reduction), &report);
+    return Describe(result, &report);
+  };
+  phase_bodies["edge_partitioned"] = [&](const SimplificationMesh& mesh) {
+    auto result = partitioned_edge_collapse.Simplify(
+        mesh, ReductionBudget(mesh, options.reduction), &report);
+    return Describe(result, &report);
+  };
+  phase_bodies["decimation"] = [&](const SimplificationMesh& mesh) {
+    auto result = vertex_decimation.Simplify(
+        mesh, ReductionBudget(mesh, options.reduction), &report);
+    return Describe(result, &report);
+  };
+  phase_bodies["decimation_dary_heap"] = [&](const SimplificationMesh& mesh) {
+    auto result = dary_decimation.Simplify(
+        mesh, ReductionBudget(mesh, options.reduction), &report);
+    return Describe(result, &report);
+  };
+  phase_bodies["decimation_radix_heap"] =
+      [&](const SimplificationMesh& mesh) {
+        auto result = radix_decimation.Simplify(
+            mesh, ReductionBudget(mesh, options.reduction), &report);
+        return Describe(result, &report);
+      };
+  phase_bodies["decimation_partitioned"] =
+      [&](const SimplificationMesh& mesh) {
+        auto result = partitioned_decimation.Simplify(
+            mesh, ReductionBudget(mesh, options.reduction), &report);
+        return Describe(result, &report);
+      };
+  phase_bodies["clustering"] = [&](const SimplificationMesh& mesh) {
+    return Describe(
+        vertex_clustering.Simplify(mesh, options.grid_resolution));
+  };
+
+  phase_bodies["out_of_core"] = [&](const SimplificationMesh& mesh) {
+    auto source = MeshIO::OpenTriangleStream(binary_path);
+    if (!source) {
+      PhaseOutput output;
+      output.failed = true;
+      return output;
+    }
+    return Describe(out_of_core_clustering.Simplify(*source));
+  };
+
+  // Input files of the phases that read one, written before the phase is
+  // timed (unless an earlier phase already wrote them for this mesh).
+  // False if the file can't be written, which fails the phase.
+  std::map<std::string, std::function<bool(const SimplificationMesh&)>>
+      phase_inputs;
+  phase_inputs["load"] = [&](const SimplificationMesh& mesh) {
+    if (FileSize(obj_path) == 0 && !MeshIO::SaveOBJ(obj_path, mesh)) {
+      std::remove(obj_path.c_str());
+      return false;
+    }
+    return true;
+  };
+  phase_inputs["out_of_core"] = [&](const SimplificationMesh& mesh) {
+    if (FileSize(binary_path) == 0 && !MeshIO::SaveBinary(binary_path, mesh)) {
+      std::remove(binary_path.c_str());
+      return false;
+    }
+    return true;
+  };
+
+  std::vector<PhaseResult> results;
+  bool any_failed = false;
+  for (MeshGenerator::Shape shape : options.shapes) {
+    for (size_t size : options.sizes) {
+      SimplificationMesh mesh =
+          MeshGenerator::Create(shape, size, options.seed);
+      std::remove(obj_path.c_str());
+      std::remove(binary_path.c_str());
+      std::cerr << MeshGenerator::GetShapeName(shape) << ": "
+                << mesh.GetVertexCount() << " vertices, "
+                << mesh.GetFaceCount() << " faces" << std::endl;
+
+      for (const std::string& phase : options.phases) {
+        auto body = phase_bodies.find(phase);
+        if (body == phase_bodies.end()) {
+          std::cerr << "  skipping unknown phase " << phase << std::endl;
+          continue;
+        }
+        auto cap = options.caps.find(phase);
+        if (cap != options.caps.end() && mesh.GetFaceCount() > cap->second) {
+          std::cerr << "  " << phase << ": skipped (over cap of "
+                    << cap->second << " faces)" << std::endl;
+          continue;
+        }
+        auto input = phase_inputs.find(phase);
+        if (input != phase_inputs.end() && !input->second(mesh)) {
+          std::cerr << "  " << phase << ": failed (can't write its input)"
+                    << std::endl;
+          any_failed = true;
+          continue;
+        }
+        PhaseResult result = RunPhase(
+            phase, mesh, options.runs,
+            [&]() { return body->second(mesh); });
+        result.shape = MeshGenerator::GetShapeName(shape);
+        if (result.failed) {
+          std::cerr << "  " << phase << ": failed" << std::endl;
+          any_failed = true;
+          continue;
+        }
+        std::cerr << "  " << phase << ": median " << result.median_ms
+                  << " ms, p95 " << result.p95_ms << " ms, "
+                  << result.faces_per_second << " faces/s, peak RSS "
+                  << result.peak_rss_bytes / (1024 * 1024) << " MB"
+                  << std::endl;
+        results.push_back(result);
+      }
+    }
+  }
+  std::remove(obj_path.c_str());
+  std::remove(binary_path.c_str());
+
+  std::vector<FastestQueue> fastest_queues = FindFastestQueues(results);
+  for (const FastestQueue& f : fastest_queues) {
+    std::cerr << "Fastest queue for " << f.simplifier << " on " << f.shape
+              << " (" << f.input_faces << " faces): " << f.backend << ", "
+              << f.median_ms << " ms" << std::endl;
+  }
+
+  std::ofstream out(options.out_path);
+  if (!out.is_open()) {
+    std::cerr << "Failed to open " << options.out_path << std::endl;
+    return 1;
+  }
+  WriteJson(out, options, results, fastest_queues);
+  std::cerr << "Wrote " << options.out_path << std::endl;
+
+  if (!options.profile_path.empty()) {
+    if (!Profiler::IsEnabled()) {
+      std::cerr << "Profiling is compiled out; " << options.profile_path
+                << " will be empty" << std::endl;
+    }
+    if (!Profiler::WriteJson(options.profile_path)) {
+      return 1;
+    }
+    std::cerr << "Wrote " << options.profile_path << std::endl;
+  }
+  return any_failed ? 1 : 0;
+}
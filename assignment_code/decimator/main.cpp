@@ -1,11 +1,22 @@
 #include <iostream>
 #include <chrono>
+#include <cstdlib>
 
 #include "DecimatorApp.hpp"
+#include "gloo/debug/Tracer.hpp"
 
 using namespace GLOO;
 
 int main() {
+  // DECIMATOR_TRACE=path records a timeline from startup and writes it as
+  // Chrome trace-event JSON on exit. Tracing can also be toggled from the
+  // Profiler window.
+  const char* trace_path = std::getenv("DECIMATOR_TRACE");
+  Tracer::SetThreadName("main");
+  if (trace_path != nullptr) {
+    Tracer::Start();
+  }
+
   std::unique_ptr<DecimatorApp> app =
       make_unique<DecimatorApp>("Mesh Decimator", glm::ivec2(1440, 900));
 
@@ -23,6 +34,13 @@ int main() {
     app->Tick(delta_time, total_elapsed_time);
     last_tick_time = current_tick_time;
   }
+
+  if (trace_path != nullptr) {
+    Tracer::Stop();
+    if (Tracer::WriteJson(trace_path)) {
+      std::cout << "Wrote " << trace_path << std::endl;
+    }
+  }
   return 0;
 }
 
@@ -1,8 +1,305 @@
 #include "EdgeCollapse.hpp"
+#include "GeometryKernels.hpp"
+#include "OneRing.hpp"
+#include "helpers.hpp"
+#include "Profiler.hpp"
 #include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <iomanip>
+#include <iterator>
 #include <queue>
+#include <random>
+#include <sstream>
 
 namespace GLOO {
+namespace {
+// Bijective 32-bit mix (the MurmurHash3 finalizer)
+uint32_t MixRank(uint32_t rank) {
+  rank ^= rank >> 16;
+  rank *= 0x85ebca6bu;
+  rank ^= rank >> 13;
+  rank *= 0xc2b2ae35u;
+  rank ^= rank >> 16;
+  return rank;
+}
+
+// Lindstrom-Turk weights of the volume and border terms of a memoryless
+// cost
+const double kVolumeWeight = 0.5;
+const double kBorderWeight = 0.5;
+// Constraints closer than this angle (1 degree) to the span of the earlier
+// ones are dropped as redundant
+const double kConstraintCos2 = 0.99969541350954794;  // cos^2
+const double kConstraintSin2 = 3.0458649045213493e-4;  // sin^2
+
+// Sum of squared terms as the quadratic v^T h v - 2 c.v + k of the new
+// position v; weight sums the squared lengths of the terms' gradients
+struct LocalQuadratic {
+  glm::dmat3 h;
+  glm::dvec3 c;
+  double k;
+  double weight;
+
+  void Clear() {
+    h = glm::dmat3(0.0);
+    c = glm::dvec3(0.0);
+    k = 0.0;
+    weight = 0.0;
+  }
+  double Evaluate(const glm::dvec3& v) const {
+    return std::max(0.0, glm::dot(v, h * v) - 2.0 * glm::dot(c, v) + k);
+  }
+};
+
+// Up to three linear constraints a_i.v = b_i on the new position; further
+// ones are only taken in directions the earlier ones leave free
+class ConstraintSet {
+ public:
+  int GetCount() const { return count_; }
+
+  void Add(const glm::dvec3& a, double b) {
+    if (count_ == 3 || !IsCompatible(a)) {
+      return;
+    }
+    a_[count_] = a;
+    b_[count_] = b;
+    count_++;
+  }
+  // Constrains the minimum of v^T h v - 2 c.v along the free directions
+  void AddFromGradient(const glm::dmat3& h, const glm::dvec3& c) {
+    if (count_ == 0) {
+      for (int i = 0; i < 3; i++) {
+        Add(glm::dvec3(h[0][i], h[1][i], h[2][i]), c[i]);
+      }
+    } else if (count_ == 1) {
+      // Two directions orthogonal to the first constraint
+      const glm::dvec3& n = a_[0];
+      glm::dvec3 q0 = std::abs(n.x) > std::abs(n.z)
+                          ? glm::dvec3(-n.y, n.x, 0.0)
+                          : glm::dvec3(0.0, -n.z, n.y);
+      glm::dvec3 q1 = glm::cross(n, q0);
+      Add(h * q0, glm::dot(c, q0));
+      Add(h * q1, glm::dot(c, q1));
+    } else if (count_ == 2) {
+      glm::dvec3 q = glm::cross(a_[0], a_[1]);
+      Add(h * q, glm::dot(c, q));
+    }
+  }
+  // Intersection of three constraints; false if they are degenerate
+  bool Solve(glm::dvec3& v) const {
+    if (count_ < 3) {
+      return false;
+    }
+    glm::dvec3 c12 = glm::cross(a_[1], a_[2]);
+    double det = glm::dot(a_[0], c12);
+    double scale = glm::length(a_[0]) * glm::length(a_[1]) *
+                   glm::length(a_[2]);
+    if (!(std::abs(det) > 1e-12 * scale)) {
+      return false;
+    }
+    v = (b_[0] * c12 + b_[1] * glm::cross(a_[2], a_[0]) +
+         b_[2] * glm::cross(a_[0], a_[1])) / det;
+    return true;
+  }
+
+ private:
+  glm::dvec3 a_[3];
+  double b_[3];
+  int count_ = 0;
+
+  bool IsCompatible(const glm::dvec3& a) const {
+    double a2 = glm::dot(a, a);
+    if (!(a2 > 0.0)) {
+      return false;
+    }
+    if (count_ == 0) {
+      return true;
+    }
+    if (count_ == 1) {
+      double d = glm::dot(a_[0], a);
+      return d * d < kConstraintCos2 * glm::dot(a_[0], a_[0]) * a2;
+    }
+    glm::dvec3 n = glm::cross(a_[0], a_[1]);
+    double d = glm::dot(n, a);
+    return d * d > kConstraintSin2 * glm::dot(n, n) * a2;
+  }
+};
+
+// The faces around both endpoints of an edge as the Lindstrom-Turk terms
+// of collapsing it
+// Reference: "Fast and Memory Efficient Polygonal Simplification" [LT98]
+class LocalGeometry {
+ public:
+  void Gather(const SimplificationMesh& mesh,
+              const std::vector<std::vector<int>>& vertex_faces,
+              const std::vector<uint8_t>& face_removed, int v1, int v2) {
+    volume_.Clear();
+    border_.Clear();
+    volume_normal_ = glm::dvec3(0.0);
+    volume_offset_ = 0.0;
+    border_edge_sum_ = glm::dvec3(0.0);
+    border_cross_sum_ = glm::dvec3(0.0);
+    link_sum_ = glm::dvec3(0.0);
+    link_count_ = 0;
+    face_edges_.clear();
+    link_.clear();
+
+    for (int side = 0; side < 2; side++) {
+      const int vertex = side == 0 ? v1 : v2;
+      for (int face_id : vertex_faces[vertex]) {
+        if (face_removed[face_id]) {
+          continue;
+        }
+        const glm::uvec3& face = mesh.faces[face_id];
+        if (side == 1 && (int(face[0]) == v1 || int(face[1]) == v1 ||
+                          int(face[2]) == v1)) {
+          continue;  // Already gathered around v1
+        }
+        AddFace(mesh, face, v1, v2);
+      }
+    }
+
+    // Every face around v1 and v2 was gathered, so their edges used by a
+    // single face are on the mesh border
+    std::sort(face_edges_.begin(), face_edges_.end());
+    for (size_t i = 0; i < face_edges_.size();) {
+      size_t j = i + 1;
+      while (j < face_edges_.size() &&
+             face_edges_[j].key == face_edges_[i].key) {
+        j++;
+      }
+      if (j - i == 1) {
+        AddBorderEdge(glm::dvec3(mesh.vertices[face_edges_[i].from]),
+                      glm::dvec3(mesh.vertices[face_edges_[i].to]));
+      }
+      i = j;
+    }
+
+    std::sort(link_.begin(), link_.end());
+    link_.erase(std::unique(link_.begin(), link_.end()), link_.end());
+    for (int vertex : link_) {
+      link_sum_ += glm::dvec3(mesh.vertices[vertex]);
+    }
+    link_count_ = static_cast<int>(link_.size());
+  }
+
+  // Position of the collapsed vertex, or fallback if it is underdetermined
+  glm::dvec3 Solve(double length2, const glm::dvec3& fallback) const {
+    ConstraintSet constraints;
+    // Volume preservation
+    constraints.Add(volume_normal_, volume_offset_);
+    // Border area preservation: the squared length of the change in the
+    // border's summed area vector
+    if (border_.weight > 0.0) {
+      const glm::dvec3& e = border_edge_sum_;
+      glm::dmat3 h = glm::dmat3(glm::dot(e, e)) - glm::outerProduct(e, e);
+      constraints.AddFromGradient(h, glm::cross(e, border_cross_sum_));
+    }
+    // Volume and border optimization
+    constraints.AddFromGradient(
+        kVolumeWeight * volume_.h + kBorderWeight * length2 * border_.h,
+        kVolumeWeight * volume_.c + kBorderWeight * length2 * border_.c);
+    // Shape optimization: the squared lengths of the new edges
+    if (link_count_ > 0) {
+      constraints.AddFromGradient(glm::dmat3(double(link_count_)),
+                                  link_sum_);
+    }
+    glm::dvec3 v;
+    return constraints.Solve(v) ? v : fallback;
+  }
+
+  // Weighted volume and area swept by moving the region to v, with the
+  // border term scaled by the squared edge length to match units
+  double GetCost(const glm::dvec3& v, double length2) const {
+    return kVolumeWeight * volume_.Evaluate(v) +
+           kBorderWeight * length2 * border_.Evaluate(v);
+  }
+
+  // RMS distance of v to the planes of the faces or the lines of the
+  // border edges, whichever is further
+  double GetDistance(const glm::dvec3& v) const {
+    double distance2 = 0.0;
+    if (volume_.weight > 0.0) {
+      distance2 = volume_.Evaluate(v) / volume_.weight;
+    }
+    if (border_.weight > 0.0) {
+      distance2 = std::max(distance2, border_.Evaluate(v) / border_.weight);
+    }
+    return std::sqrt(distance2);
+  }
+
+ private:
+  // Directed face edge touching v1 or v2, keyed by its sorted endpoints
+  struct FaceEdge {
+    uint64_t key;
+    int from;
+    int to;
+
+    bool operator<(const FaceEdge& other) const { return key < other.key; }
+  };
+
+  // Volume swept over each face, as squared multiples of six tetrahedron
+  // volumes: (n.v - n.a)^2 with n the face's area normal (times two)
+  LocalQuadratic volume_;
+  // Area swept over each border edge (x0, x1): |e x v + x0 x x1|^2 with
+  // e = x1 - x0, the squared parallelogram area
+  LocalQuadratic border_;
+  glm::dvec3 volume_normal_;
+  double volume_offset_;
+  glm::dvec3 border_edge_sum_;
+  glm::dvec3 border_cross_sum_;
+  glm::dvec3 link_sum_;
+  int link_count_;
+  std::vector<FaceEdge> face_edges_;
+  std::vector<int> link_;
+
+  void AddFace(const SimplificationMesh& mesh, const glm::uvec3& face,
+               int v1, int v2) {
+    const glm::dvec3 a(mesh.vertices[face[0]]);
+    const glm::dvec3 b(mesh.vertices[face[1]]);
+    const glm::dvec3 c(mesh.vertices[face[2]]);
+    const glm::dvec3 n = glm::cross(b - a, c - a);
+    const double d = glm::dot(n, a);
+    volume_.h += glm::outerProduct(n, n);
+    volume_.c += d * n;
+    volume_.k += d * d;
+    volume_.weight += glm::dot(n, n);
+    volume_normal_ += n;
+    volume_offset_ += d;
+
+    for (int k = 0; k < 3; k++) {
+      const int from = face[k];
+      const int to = face[(k + 1) % 3];
+      if (from != v1 && from != v2) {
+        link_.push_back(from);
+      }
+      if (from != v1 && from != v2 && to != v1 && to != v2) {
+        continue;
+      }
+      FaceEdge edge;
+      edge.key = (uint64_t(uint32_t(std::min(from, to))) << 32) |
+                 uint32_t(std::max(from, to));
+      edge.from = from;
+      edge.to = to;
+      face_edges_.push_back(edge);
+    }
+  }
+
+  void AddBorderEdge(const glm::dvec3& x0, const glm::dvec3& x1) {
+    const glm::dvec3 e = x1 - x0;
+    const glm::dvec3 w = glm::cross(x0, x1);
+    border_.h += glm::dmat3(glm::dot(e, e)) - glm::outerProduct(e, e);
+    border_.c += glm::cross(e, w);
+    border_.k += glm::dot(w, w);
+    border_.weight += glm::dot(e, e);
+    border_edge_sum_ += e;
+    border_cross_sum_ += w;
+  }
+};
+}  // namespace
 
 EdgeCollapse::EdgeCollapse() {
   // Constructor
@@ -13,44 +310,689 @@ EdgeCollapse::~EdgeCollapse() {
 }
 
 std::shared_ptr<SimplificationMesh> EdgeCollapse::Simplify(
-    const SimplificationMesh& original_mesh, 
+    const SimplificationMesh& original_mesh,
     int target_vertex_count) {
-  // TODO: Implement Garland-Heckbert edge collapse algorithm
-  // 1. Compute initial quadric matrices for all vertices
-  // 2. Build edge list and compute collapse errors
-  // 3. Iteratively collapse edges with minimum error
-  // 4. Update affected edges and quadrics
-  // 5. Continue until target vertex count is reached
-  
+  return Simplify(original_mesh,
+                  SimplificationBudget::Vertices(target_vertex_count));
+}
+
+std::shared_ptr<SimplificationMesh> EdgeCollapse::Simplify(
+    const SimplificationMesh& original_mesh,
+    const SimplificationBudget& budget, SimplificationReport* report) {
   auto result = std::make_shared<SimplificationMesh>(original_mesh);
+  SimplifyInPlace(*result, budget, report);
   return result;
 }
 
+std::shared_ptr<SimplificationMesh> EdgeCollapse::Simplify(
+    SimplificationMesh&& mesh, int target_vertex_count) {
+  return Simplify(std::move(mesh),
+                  SimplificationBudget::Vertices(target_vertex_count));
+}
+
+std::shared_ptr<SimplificationMesh> EdgeCollapse::Simplify(
+    SimplificationMesh&& mesh, const SimplificationBudget& budget,
+    SimplificationReport* report) {
+  auto result = std::make_shared<SimplificationMesh>(std::move(mesh));
+  SimplifyInPlace(*result, budget, report);
+  return result;
+}
+
+void EdgeCollapse::SimplifyInPlace(SimplificationMesh& mesh,
+                                   const SimplificationBudget& budget,
+                                   SimplificationReport* report) {
+  float max_error = 0.0f;
+  if (!mesh.IsEmpty() &&
+      !budget.IsReached(static_cast<int>(mesh.vertices.size()),
+                        static_cast<int>(mesh.faces.size()))) {
+    CollapseRun run;
+    if (multiple_choice_candidates_ > 0) {
+      RunMultipleChoiceCollapses(mesh, budget, run);
+    } else if (parallel_collapse_) {
+      RunParallelCollapses(mesh, budget, run);
+    } else {
+      BeginCollapses(mesh, run);
+      ContinueCollapses(mesh, run, budget, nullptr);
+    }
+    UpdateNormals(mesh);
+    CompactMesh(mesh);
+    max_error = run.max_error;
+  }
+  if (report != nullptr) {
+    report->vertex_count = mesh.vertices.size();
+    report->face_count = mesh.faces.size();
+    report->max_error = max_error;
+  }
+}
+
 std::shared_ptr<SimplificationMesh> EdgeCollapse::SimplifyByFactor(
-    const SimplificationMesh& original_mesh, 
+    const SimplificationMesh& original_mesh,
     float reduction_factor) {
   int target_count = static_cast<int>(
       original_mesh.vertices.size() * reduction_factor);
   return Simplify(original_mesh, target_count);
 }
 
+std::string EdgeCollapse::GetSettingsKey() const {
+  std::ostringstream key;
+  key << std::setprecision(9) << "restrict=" << restrict_to_original_positions_
+      << " parallel=" << parallel_collapse_ << " memoryless=" << memoryless_
+      << " choice=" << multiple_choice_candidates_ << ":"
+      << multiple_choice_seed_ << " pairs=" << pair_distance_
+      << " attributes=" << attribute_weight_
+      << " queue=" << static_cast<int>(queue_backend_)
+      << " locked=" << GetFlagsKey(locked_vertices_);
+  return key.str();
+}
+
+std::shared_ptr<ProgressiveMesh> EdgeCollapse::BuildProgressiveMesh(
+    const SimplificationMesh& original_mesh, int min_vertex_count) {
+  SimplificationMesh mesh = original_mesh;
+  // The progressive mesh keeps its own normals, so the run only needs them
+  // as attributes
+  if (attribute_weight_ <= 0.0f) {
+    mesh.normals.clear();
+  }
+  CollapseLog log;
+  if (!mesh.IsEmpty()) {
+    RunCollapses(mesh, SimplificationBudget::Vertices(min_vertex_count),
+                 &log);
+  } else {
+    BuildAdjacency(mesh);
+  }
+
+  DECIMATOR_PROFILE_SCOPE("EdgeCollapse.RecordProgressive");
+  const size_t vertex_count = original_mesh.vertices.size();
+  const size_t face_count = original_mesh.faces.size();
+  const size_t collapse_count = log.kept.size();
+
+  // Surviving vertices keep their relative order at the front; the vertex
+  // removed by record i goes to vertex_count - 1 - i
+  std::vector<unsigned int> vertex_map(vertex_count);
+  unsigned int next = 0;
+  for (size_t v = 0; v < vertex_count; v++) {
+    if (!vertex_removed_[v]) vertex_map[v] = next++;
+  }
+  for (size_t i = 0; i < collapse_count; i++) {
+    vertex_map[log.removed[i]] =
+        static_cast<unsigned int>(vertex_count - 1 - i);
+  }
+
+  // Surviving faces first, then the faces of the last collapse down to the
+  // first, so the live faces of every LOD form a prefix
+  std::vector<unsigned int> face_map(face_count);
+  next = 0;
+  for (size_t f = 0; f < face_count; f++) {
+    if (!face_removed_[f]) face_map[f] = next++;
+  }
+  std::vector<unsigned int> faces_after(collapse_count);
+  for (size_t i = collapse_count; i-- > 0;) {
+    faces_after[i] = next;
+    size_t begin = i == 0 ? 0 : log.removed_faces_end[i - 1];
+    for (size_t k = begin; k < log.removed_faces_end[i]; k++) {
+      face_map[log.removed_faces[k]] = next++;
+    }
+  }
+
+  SimplificationMesh ordered;
+  ordered.vertices.resize(vertex_count);
+  for (size_t v = 0; v < vertex_count; v++) {
+    ordered.vertices[vertex_map[v]] = original_mesh.vertices[v];
+  }
+  if (original_mesh.colors.size() == vertex_count) {
+    ordered.colors.resize(vertex_count);
+    for (size_t v = 0; v < vertex_count; v++) {
+      ordered.colors[vertex_map[v]] = original_mesh.colors[v];
+    }
+  }
+  if (original_mesh.texcoords.size() == vertex_count) {
+    ordered.texcoords.resize(vertex_count);
+    for (size_t v = 0; v < vertex_count; v++) {
+      ordered.texcoords[vertex_map[v]] = original_mesh.texcoords[v];
+    }
+  }
+  ordered.faces.resize(face_count);
+  ParallelFor(face_count, [&](size_t f) {
+    const glm::uvec3& face = original_mesh.faces[f];
+    ordered.faces[face_map[f]] = glm::uvec3(
+        vertex_map[face.x], vertex_map[face.y], vertex_map[face.z]);
+  });
+
+  std::vector<VertexSplit> splits(collapse_count);
+  std::vector<unsigned int> corners(log.corners.size());
+  ParallelFor(log.corners.size(), [&](size_t k) {
+    int corner = log.corners[k];
+    corners[k] = 3 * face_map[corner / 3] + corner % 3;
+  });
+  for (size_t i = 0; i < collapse_count; i++) {
+    VertexSplit& split = splits[i];
+    split.vt = vertex_map[log.kept[i]];
+    split.vt_position_before = log.old_positions[i];
+    split.vt_position_after = log.new_positions[i];
+    split.face_count = faces_after[i];
+    split.corners_begin = i == 0 ? 0 : log.corners_end[i - 1];
+    split.corners_end = log.corners_end[i];
+  }
+
+  return std::make_shared<ProgressiveMesh>(
+      std::move(ordered), std::move(splits), std::move(corners));
+}
+
+std::vector<std::shared_ptr<SimplificationMesh>> EdgeCollapse::SimplifyToLODs(
+    const SimplificationMesh& original_mesh,
+    const std::vector<float>& reduction_factors) {
+  std::vector<int> targets;
+  std::vector<size_t> order = SortLevels(original_mesh, reduction_factors,
+                                         targets);
+  std::vector<std::shared_ptr<SimplificationMesh>> lods(
+      reduction_factors.size());
+  if (original_mesh.IsEmpty()) {
+    for (auto& lod : lods) {
+      lod = std::make_shared<SimplificationMesh>(original_mesh);
+    }
+    return lods;
+  }
+
+  SimplificationMesh mesh = original_mesh;
+  CollapseRun run;
+  BeginCollapses(mesh, run);
+  for (size_t i = 0; i < order.size(); i++) {
+    const size_t level = order[i];
+    ContinueCollapses(mesh, run, SimplificationBudget::Vertices(targets[level]),
+                      nullptr);
+    UpdateNormals(mesh);
+    // Snapshot: compaction only reads the removal flags, which index the
+    // copy just as well. The coarsest level takes the working mesh itself.
+    auto lod = i + 1 < order.size()
+                   ? std::make_shared<SimplificationMesh>(mesh)
+                   : std::make_shared<SimplificationMesh>(std::move(mesh));
+    CompactMesh(*lod);
+    lods[level] = lod;
+  }
+  return lods;
+}
+
+std::shared_ptr<SharedLODChain> EdgeCollapse::SimplifyToSharedLODs(
+    const SimplificationMesh& original_mesh,
+    const std::vector<float>& reduction_factors) {
+  std::vector<int> targets;
+  std::vector<size_t> order = SortLevels(original_mesh, reduction_factors,
+                                         targets);
+  const size_t vertex_count = original_mesh.vertices.size();
+  const size_t level_count = reduction_factors.size();
+
+  // Faces of each level in original vertex indices, and for every vertex the
+  // number of (finest-first) levels it survives
+  std::vector<std::vector<glm::uvec3>> level_faces(level_count);
+  std::vector<size_t> levels_alive(vertex_count, level_count);
+  if (!original_mesh.IsEmpty()) {
+    SimplificationMesh mesh = original_mesh;
+    CollapseRun run;
+    BeginCollapses(mesh, run, true);
+    for (size_t rank = 0; rank < order.size(); rank++) {
+      size_t level = order[rank];
+      ContinueCollapses(mesh, run,
+                        SimplificationBudget::Vertices(targets[level]),
+                        nullptr);
+      CompactIf(mesh.faces, level_faces[level],
+                [&](size_t f) { return !face_removed_[f]; });
+      for (size_t v = 0; v < vertex_count; v++) {
+        if (vertex_removed_[v] && levels_alive[v] == level_count) {
+          levels_alive[v] = rank;
+        }
+      }
+    }
+  }
+
+  // Coarsest-first vertex order: stable counting sort by levels survived
+  std::vector<size_t> bucket_start(level_count + 2, 0);
+  for (size_t v = 0; v < vertex_count; v++) {
+    bucket_start[level_count - levels_alive[v] + 1]++;
+  }
+  for (size_t b = 1; b < bucket_start.size(); b++) {
+    bucket_start[b] += bucket_start[b - 1];
+  }
+  std::vector<unsigned int> vertex_map(vertex_count);
+  for (size_t v = 0; v < vertex_count; v++) {
+    vertex_map[v] = static_cast<unsigned int>(
+        bucket_start[level_count - levels_alive[v]]++);
+  }
+
+  auto chain = std::make_shared<SharedLODChain>();
+  SimplificationMesh& data = chain->vertex_data;
+  data.vertices.resize(vertex_count);
+  for (size_t v = 0; v < vertex_count; v++) {
+    data.vertices[vertex_map[v]] = original_mesh.vertices[v];
+  }
+  if (original_mesh.colors.size() == vertex_count) {
+    data.colors.resize(vertex_count);
+    for (size_t v = 0; v < vertex_count; v++) {
+      data.colors[vertex_map[v]] = original_mesh.colors[v];
+    }
+  }
+  if (original_mesh.texcoords.size() == vertex_count) {
+    data.texcoords.resize(vertex_count);
+    for (size_t v = 0; v < vertex_count; v++) {
+      data.texcoords[vertex_map[v]] = original_mesh.texcoords[v];
+    }
+  }
+  // Full-resolution normals, shared by every level
+  data.faces = original_mesh.faces;
+  for (auto& face : data.faces) {
+    face = glm::uvec3(vertex_map[face.x], vertex_map[face.y],
+                      vertex_map[face.z]);
+  }
+  data.ComputeNormals();
+  data.faces.clear();
+
+  chain->level_faces.resize(level_count);
+  chain->level_vertex_counts.resize(level_count, 0);
+  for (size_t rank = 0; rank < order.size(); rank++) {
+    size_t level = order[rank];
+    std::vector<glm::uvec3>& faces = level_faces[level];
+    ParallelFor(faces.size(), [&](size_t f) {
+      faces[f] = glm::uvec3(vertex_map[faces[f].x], vertex_map[faces[f].y],
+                            vertex_map[faces[f].z]);
+    });
+    chain->level_faces[level].swap(faces);
+    for (size_t v = 0; v < vertex_count; v++) {
+      if (levels_alive[v] > rank) chain->level_vertex_counts[level]++;
+    }
+  }
+  return chain;
+}
+
+std::vector<size_t> EdgeCollapse::SortLevels(
+    const SimplificationMesh& mesh,
+    const std::vector<float>& reduction_factors,
+    std::vector<int>& targets) const {
+  targets.resize(reduction_factors.size());
+  std::vector<size_t> order(reduction_factors.size());
+  for (size_t i = 0; i < reduction_factors.size(); i++) {
+    // Same target as SimplifyByFactor
+    targets[i] = static_cast<int>(mesh.vertices.size() * reduction_factors[i]);
+    order[i] = i;
+  }
+  std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+    return targets[a] > targets[b];
+  });
+  return order;
+}
+
+std::unique_ptr<EdgeCollapse::Session> EdgeCollapse::BeginSession(
+    const SimplificationMesh& original_mesh, int target_vertex_count) const {
+  return BeginSession(original_mesh,
+                      SimplificationBudget::Vertices(target_vertex_count));
+}
+
+std::unique_ptr<EdgeCollapse::Session> EdgeCollapse::BeginSession(
+    const SimplificationMesh& original_mesh,
+    const SimplificationBudget& budget) const {
+  return std::unique_ptr<Session>(new Session(*this, original_mesh, budget));
+}
+
+std::unique_ptr<EdgeCollapse::Session> EdgeCollapse::BeginSession(
+    SimplificationMesh&& mesh, const SimplificationBudget& budget) const {
+  return std::unique_ptr<Session>(
+      new Session(*this, std::move(mesh), budget));
+}
+
+EdgeCollapse::Session::Session(const EdgeCollapse& simplifier,
+                               SimplificationMesh mesh,
+                               const SimplificationBudget& budget)
+    : simplifier_(simplifier), mesh_(std::move(mesh)), budget_(budget) {
+  run_.vertex_count = static_cast<int>(mesh_.vertices.size());
+  run_.face_count = static_cast<int>(mesh_.faces.size());
+  run_.max_error = 0.0f;
+  done_ = mesh_.IsEmpty() ||
+          budget_.IsReached(run_.vertex_count, run_.face_count);
+}
+
+bool EdgeCollapse::Session::Step(
+    std::chrono::steady_clock::time_point deadline) {
+  if (done_) {
+    return true;
+  }
+  DECIMATOR_PROFILE_SCOPE("EdgeCollapse.SessionStep");
+  if (!started_) {
+    simplifier_.BeginCollapses(mesh_, run_);
+    started_ = true;
+  }
+  done_ = simplifier_.ContinueCollapses(mesh_, run_, budget_, nullptr,
+                                        deadline);
+  simplifier_.UpdateNormals(mesh_);
+  return done_;
+}
+
+int EdgeCollapse::Session::GetVertexCount() const {
+  return run_.vertex_count;
+}
+
+float EdgeCollapse::Session::GetMaxError() const {
+  return run_.max_error;
+}
+
+std::shared_ptr<SimplificationMesh> EdgeCollapse::Session::GetResult() const {
+  auto result = std::make_shared<SimplificationMesh>(mesh_);
+  if (started_) {
+    simplifier_.CompactMesh(*result);
+  }
+  return result;
+}
+
+void EdgeCollapse::RunCollapses(SimplificationMesh& mesh,
+                                const SimplificationBudget& budget,
+                                CollapseLog* log) {
+  CollapseRun run;
+  BeginCollapses(mesh, run);
+  ContinueCollapses(mesh, run, budget, log);
+}
+
+void EdgeCollapse::BeginCollapses(const SimplificationMesh& mesh,
+                                  CollapseRun& run, bool restrict_positions) {
+  ComputeQuadrics(mesh, run.quadrics);
+  BuildAdjacency(mesh);
+  restricts_positions_ = restricts_positions_ || restrict_positions;
+  run.vertex_count = static_cast<int>(mesh.vertices.size());
+  run.face_count = static_cast<int>(mesh.faces.size());
+  run.max_error = 0.0f;
+
+  DECIMATOR_PROFILE_SCOPE("EdgeCollapse.BuildQueue");
+  std::vector<Edge> edges;
+  BuildEdgeList(mesh, run.quadrics, edges);
+  if (pair_distance_ > 0.0f) {
+    AddVirtualPairs(mesh, run, edges);
+  }
+  DECIMATOR_COUNT("EdgeCollapse.queue_pushes", edges.size());
+  switch (queue_backend_) {
+    case QueueBackend::DARY_HEAP:
+      run.dary_queue.Assign(std::move(edges));
+      break;
+    case QueueBackend::RADIX_HEAP:
+      run.radix_queue.Assign(std::move(edges));
+      break;
+    default:
+      run.binary_queue.Assign(std::move(edges));
+      break;
+  }
+}
+
+bool EdgeCollapse::ContinueCollapses(SimplificationMesh& mesh,
+                                     CollapseRun& run,
+                                     const SimplificationBudget& budget,
+                                     CollapseLog* log,
+                                     std::chrono::steady_clock::time_point
+                                         deadline) {
+  switch (queue_backend_) {
+    case QueueBackend::DARY_HEAP:
+      return RunCollapseLoop(mesh, run, run.dary_queue, budget, log,
+                             deadline);
+    case QueueBackend::RADIX_HEAP:
+      return RunCollapseLoop(mesh, run, run.radix_queue, budget, log,
+                             deadline);
+    default:
+      return RunCollapseLoop(mesh, run, run.binary_queue, budget, log,
+                             deadline);
+  }
+}
+
+template <class Queue>
+bool EdgeCollapse::RunCollapseLoop(SimplificationMesh& mesh, CollapseRun& run,
+                                   Queue& queue,
+                                   const SimplificationBudget& budget,
+                                   CollapseLog* log,
+                                   std::chrono::steady_clock::time_point
+                                       deadline) {
+  std::vector<QuadricMatrix>& quadrics = run.quadrics;
+  int& vertex_count = run.vertex_count;
+  const bool has_deadline =
+      deadline != std::chrono::steady_clock::time_point::max();
+  {
+    DECIMATOR_PROFILE_SCOPE("EdgeCollapse.CollapseLoop");
+    std::vector<int> neighbors;
+    std::vector<Edge> updated;
+    VertexList orphans;
+    size_t pops = 0;
+    while (!budget.IsReached(vertex_count, run.face_count) &&
+           !queue.Empty()) {
+      // Reading the clock every pop would cost more than a cheap pop
+      if (has_deadline && (++pops & 31) == 0 &&
+          std::chrono::steady_clock::now() >= deadline) {
+        return false;
+      }
+      Edge edge = queue.Top();
+      queue.Pop();
+      DECIMATOR_COUNT("EdgeCollapse.queue_pops", 1);
+
+      if (vertex_removed_[edge.v1] || vertex_removed_[edge.v2] ||
+          vertex_version_[edge.v1] != edge.version1 ||
+          vertex_version_[edge.v2] != edge.version2) {
+        DECIMATOR_COUNT("EdgeCollapse.stale_pops", 1);
+        continue;
+      }
+      // The queue is ordered by raw quadric cost, so a later edge can still
+      // be within the error bound; skip this one instead of stopping
+      float geometric_error = 0.0f;
+      if (!IsCollapseValid(mesh, edge, quadrics, budget, geometric_error)) {
+        continue;
+      }
+
+      const glm::vec3 old_position1 = mesh.vertices[edge.v1];
+      const glm::vec3 old_position2 = mesh.vertices[edge.v2];
+      const CollapseCounts removed = CollapseEdge(mesh, edge, log, &orphans);
+      run.face_count -= removed.faces;
+      MergeQuadrics(mesh, quadrics, edge);
+      vertex_count -= removed.vertices;
+      run.max_error = std::max(run.max_error, geometric_error);
+      DECIMATOR_COUNT("EdgeCollapse.collapses", 1);
+
+      // Every edge around the merged vertex has a new cost
+      CollectNeighbors(mesh, edge.v1, neighbors);
+      updated.resize(neighbors.size());
+      for (size_t i = 0; i < neighbors.size(); i++) {
+        updated[i].v1 = edge.v1;
+        updated[i].v2 = neighbors[i];
+      }
+      // So does every virtual pair, found again at the new position. The
+      // removed vertices leave the hash, or later searches would pair with
+      // them; orphans other than v1 keep their positions.
+      if (pair_distance_ > 0.0f) {
+        run.pair_hash.Remove(edge.v2, old_position2);
+        for (int v : orphans) {
+          if (v != edge.v1) {
+            run.pair_hash.Remove(v, mesh.vertices[v]);
+          }
+        }
+        if (vertex_removed_[edge.v1]) {
+          run.pair_hash.Remove(edge.v1, old_position1);
+        } else {
+          run.pair_hash.Move(edge.v1, old_position1, mesh.vertices[edge.v1]);
+          FindVirtualPairs(mesh, run.pair_hash, edge.v1, neighbors, false,
+                           updated);
+        }
+      }
+      ComputeEdgeCosts(mesh, quadrics, updated.data(), updated.size());
+      for (const Edge& neighbor_edge : updated) {
+        queue.Push(neighbor_edge);
+      }
+      DECIMATOR_COUNT("EdgeCollapse.queue_pushes", updated.size());
+    }
+  }
+  return true;
+}
+
+void EdgeCollapse::RunMultipleChoiceCollapses(
+    SimplificationMesh& mesh, const SimplificationBudget& budget,
+    CollapseRun& run) {
+  ComputeQuadrics(mesh, run.quadrics);
+  BuildAdjacency(mesh);
+  run.vertex_count = static_cast<int>(mesh.vertices.size());
+  run.face_count = static_cast<int>(mesh.faces.size());
+  run.max_error = 0.0f;
+  std::vector<QuadricMatrix>& quadrics = run.quadrics;
+
+  DECIMATOR_PROFILE_SCOPE("EdgeCollapse.MultipleChoiceLoop");
+  // Vertices that may still have edges, in any order; slots maps them back
+  // so they can be swapped out
+  std::vector<int> live;
+  std::vector<int> slots(mesh.vertices.size(), -1);
+  for (size_t v = 0; v < mesh.vertices.size(); v++) {
+    if (!vertex_faces_[v].empty()) {
+      slots[v] = static_cast<int>(live.size());
+      live.push_back(static_cast<int>(v));
+    }
+  }
+  auto remove_live = [&](int v) {
+    if (slots[v] < 0) return;
+    live[slots[v]] = live.back();
+    slots[live.back()] = slots[v];
+    live.pop_back();
+    slots[v] = -1;
+  };
+
+  // mt19937's output is fixed by the standard (unlike the distributions),
+  // so a seed gives the same samples everywhere
+  std::mt19937 rng(multiple_choice_seed_);
+  std::vector<Edge> candidates;
+  int misses = 0;
+  while (!budget.IsReached(run.vertex_count, run.face_count) &&
+         !live.empty() && misses < kMaxMultipleChoiceMisses) {
+    // A random face of a random live vertex, and one of the face's two
+    // edges at that vertex
+    candidates.clear();
+    for (int i = 0; i < multiple_choice_candidates_ && !live.empty(); i++) {
+      const int v = live[rng() % live.size()];
+      std::vector<int>& faces = vertex_faces_[v];
+      if (faces.empty()) {
+        remove_live(v);
+        continue;
+      }
+      int face_id = faces[rng() % faces.size()];
+      if (face_removed_[face_id]) {
+        // Only the lists of merged vertices are kept free of dead faces
+        faces.erase(std::remove_if(faces.begin(), faces.end(),
+                                   [&](int f) { return face_removed_[f]; }),
+                    faces.end());
+        if (faces.empty()) {
+          remove_live(v);
+          continue;
+        }
+        face_id = faces[rng() % faces.size()];
+      }
+      const glm::uvec3& face = mesh.faces[face_id];
+      int corner = 0;
+      while (static_cast<int>(face[corner]) != v) {
+        corner++;
+      }
+      Edge edge;
+      edge.v1 = v;
+      edge.v2 = static_cast<int>(face[(corner + 1 + rng() % 2) % 3]);
+      candidates.push_back(edge);
+    }
+    DECIMATOR_COUNT("EdgeCollapse.sampled_edges", candidates.size());
+    ComputeEdgeCosts(mesh, quadrics, candidates.data(), candidates.size());
+    // Cheapest first (Edge's operator< is the heap's reversed order)
+    std::sort(candidates.begin(), candidates.end(),
+              [](const Edge& a, const Edge& b) { return b < a; });
+
+    bool collapsed = false;
+    for (const Edge& edge : candidates) {
+      float geometric_error = 0.0f;
+      if (!IsCollapseValid(mesh, edge, quadrics, budget, geometric_error)) {
+        continue;
+      }
+      const CollapseCounts removed = CollapseEdge(mesh, edge, nullptr);
+      run.face_count -= removed.faces;
+      MergeQuadrics(mesh, quadrics, edge);
+      run.vertex_count -= removed.vertices;
+      run.max_error = std::max(run.max_error, geometric_error);
+      remove_live(edge.v2);
+      DECIMATOR_COUNT("EdgeCollapse.collapses", 1);
+      collapsed = true;
+      break;
+    }
+    misses = collapsed ? 0 : misses + 1;
+  }
+}
+
+EdgeCollapse::AttributeQuadric::AttributeQuadric() {
+  std::memset(this, 0, sizeof(*this));
+}
+
+void EdgeCollapse::AttributeQuadric::Add(const AttributeQuadric& other) {
+  for (int k = 0; k < 10; k++) {
+    quadric[k] += other.quadric[k];
+  }
+  for (int j = 0; j < kMaxAttributeChannels; j++) {
+    for (int axis = 0; axis < 3; axis++) {
+      gradient[j][axis] += other.gradient[j][axis];
+    }
+    offset[j] += other.offset[j];
+  }
+  weight += other.weight;
+}
+
+void EdgeCollapse::AttributeQuadric::AddReduced(int channels,
+                                                QuadricMatrix& q) const {
+  for (int k = 0; k < 10; k++) {
+    q.data[k] += quadric[k];
+  }
+  if (weight <= 0.0) {
+    return;
+  }
+  // The best value of each channel is (G.p + E) / weight, which leaves
+  // the quadric minus (G, E)(G, E)^T / weight
+  for (int j = 0; j < channels; j++) {
+    const double u[4] = {gradient[j][0], gradient[j][1], gradient[j][2],
+                         offset[j]};
+    int k = 0;
+    for (int a = 0; a < 4; a++) {
+      for (int b = a; b < 4; b++) {
+        q.data[k++] -= u[a] * u[b] / weight;
+      }
+    }
+  }
+}
+
+void EdgeCollapse::AttributeQuadric::Solve(int channels, const glm::vec3& p,
+                                           double* values) const {
+  for (int j = 0; j < channels; j++) {
+    values[j] = weight > 0.0
+                    ? (gradient[j][0] * p.x + gradient[j][1] * p.y +
+                       gradient[j][2] * p.z + offset[j]) / weight
+                    : 0.0;
+  }
+}
+
 // Quadric Matrix implementation
 EdgeCollapse::QuadricMatrix::QuadricMatrix() {
   for (int i = 0; i < 10; i++) {
-    data[i] = 0.0f;
+    data[i] = 0.0;
   }
 }
 
-void EdgeCollapse::QuadricMatrix::AddPlane(const glm::vec3& normal, float d) {
-  // TODO: Add plane equation to quadric matrix
+void EdgeCollapse::QuadricMatrix::AddPlane(const glm::vec3& normal, float d,
+                                           double weight) {
   // Q = K_p = [a² ab ac ad; ab b² bc bd; ac bc c² cd; ad bd cd d²]
   // where plane is ax + by + cz + d = 0
+  const double p[4] = {normal.x, normal.y, normal.z, d};
+  int k = 0;
+  for (int i = 0; i < 4; i++) {
+    for (int j = i; j < 4; j++) {
+      data[k++] += weight * p[i] * p[j];
+    }
+  }
 }
 
 float EdgeCollapse::QuadricMatrix::ComputeError(const glm::vec3& v) const {
-  // TODO: Compute quadric error for vertex position
-  // Error = v^T * Q * v
-  return 0.0f;
+  // Error = v^T * Q * v with v = (x, y, z, 1)
+  const double x = v.x, y = v.y, z = v.z;
+  double error = data[0] * x * x + 2.0 * data[1] * x * y +
+                 2.0 * data[2] * x * z + 2.0 * data[3] * x +
+                 data[4] * y * y + 2.0 * data[5] * y * z + 2.0 * data[6] * y +
+                 data[7] * z * z + 2.0 * data[8] * z + data[9];
+  // Cancellation can push exact zeros slightly negative
+  return static_cast<float>(std::max(0.0, error));
 }
 
 EdgeCollapse::QuadricMatrix EdgeCollapse::QuadricMatrix::operator+(
@@ -63,39 +1005,1104 @@ EdgeCollapse::QuadricMatrix EdgeCollapse::QuadricMatrix::operator+(
 }
 
 void EdgeCollapse::ComputeQuadrics(
-    const SimplificationMesh& mesh, 
+    const SimplificationMesh& mesh,
     std::vector<QuadricMatrix>& quadrics) {
-  // TODO: Compute quadric error matrices for all vertices
-  // For each face, compute plane equation and add to vertex quadrics
+  attribute_quadrics_.clear();
+  attribute_channels_ = 0;
+  optimizes_normals_ = false;
+  seam_vertices_.clear();
+  if (memoryless_) {
+    quadrics.clear();
+    return;
+  }
+  DECIMATOR_PROFILE_SCOPE("EdgeCollapse.ComputeQuadrics");
+  quadrics.assign(mesh.vertices.size(), QuadricMatrix());
+
+  // Area-weighted plane of every face
+  std::vector<glm::vec3> face_normals(mesh.faces.size());
+  std::vector<float> double_areas(mesh.faces.size());
+  std::vector<float> offsets(mesh.faces.size());
+  GeometryKernels::ComputeFacePlanes(
+      mesh.vertices.data(), mesh.faces.data(), mesh.faces.size(),
+      face_normals.data(), double_areas.data(), offsets.data());
+  for (size_t i = 0; i < mesh.faces.size(); i++) {
+    if (double_areas[i] <= 0.0f) {
+      continue;
+    }
+    const glm::uvec3& face = mesh.faces[i];
+    QuadricMatrix plane;
+    plane.AddPlane(face_normals[i], offsets[i], 0.5 * double_areas[i]);
+    quadrics[face.x] = quadrics[face.x] + plane;
+    quadrics[face.y] = quadrics[face.y] + plane;
+    quadrics[face.z] = quadrics[face.z] + plane;
+  }
+  if (attribute_weight_ > 0.0f) {
+    ComputeAttributeQuadrics(mesh, double_areas);
+  }
+
+  // Boundary edges are the half-edge keys that occur exactly once; sorting
+  // them with their face lets us find those runs in one pass
+  std::vector<uint64_t> keys(mesh.faces.size() * 3);
+  std::vector<uint32_t> key_faces(keys.size());
+  ParallelFor(mesh.faces.size(), [&](size_t i) {
+    const glm::uvec3& face = mesh.faces[i];
+    const unsigned int corners[3] = {face.x, face.y, face.z};
+    for (int c = 0; c < 3; c++) {
+      uint64_t a = std::min(corners[c], corners[(c + 1) % 3]);
+      uint64_t b = std::max(corners[c], corners[(c + 1) % 3]);
+      keys[3 * i + c] = (a << 32) | b;
+      key_faces[3 * i + c] = static_cast<uint32_t>(i);
+    }
+  });
+  RadixSortPairs(keys, key_faces);
+
+  for (size_t i = 0; i < keys.size(); i++) {
+    bool first = i == 0 || keys[i] != keys[i - 1];
+    bool last = i + 1 == keys.size() || keys[i] != keys[i + 1];
+    if (!first || !last) {
+      continue;
+    }
+    const glm::vec3& face_normal = face_normals[key_faces[i]];
+    int a = static_cast<int>(keys[i] >> 32);
+    int b = static_cast<int>(keys[i] & 0xFFFFFFFFu);
+    glm::vec3 edge_dir = mesh.vertices[b] - mesh.vertices[a];
+    glm::vec3 normal = glm::cross(edge_dir, face_normal);
+    float length = glm::length(normal);
+    if (length <= 0.0f) {
+      continue;
+    }
+    normal /= length;
+
+    QuadricMatrix plane;
+    plane.AddPlane(normal, -glm::dot(normal, mesh.vertices[a]),
+                   kBoundaryWeight * glm::dot(edge_dir, edge_dir));
+    quadrics[a] = quadrics[a] + plane;
+    quadrics[b] = quadrics[b] + plane;
+  }
+}
+
+void EdgeCollapse::ComputeAttributeQuadrics(
+    const SimplificationMesh& mesh, const std::vector<float>& double_areas) {
+  const size_t vertex_count = mesh.vertices.size();
+  optimizes_normals_ = mesh.normals.size() == vertex_count;
+  optimizes_colors_ = mesh.colors.size() == vertex_count;
+  optimizes_texcoords_ = mesh.texcoords.size() == vertex_count;
+  attribute_channels_ = (optimizes_normals_ ? 3 : 0) +
+                        (optimizes_colors_ ? 3 : 0) +
+                        (optimizes_texcoords_ ? 2 : 0);
+  if (attribute_channels_ == 0) {
+    return;
+  }
+  attribute_quadrics_.assign(vertex_count, AttributeQuadric());
+  FindSeamVertices(mesh);
+
+  double values[3][kMaxAttributeChannels];
+  for (size_t i = 0; i < mesh.faces.size(); i++) {
+    if (double_areas[i] <= 0.0f) {
+      continue;
+    }
+    const glm::uvec3& face = mesh.faces[i];
+    const glm::dvec3 p0(mesh.vertices[face.x]);
+    const glm::dvec3 e1 = glm::dvec3(mesh.vertices[face.y]) - p0;
+    const glm::dvec3 e2 = glm::dvec3(mesh.vertices[face.z]) - p0;
+    const glm::dvec3 n = glm::cross(e1, e2);
+    const double length2 = glm::dot(n, n);
+    if (length2 <= 0.0) {
+      continue;
+    }
+    // Gradients lie in the face plane and match the differences along
+    // both edges: g = d1 * along1 + d2 * along2
+    const glm::dvec3 along1 = glm::cross(e2, n) / length2;
+    const glm::dvec3 along2 = glm::cross(n, e1) / length2;
+    for (int c = 0; c < 3; c++) {
+      GetAttributes(mesh, static_cast<int>(face[c]), values[c]);
+    }
+
+    AttributeQuadric face_quadric;
+    face_quadric.weight = 0.5 * attribute_weight_ * double_areas[i];
+    const double w = face_quadric.weight;
+    for (int j = 0; j < attribute_channels_; j++) {
+      const glm::dvec3 g = (values[1][j] - values[0][j]) * along1 +
+                           (values[2][j] - values[0][j]) * along2;
+      const double e = values[0][j] - glm::dot(g, p0);
+      const double u[4] = {g.x, g.y, g.z, e};
+      int k = 0;
+      for (int a = 0; a < 4; a++) {
+        for (int b = a; b < 4; b++) {
+          face_quadric.quadric[k++] += w * u[a] * u[b];
+        }
+      }
+      for (int axis = 0; axis < 3; axis++) {
+        face_quadric.gradient[j][axis] = w * g[axis];
+      }
+      face_quadric.offset[j] = w * e;
+    }
+    attribute_quadrics_[face.x].Add(face_quadric);
+    attribute_quadrics_[face.y].Add(face_quadric);
+    attribute_quadrics_[face.z].Add(face_quadric);
+  }
+}
+
+void EdgeCollapse::FindSeamVertices(const SimplificationMesh& mesh) {
+  // Vertices sorted by position, so split ones end up next to each other
+  const std::vector<glm::vec3>& positions = mesh.vertices;
+  std::vector<int> order(positions.size());
+  for (size_t i = 0; i < order.size(); i++) {
+    order[i] = static_cast<int>(i);
+  }
+  std::sort(order.begin(), order.end(), [&](int a, int b) {
+    const glm::vec3& pa = positions[a];
+    const glm::vec3& pb = positions[b];
+    if (pa.x != pb.x) return pa.x < pb.x;
+    if (pa.y != pb.y) return pa.y < pb.y;
+    return pa.z < pb.z;
+  });
+  seam_vertices_.assign(positions.size(), 0);
+  for (size_t i = 1; i < order.size(); i++) {
+    if (positions[order[i]] == positions[order[i - 1]]) {
+      seam_vertices_[order[i]] = 1;
+      seam_vertices_[order[i - 1]] = 1;
+    }
+  }
+}
+
+void EdgeCollapse::GetAttributes(const SimplificationMesh& mesh,
+                                 int vertex_index, double* values) const {
+  int j = 0;
+  if (optimizes_normals_) {
+    const glm::vec3& normal = mesh.normals[vertex_index];
+    for (int c = 0; c < 3; c++) values[j++] = normal[c];
+  }
+  if (optimizes_colors_) {
+    const glm::vec3& color = mesh.colors[vertex_index];
+    for (int c = 0; c < 3; c++) values[j++] = color[c];
+  }
+  if (optimizes_texcoords_) {
+    const glm::vec2& texcoord = mesh.texcoords[vertex_index];
+    for (int c = 0; c < 2; c++) values[j++] = texcoord[c];
+  }
+}
+
+void EdgeCollapse::SetAttributes(SimplificationMesh& mesh, int vertex_index,
+                                 const double* values) const {
+  int j = 0;
+  if (optimizes_normals_) {
+    glm::vec3 normal(values[j], values[j + 1], values[j + 2]);
+    j += 3;
+    const float length = glm::length(normal);
+    if (length > 0.0f) {
+      mesh.normals[vertex_index] = normal / length;
+    }
+  }
+  if (optimizes_colors_) {
+    mesh.colors[vertex_index] =
+        glm::vec3(values[j], values[j + 1], values[j + 2]);
+    j += 3;
+  }
+  if (optimizes_texcoords_) {
+    mesh.texcoords[vertex_index] = glm::vec2(values[j], values[j + 1]);
+  }
 }
 
-void EdgeCollapse::BuildEdgeList(const SimplificationMesh& mesh, 
+EdgeCollapse::QuadricMatrix EdgeCollapse::GetCollapseQuadric(
+    const std::vector<QuadricMatrix>& quadrics, int v1, int v2) const {
+  QuadricMatrix q = quadrics[v1] + quadrics[v2];
+  if (attribute_channels_ > 0) {
+    AttributeQuadric attributes = attribute_quadrics_[v1];
+    attributes.Add(attribute_quadrics_[v2]);
+    attributes.AddReduced(attribute_channels_, q);
+  }
+  return q;
+}
+
+void EdgeCollapse::MergeQuadrics(SimplificationMesh& mesh,
+                                 std::vector<QuadricMatrix>& quadrics,
+                                 const Edge& edge) {
+  if (memoryless_) {
+    return;
+  }
+  quadrics[edge.v1] = quadrics[edge.v1] + quadrics[edge.v2];
+  if (attribute_channels_ > 0) {
+    AttributeQuadric& attributes = attribute_quadrics_[edge.v1];
+    attributes.Add(attribute_quadrics_[edge.v2]);
+    // Locked (and seam) vertices and restricted runs keep the attributes
+    // of the kept vertex
+    if (!IsLocked(edge.v1) && !restricts_positions_) {
+      double values[kMaxAttributeChannels];
+      attributes.Solve(attribute_channels_, mesh.vertices[edge.v1], values);
+      SetAttributes(mesh, edge.v1, values);
+    }
+  }
+}
+
+void EdgeCollapse::RunParallelCollapses(SimplificationMesh& mesh,
+                                        const SimplificationBudget& budget,
+                                        CollapseRun& run) {
+  ComputeQuadrics(mesh, run.quadrics);
+  BuildAdjacency(mesh);
+  run.vertex_count = static_cast<int>(mesh.vertices.size());
+  run.face_count = static_cast<int>(mesh.faces.size());
+  run.max_error = 0.0f;
+  std::vector<QuadricMatrix>& quadrics = run.quadrics;
+
+  // Candidates are kept unordered; stale and rejected ones are dropped at
+  // the end of each round
+  std::vector<Edge> candidates;
+  {
+    DECIMATOR_PROFILE_SCOPE("EdgeCollapse.BuildQueue");
+    BuildEdgeList(mesh, quadrics, candidates);
+  }
+
+  DECIMATOR_PROFILE_SCOPE("EdgeCollapse.ParallelRounds");
+  // Per-vertex claim of the current selection pass: (~pass << 32) |
+  // priority. Claims of earlier passes compare greater, so they never need
+  // clearing.
+  std::vector<std::atomic<uint64_t>> claims(mesh.vertices.size());
+  ParallelFor(claims.size(), [&](size_t i) {
+    claims[i].store(UINT64_MAX, std::memory_order_relaxed);
+  });
+  uint32_t pass = 0;
+  // round + 1 on the vertices of the regions selected in that round
+  std::vector<uint32_t> locks(mesh.vertices.size(), 0);
+
+  const size_t kSampleSize = 4096;
+  const size_t min_window = kMinParallelWindow;
+  std::vector<uint64_t> keys, sample, window_keys;
+  std::vector<uint32_t> ids, window, pending, next_pending, selected;
+  std::vector<size_t> region_offsets;
+  std::vector<int> regions;
+  std::vector<uint8_t> dropped, state, applied_flags;
+  std::vector<float> errors;
+  std::vector<CollapseCounts> removed;
+  std::vector<Edge> kept;
+  for (uint32_t round = 0;
+       !budget.IsReached(run.vertex_count, run.face_count) &&
+       !candidates.empty();
+       round++) {
+    DECIMATOR_COUNT("EdgeCollapse.parallel_rounds", 1);
+    const size_t candidate_count = candidates.size();
+
+    // 1. The window: the cheapest window_size candidates in queue order.
+    //    The key threshold comes from an evenly spaced sample.
+    size_t needed = static_cast<size_t>(run.vertex_count -
+                                        budget.target_vertex_count);
+    needed = std::min(needed, static_cast<size_t>(run.face_count -
+                                                  budget.target_face_count) /
+                                      2 + 1);
+    const size_t window_size = std::max(
+        min_window, std::min(needed, static_cast<size_t>(run.vertex_count) /
+                                         kParallelWindowDivisor));
+    keys.resize(candidate_count);
+    ParallelFor(candidate_count,
+                [&](size_t i) { keys[i] = candidates[i].GetOrderKey(); });
+    uint64_t threshold = UINT64_MAX;
+    if (window_size < candidate_count) {
+      const size_t sample_count = std::min(kSampleSize, candidate_count);
+      sample.resize(sample_count);
+      for (size_t i = 0; i < sample_count; i++) {
+        sample[i] = keys[i * candidate_count / sample_count];
+      }
+      std::sort(sample.begin(), sample.end());
+      threshold = sample[window_size * sample_count / candidate_count];
+    }
+    ids.resize(candidate_count);
+    ParallelFor(candidate_count,
+                [&](size_t i) { ids[i] = static_cast<uint32_t>(i); });
+    CompactIf(ids, window, [&](size_t i) { return keys[i] <= threshold; });
+    window_keys.resize(window.size());
+    ParallelFor(window.size(),
+                [&](size_t j) { window_keys[j] = keys[window[j]]; });
+    RadixSortPairs(window_keys, window);
+    if (window.size() > window_size) {
+      window.resize(window_size);  // Ties at the threshold
+    }
+    const size_t window_count = window.size();
+
+    // 2. The region of each current window edge: the corners of the faces
+    //    around both endpoints, i.e. everything its collapse reads or
+    //    writes. Stale edges are dropped.
+    dropped.assign(candidate_count, 0);
+    region_offsets.resize(window_count + 1);
+    ParallelFor(window_count, [&](size_t j) {
+      const Edge& edge = candidates[window[j]];
+      size_t corners = 0;
+      if (vertex_removed_[edge.v1] || vertex_removed_[edge.v2] ||
+          vertex_version_[edge.v1] != edge.version1 ||
+          vertex_version_[edge.v2] != edge.version2) {
+        DECIMATOR_COUNT("EdgeCollapse.stale_pops", 1);
+        dropped[window[j]] = 1;
+      } else if (IsLocked(edge.v2)) {
+        DECIMATOR_COUNT("EdgeCollapse.rejected_locked", 1);
+        dropped[window[j]] = 1;
+      } else {
+        corners = 3 * (vertex_faces_[edge.v1].size() +
+                       vertex_faces_[edge.v2].size());
+      }
+      region_offsets[j] = corners;
+    }, kCollapseGrainSize);
+    region_offsets[window_count] = 0;
+    const size_t region_size = ExclusiveScan(region_offsets, region_offsets);
+    regions.resize(region_size);
+    ParallelFor(window_count, [&](size_t j) {
+      if (dropped[window[j]]) return;
+      const Edge& edge = candidates[window[j]];
+      size_t out = region_offsets[j];
+      const int ends[2] = {edge.v1, edge.v2};
+      for (int v : ends) {
+        for (int f : vertex_faces_[v]) {
+          const glm::uvec3& face = mesh.faces[f];
+          regions[out++] = face.x;
+          regions[out++] = face.y;
+          regions[out++] = face.z;
+        }
+      }
+    }, kCollapseGrainSize);
+
+    // 3. Select window edges with disjoint regions, so their collapses can
+    //    run concurrently. Each pass, pending edges claim their region with
+    //    a priority (a mix of their rank, so local winners are spread over
+    //    the window instead of only at cost minima); holders of all their
+    //    claims are selected and lock their region, and pending edges
+    //    touching a locked vertex wait for the next round. This is a greedy
+    //    maximal set, found in a few passes.
+    const uint32_t lock_stamp = round + 1;
+    state.assign(window_count, 0);  // 1: selected
+    ids.resize(window_count);
+    ParallelFor(window_count,
+                [&](size_t j) { ids[j] = static_cast<uint32_t>(j); });
+    CompactIf(ids, pending,
+              [&](size_t j) { return !dropped[window[j]]; });
+    while (!pending.empty()) {
+      DECIMATOR_COUNT("EdgeCollapse.selection_passes", 1);
+      const uint64_t pass_bits = static_cast<uint64_t>(~pass++) << 32;
+      CompactIf(pending, next_pending, [&](size_t p) {
+        for (size_t r = region_offsets[pending[p]];
+             r < region_offsets[pending[p] + 1]; r++) {
+          if (locks[regions[r]] == lock_stamp) return false;
+        }
+        return true;
+      });
+      pending.swap(next_pending);
+      ParallelFor(pending.size(), [&](size_t p) {
+        const uint32_t j = pending[p];
+        const uint64_t claim = pass_bits | MixRank(j);
+        for (size_t r = region_offsets[j]; r < region_offsets[j + 1]; r++) {
+          std::atomic<uint64_t>& slot = claims[regions[r]];
+          uint64_t current = slot.load(std::memory_order_relaxed);
+          while (claim < current &&
+                 !slot.compare_exchange_weak(current, claim,
+                                             std::memory_order_relaxed)) {
+          }
+        }
+      }, kCollapseGrainSize);
+      // Winners' regions are disjoint, so each lock has a single writer
+      ParallelFor(pending.size(), [&](size_t p) {
+        const uint32_t j = pending[p];
+        const uint64_t claim = pass_bits | MixRank(j);
+        for (size_t r = region_offsets[j]; r < region_offsets[j + 1]; r++) {
+          if (claims[regions[r]].load(std::memory_order_relaxed) != claim) {
+            return;
+          }
+        }
+        state[j] = 1;
+        for (size_t r = region_offsets[j]; r < region_offsets[j + 1]; r++) {
+          locks[regions[r]] = lock_stamp;
+        }
+      }, kCollapseGrainSize);
+      CompactIf(pending, next_pending,
+                [&](size_t p) { return !state[pending[p]]; });
+      pending.swap(next_pending);
+    }
+
+    // 4. Validate the selected edges as the serial loop does when popping
+    //    them; rejected edges are dropped for good, like popped ones (new
+    //    edges replace them when an endpoint changes)
+    CompactIf(ids, selected, [&](size_t j) { return state[j] != 0; });
+    errors.resize(selected.size());
+    removed.resize(selected.size());
+    applied_flags.assign(selected.size(), 0);
+    ParallelFor(selected.size(), [&](size_t k) {
+      const Edge& edge = candidates[window[selected[k]]];
+      dropped[window[selected[k]]] = 1;
+      if (OrphansLockedVertex(mesh, edge) ||
+          JoinsLockedVertices(mesh, edge)) {
+        DECIMATOR_COUNT("EdgeCollapse.rejected_locked", 1);
+        return;
+      }
+      if (!SatisfiesLinkCondition(mesh, edge)) {
+        DECIMATOR_COUNT("EdgeCollapse.rejected_link_condition", 1);
+        return;
+      }
+      errors[k] = GetGeometricError(mesh, edge, quadrics);
+      if (!budget.AllowsError(errors[k])) {
+        DECIMATOR_COUNT("EdgeCollapse.rejected_max_error", 1);
+        return;
+      }
+      if (CausesFoldOver(mesh, edge)) {
+        DECIMATOR_COUNT("EdgeCollapse.rejected_fold_over", 1);
+        return;
+      }
+      int shared = 0;
+      for (int f : vertex_faces_[edge.v1]) {
+        const glm::uvec3& face = mesh.faces[f];
+        if (!face_removed_[f] && (static_cast<int>(face.x) == edge.v2 ||
+                                  static_cast<int>(face.y) == edge.v2 ||
+                                  static_cast<int>(face.z) == edge.v2)) {
+          shared++;
+        }
+      }
+      removed[k].faces = shared;
+      VertexList orphans;
+      GatherOrphanedVertices(mesh, edge, orphans);
+      removed[k].vertices = 1 + static_cast<int>(orphans.Size());
+      applied_flags[k] = 1;
+    }, kCollapseGrainSize);
+
+    // 5. Stop exactly at the budget, counting the valid collapses in queue
+    //    order as the serial loop would perform them
+    size_t apply_count = 0;
+    for (size_t k = 0; k < selected.size(); k++) {
+      if (!applied_flags[k]) continue;
+      if (budget.IsReached(run.vertex_count, run.face_count)) {
+        // Not performed; they stay candidates
+        for (size_t rest = k; rest < selected.size(); rest++) {
+          dropped[window[selected[rest]]] = 0;
+        }
+        break;
+      }
+      run.vertex_count -= removed[k].vertices;
+      run.face_count -= removed[k].faces;
+      run.max_error = std::max(run.max_error, errors[k]);
+      selected[apply_count++] = selected[k];
+    }
+    selected.resize(apply_count);
+    DECIMATOR_COUNT("EdgeCollapse.collapses", apply_count);
+
+    // 6. Collapse them concurrently, then compute new candidates for every
+    //    edge around the merged vertices (appended in collapse order, so the
+    //    result doesn't depend on the worker count)
+    ParallelFor(apply_count, [&](size_t k) {
+      const Edge& edge = candidates[window[selected[k]]];
+      CollapseEdge(mesh, edge, nullptr);
+      MergeQuadrics(mesh, quadrics, edge);
+    }, kCollapseGrainSize);
+    std::vector<std::vector<Edge>> chunk_edges(
+        GetParallelChunkCount(apply_count, kCollapseGrainSize));
+    ParallelChunks(apply_count, [&](size_t c, size_t begin, size_t end) {
+      std::vector<int> neighbors;
+      std::vector<Edge>& updated = chunk_edges[c];
+      for (size_t k = begin; k < end; k++) {
+        const int v1 = candidates[window[selected[k]]].v1;
+        CollectNeighbors(mesh, v1, neighbors);
+        for (int neighbor : neighbors) {
+          Edge edge;
+          edge.v1 = v1;
+          edge.v2 = neighbor;
+          updated.push_back(edge);
+        }
+      }
+      ComputeEdgeCosts(mesh, quadrics, updated.data(), updated.size());
+    }, kCollapseGrainSize);
+
+    // 7. Keep the candidates that are still current
+    CompactIf(candidates, kept, [&](size_t i) {
+      const Edge& edge = candidates[i];
+      return !dropped[i] && !vertex_removed_[edge.v1] &&
+             !vertex_removed_[edge.v2] &&
+             vertex_version_[edge.v1] == edge.version1 &&
+             vertex_version_[edge.v2] == edge.version2;
+    });
+    for (const std::vector<Edge>& updated : chunk_edges) {
+      kept.insert(kept.end(), updated.begin(), updated.end());
+      DECIMATOR_COUNT("EdgeCollapse.queue_pushes", updated.size());
+    }
+    candidates.swap(kept);
+  }
+}
+
+uint64_t EdgeCollapse::Edge::GetOrderKey() const {
+  // Non-negative floats order like their bit patterns; -0 maps to 0
+  uint32_t error_bits = 0;
+  if (error > 0.0f) {
+    std::memcpy(&error_bits, &error, sizeof(error_bits));
+  }
+  uint32_t length_bits;
+  std::memcpy(&length_bits, &length2, sizeof(length_bits));
+  return static_cast<uint64_t>(error_bits) << 32 | length_bits;
+}
+
+void EdgeCollapse::BuildAdjacency(const SimplificationMesh& mesh) {
+  vertex_faces_.assign(mesh.vertices.size(), std::vector<int>());
+  for (size_t i = 0; i < mesh.faces.size(); i++) {
+    const glm::uvec3& face = mesh.faces[i];
+    vertex_faces_[face.x].push_back(static_cast<int>(i));
+    vertex_faces_[face.y].push_back(static_cast<int>(i));
+    vertex_faces_[face.z].push_back(static_cast<int>(i));
+  }
+  face_removed_.assign(mesh.faces.size(), false);
+  vertex_removed_.assign(mesh.vertices.size(), false);
+  vertex_version_.assign(mesh.vertices.size(), 0);
+  has_locks_ = locked_vertices_.size() == mesh.vertices.size();
+  restricts_positions_ = restrict_to_original_positions_;
+  updates_normals_ =
+      mesh.normals.size() == mesh.vertices.size() && !optimizes_normals_;
+  normal_dirty_.assign(updates_normals_ ? mesh.vertices.size() : 0, 0);
+}
+
+void EdgeCollapse::BuildEdgeList(const SimplificationMesh& mesh,
+                                  const std::vector<QuadricMatrix>& quadrics,
                                   std::vector<Edge>& edges) {
-  // TODO: Build list of all edges from faces
+  std::vector<MeshEdge> unique_edges = mesh.GetUniqueEdges();
+  edges.resize(unique_edges.size());
+  // Initial costs are independent per edge
+  ParallelChunks(unique_edges.size(), [&](size_t, size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++) {
+      edges[i].v1 = unique_edges[i].v1;
+      edges[i].v2 = unique_edges[i].v2;
+    }
+    ComputeEdgeCosts(mesh, quadrics, edges.data() + begin, end - begin);
+  });
 }
 
-float EdgeCollapse::ComputeEdgeCollapseError(
-    const Edge& edge, 
-    const std::vector<QuadricMatrix>& quadrics) {
-  // TODO: Compute error of collapsing this edge
-  return 0.0f;
+void EdgeCollapse::ComputeEdgeCosts(const SimplificationMesh& mesh,
+                                    const std::vector<QuadricMatrix>& quadrics,
+                                    Edge* edges, size_t count) const {
+  if (memoryless_) {
+    ComputeMemorylessCosts(mesh, edges, count);
+    return;
+  }
+  const size_t kBatch = GeometryKernels::kQuadricBatch;
+  GeometryKernels::QuadricBatch batch;
+  for (size_t first = 0; first < count; first += kBatch) {
+    const size_t lanes = std::min(kBatch, count - first);
+    // Unused lanes repeat the last edge
+    for (size_t lane = 0; lane < kBatch; lane++) {
+      const Edge& edge = edges[first + std::min(lane, lanes - 1)];
+      const QuadricMatrix q = GetCollapseQuadric(quadrics, edge.v1, edge.v2);
+      for (int k = 0; k < 10; k++) {
+        batch.quadric[k][lane] = q.data[k];
+      }
+      const glm::vec3& p1 = mesh.vertices[edge.v1];
+      const glm::vec3& p2 = mesh.vertices[edge.v2];
+      for (int axis = 0; axis < 3; axis++) {
+        batch.first[axis][lane] = p1[axis];
+        batch.second[axis][lane] = p2[axis];
+      }
+    }
+    // With restricted positions the kept vertex (v1) never moves, so the
+    // solve only picks the cheaper endpoint
+    GeometryKernels::SolveQuadricBatch(batch, restricts_positions_);
+
+    for (size_t lane = 0; lane < lanes; lane++) {
+      Edge& edge = edges[first + lane];
+      if (batch.keeps_second[lane]) {
+        std::swap(edge.v1, edge.v2);
+      }
+      edge.optimal_pos = glm::vec3(batch.position[0][lane],
+                                   batch.position[1][lane],
+                                   batch.position[2][lane]);
+      edge.error = batch.error[lane];
+      if (IsLocked(edge.v1) || IsLocked(edge.v2)) {
+        // Collapses onto the locked endpoint where it is (with two locked
+        // endpoints the collapse is rejected when popped)
+        if (IsLocked(edge.v2)) {
+          std::swap(edge.v1, edge.v2);
+        }
+        edge.optimal_pos = mesh.vertices[edge.v1];
+        edge.error = GetCollapseQuadric(quadrics, edge.v1, edge.v2)
+                         .ComputeError(edge.optimal_pos);
+      }
+      edge.version1 = vertex_version_[edge.v1];
+      edge.version2 = vertex_version_[edge.v2];
+      glm::vec3 dir = mesh.vertices[edge.v2] - mesh.vertices[edge.v1];
+      edge.length2 = glm::dot(dir, dir);
+    }
+  }
 }
 
-glm::vec3 EdgeCollapse::ComputeOptimalPosition(
-    const Edge& edge, 
-    const std::vector<QuadricMatrix>& quadrics) {
-  // TODO: Compute optimal position for collapsed vertex
-  // Solve: Q_bar * v_bar = 0, where Q_bar = Q1 + Q2
-  return glm::vec3(0.0f);
+void EdgeCollapse::ComputeMemorylessCosts(const SimplificationMesh& mesh,
+                                          Edge* edges, size_t count) const {
+  LocalGeometry geometry;
+  for (size_t i = 0; i < count; i++) {
+    Edge& edge = edges[i];
+    geometry.Gather(mesh, vertex_faces_, face_removed_, edge.v1, edge.v2);
+    const glm::dvec3 p1(mesh.vertices[edge.v1]);
+    const glm::dvec3 p2(mesh.vertices[edge.v2]);
+    const double length2 = glm::dot(p2 - p1, p2 - p1);
+
+    glm::dvec3 position;
+    if (IsLocked(edge.v1) || IsLocked(edge.v2)) {
+      // Collapses onto the locked endpoint where it is (with two locked
+      // endpoints the collapse is rejected when popped)
+      if (IsLocked(edge.v2)) {
+        std::swap(edge.v1, edge.v2);
+      }
+      position = glm::dvec3(mesh.vertices[edge.v1]);
+    } else if (restricts_positions_) {
+      if (geometry.GetCost(p2, length2) < geometry.GetCost(p1, length2)) {
+        std::swap(edge.v1, edge.v2);
+      }
+      position = glm::dvec3(mesh.vertices[edge.v1]);
+    } else {
+      position = geometry.Solve(length2, 0.5 * (p1 + p2));
+    }
+    edge.optimal_pos = glm::vec3(position);
+    // The cost has units of volume squared; its cube root orders the same
+    // and stays well within float range on small meshes
+    edge.error = static_cast<float>(
+        std::cbrt(geometry.GetCost(position, length2)));
+    edge.version1 = vertex_version_[edge.v1];
+    edge.version2 = vertex_version_[edge.v2];
+    glm::vec3 dir = mesh.vertices[edge.v2] - mesh.vertices[edge.v1];
+    edge.length2 = glm::dot(dir, dir);
+  }
 }
 
-void EdgeCollapse::CollapseEdge(SimplificationMesh& mesh, const Edge& edge) {
-  // TODO: Perform edge collapse operation
-  // 1. Move v1 to optimal position
+float EdgeCollapse::GetGeometricError(
+    const SimplificationMesh& mesh, const Edge& edge,
+    const std::vector<QuadricMatrix>& quadrics) const {
+  if (memoryless_) {
+    LocalGeometry geometry;
+    geometry.Gather(mesh, vertex_faces_, face_removed_, edge.v1, edge.v2);
+    return static_cast<float>(
+        geometry.GetDistance(glm::dvec3(edge.optimal_pos)));
+  }
+  QuadricMatrix q = quadrics[edge.v1] + quadrics[edge.v2];
+  double weight = q.data[0] + q.data[4] + q.data[7];
+  if (weight <= 0.0) {
+    return 0.0f;
+  }
+  // The cost also counts attribute error then; measure geometry alone
+  const float error = attribute_channels_ > 0
+                          ? q.ComputeError(edge.optimal_pos)
+                          : edge.error;
+  return static_cast<float>(std::sqrt(error / weight));
+}
+
+void EdgeCollapse::CollectNeighbors(const SimplificationMesh& mesh,
+                                    int vertex_index,
+                                    std::vector<int>& neighbors) const {
+  neighbors.clear();
+  for (int f : vertex_faces_[vertex_index]) {
+    if (face_removed_[f]) continue;
+    const glm::uvec3& face = mesh.faces[f];
+    if (static_cast<int>(face.x) != vertex_index) neighbors.push_back(face.x);
+    if (static_cast<int>(face.y) != vertex_index) neighbors.push_back(face.y);
+    if (static_cast<int>(face.z) != vertex_index) neighbors.push_back(face.z);
+  }
+  std::sort(neighbors.begin(), neighbors.end());
+  neighbors.erase(std::unique(neighbors.begin(), neighbors.end()),
+                  neighbors.end());
+}
+
+void EdgeCollapse::FindVirtualPairs(const SimplificationMesh& mesh,
+                                    const SpatialHash& hash,
+                                    int vertex_index,
+                                    const std::vector<int>& neighbors,
+                                    bool later_only,
+                                    std::vector<Edge>& pairs) const {
+  std::vector<int> nearby;
+  hash.FindNear(mesh.vertices[vertex_index], pair_distance_, mesh.vertices,
+                vertex_index, nearby);
+  for (int v : nearby) {
+    if ((later_only && v < vertex_index) ||
+        std::binary_search(neighbors.begin(), neighbors.end(), v)) {
+      continue;
+    }
+    Edge pair;
+    pair.v1 = vertex_index;
+    pair.v2 = v;
+    pairs.push_back(pair);
+  }
+}
+
+void EdgeCollapse::AddVirtualPairs(const SimplificationMesh& mesh,
+                                   CollapseRun& run,
+                                   std::vector<Edge>& edges) const {
+  DECIMATOR_PROFILE_SCOPE("EdgeCollapse.VirtualPairs");
+  run.pair_hash.Reset(pair_distance_);
+  for (size_t i = 0; i < mesh.vertices.size(); i++) {
+    run.pair_hash.Insert(static_cast<int>(i), mesh.vertices[i]);
+  }
+  const size_t first_pair = edges.size();
+  std::vector<int> neighbors;
+  for (size_t i = 0; i < mesh.vertices.size(); i++) {
+    CollectNeighbors(mesh, static_cast<int>(i), neighbors);
+    FindVirtualPairs(mesh, run.pair_hash, static_cast<int>(i), neighbors,
+                     true, edges);
+  }
+  ComputeEdgeCosts(mesh, run.quadrics, edges.data() + first_pair,
+                   edges.size() - first_pair);
+  DECIMATOR_COUNT("EdgeCollapse.virtual_pairs", edges.size() - first_pair);
+}
+
+bool EdgeCollapse::SatisfiesLinkCondition(const SimplificationMesh& mesh,
+                                          const Edge& edge) const {
+  // Opposite vertices of the faces sharing the edge
+  VertexList opposite;
+  for (int f : vertex_faces_[edge.v1]) {
+    if (face_removed_[f]) continue;
+    const glm::uvec3& face = mesh.faces[f];
+    int corners[3] = {static_cast<int>(face.x), static_cast<int>(face.y),
+                      static_cast<int>(face.z)};
+    bool has_v2 = corners[0] == edge.v2 || corners[1] == edge.v2 ||
+                  corners[2] == edge.v2;
+    if (!has_v2) continue;
+    for (int c : corners) {
+      if (c != edge.v1 && c != edge.v2) opposite.Add(c);
+    }
+  }
+  if (opposite.Empty() && pair_distance_ <= 0.0f) {
+    return false;  // Edge no longer exists
+  }
+  opposite.Sort();
+
+  // Merge the sorted one-rings, matching each common neighbor against the
+  // opposite vertices. Duplicated opposite vertices (a non-manifold fan)
+  // also fail here.
+  VertexList ring1, ring2;
+  GatherRingVertices(mesh, vertex_faces_[edge.v1], face_removed_, edge.v1,
+                     ring1);
+  GatherRingVertices(mesh, vertex_faces_[edge.v2], face_removed_, edge.v2,
+                     ring2);
+  size_t i = 0, j = 0, matched = 0;
+  while (i < ring1.Size() && j < ring2.Size()) {
+    if (ring1[i] < ring2[j]) {
+      i++;
+    } else if (ring2[j] < ring1[i]) {
+      j++;
+    } else {
+      if (matched == opposite.Size() || opposite[matched] != ring1[i]) {
+        return false;
+      }
+      matched++;
+      i++;
+      j++;
+    }
+  }
+  return matched == opposite.Size();
+}
+
+bool EdgeCollapse::IsCollapseValid(const SimplificationMesh& mesh,
+                                   const Edge& edge,
+                                   const std::vector<QuadricMatrix>& quadrics,
+                                   const SimplificationBudget& budget,
+                                   float& geometric_error) const {
+  if (IsLocked(edge.v2) || OrphansLockedVertex(mesh, edge) ||
+      JoinsLockedVertices(mesh, edge)) {
+    DECIMATOR_COUNT("EdgeCollapse.rejected_locked", 1);
+    return false;
+  }
+  if (!SatisfiesLinkCondition(mesh, edge)) {
+    DECIMATOR_COUNT("EdgeCollapse.rejected_link_condition", 1);
+    return false;
+  }
+  geometric_error = GetGeometricError(mesh, edge, quadrics);
+  if (!budget.AllowsError(geometric_error)) {
+    DECIMATOR_COUNT("EdgeCollapse.rejected_max_error", 1);
+    return false;
+  }
+  if (CausesFoldOver(mesh, edge)) {
+    DECIMATOR_COUNT("EdgeCollapse.rejected_fold_over", 1);
+    return false;
+  }
+  return true;
+}
+
+bool EdgeCollapse::CausesFoldOver(const SimplificationMesh& mesh,
+                                  const Edge& edge) const {
+  // Faces around the edge go to the flip kernel a batch at a time
+  GeometryKernels::FlipBatch batch;
+  size_t count = 0;
+  for (int c = 0; c < 3; c++) {
+    for (size_t lane = 0; lane < GeometryKernels::kFlipBatch; lane++) {
+      batch.target[c][lane] = edge.optimal_pos[c];
+    }
+  }
+  const int ends[2] = {edge.v1, edge.v2};
+  for (int end : ends) {
+    for (int f : vertex_faces_[end]) {
+      if (face_removed_[f]) continue;
+      const glm::uvec3& face = mesh.faces[f];
+      int moved = -1;
+      bool collapses = false;
+      for (int c = 0; c < 3; c++) {
+        const int corner = static_cast<int>(face[c]);
+        if (corner == edge.v1 || corner == edge.v2) {
+          collapses = moved >= 0;
+          moved = c;
+        }
+      }
+      if (collapses) continue;  // Collapses away with the edge
+
+      for (int c = 0; c < 3; c++) {
+        const glm::vec3& position = mesh.vertices[face[c]];
+        batch.corners[c][0][count] = position.x;
+        batch.corners[c][1][count] = position.y;
+        batch.corners[c][2][count] = position.z;
+      }
+      batch.moved[count] = moved;
+      if (++count == GeometryKernels::kFlipBatch) {
+        if (GeometryKernels::HasFlippedFaces(batch, count)) {
+          return true;
+        }
+        count = 0;
+      }
+    }
+  }
+  return count > 0 && GeometryKernels::HasFlippedFaces(batch, count);
+}
+
+EdgeCollapse::CollapseCounts EdgeCollapse::CollapseEdge(
+    SimplificationMesh& mesh, const Edge& edge, CollapseLog* log,
+    VertexList* orphans) {
+  if (orphans != nullptr) {
+    orphans->Clear();
+  }
+  if (log != nullptr) {
+    log->kept.push_back(edge.v1);
+    log->removed.push_back(edge.v2);
+    log->old_positions.push_back(mesh.vertices[edge.v1]);
+    log->new_positions.push_back(edge.optimal_pos);
+  }
+
+  // 1. Move v1 to optimal position (interpolating per-vertex attributes by
+  //    where it lands along the edge)
+  const glm::vec3 p1 = mesh.vertices[edge.v1];
+  const glm::vec3 p2 = mesh.vertices[edge.v2];
+  glm::vec3 dir = p2 - p1;
+  float length2 = glm::dot(dir, dir);
+  float t = length2 > 0.0f ? glm::dot(edge.optimal_pos - p1, dir) / length2
+                           : 0.5f;
+  t = std::max(0.0f, std::min(1.0f, t));
+  mesh.vertices[edge.v1] = edge.optimal_pos;
+  if (mesh.colors.size() == mesh.vertices.size()) {
+    mesh.colors[edge.v1] += t * (mesh.colors[edge.v2] - mesh.colors[edge.v1]);
+  }
+  if (mesh.texcoords.size() == mesh.vertices.size()) {
+    mesh.texcoords[edge.v1] +=
+        t * (mesh.texcoords[edge.v2] - mesh.texcoords[edge.v1]);
+  }
+
   // 2. Update all faces referencing v2 to reference v1
-  // 3. Remove degenerate faces
-  // 4. Remove v2 from vertex list
+  // 3. Remove degenerate faces (the ones that contained both)
+  const unsigned int from = static_cast<unsigned int>(edge.v2);
+  const unsigned int to = static_cast<unsigned int>(edge.v1);
+  int removed_faces = 0;
+  VertexList third_corners;
+  for (int f : vertex_faces_[edge.v2]) {
+    if (face_removed_[f]) continue;
+    glm::uvec3& face = mesh.faces[f];
+    if (face.x == to || face.y == to || face.z == to) {
+      face_removed_[f] = true;
+      removed_faces++;
+      if (log != nullptr) log->removed_faces.push_back(f);
+      for (int c = 0; c < 3; c++) {
+        if (face[c] != from && face[c] != to) {
+          third_corners.Add(static_cast<int>(face[c]));
+        }
+      }
+      continue;
+    }
+    for (int c = 0; c < 3; c++) {
+      if (face[c] == from) {
+        face[c] = to;
+        if (log != nullptr) log->corners.push_back(3 * f + c);
+      }
+    }
+    vertex_faces_[edge.v1].push_back(f);
+  }
+  if (log != nullptr) {
+    log->removed_faces_end.push_back(log->removed_faces.size());
+    log->corners_end.push_back(log->corners.size());
+  }
+
+  // Keep the merged list free of dead faces so it doesn't grow unbounded
+  std::vector<int>& faces1 = vertex_faces_[edge.v1];
+  faces1.erase(std::remove_if(faces1.begin(), faces1.end(),
+                              [&](int f) { return face_removed_[f]; }),
+               faces1.end());
+
+  // 4. Remove v2 (compacted away at the end)
+  std::vector<int>().swap(vertex_faces_[edge.v2]);
+  vertex_removed_[edge.v2] = true;
+  vertex_version_[edge.v1]++;
+  vertex_version_[edge.v2]++;
+  CollapseCounts counts = {1, removed_faces};
+
+  // 5. Remove the vertices left without faces as well, or they would stay
+  //    in the output unreferenced and count towards the target. Locked
+  //    vertices are never among them: validation rejects such collapses
+  auto remove_orphan = [&](int v) {
+    std::vector<int>().swap(vertex_faces_[v]);
+    vertex_removed_[v] = true;
+    vertex_version_[v]++;
+    counts.vertices++;
+    if (orphans != nullptr) {
+      orphans->Add(v);
+    }
+    if (log != nullptr) {
+      log->kept.push_back(v);
+      log->removed.push_back(v);
+      log->old_positions.push_back(mesh.vertices[v]);
+      log->new_positions.push_back(mesh.vertices[v]);
+      log->removed_faces_end.push_back(log->removed_faces.size());
+      log->corners_end.push_back(log->corners.size());
+    }
+  };
+  if (faces1.empty()) {
+    remove_orphan(edge.v1);
+  }
+  for (int v : third_corners) {
+    if (!vertex_removed_[v] && !HasLiveFace(v)) {
+      remove_orphan(v);
+    }
+  }
+
+  // 6. Only the faces around v1 changed, so only the normals of v1 and its
+  //    ring did (and the removed faces' third corners', which can drop off
+  //    the ring). Parallel collapses own every vertex of both rings.
+  if (updates_normals_) {
+    for (int f : faces1) {
+      for (int c = 0; c < 3; c++) {
+        normal_dirty_[mesh.faces[f][c]] = 1;
+      }
+    }
+    for (int v : third_corners) {
+      normal_dirty_[v] = 1;
+    }
+  }
+  return counts;
 }
 
-}  // namespace GLOO
+void EdgeCollapse::GatherOrphanedVertices(const SimplificationMesh& mesh,
+                                          const Edge& edge,
+                                          VertexList& orphans) const {
+  auto contains_edge = [&](int f) {
+    const glm::uvec3& face = mesh.faces[f];
+    bool has1 = false;
+    bool has2 = false;
+    for (int c = 0; c < 3; c++) {
+      has1 |= static_cast<int>(face[c]) == edge.v1;
+      has2 |= static_cast<int>(face[c]) == edge.v2;
+    }
+    return has1 && has2;
+  };
+  auto is_orphaned = [&](int v) {
+    for (int f : vertex_faces_[v]) {
+      if (!face_removed_[f] && !contains_edge(f)) return false;
+    }
+    return true;
+  };
+  // A vertex is orphaned when all of its live faces contain the edge: v1
+  // (over the faces of both endpoints) and the third corners of those faces
+  orphans.Clear();
+  if (is_orphaned(edge.v1) && is_orphaned(edge.v2)) {
+    orphans.Add(edge.v1);
+  }
+  // At most a few entries, unsorted: a linear search is cheapest
+  const size_t first_corner = orphans.Size();
+  for (int f : vertex_faces_[edge.v2]) {
+    if (face_removed_[f] || !contains_edge(f)) continue;
+    for (int c = 0; c < 3; c++) {
+      const int v = static_cast<int>(mesh.faces[f][c]);
+      if (v != edge.v1 && v != edge.v2 &&
+          std::find(orphans.begin() + first_corner, orphans.end(), v) ==
+              orphans.end() &&
+          is_orphaned(v)) {
+        orphans.Add(v);
+      }
+    }
+  }
+}
+
+bool EdgeCollapse::OrphansLockedVertex(const SimplificationMesh& mesh,
+                                       const Edge& edge) const {
+  if (!has_locks_ && seam_vertices_.empty()) {
+    return false;
+  }
+  VertexList orphans;
+  GatherOrphanedVertices(mesh, edge, orphans);
+  for (int v : orphans) {
+    if (IsLocked(v)) return true;
+  }
+  return false;
+}
 
+bool EdgeCollapse::JoinsLockedVertices(const SimplificationMesh& mesh,
+                                       const Edge& edge) const {
+  // The collapse joins v1 to every neighbor of v2; only a locked v1 can
+  // gain an edge to a locked vertex
+  if (!has_locks_ || !locked_vertices_[edge.v1]) {
+    return false;
+  }
+  auto is_neighbor_of_v1 = [&](int v) {
+    for (int f : vertex_faces_[edge.v1]) {
+      const glm::uvec3& face = mesh.faces[f];
+      if (!face_removed_[f] && (static_cast<int>(face.x) == v ||
+                                static_cast<int>(face.y) == v ||
+                                static_cast<int>(face.z) == v)) {
+        return true;
+      }
+    }
+    return false;
+  };
+  for (int f : vertex_faces_[edge.v2]) {
+    if (face_removed_[f]) continue;
+    for (int c = 0; c < 3; c++) {
+      const int v = static_cast<int>(mesh.faces[f][c]);
+      if (v != edge.v1 && v != edge.v2 && locked_vertices_[v] &&
+          !is_neighbor_of_v1(v)) {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+bool EdgeCollapse::HasLiveFace(int vertex_index) const {
+  for (int f : vertex_faces_[vertex_index]) {
+    if (!face_removed_[f]) return true;
+  }
+  return false;
+}
+
+void EdgeCollapse::UpdateNormals(SimplificationMesh& mesh) {
+  if (!updates_normals_) {
+    return;
+  }
+  DECIMATOR_PROFILE_SCOPE("EdgeCollapse.UpdateNormals");
+  ParallelFor(normal_dirty_.size(), [&](size_t v) {
+    if (!normal_dirty_[v]) return;
+    normal_dirty_[v] = 0;
+    if (!vertex_removed_[v]) {
+      mesh.normals[v] =
+          ComputeVertexNormal(mesh, vertex_faces_[v], face_removed_);
+    }
+  }, kCollapseGrainSize);
+}
+
+void EdgeCollapse::CompactMesh(SimplificationMesh& mesh) const {
+  DECIMATOR_PROFILE_SCOPE("EdgeCollapse.Compact");
+  mesh.RemoveFlagged(vertex_removed_, face_removed_);
+}
+
+SimplificationMesh SharedLODChain::GetLevel(size_t level) const {
+  SimplificationMesh mesh;
+  size_t count = level_vertex_counts[level];
+  mesh.vertices.assign(vertex_data.vertices.begin(),
+                       vertex_data.vertices.begin() + count);
+  if (!vertex_data.colors.empty()) {
+    mesh.colors.assign(vertex_data.colors.begin(),
+                       vertex_data.colors.begin() + count);
+  }
+  if (!vertex_data.texcoords.empty()) {
+    mesh.texcoords.assign(vertex_data.texcoords.begin(),
+                          vertex_data.texcoords.begin() + count);
+  }
+  mesh.faces = level_faces[level];
+  mesh.ComputeNormals();
+  return mesh;
+}
+
+}  // namespace GLOO
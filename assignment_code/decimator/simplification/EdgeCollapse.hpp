@@ -1,17 +1,41 @@
 #ifndef EDGE_COLLAPSE_H_
 #define EDGE_COLLAPSE_H_
 
+#include <chrono>
+#include <cstdint>
 #include <memory>
+#include <string>
 #include <vector>
 #include <glm/glm.hpp>
 #include "SimplificationMesh.hpp"
+#include "OneRing.hpp"
+#include "SimplificationBudget.hpp"
+#include "ProgressiveMesh.hpp"
+#include "PriorityQueues.hpp"
+#include "SpatialHash.hpp"
 
 namespace GLOO {
 
+// LOD index buffers over one shared vertex buffer (see
+// EdgeCollapse::SimplifyToSharedLODs). Vertices are ordered coarsest-first,
+// so the vertices used by level i are the prefix of length
+// level_vertex_counts[i].
+struct SharedLODChain {
+  SimplificationMesh vertex_data;  // Shared vertex attributes; no faces
+  std::vector<std::vector<glm::uvec3>> level_faces;
+  std::vector<size_t> level_vertex_counts;
+
+  size_t GetLevelCount() const { return level_faces.size(); }
+  // Standalone copy of one level (with normals)
+  SimplificationMesh GetLevel(size_t level) const;
+};
+
 // Edge Collapse using Garland-Heckbert algorithm
 // Reference: "Surface Simplification Using Quadric Error Metrics" [GH97]
 class EdgeCollapse {
  public:
+  class Session;
+
   EdgeCollapse();
   ~EdgeCollapse();
 
@@ -23,40 +47,432 @@ class EdgeCollapse {
   std::shared_ptr<SimplificationMesh> SimplifyByFactor(const SimplificationMesh& original_mesh, 
                                                float reduction_factor);
 
+  // Simplify until a count target of the budget is reached. The error of a
+  // collapse is the RMS distance of the new vertex to the planes in its
+  // quadric; collapses above budget.max_error are skipped.
+  std::shared_ptr<SimplificationMesh> Simplify(
+      const SimplificationMesh& original_mesh,
+      const SimplificationBudget& budget,
+      SimplificationReport* report = nullptr);
+
+  // Same as above, but simplify the given mesh without copying it first,
+  // so peak memory is one mesh instead of two
+  std::shared_ptr<SimplificationMesh> Simplify(SimplificationMesh&& mesh,
+                                               int target_vertex_count);
+  std::shared_ptr<SimplificationMesh> Simplify(
+      SimplificationMesh&& mesh, const SimplificationBudget& budget,
+      SimplificationReport* report = nullptr);
+  void SimplifyInPlace(SimplificationMesh& mesh,
+                       const SimplificationBudget& budget,
+                       SimplificationReport* report = nullptr);
+
+  // Runs the same collapse sequence down to min_vertex_count (or as far as
+  // the mesh allows) and records it as a progressive mesh, so any LOD in
+  // between can be extracted without simplifying again. The LOD at n
+  // vertices matches Simplify(original_mesh, n).
+  std::shared_ptr<ProgressiveMesh> BuildProgressiveMesh(
+      const SimplificationMesh& original_mesh, int min_vertex_count = 0);
+
+  // One LOD per reduction factor (same meaning and order as the factors
+  // passed), snapshotted from a single collapse run instead of one run per
+  // level.
+  std::vector<std::shared_ptr<SimplificationMesh>> SimplifyToLODs(
+      const SimplificationMesh& original_mesh,
+      const std::vector<float>& reduction_factors);
+
+  // Like SimplifyToLODs, but collapses only to original vertex positions
+  // so every level is just an index buffer into one vertex buffer.
+  std::shared_ptr<SharedLODChain> SimplifyToSharedLODs(
+      const SimplificationMesh& original_mesh,
+      const std::vector<float>& reduction_factors);
+
+  // Starts a resumable simplification towards target_vertex_count (or a
+  // budget) that is advanced with Session::Step. The session copies this
+  // simplifier's settings, so later setter calls don't affect it.
+  std::unique_ptr<Session> BeginSession(const SimplificationMesh& original_mesh,
+                                        int target_vertex_count) const;
+  std::unique_ptr<Session> BeginSession(const SimplificationMesh& original_mesh,
+                                        const SimplificationBudget& budget) const;
+  // Takes over the mesh instead of copying it
+  std::unique_ptr<Session> BeginSession(SimplificationMesh&& mesh,
+                                        const SimplificationBudget& budget) const;
+
+  // Place collapsed vertices at the better endpoint instead of the quadric
+  // optimum (half-edge collapse). Lower quality, but no new positions.
+  void SetRestrictToOriginalPositions(bool restrict_positions) {
+    restrict_to_original_positions_ = restrict_positions;
+  }
+
+  // Collapse in rounds across the parallel workers instead of one edge at a
+  // time: each round takes the cheapest candidate edges, keeps a set whose
+  // one-rings don't overlap and collapses them concurrently. Close to, but
+  // not the same as, the serial result (and independent of the worker
+  // count). Used by Simplify and SimplifyInPlace; progressive meshes, LODs
+  // and sessions always collapse serially.
+  void SetParallelCollapse(bool parallel) { parallel_collapse_ = parallel; }
+
+  // Cost collapses from the current faces around the edge instead of
+  // accumulated quadrics (Lindstrom-Turk memoryless simplification [LT98]):
+  // the new vertex keeps the local volume and border area, then minimizes
+  // the volume and area swept by the collapse. No per-vertex quadrics are
+  // kept, but every cost gathers the faces around both endpoints. Budget
+  // error is the RMS distance of the new vertex to the planes of those
+  // faces (or to the lines of their border edges, if further).
+  void SetMemoryless(bool memoryless) { memoryless_ = memoryless; }
+
+  // Multiple-choice collapse (Wu-Kobbelt [WK02]) instead of the greedy
+  // queue: every step costs `candidates` random edges and collapses the
+  // cheapest valid one, so there is no queue to build or keep up to date.
+  // The sampling is seeded, so a seed always gives the same result. 0
+  // candidates turns it off. Used by Simplify and SimplifyInPlace (taking
+  // precedence over SetParallelCollapse); progressive meshes, LODs and
+  // sessions always use the queue.
+  void SetMultipleChoice(int candidates, uint32_t seed = 1) {
+    multiple_choice_candidates_ = candidates;
+    multiple_choice_seed_ = seed;
+  }
+
+  // Queue the serial collapse loop runs on (see PriorityQueues.hpp). Edges
+  // have no stable id, so every backend queues updated edges anew and
+  // skips the stale entries. The result is the same up to exact ties.
+  void SetQueueBackend(QueueBackend backend) { queue_backend_ = backend; }
+
+  // Also contract vertex pairs closer than distance that share no edge
+  // (the virtual pairs of [GH97]), so separate pieces such as foliage or
+  // scan fragments can merge instead of each stopping at its smallest
+  // closed form. Pairs are found with a spatial hash that follows the
+  // vertices as they move, and merging two pieces must not pinch a shared
+  // neighbor. 0 (the default) collapses edges only. Used by the queue
+  // (Simplify, sessions, progressive meshes and LODs); the parallel and
+  // multiple-choice modes collapse edges only.
+  void SetPairDistance(float distance) { pair_distance_ = distance; }
+
+  // Optimize the per-vertex attributes (whichever of normals, colors and
+  // texcoords the mesh has for every vertex) together with the position
+  // in every collapse, with generalized quadrics [H99]. Each face adds
+  // the squared deviation of each attribute channel from its linear
+  // interpolation over the face, times weight, so the collapse cost also
+  // counts attribute error and the new vertex gets the attribute values
+  // that minimize it. weight is the cost of one unit of attribute change
+  // relative to one mesh unit of distance; 0 (the default) optimizes
+  // positions only and interpolates the attributes along the edge.
+  // Attribute seams are split vertices (several vertices at one position);
+  // those are kept like locked vertices, so seams neither crack nor
+  // change their attributes. Normals come out normalized, instead of
+  // area-weighted from the faces. Ignored by memoryless runs; with
+  // restricted positions it only steers which endpoint is kept.
+  // Progressive meshes keep the original attributes.
+  void SetAttributeWeight(float weight) { attribute_weight_ = weight; }
+
+  // Vertices flagged nonzero are never removed or moved: an edge with one
+  // locked endpoint collapses onto it and an edge with two doesn't
+  // collapse. Nor does a collapse join two locked vertices by a new edge,
+  // as they may border faces the mesh doesn't include (the blocks of
+  // PartitionedSimplifier) that already have it. Compaction keeps the
+  // vertex order, so locked vertices placed first stay first. Ignored
+  // unless there is one flag per mesh vertex.
+  void SetLockedVertices(std::vector<uint8_t> locked) {
+    locked_vertices_ = std::move(locked);
+  }
+
+  // Every setting above as text, for result cache keys
+  // (SimplificationCache::MakeKey)
+  std::string GetSettingsKey() const;
+
  private:
-  // TODO: Implement quadric error metric computation
-  // TODO: Implement edge collapse operations
-  // TODO: Implement priority queue for edge selection
-  
+  // Boundary edges get a perpendicular constraint plane weighted by this
+  // factor so open borders don't shrink inwards
+  static constexpr double kBoundaryWeight = 1000.0;
+
+  // A parallel round considers at most the cheapest live vertex count /
+  // kParallelWindowDivisor candidates (but at least kMinParallelWindow), so
+  // each round stays close to what the serial queue would pick next
+  static const int kParallelWindowDivisor = 8;
+  static const size_t kMinParallelWindow = 1024;
+  // Parallel grain of the per-edge steps of a round (validation, claims,
+  // collapses), which take microseconds per edge
+  static const size_t kCollapseGrainSize = 256;
+  // Multiple-choice runs stop after this many steps in a row without a
+  // valid candidate
+  static const int kMaxMultipleChoiceMisses = 1000;
+  // Normals, colors and texcoords
+  static const int kMaxAttributeChannels = 8;
+
+  bool restrict_to_original_positions_ = false;
+  bool parallel_collapse_ = false;
+  bool memoryless_ = false;
+  int multiple_choice_candidates_ = 0;
+  uint32_t multiple_choice_seed_ = 1;
+  float pair_distance_ = 0.0f;
+  float attribute_weight_ = 0.0f;
+  QueueBackend queue_backend_ = QueueBackend::BINARY_HEAP;
+  std::vector<uint8_t> locked_vertices_;
+
   struct QuadricMatrix {
     // 4x4 symmetric matrix for quadric error metric
-    float data[10];  // Only store 10 values due to symmetry
+    // [a2 ab ac ad; ab b2 bc bd; ac bc c2 cd; ad bd cd d2], stored row-major
+    // upper triangle. Double precision: the sums of many nearly coplanar
+    // planes cancel badly in float.
+    double data[10];  // Only store 10 values due to symmetry
     
     QuadricMatrix();
-    void AddPlane(const glm::vec3& normal, float d);
+    void AddPlane(const glm::vec3& normal, float d, double weight = 1.0);
     float ComputeError(const glm::vec3& v) const;
     QuadricMatrix operator+(const QuadricMatrix& other) const;
   };
   
+  // Attribute part of a generalized quadric [H99]: for each channel, the
+  // sum over faces of weight * (g.p + e - s)^2, where g and e give the
+  // channel's linear interpolation over the face and s is the new value.
+  // Solving for the s that minimize it leaves a quadric in p alone.
+  struct AttributeQuadric {
+    double quadric[10];  // Sum of weight * (g, e)(g, e)^T, as QuadricMatrix
+    double gradient[kMaxAttributeChannels][3];  // Sum of weight * g
+    double offset[kMaxAttributeChannels];       // Sum of weight * e
+    double weight;
+
+    AttributeQuadric();
+    void Add(const AttributeQuadric& other);
+    // Adds the quadric in p left after solving for the channel values
+    void AddReduced(int channels, QuadricMatrix& q) const;
+    // Channel values that minimize the error at p
+    void Solve(int channels, const glm::vec3& p, double* values) const;
+  };
+
+  // A vertex pair to contract: an edge, or a virtual pair (no faces in
+  // common) with SetPairDistance
   struct Edge {
     int v1, v2;  // Vertex indices
     float error;  // Collapse error
     glm::vec3 optimal_pos;  // Optimal position after collapse
+    // Vertex versions when the edge was queued; a mismatch means one of
+    // the endpoints changed since and the entry is stale
+    unsigned int version1, version2;
+    // Squared length; breaks ties so flat regions (all errors zero) collapse
+    // short edges first instead of snowballing into one high-valence vertex
+    float length2;
     
+    // Unsigned key with the same order as the queue (cheapest first)
+    uint64_t GetOrderKey() const;
+    uint32_t GetQueueId() const { return kNoQueueId; }
+
     bool operator<(const Edge& other) const {
-      return error > other.error;  // Min heap
+      if (error != other.error) {
+        return error > other.error;  // Min heap
+      }
+      return length2 > other.length2;
     }
   };
 
-  // Helper methods (to be implemented)
+  // Collapses performed by RunCollapses, in order (flat arrays so long
+  // runs don't allocate per collapse). A vertex a collapse leaves without
+  // faces gets a record of its own right after it, with kept == removed
+  // and no faces or corners, so every record removes exactly one vertex.
+  struct CollapseLog {
+    std::vector<int> kept;                 // v1 of each collapse
+    std::vector<int> removed;              // v2 of each collapse
+    std::vector<glm::vec3> old_positions;  // v1 before the collapse
+    std::vector<glm::vec3> new_positions;  // v1 after the collapse
+    std::vector<size_t> removed_faces_end;
+    std::vector<int> removed_faces;        // Faces that contained both
+    std::vector<size_t> corners_end;
+    std::vector<int> corners;              // 3 * face + corner moved v2 -> v1
+  };
+
+  // Queue state of one collapse run, so it can be continued towards lower
+  // targets (e.g. to snapshot several LODs)
+  struct CollapseRun {
+    std::vector<QuadricMatrix> quadrics;
+    // Only the queue of the backend in use is filled
+    LazyBinaryHeap<Edge> binary_queue;
+    IndexedDaryHeap<Edge> dary_queue;
+    MonotoneRadixHeap<Edge> radix_queue;
+    // Live vertices by position, with SetPairDistance
+    SpatialHash pair_hash;
+    int vertex_count;
+    int face_count;
+    float max_error;  // Largest GetGeometricError of the collapses so far
+  };
+
+  // Per-run connectivity, valid during Simplify
+  std::vector<std::vector<int>> vertex_faces_;
+  std::vector<uint8_t> face_removed_;
+  std::vector<uint8_t> vertex_removed_;
+  std::vector<unsigned int> vertex_version_;
+  bool has_locks_ = false;  // locked_vertices_ matches the mesh
+  // Collapses keep an endpoint's position in this run
+  bool restricts_positions_ = false;
+  // The mesh has normals and the attribute quadrics don't set them, so
+  // each collapse flags the ones it changed for UpdateNormals
+  bool updates_normals_ = false;
+  std::vector<uint8_t> normal_dirty_;
+  // Attribute quadrics and the arrays they cover (in that channel order),
+  // with SetAttributeWeight
+  std::vector<AttributeQuadric> attribute_quadrics_;
+  int attribute_channels_ = 0;
+  bool optimizes_normals_ = false;
+  bool optimizes_colors_ = false;
+  bool optimizes_texcoords_ = false;
+  // Split vertices, kept like locked ones while attributes are optimized
+  std::vector<uint8_t> seam_vertices_;
+
+  bool IsLocked(int vertex_index) const {
+    return (has_locks_ && locked_vertices_[vertex_index] != 0) ||
+           (!seam_vertices_.empty() && seam_vertices_[vertex_index] != 0);
+  }
+  // Also sets up the attribute quadrics and seams of the run
   void ComputeQuadrics(const SimplificationMesh& mesh, 
                        std::vector<QuadricMatrix>& quadrics);
-  void BuildEdgeList(const SimplificationMesh& mesh, std::vector<Edge>& edges);
-  float ComputeEdgeCollapseError(const Edge& edge, 
-                                  const std::vector<QuadricMatrix>& quadrics);
-  glm::vec3 ComputeOptimalPosition(const Edge& edge, 
-                                     const std::vector<QuadricMatrix>& quadrics);
-  void CollapseEdge(SimplificationMesh& mesh, const Edge& edge);
+  void ComputeAttributeQuadrics(const SimplificationMesh& mesh,
+                                const std::vector<float>& double_areas);
+  void FindSeamVertices(const SimplificationMesh& mesh);
+  void GetAttributes(const SimplificationMesh& mesh, int vertex_index,
+                     double* values) const;
+  void SetAttributes(SimplificationMesh& mesh, int vertex_index,
+                     const double* values) const;
+  // Quadric a collapse of v1 and v2 is costed with: the sum of theirs,
+  // plus the attribute error left at the best attribute values
+  QuadricMatrix GetCollapseQuadric(const std::vector<QuadricMatrix>& quadrics,
+                                   int v1, int v2) const;
+  // Merges v2's quadrics into v1's after a collapse (and sets v1's
+  // optimized attributes)
+  void MergeQuadrics(SimplificationMesh& mesh,
+                     std::vector<QuadricMatrix>& quadrics, const Edge& edge);
+  void BuildAdjacency(const SimplificationMesh& mesh);
+  void BuildEdgeList(const SimplificationMesh& mesh,
+                     const std::vector<QuadricMatrix>& quadrics,
+                     std::vector<Edge>& edges);
+  // Fills in the collapse position, error and the rest of edges
+  // [0, count) from their v1/v2, solving GeometryKernels::kQuadricBatch
+  // edges at a time. With restricted positions, v1 and v2 may be swapped
+  // so that v1 is the cheaper endpoint to keep; a locked endpoint is
+  // always v1.
+  void ComputeEdgeCosts(const SimplificationMesh& mesh,
+                        const std::vector<QuadricMatrix>& quadrics,
+                        Edge* edges, size_t count) const;
+  // ComputeEdgeCosts of memoryless runs, which have no quadrics
+  void ComputeMemorylessCosts(const SimplificationMesh& mesh, Edge* edges,
+                              size_t count) const;
+  // Edge cost in distance units: the quadric error divided by the summed
+  // plane weights (the trace of the 3x3 block, as normals are unit length)
+  float GetGeometricError(const SimplificationMesh& mesh, const Edge& edge,
+                          const std::vector<QuadricMatrix>& quadrics) const;
+  void CollectNeighbors(const SimplificationMesh& mesh, int vertex_index,
+                        std::vector<int>& neighbors) const;
+  // Appends the virtual pairs (vertex_index, v) for the vertices v within
+  // pair_distance_ that aren't in the sorted neighbors (and, with
+  // later_only, come after vertex_index); costs are left to the caller
+  void FindVirtualPairs(const SimplificationMesh& mesh,
+                        const SpatialHash& hash, int vertex_index,
+                        const std::vector<int>& neighbors, bool later_only,
+                        std::vector<Edge>& pairs) const;
+  // Fills run.pair_hash and appends the initial virtual pairs, with costs
+  void AddVirtualPairs(const SimplificationMesh& mesh, CollapseRun& run,
+                       std::vector<Edge>& edges) const;
+  // Rejects collapses that would pinch the surface (common neighbors other
+  // than the edge's opposite vertices; any, for a virtual pair)
+  bool SatisfiesLinkCondition(const SimplificationMesh& mesh,
+                              const Edge& edge) const;
+  // Rejects collapses that flip or degenerate any surviving face
+  bool CausesFoldOver(const SimplificationMesh& mesh, const Edge& edge) const;
+  // All the checks of a serial collapse (locked v2, link condition, error
+  // budget, fold-over); sets geometric_error when it gets that far
+  bool IsCollapseValid(const SimplificationMesh& mesh, const Edge& edge,
+                       const std::vector<QuadricMatrix>& quadrics,
+                       const SimplificationBudget& budget,
+                       float& geometric_error) const;
+  // Collapses edges of mesh in place until the budget is reached or no
+  // valid collapse remains; removed elements are only flagged.
+  void RunCollapses(SimplificationMesh& mesh,
+                    const SimplificationBudget& budget, CollapseLog* log);
+  // restrict_positions collapses to endpoints in this run whatever
+  // SetRestrictToOriginalPositions says (for SimplifyToSharedLODs)
+  void BeginCollapses(const SimplificationMesh& mesh, CollapseRun& run,
+                      bool restrict_positions = false);
+  // Returns false if it stopped at the deadline before finishing
+  bool ContinueCollapses(SimplificationMesh& mesh, CollapseRun& run,
+                         const SimplificationBudget& budget, CollapseLog* log,
+                         std::chrono::steady_clock::time_point deadline =
+                             std::chrono::steady_clock::time_point::max());
+  // ContinueCollapses on the queue of the chosen backend
+  template <class Queue>
+  bool RunCollapseLoop(SimplificationMesh& mesh, CollapseRun& run,
+                       Queue& queue, const SimplificationBudget& budget,
+                       CollapseLog* log,
+                       std::chrono::steady_clock::time_point deadline);
+  // Alternative to BeginCollapses/ContinueCollapses used with
+  // SetParallelCollapse; leaves the queues empty
+  void RunParallelCollapses(SimplificationMesh& mesh,
+                            const SimplificationBudget& budget,
+                            CollapseRun& run);
+  // Alternative to BeginCollapses/ContinueCollapses used with
+  // SetMultipleChoice; leaves the queues empty
+  void RunMultipleChoiceCollapses(SimplificationMesh& mesh,
+                                  const SimplificationBudget& budget,
+                                  CollapseRun& run);
+  // Levels sorted from finest to coarsest vertex target
+  std::vector<size_t> SortLevels(
+      const SimplificationMesh& mesh,
+      const std::vector<float>& reduction_factors,
+      std::vector<int>& targets) const;
+  // Elements removed by one collapse: v2 plus any vertex left without
+  // faces (the corners of a loose triangle, a fin or a duplicated face),
+  // and the faces that contained the edge. The vertices removed besides
+  // v2 are listed in orphans if given.
+  struct CollapseCounts {
+    int vertices;
+    int faces;
+  };
+  CollapseCounts CollapseEdge(SimplificationMesh& mesh, const Edge& edge,
+                              CollapseLog* log,
+                              VertexList* orphans = nullptr);
+  // Vertices besides v2 that CollapseEdge would remove
+  void GatherOrphanedVertices(const SimplificationMesh& mesh,
+                              const Edge& edge, VertexList& orphans) const;
+  // True if the collapse would remove a locked vertex by leaving it
+  // without faces, which keeps it from being valid
+  bool OrphansLockedVertex(const SimplificationMesh& mesh,
+                           const Edge& edge) const;
+  // True if the collapse would add an edge between two locked vertices
+  bool JoinsLockedVertices(const SimplificationMesh& mesh,
+                           const Edge& edge) const;
+  // True if a live face still uses the vertex
+  bool HasLiveFace(int vertex_index) const;
+  // Recomputes the normals flagged by the collapses since the last call
+  // from the current faces. Called wherever the mesh is handed out
+  // (compaction, LOD snapshots, session steps), so vertices changed
+  // several times in between are only recomputed once.
+  void UpdateNormals(SimplificationMesh& mesh);
+  // Drops removed faces and vertices and renumbers the rest
+  void CompactMesh(SimplificationMesh& mesh) const;
+};
+
+// Edge collapse run that can be spread over several calls, e.g. a few
+// milliseconds per frame. The working mesh only flags removed elements, so
+// any intermediate state can be compacted for display.
+class EdgeCollapse::Session {
+ public:
+  // Collapses edges until the target is reached, no valid collapse remains
+  // or the deadline passes; returns IsDone(). The first call also computes
+  // the quadrics and the queue, which is not interruptible.
+  bool Step(std::chrono::steady_clock::time_point deadline);
+  bool IsDone() const { return done_; }
+  int GetVertexCount() const;
+  float GetMaxError() const;
+  // Compacted copy of the current (possibly partial) result
+  std::shared_ptr<SimplificationMesh> GetResult() const;
+
+ private:
+  friend class EdgeCollapse;
+  Session(const EdgeCollapse& simplifier, SimplificationMesh mesh,
+          const SimplificationBudget& budget);
+
+  EdgeCollapse simplifier_;  // Own copy: holds the per-run connectivity
+  SimplificationMesh mesh_;
+  CollapseRun run_;
+  SimplificationBudget budget_;
+  bool started_ = false;
+  bool done_ = false;
 };
 
 }  // namespace GLOO
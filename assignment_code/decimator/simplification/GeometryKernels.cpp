@@ -0,0 +1,843 @@
+#include "GeometryKernels.hpp"
+#include "helpers.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define DECIMATOR_KERNELS_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+// MSVC compiles AVX2 intrinsics without a per-function target
+#define DECIMATOR_TARGET_AVX2
+#else
+#define DECIMATOR_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+namespace GLOO {
+namespace {
+typedef GeometryKernels::SimdLevel SimdLevel;
+
+SimdLevel DetectSimdLevel() {
+#if defined(DECIMATOR_KERNELS_X86)
+#if defined(_MSC_VER) && !defined(__clang__)
+  int info[4];
+  __cpuid(info, 0);
+  if (info[0] >= 7) {
+    __cpuid(info, 1);
+    const bool os_saves_ymm = (info[2] & (1 << 27)) != 0 &&
+                              (info[2] & (1 << 28)) != 0 &&
+                              (_xgetbv(0) & 6) == 6;
+    __cpuidex(info, 7, 0);
+    if (os_saves_ymm && (info[1] & (1 << 5)) != 0) {
+      return SimdLevel::AVX2;
+    }
+  }
+#else
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")) {
+    return SimdLevel::AVX2;
+  }
+#endif
+  // Part of the x86-64 baseline
+  return SimdLevel::SSE2;
+#else
+  return SimdLevel::SCALAR;
+#endif
+}
+
+std::atomic<int>& CurrentLevel() {
+  static std::atomic<int> level(
+      static_cast<int>(GeometryKernels::GetSupportedSimdLevel()));
+  return level;
+}
+
+// Scalar reference versions. The SIMD ones below must do exactly the same
+// operations in the same order: cross and dot as in glm, then
+// normal = cross * (1 / sqrt(dot(cross, cross))) as glm::normalize does.
+
+void FacePlane(const glm::vec3* vertices, const glm::uvec3& face,
+               glm::vec3& normal, float& double_area, float& offset) {
+  const glm::vec3& p0 = vertices[face.x];
+  glm::vec3 cross = glm::cross(vertices[face.y] - p0, vertices[face.z] - p0);
+  float squared = glm::dot(cross, cross);
+  if (squared > 0.0f) {
+    double_area = std::sqrt(squared);
+    normal = cross * (1.0f / double_area);
+    offset = -glm::dot(normal, p0);
+  } else {
+    normal = glm::vec3(0.0f);
+    double_area = 0.0f;
+    offset = 0.0f;
+  }
+}
+
+void FacePlanesScalar(const glm::vec3* vertices, const glm::uvec3* faces,
+                      size_t begin, size_t end, glm::vec3* normals,
+                      float* double_areas, float* offsets) {
+  for (size_t i = begin; i < end; i++) {
+    float double_area, offset;
+    FacePlane(vertices, faces[i], normals[i], double_area, offset);
+    if (double_areas != nullptr) {
+      double_areas[i] = double_area;
+    }
+    if (offsets != nullptr) {
+      offsets[i] = offset;
+    }
+  }
+}
+
+void NormalizeScalar(glm::vec3* vectors, size_t begin, size_t end) {
+  for (size_t i = begin; i < end; i++) {
+    float squared = glm::dot(vectors[i], vectors[i]);
+    if (squared > 0.0f) {
+      vectors[i] = vectors[i] * (1.0f / std::sqrt(squared));
+    }
+  }
+}
+
+void BoundsScalar(const float* x, const float* y, const float* z,
+                  size_t padded_count, glm::vec3& min_bounds,
+                  glm::vec3& max_bounds) {
+  // One running min/max per lane, so the compiler can still keep each
+  // block in vector registers
+  const size_t kLanes = 8;
+  const float* axes[3] = {x, y, z};
+  for (int axis = 0; axis < 3; axis++) {
+    float lo[kLanes];
+    float hi[kLanes];
+    for (size_t lane = 0; lane < kLanes; lane++) {
+      lo[lane] = hi[lane] = axes[axis][lane];
+    }
+    for (size_t i = kLanes; i < padded_count; i += kLanes) {
+      for (size_t lane = 0; lane < kLanes; lane++) {
+        lo[lane] = std::min(lo[lane], axes[axis][i + lane]);
+        hi[lane] = std::max(hi[lane], axes[axis][i + lane]);
+      }
+    }
+    min_bounds[axis] = *std::min_element(lo, lo + kLanes);
+    max_bounds[axis] = *std::max_element(hi, hi + kLanes);
+  }
+}
+
+// The quadric solve mirrors QuadricMatrix::ComputeError and
+// glm::determinant / glm::inverse term for term. It works in doubles, so
+// SSE2 would only give two lanes; below AVX2 it runs this scalar loop.
+const size_t kQuadricLanes = GeometryKernels::kQuadricBatch;
+
+inline float QuadricError(
+    const double (&q)[10][kQuadricLanes], size_t lane, float px, float py,
+    float pz) {
+  const double x = px, y = py, z = pz;
+  double error = q[0][lane] * x * x + 2.0 * q[1][lane] * x * y +
+                 2.0 * q[2][lane] * x * z + 2.0 * q[3][lane] * x +
+                 q[4][lane] * y * y + 2.0 * q[5][lane] * y * z +
+                 2.0 * q[6][lane] * y + q[7][lane] * z * z +
+                 2.0 * q[8][lane] * z + q[9][lane];
+  return static_cast<float>(error > 0.0 ? error : 0.0);
+}
+
+void SolveQuadricBatchScalar(GeometryKernels::QuadricBatch& batch,
+                             bool endpoints_only) {
+  const double (&q)[10][kQuadricLanes] = batch.quadric;
+  const float (&p1)[3][kQuadricLanes] = batch.first;
+  const float (&p2)[3][kQuadricLanes] = batch.second;
+  if (endpoints_only) {
+    for (size_t lane = 0; lane < kQuadricLanes; lane++) {
+      float e1 = QuadricError(q, lane, p1[0][lane], p1[1][lane], p1[2][lane]);
+      float e2 = QuadricError(q, lane, p2[0][lane], p2[1][lane], p2[2][lane]);
+      bool second = e2 < e1;
+      for (int axis = 0; axis < 3; axis++) {
+        batch.position[axis][lane] = second ? p2[axis][lane] : p1[axis][lane];
+      }
+      batch.error[lane] = second ? e2 : e1;
+      batch.keeps_second[lane] = second;
+    }
+    return;
+  }
+
+  for (size_t lane = 0; lane < kQuadricLanes; lane++) {
+    batch.keeps_second[lane] = false;
+    // A v = -b for the upper-left 3x3 block A (symmetric) and last column b
+    const double a00 = q[0][lane], a01 = q[1][lane], a02 = q[2][lane];
+    const double a11 = q[4][lane], a12 = q[5][lane], a22 = q[7][lane];
+    const double c0 = a11 * a22 - a12 * a12;
+    const double c1 = a01 * a22 - a12 * a02;
+    const double c2 = a01 * a12 - a11 * a02;
+    const double det = a00 * c0 - a01 * c1 + a02 * c2;
+    const double trace = a00 + a11 + a22;
+    if (std::abs(det) > 1e-9 * trace * trace * trace) {
+      const double inverse = 1.0 / det;
+      const double i00 = c0 * inverse;
+      const double i01 = -c1 * inverse;
+      const double i02 = c2 * inverse;
+      const double i11 = (a00 * a22 - a02 * a02) * inverse;
+      const double i12 = -(a00 * a12 - a02 * a01) * inverse;
+      const double i22 = (a00 * a11 - a01 * a01) * inverse;
+      const double bx = -q[3][lane], by = -q[6][lane], bz = -q[8][lane];
+      float x = static_cast<float>(i00 * bx + i01 * by + i02 * bz);
+      float y = static_cast<float>(i01 * bx + i11 * by + i12 * bz);
+      float z = static_cast<float>(i02 * bx + i12 * by + i22 * bz);
+      batch.position[0][lane] = x;
+      batch.position[1][lane] = y;
+      batch.position[2][lane] = z;
+      batch.error[lane] = QuadricError(q, lane, x, y, z);
+      continue;
+    }
+
+    // Singular (flat or straight neighborhood): best of the endpoints and
+    // the midpoint, the midpoint on ties
+    float best[3];
+    for (int axis = 0; axis < 3; axis++) {
+      best[axis] = 0.5f * (p1[axis][lane] + p2[axis][lane]);
+    }
+    float best_error = QuadricError(q, lane, best[0], best[1], best[2]);
+    const float (*endpoints[2])[kQuadricLanes] = {p1, p2};
+    for (int i = 0; i < 2; i++) {
+      const float (*p)[kQuadricLanes] = endpoints[i];
+      float error = QuadricError(q, lane, p[0][lane], p[1][lane], p[2][lane]);
+      if (error < best_error) {
+        best_error = error;
+        for (int axis = 0; axis < 3; axis++) {
+          best[axis] = p[axis][lane];
+        }
+      }
+    }
+    for (int axis = 0; axis < 3; axis++) {
+      batch.position[axis][lane] = best[axis];
+    }
+    batch.error[lane] = best_error;
+  }
+}
+
+bool HasFlippedFacesScalar(const GeometryKernels::FlipBatch& batch,
+                           size_t count) {
+  for (size_t lane = 0; lane < count; lane++) {
+    glm::vec3 before[3], after[3];
+    for (int corner = 0; corner < 3; corner++) {
+      before[corner] = glm::vec3(batch.corners[corner][0][lane],
+                                 batch.corners[corner][1][lane],
+                                 batch.corners[corner][2][lane]);
+      after[corner] = before[corner];
+    }
+    after[batch.moved[lane]] = glm::vec3(
+        batch.target[0][lane], batch.target[1][lane], batch.target[2][lane]);
+    glm::vec3 n_before = glm::cross(before[1] - before[0],
+                                    before[2] - before[0]);
+    glm::vec3 n_after = glm::cross(after[1] - after[0], after[2] - after[0]);
+    if (glm::length(n_after) <= 1e-6f * glm::length(n_before) ||
+        glm::dot(n_before, n_after) <= 0.0f) {
+      return true;
+    }
+  }
+  return false;
+}
+
+#if defined(DECIMATOR_KERNELS_X86)
+// Quadric error of four positions, rounded to float like ComputeError's
+// result but kept as doubles
+DECIMATOR_TARGET_AVX2
+__m256d QuadricErrorAvx2(const __m256d (&q)[10], __m256d x, __m256d y,
+                         __m256d z) {
+  const __m256d two = _mm256_set1_pd(2.0);
+  __m256d error = _mm256_mul_pd(_mm256_mul_pd(q[0], x), x);
+  error = _mm256_add_pd(
+      error, _mm256_mul_pd(_mm256_mul_pd(_mm256_mul_pd(two, q[1]), x), y));
+  error = _mm256_add_pd(
+      error, _mm256_mul_pd(_mm256_mul_pd(_mm256_mul_pd(two, q[2]), x), z));
+  error = _mm256_add_pd(error, _mm256_mul_pd(_mm256_mul_pd(two, q[3]), x));
+  error = _mm256_add_pd(error, _mm256_mul_pd(_mm256_mul_pd(q[4], y), y));
+  error = _mm256_add_pd(
+      error, _mm256_mul_pd(_mm256_mul_pd(_mm256_mul_pd(two, q[5]), y), z));
+  error = _mm256_add_pd(error, _mm256_mul_pd(_mm256_mul_pd(two, q[6]), y));
+  error = _mm256_add_pd(error, _mm256_mul_pd(_mm256_mul_pd(q[7], z), z));
+  error = _mm256_add_pd(error, _mm256_mul_pd(_mm256_mul_pd(two, q[8]), z));
+  error = _mm256_add_pd(error, q[9]);
+  // max(error, 0) is error > 0 ? error : 0, NaN included
+  error = _mm256_max_pd(error, _mm256_setzero_pd());
+  return _mm256_cvtps_pd(_mm256_cvtpd_ps(error));
+}
+
+DECIMATOR_TARGET_AVX2
+void SolveQuadricBatchAvx2(GeometryKernels::QuadricBatch& batch,
+                           bool endpoints_only) {
+  const __m256d sign = _mm256_set1_pd(-0.0);
+  const __m256d one = _mm256_set1_pd(1.0);
+  const __m256d tolerance = _mm256_set1_pd(1e-9);
+  const __m128 half = _mm_set1_ps(0.5f);
+  for (size_t base = 0; base < kQuadricLanes; base += 4) {
+    __m256d q[10];
+    for (int k = 0; k < 10; k++) {
+      q[k] = _mm256_loadu_pd(&batch.quadric[k][base]);
+    }
+    __m128 f1[3], f2[3];
+    __m256d p1[3], p2[3];
+    for (int axis = 0; axis < 3; axis++) {
+      f1[axis] = _mm_loadu_ps(&batch.first[axis][base]);
+      f2[axis] = _mm_loadu_ps(&batch.second[axis][base]);
+      p1[axis] = _mm256_cvtps_pd(f1[axis]);
+      p2[axis] = _mm256_cvtps_pd(f2[axis]);
+    }
+    __m256d e1 = QuadricErrorAvx2(q, p1[0], p1[1], p1[2]);
+    __m256d e2 = QuadricErrorAvx2(q, p2[0], p2[1], p2[2]);
+
+    if (endpoints_only) {
+      __m256d second = _mm256_cmp_pd(e2, e1, _CMP_LT_OQ);
+      for (int axis = 0; axis < 3; axis++) {
+        _mm_storeu_ps(&batch.position[axis][base],
+                      _mm256_cvtpd_ps(_mm256_blendv_pd(p1[axis], p2[axis],
+                                                       second)));
+      }
+      _mm_storeu_ps(&batch.error[base],
+                    _mm256_cvtpd_ps(_mm256_blendv_pd(e1, e2, second)));
+      int bits = _mm256_movemask_pd(second);
+      for (int lane = 0; lane < 4; lane++) {
+        batch.keeps_second[base + lane] = (bits >> lane) & 1;
+      }
+      continue;
+    }
+
+    // Fallback: best of the endpoints and the midpoint, midpoint on ties
+    __m256d fallback[3];
+    for (int axis = 0; axis < 3; axis++) {
+      fallback[axis] = _mm256_cvtps_pd(
+          _mm_mul_ps(half, _mm_add_ps(f1[axis], f2[axis])));
+    }
+    __m256d best =
+        QuadricErrorAvx2(q, fallback[0], fallback[1], fallback[2]);
+    __m256d use1 = _mm256_cmp_pd(e1, best, _CMP_LT_OQ);
+    best = _mm256_blendv_pd(best, e1, use1);
+    __m256d use2 = _mm256_cmp_pd(e2, best, _CMP_LT_OQ);
+    best = _mm256_blendv_pd(best, e2, use2);
+    for (int axis = 0; axis < 3; axis++) {
+      fallback[axis] = _mm256_blendv_pd(fallback[axis], p1[axis], use1);
+      fallback[axis] = _mm256_blendv_pd(fallback[axis], p2[axis], use2);
+    }
+
+    const __m256d a00 = q[0], a01 = q[1], a02 = q[2];
+    const __m256d a11 = q[4], a12 = q[5], a22 = q[7];
+    __m256d c0 = _mm256_sub_pd(_mm256_mul_pd(a11, a22),
+                               _mm256_mul_pd(a12, a12));
+    __m256d c1 = _mm256_sub_pd(_mm256_mul_pd(a01, a22),
+                               _mm256_mul_pd(a12, a02));
+    __m256d c2 = _mm256_sub_pd(_mm256_mul_pd(a01, a12),
+                               _mm256_mul_pd(a11, a02));
+    __m256d det = _mm256_add_pd(
+        _mm256_sub_pd(_mm256_mul_pd(a00, c0), _mm256_mul_pd(a01, c1)),
+        _mm256_mul_pd(a02, c2));
+    __m256d trace = _mm256_add_pd(_mm256_add_pd(a00, a11), a22);
+    __m256d threshold = _mm256_mul_pd(
+        _mm256_mul_pd(_mm256_mul_pd(tolerance, trace), trace), trace);
+    __m256d solvable = _mm256_cmp_pd(_mm256_andnot_pd(sign, det), threshold,
+                                     _CMP_GT_OQ);
+    __m256d inverse = _mm256_div_pd(one, det);
+    __m256d i00 = _mm256_mul_pd(c0, inverse);
+    __m256d i01 = _mm256_mul_pd(_mm256_xor_pd(c1, sign), inverse);
+    __m256d i02 = _mm256_mul_pd(c2, inverse);
+    __m256d i11 = _mm256_mul_pd(
+        _mm256_sub_pd(_mm256_mul_pd(a00, a22), _mm256_mul_pd(a02, a02)),
+        inverse);
+    __m256d i12 = _mm256_mul_pd(
+        _mm256_xor_pd(_mm256_sub_pd(_mm256_mul_pd(a00, a12),
+                                    _mm256_mul_pd(a02, a01)),
+                      sign),
+        inverse);
+    __m256d i22 = _mm256_mul_pd(
+        _mm256_sub_pd(_mm256_mul_pd(a00, a11), _mm256_mul_pd(a01, a01)),
+        inverse);
+    __m256d bx = _mm256_xor_pd(q[3], sign);
+    __m256d by = _mm256_xor_pd(q[6], sign);
+    __m256d bz = _mm256_xor_pd(q[8], sign);
+    __m256d solved[3];
+    solved[0] = _mm256_add_pd(
+        _mm256_add_pd(_mm256_mul_pd(i00, bx), _mm256_mul_pd(i01, by)),
+        _mm256_mul_pd(i02, bz));
+    solved[1] = _mm256_add_pd(
+        _mm256_add_pd(_mm256_mul_pd(i01, bx), _mm256_mul_pd(i11, by)),
+        _mm256_mul_pd(i12, bz));
+    solved[2] = _mm256_add_pd(
+        _mm256_add_pd(_mm256_mul_pd(i02, bx), _mm256_mul_pd(i12, by)),
+        _mm256_mul_pd(i22, bz));
+    for (int axis = 0; axis < 3; axis++) {
+      solved[axis] = _mm256_cvtps_pd(_mm256_cvtpd_ps(solved[axis]));
+    }
+    __m256d solved_error =
+        QuadricErrorAvx2(q, solved[0], solved[1], solved[2]);
+
+    for (int axis = 0; axis < 3; axis++) {
+      _mm_storeu_ps(&batch.position[axis][base],
+                    _mm256_cvtpd_ps(_mm256_blendv_pd(fallback[axis],
+                                                     solved[axis], solvable)));
+    }
+    _mm_storeu_ps(&batch.error[base],
+                  _mm256_cvtpd_ps(_mm256_blendv_pd(best, solved_error,
+                                                   solvable)));
+    for (int lane = 0; lane < 4; lane++) {
+      batch.keeps_second[base + lane] = false;
+    }
+  }
+}
+
+// Writes lanes [0, count) of three registers' worth of coordinates as vec3s
+bool HasFlippedFacesSse2(const GeometryKernels::FlipBatch& batch,
+                         size_t count) {
+  for (size_t first = 0; first < count; first += 4) {
+    __m128 before[3][3], after[3][3];  // [corner][axis]
+    const __m128i moved = _mm_loadu_si128(
+        reinterpret_cast<const __m128i*>(batch.moved + first));
+    for (int corner = 0; corner < 3; corner++) {
+      __m128 is_moved =
+          _mm_castsi128_ps(_mm_cmpeq_epi32(moved, _mm_set1_epi32(corner)));
+      for (int axis = 0; axis < 3; axis++) {
+        before[corner][axis] =
+            _mm_loadu_ps(batch.corners[corner][axis] + first);
+        after[corner][axis] = _mm_or_ps(
+            _mm_and_ps(is_moved, _mm_loadu_ps(batch.target[axis] + first)),
+            _mm_andnot_ps(is_moved, before[corner][axis]));
+      }
+    }
+    __m128 normals[2][3];  // Before and after
+    for (int k = 0; k < 2; k++) {
+      __m128 (&p)[3][3] = k == 0 ? before : after;
+      __m128 ax = _mm_sub_ps(p[1][0], p[0][0]);
+      __m128 ay = _mm_sub_ps(p[1][1], p[0][1]);
+      __m128 az = _mm_sub_ps(p[1][2], p[0][2]);
+      __m128 bx = _mm_sub_ps(p[2][0], p[0][0]);
+      __m128 by = _mm_sub_ps(p[2][1], p[0][1]);
+      __m128 bz = _mm_sub_ps(p[2][2], p[0][2]);
+      normals[k][0] = _mm_sub_ps(_mm_mul_ps(ay, bz), _mm_mul_ps(by, az));
+      normals[k][1] = _mm_sub_ps(_mm_mul_ps(az, bx), _mm_mul_ps(bz, ax));
+      normals[k][2] = _mm_sub_ps(_mm_mul_ps(ax, by), _mm_mul_ps(bx, ay));
+    }
+    __m128 lengths[2];
+    for (int k = 0; k < 2; k++) {
+      lengths[k] = _mm_sqrt_ps(_mm_add_ps(
+          _mm_add_ps(_mm_mul_ps(normals[k][0], normals[k][0]),
+                     _mm_mul_ps(normals[k][1], normals[k][1])),
+          _mm_mul_ps(normals[k][2], normals[k][2])));
+    }
+    __m128 dot = _mm_add_ps(
+        _mm_add_ps(_mm_mul_ps(normals[0][0], normals[1][0]),
+                   _mm_mul_ps(normals[0][1], normals[1][1])),
+        _mm_mul_ps(normals[0][2], normals[1][2]));
+    __m128 degenerate = _mm_cmple_ps(
+        lengths[1], _mm_mul_ps(_mm_set1_ps(1e-6f), lengths[0]));
+    __m128 flipped = _mm_cmple_ps(dot, _mm_setzero_ps());
+    int lanes = _mm_movemask_ps(_mm_or_ps(degenerate, flipped));
+    const size_t valid = count - first < 4 ? count - first : 4;
+    if ((lanes & ((1 << valid) - 1)) != 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+DECIMATOR_TARGET_AVX2
+bool HasFlippedFacesAvx2(const GeometryKernels::FlipBatch& batch,
+                         size_t count) {
+  __m256 before[3][3], after[3][3];  // [corner][axis]
+  const __m256i moved =
+      _mm256_loadu_si256(reinterpret_cast<const __m256i*>(batch.moved));
+  for (int corner = 0; corner < 3; corner++) {
+    __m256 is_moved = _mm256_castsi256_ps(
+        _mm256_cmpeq_epi32(moved, _mm256_set1_epi32(corner)));
+    for (int axis = 0; axis < 3; axis++) {
+      before[corner][axis] = _mm256_loadu_ps(batch.corners[corner][axis]);
+      after[corner][axis] = _mm256_blendv_ps(
+          before[corner][axis], _mm256_loadu_ps(batch.target[axis]),
+          is_moved);
+    }
+  }
+  __m256 normals[2][3];  // Before and after
+  for (int k = 0; k < 2; k++) {
+    __m256 (&p)[3][3] = k == 0 ? before : after;
+    __m256 ax = _mm256_sub_ps(p[1][0], p[0][0]);
+    __m256 ay = _mm256_sub_ps(p[1][1], p[0][1]);
+    __m256 az = _mm256_sub_ps(p[1][2], p[0][2]);
+    __m256 bx = _mm256_sub_ps(p[2][0], p[0][0]);
+    __m256 by = _mm256_sub_ps(p[2][1], p[0][1]);
+    __m256 bz = _mm256_sub_ps(p[2][2], p[0][2]);
+    normals[k][0] =
+        _mm256_sub_ps(_mm256_mul_ps(ay, bz), _mm256_mul_ps(by, az));
+    normals[k][1] =
+        _mm256_sub_ps(_mm256_mul_ps(az, bx), _mm256_mul_ps(bz, ax));
+    normals[k][2] =
+        _mm256_sub_ps(_mm256_mul_ps(ax, by), _mm256_mul_ps(bx, ay));
+  }
+  __m256 lengths[2];
+  for (int k = 0; k < 2; k++) {
+    lengths[k] = _mm256_sqrt_ps(_mm256_add_ps(
+        _mm256_add_ps(_mm256_mul_ps(normals[k][0], normals[k][0]),
+                      _mm256_mul_ps(normals[k][1], normals[k][1])),
+        _mm256_mul_ps(normals[k][2], normals[k][2])));
+  }
+  __m256 dot = _mm256_add_ps(
+      _mm256_add_ps(_mm256_mul_ps(normals[0][0], normals[1][0]),
+                    _mm256_mul_ps(normals[0][1], normals[1][1])),
+      _mm256_mul_ps(normals[0][2], normals[1][2]));
+  __m256 degenerate = _mm256_cmp_ps(
+      lengths[1], _mm256_mul_ps(_mm256_set1_ps(1e-6f), lengths[0]),
+      _CMP_LE_OQ);
+  __m256 flipped = _mm256_cmp_ps(dot, _mm256_setzero_ps(), _CMP_LE_OQ);
+  int lanes = _mm256_movemask_ps(_mm256_or_ps(degenerate, flipped));
+  return (lanes & ((1 << count) - 1)) != 0;
+}
+
+void StoreVectors(const float* x, const float* y, const float* z,
+                  size_t count, glm::vec3* out) {
+  for (size_t lane = 0; lane < count; lane++) {
+    out[lane] = glm::vec3(x[lane], y[lane], z[lane]);
+  }
+}
+
+void FacePlanesSse2(const glm::vec3* vertices, const glm::uvec3* faces,
+                    size_t begin, size_t end, glm::vec3* normals,
+                    float* double_areas, float* offsets) {
+  const __m128 zero = _mm_setzero_ps();
+  const __m128 one = _mm_set1_ps(1.0f);
+  const __m128 sign = _mm_set1_ps(-0.0f);
+  size_t i = begin;
+  for (; i + 4 <= end; i += 4) {
+    __m128 p[3][3];  // [corner][axis]
+    for (int corner = 0; corner < 3; corner++) {
+      const glm::vec3& a = vertices[faces[i][corner]];
+      const glm::vec3& b = vertices[faces[i + 1][corner]];
+      const glm::vec3& c = vertices[faces[i + 2][corner]];
+      const glm::vec3& d = vertices[faces[i + 3][corner]];
+      for (int axis = 0; axis < 3; axis++) {
+        p[corner][axis] = _mm_setr_ps(a[axis], b[axis], c[axis], d[axis]);
+      }
+    }
+    __m128 ax = _mm_sub_ps(p[1][0], p[0][0]);
+    __m128 ay = _mm_sub_ps(p[1][1], p[0][1]);
+    __m128 az = _mm_sub_ps(p[1][2], p[0][2]);
+    __m128 bx = _mm_sub_ps(p[2][0], p[0][0]);
+    __m128 by = _mm_sub_ps(p[2][1], p[0][1]);
+    __m128 bz = _mm_sub_ps(p[2][2], p[0][2]);
+    __m128 cx = _mm_sub_ps(_mm_mul_ps(ay, bz), _mm_mul_ps(by, az));
+    __m128 cy = _mm_sub_ps(_mm_mul_ps(az, bx), _mm_mul_ps(bz, ax));
+    __m128 cz = _mm_sub_ps(_mm_mul_ps(ax, by), _mm_mul_ps(bx, ay));
+    __m128 squared = _mm_add_ps(
+        _mm_add_ps(_mm_mul_ps(cx, cx), _mm_mul_ps(cy, cy)),
+        _mm_mul_ps(cz, cz));
+    __m128 valid = _mm_cmpgt_ps(squared, zero);
+    __m128 length = _mm_sqrt_ps(squared);
+    __m128 inverse = _mm_div_ps(one, length);
+    __m128 nx = _mm_and_ps(valid, _mm_mul_ps(cx, inverse));
+    __m128 ny = _mm_and_ps(valid, _mm_mul_ps(cy, inverse));
+    __m128 nz = _mm_and_ps(valid, _mm_mul_ps(cz, inverse));
+    alignas(16) float out[3][4];
+    _mm_store_ps(out[0], nx);
+    _mm_store_ps(out[1], ny);
+    _mm_store_ps(out[2], nz);
+    StoreVectors(out[0], out[1], out[2], 4, normals + i);
+    if (double_areas != nullptr) {
+      _mm_storeu_ps(double_areas + i, _mm_and_ps(valid, length));
+    }
+    if (offsets != nullptr) {
+      __m128 dot = _mm_add_ps(
+          _mm_add_ps(_mm_mul_ps(nx, p[0][0]), _mm_mul_ps(ny, p[0][1])),
+          _mm_mul_ps(nz, p[0][2]));
+      _mm_storeu_ps(offsets + i, _mm_and_ps(valid, _mm_xor_ps(dot, sign)));
+    }
+  }
+  FacePlanesScalar(vertices, faces, i, end, normals, double_areas, offsets);
+}
+
+DECIMATOR_TARGET_AVX2
+void FacePlanesAvx2(const glm::vec3* vertices, const glm::uvec3* faces,
+                    size_t begin, size_t end, glm::vec3* normals,
+                    float* double_areas, float* offsets) {
+  const __m256 zero = _mm256_setzero_ps();
+  const __m256 one = _mm256_set1_ps(1.0f);
+  const __m256 sign = _mm256_set1_ps(-0.0f);
+  size_t i = begin;
+  for (; i + 8 <= end; i += 8) {
+    __m256 p[3][3];  // [corner][axis]
+    for (int corner = 0; corner < 3; corner++) {
+      // Plain loads: on scattered vertices gathers are no faster
+      const glm::vec3* q[8];
+      for (int lane = 0; lane < 8; lane++) {
+        q[lane] = &vertices[faces[i + lane][corner]];
+      }
+      for (int axis = 0; axis < 3; axis++) {
+        p[corner][axis] = _mm256_setr_ps(
+            (*q[0])[axis], (*q[1])[axis], (*q[2])[axis], (*q[3])[axis],
+            (*q[4])[axis], (*q[5])[axis], (*q[6])[axis], (*q[7])[axis]);
+      }
+    }
+    __m256 ax = _mm256_sub_ps(p[1][0], p[0][0]);
+    __m256 ay = _mm256_sub_ps(p[1][1], p[0][1]);
+    __m256 az = _mm256_sub_ps(p[1][2], p[0][2]);
+    __m256 bx = _mm256_sub_ps(p[2][0], p[0][0]);
+    __m256 by = _mm256_sub_ps(p[2][1], p[0][1]);
+    __m256 bz = _mm256_sub_ps(p[2][2], p[0][2]);
+    __m256 cx = _mm256_sub_ps(_mm256_mul_ps(ay, bz), _mm256_mul_ps(by, az));
+    __m256 cy = _mm256_sub_ps(_mm256_mul_ps(az, bx), _mm256_mul_ps(bz, ax));
+    __m256 cz = _mm256_sub_ps(_mm256_mul_ps(ax, by), _mm256_mul_ps(bx, ay));
+    __m256 squared = _mm256_add_ps(
+        _mm256_add_ps(_mm256_mul_ps(cx, cx), _mm256_mul_ps(cy, cy)),
+        _mm256_mul_ps(cz, cz));
+    __m256 valid = _mm256_cmp_ps(squared, zero, _CMP_GT_OQ);
+    __m256 length = _mm256_sqrt_ps(squared);
+    __m256 inverse = _mm256_div_ps(one, length);
+    __m256 nx = _mm256_and_ps(valid, _mm256_mul_ps(cx, inverse));
+    __m256 ny = _mm256_and_ps(valid, _mm256_mul_ps(cy, inverse));
+    __m256 nz = _mm256_and_ps(valid, _mm256_mul_ps(cz, inverse));
+    alignas(32) float out[3][8];
+    _mm256_store_ps(out[0], nx);
+    _mm256_store_ps(out[1], ny);
+    _mm256_store_ps(out[2], nz);
+    StoreVectors(out[0], out[1], out[2], 8, normals + i);
+    if (double_areas != nullptr) {
+      _mm256_storeu_ps(double_areas + i, _mm256_and_ps(valid, length));
+    }
+    if (offsets != nullptr) {
+      __m256 dot = _mm256_add_ps(
+          _mm256_add_ps(_mm256_mul_ps(nx, p[0][0]), _mm256_mul_ps(ny, p[0][1])),
+          _mm256_mul_ps(nz, p[0][2]));
+      _mm256_storeu_ps(offsets + i,
+                       _mm256_and_ps(valid, _mm256_xor_ps(dot, sign)));
+    }
+  }
+  FacePlanesScalar(vertices, faces, i, end, normals, double_areas, offsets);
+}
+
+void NormalizeSse2(glm::vec3* vectors, size_t begin, size_t end) {
+  const __m128 zero = _mm_setzero_ps();
+  const __m128 one = _mm_set1_ps(1.0f);
+  size_t i = begin;
+  for (; i + 4 <= end; i += 4) {
+    alignas(16) float v[3][4];
+    for (int lane = 0; lane < 4; lane++) {
+      v[0][lane] = vectors[i + lane].x;
+      v[1][lane] = vectors[i + lane].y;
+      v[2][lane] = vectors[i + lane].z;
+    }
+    __m128 x = _mm_load_ps(v[0]);
+    __m128 y = _mm_load_ps(v[1]);
+    __m128 z = _mm_load_ps(v[2]);
+    __m128 squared = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)),
+                                _mm_mul_ps(z, z));
+    __m128 valid = _mm_cmpgt_ps(squared, zero);
+    // Lanes that stay unchanged divide by 1 instead
+    __m128 scale = _mm_or_ps(
+        _mm_and_ps(valid, _mm_div_ps(one, _mm_sqrt_ps(squared))),
+        _mm_andnot_ps(valid, one));
+    _mm_store_ps(v[0], _mm_mul_ps(x, scale));
+    _mm_store_ps(v[1], _mm_mul_ps(y, scale));
+    _mm_store_ps(v[2], _mm_mul_ps(z, scale));
+    StoreVectors(v[0], v[1], v[2], 4, vectors + i);
+  }
+  NormalizeScalar(vectors, i, end);
+}
+
+DECIMATOR_TARGET_AVX2
+void NormalizeAvx2(glm::vec3* vectors, size_t begin, size_t end) {
+  const __m256 zero = _mm256_setzero_ps();
+  const __m256 one = _mm256_set1_ps(1.0f);
+  size_t i = begin;
+  for (; i + 8 <= end; i += 8) {
+    alignas(32) float v[3][8];
+    for (int lane = 0; lane < 8; lane++) {
+      v[0][lane] = vectors[i + lane].x;
+      v[1][lane] = vectors[i + lane].y;
+      v[2][lane] = vectors[i + lane].z;
+    }
+    __m256 x = _mm256_load_ps(v[0]);
+    __m256 y = _mm256_load_ps(v[1]);
+    __m256 z = _mm256_load_ps(v[2]);
+    __m256 squared = _mm256_add_ps(
+        _mm256_add_ps(_mm256_mul_ps(x, x), _mm256_mul_ps(y, y)),
+        _mm256_mul_ps(z, z));
+    __m256 valid = _mm256_cmp_ps(squared, zero, _CMP_GT_OQ);
+    __m256 scale = _mm256_blendv_ps(
+        one, _mm256_div_ps(one, _mm256_sqrt_ps(squared)), valid);
+    _mm256_store_ps(v[0], _mm256_mul_ps(x, scale));
+    _mm256_store_ps(v[1], _mm256_mul_ps(y, scale));
+    _mm256_store_ps(v[2], _mm256_mul_ps(z, scale));
+    StoreVectors(v[0], v[1], v[2], 8, vectors + i);
+  }
+  NormalizeScalar(vectors, i, end);
+}
+
+void BoundsSse2(const float* x, const float* y, const float* z,
+                size_t padded_count, glm::vec3& min_bounds,
+                glm::vec3& max_bounds) {
+  const float* axes[3] = {x, y, z};
+  for (int axis = 0; axis < 3; axis++) {
+    const float* values = axes[axis];
+    __m128 lo = _mm_load_ps(values);
+    __m128 hi = lo;
+    for (size_t i = 4; i < padded_count; i += 4) {
+      __m128 block = _mm_load_ps(values + i);
+      lo = _mm_min_ps(lo, block);
+      hi = _mm_max_ps(hi, block);
+    }
+    alignas(16) float lanes[2][4];
+    _mm_store_ps(lanes[0], lo);
+    _mm_store_ps(lanes[1], hi);
+    min_bounds[axis] = *std::min_element(lanes[0], lanes[0] + 4);
+    max_bounds[axis] = *std::max_element(lanes[1], lanes[1] + 4);
+  }
+}
+
+DECIMATOR_TARGET_AVX2
+void BoundsAvx2(const float* x, const float* y, const float* z,
+                size_t padded_count, glm::vec3& min_bounds,
+                glm::vec3& max_bounds) {
+  const float* axes[3] = {x, y, z};
+  for (int axis = 0; axis < 3; axis++) {
+    const float* values = axes[axis];
+    __m256 lo = _mm256_load_ps(values);
+    __m256 hi = lo;
+    for (size_t i = 8; i < padded_count; i += 8) {
+      __m256 block = _mm256_load_ps(values + i);
+      lo = _mm256_min_ps(lo, block);
+      hi = _mm256_max_ps(hi, block);
+    }
+    alignas(32) float lanes[2][8];
+    _mm256_store_ps(lanes[0], lo);
+    _mm256_store_ps(lanes[1], hi);
+    min_bounds[axis] = *std::min_element(lanes[0], lanes[0] + 8);
+    max_bounds[axis] = *std::max_element(lanes[1], lanes[1] + 8);
+  }
+}
+#endif
+}  // namespace
+
+GeometryKernels::SimdLevel GeometryKernels::GetSimdLevel() {
+  return static_cast<SimdLevel>(CurrentLevel().load(std::memory_order_relaxed));
+}
+
+GeometryKernels::SimdLevel GeometryKernels::GetSupportedSimdLevel() {
+  static const SimdLevel supported = DetectSimdLevel();
+  return supported;
+}
+
+void GeometryKernels::SetSimdLevel(SimdLevel level) {
+  level = std::min(level, GetSupportedSimdLevel());
+  CurrentLevel().store(static_cast<int>(level), std::memory_order_relaxed);
+}
+
+const char* GeometryKernels::GetSimdLevelName(SimdLevel level) {
+  switch (level) {
+    case SimdLevel::AVX2:
+      return "avx2";
+    case SimdLevel::SSE2:
+      return "sse2";
+    case SimdLevel::SCALAR:
+    default:
+      return "scalar";
+  }
+}
+
+void GeometryKernels::ComputeFacePlanes(const glm::vec3* vertices,
+                                        const glm::uvec3* faces,
+                                        size_t face_count, glm::vec3* normals,
+                                        float* double_areas, float* offsets) {
+  SimdLevel level = GetSimdLevel();
+  ParallelChunks(face_count, [&](size_t, size_t begin, size_t end) {
+    switch (level) {
+#if defined(DECIMATOR_KERNELS_X86)
+      case SimdLevel::AVX2:
+        FacePlanesAvx2(vertices, faces, begin, end, normals, double_areas,
+                       offsets);
+        break;
+      case SimdLevel::SSE2:
+        FacePlanesSse2(vertices, faces, begin, end, normals, double_areas,
+                       offsets);
+        break;
+#endif
+      default:
+        FacePlanesScalar(vertices, faces, begin, end, normals, double_areas,
+                         offsets);
+        break;
+    }
+  });
+}
+
+void GeometryKernels::AccumulateVertexNormals(const glm::vec3* vertices,
+                                              const glm::uvec3* faces,
+                                              size_t face_count,
+                                              glm::vec3* sums) {
+  // Serial and scalar at every level: the scatter has to run in face order
+  // so the sums don't depend on the thread count, and a cross product is
+  // cheaper than transposing its corners into SIMD lanes
+  for (size_t i = 0; i < face_count; i++) {
+    const glm::uvec3& face = faces[i];
+    const glm::vec3& p0 = vertices[face.x];
+    const glm::vec3 cross =
+        glm::cross(vertices[face.y] - p0, vertices[face.z] - p0);
+    sums[face.x] += cross;
+    sums[face.y] += cross;
+    sums[face.z] += cross;
+  }
+}
+
+void GeometryKernels::NormalizeVectors(glm::vec3* vectors, size_t count) {
+  SimdLevel level = GetSimdLevel();
+  ParallelChunks(count, [&](size_t, size_t begin, size_t end) {
+    switch (level) {
+#if defined(DECIMATOR_KERNELS_X86)
+      case SimdLevel::AVX2:
+        NormalizeAvx2(vectors, begin, end);
+        break;
+      case SimdLevel::SSE2:
+        NormalizeSse2(vectors, begin, end);
+        break;
+#endif
+      default:
+        NormalizeScalar(vectors, begin, end);
+        break;
+    }
+  });
+}
+
+void GeometryKernels::SolveQuadricBatch(QuadricBatch& batch,
+                                        bool endpoints_only) {
+#if defined(DECIMATOR_KERNELS_X86)
+  if (GetSimdLevel() == SimdLevel::AVX2) {
+    SolveQuadricBatchAvx2(batch, endpoints_only);
+    return;
+  }
+#endif
+  SolveQuadricBatchScalar(batch, endpoints_only);
+}
+
+bool GeometryKernels::HasFlippedFaces(const FlipBatch& batch, size_t count) {
+#if defined(DECIMATOR_KERNELS_X86)
+  switch (GetSimdLevel()) {
+    case SimdLevel::AVX2:
+      return HasFlippedFacesAvx2(batch, count);
+    case SimdLevel::SSE2:
+      return HasFlippedFacesSse2(batch, count);
+    default:
+      break;
+  }
+#endif
+  return HasFlippedFacesScalar(batch, count);
+}
+
+void GeometryKernels::ComputeBounds(const float* x, const float* y,
+                                    const float* z, size_t padded_count,
+                                    glm::vec3& min_bounds,
+                                    glm::vec3& max_bounds) {
+  switch (GetSimdLevel()) {
+#if defined(DECIMATOR_KERNELS_X86)
+    case SimdLevel::AVX2:
+      BoundsAvx2(x, y, z, padded_count, min_bounds, max_bounds);
+      break;
+    case SimdLevel::SSE2:
+      BoundsSse2(x, y, z, padded_count, min_bounds, max_bounds);
+      break;
+#endif
+    default:
+      BoundsScalar(x, y, z, padded_count, min_bounds, max_bounds);
+      break;
+  }
+}
+
+}  // namespace GLOO
@@ -0,0 +1,97 @@
+#ifndef GEOMETRY_KERNELS_H_
+#define GEOMETRY_KERNELS_H_
+
+#include <cstddef>
+#include <glm/glm.hpp>
+
+namespace GLOO {
+
+// Batch kernels for the per-face and per-vertex passes that run on every
+// load and every result (face planes, vertex normals and bounds) and
+// for the quadric solves and fold-over tests of the simplifiers.
+//
+// Apart from AccumulateVertexNormals, each kernel has a scalar and an AVX2
+// version, and the float kernels an SSE2 one; the best one the CPU supports
+// is picked at runtime, so the binary needs no -mavx2. The versions use the
+// same operations in the same order (no FMA), so they return bit-identical
+// results, matching the glm functions they replace. ComputeFacePlanes and
+// NormalizeVectors split their input across the parallel workers;
+// AccumulateVertexNormals is a serial scalar loop.
+class GeometryKernels {
+ public:
+  enum class SimdLevel { SCALAR, SSE2, AVX2 };
+
+  // Level the kernels currently use (the best supported one by default)
+  static SimdLevel GetSimdLevel();
+  static SimdLevel GetSupportedSimdLevel();
+  // Forces a level for testing and benchmarking, capped at the supported
+  // one
+  static void SetSimdLevel(SimdLevel level);
+  static const char* GetSimdLevelName(SimdLevel level);
+
+  // For faces [0, face_count): the unit normal of the face (zero for
+  // degenerate faces) and, when the pointers are non-null, the length of the
+  // edge cross product (twice the area) and the plane offset
+  // -dot(normal, v0).
+  static void ComputeFacePlanes(const glm::vec3* vertices,
+                                const glm::uvec3* faces, size_t face_count,
+                                glm::vec3* normals, float* double_areas,
+                                float* offsets);
+
+  // Adds the edge cross product of each of faces [0, face_count) (its
+  // normal times twice its area) to the sums of its three corners, in face
+  // order. With NormalizeVectors, this gives area-weighted vertex normals
+  // (the normalization is the part that runs in SIMD and in parallel).
+  static void AccumulateVertexNormals(const glm::vec3* vertices,
+                                      const glm::uvec3* faces,
+                                      size_t face_count, glm::vec3* sums);
+
+  // Normalizes vectors in place; zero vectors are left unchanged.
+  static void NormalizeVectors(glm::vec3* vectors, size_t count);
+
+  // Up to kQuadricBatch edge collapses in structure-of-arrays form, one
+  // lane per edge. Unused lanes should repeat a real edge.
+  static const size_t kQuadricBatch = 8;
+  struct QuadricBatch {
+    // Input: the summed quadric of the two endpoints, upper triangle stored
+    // row-major as in EdgeCollapse::QuadricMatrix, and the endpoints
+    double quadric[10][kQuadricBatch];
+    float first[3][kQuadricBatch];
+    float second[3][kQuadricBatch];
+    // Output: collapse position, its quadric error and, for endpoints-only
+    // solves, whether the second endpoint is the one kept
+    float position[3][kQuadricBatch];
+    float error[kQuadricBatch];
+    bool keeps_second[kQuadricBatch];
+  };
+
+  // Optimal collapse position of every lane: the closed-form 3x3 inverse
+  // solve, or the best of the endpoints and midpoint when the system is
+  // near singular. With endpoints_only, the cheaper endpoint instead. Same
+  // results as the per-edge solve with glm::inverse it replaces.
+  static void SolveQuadricBatch(QuadricBatch& batch, bool endpoints_only);
+
+  // Up to kFlipBatch faces with one moving corner (e.g. the faces around a
+  // collapsed edge that survive it), one lane per face
+  static const size_t kFlipBatch = 8;
+  struct FlipBatch {
+    float corners[3][3][kFlipBatch];  // [corner][axis], before the move
+    float target[3][kFlipBatch];      // New position of the moving corner
+    int moved[kFlipBatch];            // Which corner moves (0-2)
+  };
+
+  // Whether moving the corner flips (the normal turns by 90 degrees or
+  // more) or degenerates (twice the area drops to 1e-6 of what it was or
+  // below) any of the first count faces
+  static bool HasFlippedFaces(const FlipBatch& batch, size_t count);
+
+  // Bounds of three coordinate arrays that are padded to a multiple of 8
+  // and 32-byte aligned (see SoAPositions); padded_count must be > 0.
+  static void ComputeBounds(const float* x, const float* y, const float* z,
+                            size_t padded_count, glm::vec3& min_bounds,
+                            glm::vec3& max_bounds);
+};
+
+}  // namespace GLOO
+
+#endif
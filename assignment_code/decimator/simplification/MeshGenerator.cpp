@@ -0,0 +1,423 @@
+#include "MeshGenerator.hpp"
+#include "helpers.hpp"
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <random>
+#include <utility>
+
+namespace GLOO {
+
+namespace {
+
+const float kTwoPi = 6.28318530718f;
+
+// Lattice hash in [-1, 1] for value noise.
+float LatticeValue(int x, int y, uint32_t seed) {
+  uint32_t h = seed;
+  h ^= static_cast<uint32_t>(x) * 0x27d4eb2du;
+  h = (h ^ (h >> 15)) * 0x85ebca6bu;
+  h ^= static_cast<uint32_t>(y) * 0x165667b1u;
+  h = (h ^ (h >> 13)) * 0xc2b2ae35u;
+  h ^= h >> 16;
+  return (h & 0xFFFFFF) / float(0x7FFFFF) - 1.0f;
+}
+
+float ValueNoise(float x, float y, uint32_t seed) {
+  int ix = static_cast<int>(std::floor(x));
+  int iy = static_cast<int>(std::floor(y));
+  float fx = x - ix;
+  float fy = y - iy;
+  // Smoothstep fade.
+  float ux = fx * fx * (3.0f - 2.0f * fx);
+  float uy = fy * fy * (3.0f - 2.0f * fy);
+  float v00 = LatticeValue(ix, iy, seed);
+  float v10 = LatticeValue(ix + 1, iy, seed);
+  float v01 = LatticeValue(ix, iy + 1, seed);
+  float v11 = LatticeValue(ix + 1, iy + 1, seed);
+  float a = v00 + (v10 - v00) * ux;
+  float b = v01 + (v11 - v01) * ux;
+  return a + (b - a) * uy;
+}
+
+// Fractal (fBm) sum of value noise octaves, roughly in [-1, 1].
+float FractalNoise(float x, float y, uint32_t seed) {
+  float sum = 0.0f;
+  float amplitude = 0.5f;
+  float frequency = 4.0f;
+  for (int octave = 0; octave < 6; octave++) {
+    sum += amplitude * ValueNoise(x * frequency, y * frequency, seed + octave);
+    amplitude *= 0.5f;
+    frequency *= 2.0f;
+  }
+  return sum;
+}
+
+// Appends the faces of a resolution x resolution quad grid whose vertices
+// are laid out row-major starting at `base`.
+void AppendGridFaces(size_t resolution, unsigned int base,
+                     std::vector<glm::uvec3>& faces) {
+  size_t row = resolution + 1;
+  size_t first = faces.size();
+  faces.resize(first + 2 * resolution * resolution);
+  ParallelFor(resolution * resolution, [&](size_t q) {
+    size_t i = q / resolution;
+    size_t j = q % resolution;
+    unsigned int a = base + static_cast<unsigned int>(i * row + j);
+    unsigned int b = a + 1;
+    unsigned int c = a + static_cast<unsigned int>(row);
+    unsigned int d = c + 1;
+    faces[first + 2 * q] = glm::uvec3(a, c, d);
+    faces[first + 2 * q + 1] = glm::uvec3(a, d, b);
+  });
+}
+
+// Drops vertices no face references and remaps the faces accordingly.
+void RemoveUnreferencedVertices(SimplificationMesh& mesh) {
+  std::vector<unsigned int> used(mesh.vertices.size(), 0);
+  for (const auto& face : mesh.faces) {
+    used[face.x] = used[face.y] = used[face.z] = 1;
+  }
+  std::vector<unsigned int> remap;
+  ExclusiveScan(used, remap);
+
+  std::vector<glm::vec3> vertices;
+  CompactIf(mesh.vertices, vertices, [&](size_t i) { return used[i] != 0; });
+  mesh.vertices.swap(vertices);
+  ParallelFor(mesh.faces.size(), [&](size_t i) {
+    glm::uvec3& face = mesh.faces[i];
+    face = glm::uvec3(remap[face.x], remap[face.y], remap[face.z]);
+  });
+}
+
+}  // namespace
+
+SimplificationMesh MeshGenerator::CreateIcosphere(float radius,
+                                                  size_t frequency) {
+  frequency = std::max<size_t>(1, frequency);
+  const float t = (1.0f + std::sqrt(5.0f)) / 2.0f;
+  const glm::vec3 corners[12] = {
+      {-1, t, 0}, {1, t, 0}, {-1, -t, 0}, {1, -t, 0},
+      {0, -1, t}, {0, 1, t}, {0, -1, -t}, {0, 1, -t},
+      {t, 0, -1}, {t, 0, 1}, {-t, 0, -1}, {-t, 0, 1}};
+  const unsigned int ico_faces[20][3] = {
+      {0, 11, 5}, {0, 5, 1}, {0, 1, 7}, {0, 7, 10}, {0, 10, 11},
+      {1, 5, 9}, {5, 11, 4}, {11, 10, 2}, {10, 7, 6}, {7, 1, 8},
+      {3, 9, 4}, {3, 4, 2}, {3, 2, 6}, {3, 6, 8}, {3, 8, 9},
+      {4, 9, 5}, {2, 4, 11}, {6, 2, 10}, {8, 6, 7}, {9, 8, 1}};
+
+  const size_t f = frequency;
+  SimplificationMesh mesh;
+  mesh.vertices.reserve(10 * f * f + 2);
+  mesh.faces.reserve(20 * f * f);
+  for (const auto& corner : corners) {
+    mesh.vertices.push_back(corner);
+  }
+
+  // Interior points of each icosahedron edge, stored from the lower corner
+  // index to the higher one so neighbouring faces share them.
+  std::map<std::pair<unsigned int, unsigned int>, unsigned int> edge_base;
+  auto edge_vertex = [&](unsigned int u, unsigned int v, size_t step) {
+    std::pair<unsigned int, unsigned int> key(std::min(u, v), std::max(u, v));
+    auto it = edge_base.find(key);
+    if (it == edge_base.end()) {
+      unsigned int base = static_cast<unsigned int>(mesh.vertices.size());
+      for (size_t s = 1; s < f; s++) {
+        mesh.vertices.push_back(glm::mix(corners[key.first],
+                                         corners[key.second],
+                                         float(s) / float(f)));
+      }
+      it = edge_base.insert(std::make_pair(key, base)).first;
+    }
+    size_t from_low = u < v ? step : f - step;
+    return it->second + static_cast<unsigned int>(from_low - 1);
+  };
+
+  std::vector<unsigned int> grid;
+  for (const auto& ico : ico_faces) {
+    unsigned int a = ico[0], b = ico[1], c = ico[2];
+    // grid[(i, j)] for i + j <= f, point = a + (b - a) i / f + (c - a) j / f.
+    grid.assign((f + 1) * (f + 1), 0);
+    auto at = [&](size_t i, size_t j) -> unsigned int& {
+      return grid[i * (f + 1) + j];
+    };
+    for (size_t i = 0; i <= f; i++) {
+      for (size_t j = 0; i + j <= f; j++) {
+        unsigned int index;
+        if (i == 0 && j == 0) {
+          index = a;
+        } else if (i == f) {
+          index = b;
+        } else if (j == f) {
+          index = c;
+        } else if (j == 0) {
+          index = edge_vertex(a, b, i);
+        } else if (i == 0) {
+          index = edge_vertex(a, c, j);
+        } else if (i + j == f) {
+          index = edge_vertex(b, c, j);
+        } else {
+          index = static_cast<unsigned int>(mesh.vertices.size());
+          mesh.vertices.push_back(corners[a] +
+                                  (corners[b] - corners[a]) * (float(i) / f) +
+                                  (corners[c] - corners[a]) * (float(j) / f));
+        }
+        at(i, j) = index;
+      }
+    }
+    for (size_t i = 0; i < f; i++) {
+      for (size_t j = 0; i + j < f; j++) {
+        mesh.faces.push_back(glm::uvec3(at(i, j), at(i + 1, j), at(i, j + 1)));
+        if (i + j + 1 < f) {
+          mesh.faces.push_back(
+              glm::uvec3(at(i + 1, j), at(i + 1, j + 1), at(i, j + 1)));
+        }
+      }
+    }
+  }
+
+  mesh.normals.resize(mesh.vertices.size());
+  ParallelFor(mesh.vertices.size(), [&](size_t i) {
+    mesh.normals[i] = glm::normalize(mesh.vertices[i]);
+    mesh.vertices[i] = mesh.normals[i] * radius;
+  });
+  return mesh;
+}
+
+SimplificationMesh MeshGenerator::CreateTerrain(size_t resolution,
+                                                float amplitude,
+                                                uint32_t seed) {
+  resolution = std::max<size_t>(1, resolution);
+  const size_t row = resolution + 1;
+  SimplificationMesh mesh;
+  mesh.vertices.resize(row * row);
+  ParallelFor(row * row, [&](size_t v) {
+    float x = 2.0f * (v % row) / resolution - 1.0f;
+    float z = 2.0f * (v / row) / resolution - 1.0f;
+    mesh.vertices[v] = glm::vec3(x, amplitude * FractalNoise(x, z, seed), z);
+  });
+  AppendGridFaces(resolution, 0, mesh.faces);
+  mesh.ComputeNormals();
+  return mesh;
+}
+
+SimplificationMesh MeshGenerator::CreateTorusKnot(int p,
+                                                  int q,
+                                                  size_t segments,
+                                                  size_t sides,
+                                                  float tube_radius) {
+  segments = std::max<size_t>(3, segments);
+  sides = std::max<size_t>(3, sides);
+  auto curve = [p, q](float t) {
+    float r = 2.0f + std::cos(q * t);
+    return glm::vec3(r * std::cos(p * t), r * std::sin(p * t),
+                     std::sin(q * t)) / 3.0f;
+  };
+
+  SimplificationMesh mesh;
+  mesh.vertices.resize(segments * sides);
+  ParallelFor(segments, [&](size_t i) {
+    float t = kTwoPi * i / segments;
+    float dt = kTwoPi / (4.0f * segments);
+    glm::vec3 center = curve(t);
+    glm::vec3 tangent = glm::normalize(curve(t + dt) - curve(t - dt));
+    // The knot's tangent is never parallel to z, so z gives a stable frame.
+    glm::vec3 normal =
+        glm::normalize(glm::cross(tangent, glm::vec3(0.0f, 0.0f, 1.0f)));
+    glm::vec3 binormal = glm::cross(tangent, normal);
+    for (size_t j = 0; j < sides; j++) {
+      float phi = kTwoPi * j / sides;
+      mesh.vertices[i * sides + j] =
+          center + tube_radius * (std::cos(phi) * normal +
+                                  std::sin(phi) * binormal);
+    }
+  });
+
+  mesh.faces.resize(2 * segments * sides);
+  ParallelFor(segments * sides, [&](size_t k) {
+    size_t i = k / sides;
+    size_t j = k % sides;
+    size_t i1 = (i + 1) % segments;
+    size_t j1 = (j + 1) % sides;
+    unsigned int a = static_cast<unsigned int>(i * sides + j);
+    unsigned int b = static_cast<unsigned int>(i * sides + j1);
+    unsigned int c = static_cast<unsigned int>(i1 * sides + j);
+    unsigned int d = static_cast<unsigned int>(i1 * sides + j1);
+    mesh.faces[2 * k] = glm::uvec3(a, d, c);
+    mesh.faces[2 * k + 1] = glm::uvec3(a, b, d);
+  });
+  mesh.ComputeNormals();
+  return mesh;
+}
+
+SimplificationMesh MeshGenerator::CreatePlaneWithHoles(size_t resolution,
+                                                       size_t num_holes,
+                                                       uint32_t seed) {
+  resolution = std::max<size_t>(1, resolution);
+  const size_t row = resolution + 1;
+  SimplificationMesh mesh;
+  mesh.vertices.resize(row * row);
+  ParallelFor(row * row, [&](size_t v) {
+    mesh.vertices[v] = glm::vec3(2.0f * (v % row) / resolution - 1.0f, 0.0f,
+                                 2.0f * (v / row) / resolution - 1.0f);
+  });
+  std::vector<glm::uvec3> grid_faces;
+  AppendGridFaces(resolution, 0, grid_faces);
+
+  std::mt19937 rng(seed);
+  std::uniform_real_distribution<float> center(-0.85f, 0.85f);
+  std::uniform_real_distribution<float> radius(0.03f, 0.12f);
+  std::vector<glm::vec3> holes(num_holes);  // (x, z, radius^2)
+  for (auto& hole : holes) {
+    float r = radius(rng);
+    hole = glm::vec3(center(rng), center(rng), r * r);
+  }
+
+  CompactIf(grid_faces, mesh.faces, [&](size_t i) {
+    const glm::uvec3& face = grid_faces[i];
+    glm::vec3 centroid = (mesh.vertices[face.x] + mesh.vertices[face.y] +
+                          mesh.vertices[face.z]) / 3.0f;
+    for (const auto& hole : holes) {
+      float dx = centroid.x - hole.x;
+      float dz = centroid.z - hole.y;
+      if (dx * dx + dz * dz < hole.z) {
+        return false;
+      }
+    }
+    return true;
+  });
+  RemoveUnreferencedVertices(mesh);
+  mesh.ComputeNormals();
+  return mesh;
+}
+
+SimplificationMesh MeshGenerator::CreateNonManifoldSoup(size_t num_faces,
+                                                        uint32_t seed) {
+  std::mt19937 rng(seed);
+  std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+  // ~40% manifold base grid the defects are attached to.
+  size_t resolution = std::max<size_t>(
+      2, static_cast<size_t>(std::sqrt(0.2 * num_faces)));
+  SimplificationMesh mesh = CreateTerrain(resolution, 0.1f, seed);
+  mesh.normals.clear();
+  const size_t row = resolution + 1;
+  const size_t grid_faces = mesh.faces.size();
+  const float cell = 2.0f / resolution;
+
+  auto random_grid_vertex = [&]() {
+    size_t i = static_cast<size_t>(unit(rng) * resolution);
+    size_t j = static_cast<size_t>(unit(rng) * resolution);
+    return static_cast<unsigned int>(std::min(i, resolution - 1) * row +
+                                     std::min(j, resolution - 1));
+  };
+  auto add_vertex = [&](const glm::vec3& v) {
+    mesh.vertices.push_back(v);
+    return static_cast<unsigned int>(mesh.vertices.size() - 1);
+  };
+
+  size_t remaining = num_faces > grid_faces ? num_faces - grid_faces : 0;
+  size_t fins = remaining / 4;
+  size_t bowties = remaining / 6;
+  size_t duplicates = remaining / 6;
+  size_t loose = remaining - fins - bowties - duplicates;
+
+  // Fins: a third face on a grid edge makes it non-manifold.
+  for (size_t k = 0; k < fins; k++) {
+    unsigned int a = random_grid_vertex();
+    unsigned int b = a + 1;
+    glm::vec3 mid = 0.5f * (mesh.vertices[a] + mesh.vertices[b]);
+    unsigned int apex = add_vertex(
+        mid + glm::vec3(0.0f, cell * (0.5f + unit(rng)), 0.0f));
+    mesh.faces.push_back(glm::uvec3(a, b, apex));
+  }
+  // Bow-ties: a triangle hanging off a single grid vertex.
+  for (size_t k = 0; k < bowties; k++) {
+    unsigned int a = random_grid_vertex();
+    glm::vec3 base = mesh.vertices[a] + glm::vec3(0.0f, cell, 0.0f);
+    unsigned int b = add_vertex(base + glm::vec3(cell * 0.5f, 0.0f, 0.0f));
+    unsigned int c = add_vertex(base + glm::vec3(0.0f, 0.0f, cell * 0.5f));
+    mesh.faces.push_back(glm::uvec3(a, b, c));
+  }
+  // Duplicated faces, half of them with flipped orientation.
+  for (size_t k = 0; k < duplicates; k++) {
+    glm::uvec3 face = mesh.faces[static_cast<size_t>(unit(rng) * grid_faces) %
+                                 grid_faces];
+    if (k % 2) std::swap(face.y, face.z);
+    mesh.faces.push_back(face);
+  }
+  // Loose triangles scattered above the grid.
+  for (size_t k = 0; k < loose; k++) {
+    glm::vec3 origin(2.0f * unit(rng) - 1.0f, 0.2f + unit(rng),
+                     2.0f * unit(rng) - 1.0f);
+    unsigned int a = add_vertex(origin);
+    unsigned int b = add_vertex(origin + glm::vec3(cell, 0.0f, 0.0f));
+    unsigned int c = add_vertex(origin +
+                                glm::vec3(0.0f, cell * unit(rng), cell));
+    mesh.faces.push_back(glm::uvec3(a, b, c));
+  }
+  mesh.ComputeNormals();
+  return mesh;
+}
+
+SimplificationMesh MeshGenerator::Create(Shape shape,
+                                         size_t target_faces,
+                                         uint32_t seed) {
+  target_faces = std::max<size_t>(target_faces, 20);
+  switch (shape) {
+    case Shape::ICOSPHERE:
+      return CreateIcosphere(
+          1.0f, static_cast<size_t>(std::lround(std::sqrt(target_faces / 20.0))));
+    case Shape::TERRAIN:
+      return CreateTerrain(
+          static_cast<size_t>(std::lround(std::sqrt(target_faces / 2.0))),
+          0.3f, seed);
+    case Shape::TORUS_KNOT: {
+      // Keep quads roughly square: the knot is ~16x longer than the tube
+      // circumference.
+      size_t sides = std::max<size_t>(
+          4, static_cast<size_t>(std::sqrt(target_faces / 32.0)));
+      return CreateTorusKnot(2, 3, target_faces / (2 * sides), sides, 0.1f);
+    }
+    case Shape::PLANE_WITH_HOLES: {
+      // Holes remove ~15% of the grid.
+      size_t resolution = static_cast<size_t>(
+          std::lround(std::sqrt(target_faces / (2.0 * 0.85))));
+      return CreatePlaneWithHoles(resolution, 12, seed);
+    }
+    case Shape::NON_MANIFOLD_SOUP:
+      return CreateNonManifoldSoup(target_faces, seed);
+  }
+  return SimplificationMesh();
+}
+
+const char* MeshGenerator::GetShapeName(Shape shape) {
+  switch (shape) {
+    case Shape::ICOSPHERE:
+      return "icosphere";
+    case Shape::TERRAIN:
+      return "terrain";
+    case Shape::TORUS_KNOT:
+      return "torus_knot";
+    case Shape::PLANE_WITH_HOLES:
+      return "plane_with_holes";
+    case Shape::NON_MANIFOLD_SOUP:
+      return "non_manifold_soup";
+    default:
+      return "unknown";
+  }
+}
+
+bool MeshGenerator::ParseShapeName(const std::string& name, Shape& shape) {
+  const Shape shapes[] = {Shape::ICOSPHERE, Shape::TERRAIN, Shape::TORUS_KNOT,
+                          Shape::PLANE_WITH_HOLES, Shape::NON_MANIFOLD_SOUP};
+  for (Shape candidate : shapes) {
+    if (name == GetShapeName(candidate)) {
+      shape = candidate;
+      return true;
+    }
+  }
+  return false;
+}
+
+}  // namespace GLOO
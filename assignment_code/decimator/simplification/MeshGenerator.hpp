@@ -0,0 +1,66 @@
+#ifndef MESH_GENERATOR_H_
+#define MESH_GENERATOR_H_
+
+#include <cstdint>
+#include <string>
+#include "SimplificationMesh.hpp"
+
+namespace GLOO {
+
+// GL-free procedural meshes for testing and benchmarking the simplifiers.
+// Unlike gloo's PrimitiveFactory these build a SimplificationMesh directly,
+// run headless, and scale to tens of millions of triangles. Every random
+// choice is driven by the seed, so the same arguments give the same mesh.
+class MeshGenerator {
+ public:
+  enum class Shape {
+    ICOSPHERE,           // Closed genus-0 sphere
+    TERRAIN,             // Noisy heightfield with a single open boundary
+    TORUS_KNOT,          // Closed genus-1 tube
+    PLANE_WITH_HOLES,    // Grid with many boundary loops
+    NON_MANIFOLD_SOUP    // Fins, bow-ties, duplicates and loose triangles
+  };
+
+  // Geodesic sphere: every icosahedron face is split into frequency^2
+  // triangles (20 * frequency^2 faces). frequency = 2^n matches n rounds of
+  // loop subdivision.
+  static SimplificationMesh CreateIcosphere(float radius, size_t frequency);
+
+  // resolution x resolution quad grid over [-1, 1]^2 (2 * resolution^2
+  // faces) displaced along y by seeded fractal value noise.
+  static SimplificationMesh CreateTerrain(size_t resolution,
+                                          float amplitude,
+                                          uint32_t seed);
+
+  // (p, q) torus knot tube with `segments` rings of `sides` vertices
+  // (2 * segments * sides faces).
+  static SimplificationMesh CreateTorusKnot(int p,
+                                            int q,
+                                            size_t segments,
+                                            size_t sides,
+                                            float tube_radius);
+
+  // resolution x resolution grid with `num_holes` random circular holes
+  // punched out. Unreferenced vertices are removed.
+  static SimplificationMesh CreatePlaneWithHoles(size_t resolution,
+                                                 size_t num_holes,
+                                                 uint32_t seed);
+
+  // Roughly num_faces triangles mixing a base grid with non-manifold fin
+  // edges, bow-tie vertices, duplicated faces and disconnected triangles.
+  static SimplificationMesh CreateNonManifoldSoup(size_t num_faces,
+                                                  uint32_t seed);
+
+  // Any shape with approximately target_faces triangles.
+  static SimplificationMesh Create(Shape shape,
+                                   size_t target_faces,
+                                   uint32_t seed);
+
+  static const char* GetShapeName(Shape shape);
+  // Parses a name returned by GetShapeName; returns false if unknown.
+  static bool ParseShapeName(const std::string& name, Shape& shape);
+};
+
+}  // namespace GLOO
+
+#endif
@@ -0,0 +1,172 @@
+#include "OneRing.hpp"
+#include <cmath>
+
+namespace GLOO {
+
+void GatherRingVertices(const SimplificationMesh& mesh,
+                        const std::vector<int>& faces,
+                        const std::vector<uint8_t>& face_removed, int center,
+                        VertexList& ring) {
+  ring.Clear();
+  for (int f : faces) {
+    if (face_removed[f]) continue;
+    const glm::uvec3& face = mesh.faces[f];
+    for (int c = 0; c < 3; c++) {
+      if (static_cast<int>(face[c]) != center) {
+        ring.Add(static_cast<int>(face[c]));
+      }
+    }
+  }
+  ring.SortUnique();
+}
+
+bool GatherOrderedRing(const SimplificationMesh& mesh,
+                       const std::vector<int>& faces,
+                       const std::vector<uint8_t>& face_removed, int center,
+                       VertexList& ring, bool& closed) {
+  ring.Clear();
+  // Ring edges as (a << 32 | b), sorted to look up the edge leaving a
+  InlineList<uint64_t> links;
+  VertexList heads;
+  for (int f : faces) {
+    if (face_removed[f]) continue;
+    const glm::uvec3& face = mesh.faces[f];
+    int corner = -1;
+    for (int c = 0; c < 3; c++) {
+      if (static_cast<int>(face[c]) == center) {
+        if (corner >= 0) {
+          return false;  // Degenerate face
+        }
+        corner = c;
+      }
+    }
+    if (corner < 0) {
+      continue;
+    }
+    const uint32_t a = face[(corner + 1) % 3];
+    const uint32_t b = face[(corner + 2) % 3];
+    links.Add(static_cast<uint64_t>(a) << 32 | b);
+    heads.Add(static_cast<int>(b));
+  }
+  const size_t count = links.Size();
+  if (count == 0) {
+    return false;
+  }
+  links.Sort();
+  heads.Sort();
+  for (size_t i = 1; i < count; i++) {
+    if ((links[i] >> 32) == (links[i - 1] >> 32) || heads[i] == heads[i - 1]) {
+      return false;  // Two faces leave or enter the same ring vertex
+    }
+  }
+
+  // A fan starts at the only tail that is no head; a cycle anywhere
+  int start = static_cast<int>(links[0] >> 32);
+  int starts = 0;
+  for (size_t i = 0; i < count; i++) {
+    const int tail = static_cast<int>(links[i] >> 32);
+    if (!heads.Contains(tail)) {
+      start = tail;
+      starts++;
+    }
+  }
+  if (starts > 1) {
+    return false;
+  }
+  closed = starts == 0;
+
+  int current = start;
+  ring.Add(current);
+  for (size_t step = 0; step < count; step++) {
+    const uint64_t key = static_cast<uint64_t>(current) << 32;
+    const uint64_t* link = std::lower_bound(links.begin(), links.end(), key);
+    if (link == links.end() || static_cast<int>(*link >> 32) != current) {
+      return false;
+    }
+    current = static_cast<int>(*link & 0xffffffffu);
+    if (step + 1 < count || !closed) {
+      ring.Add(current);
+    }
+  }
+  if (closed && current != start) {
+    return false;
+  }
+  // Every ring vertex once (several cycles or a pinched fan repeat one)
+  VertexList sorted;
+  for (int v : ring) {
+    sorted.Add(v);
+  }
+  sorted.SortUnique();
+  return sorted.Size() == ring.Size();
+}
+
+glm::vec3 ComputeVertexNormal(const SimplificationMesh& mesh,
+                              const std::vector<int>& faces,
+                              const std::vector<uint8_t>& face_removed) {
+  // The cross product is the normal times twice the area
+  glm::vec3 sum(0.0f);
+  for (int f : faces) {
+    if (face_removed[f]) continue;
+    const glm::uvec3& face = mesh.faces[f];
+    const glm::vec3& p0 = mesh.vertices[face.x];
+    sum += glm::cross(mesh.vertices[face.y] - p0, mesh.vertices[face.z] - p0);
+  }
+  const float squared = glm::dot(sum, sum);
+  return squared > 0.0f ? sum * (1.0f / std::sqrt(squared)) : sum;
+}
+
+float PointTriangleDistance(const glm::vec3& p, const glm::vec3& a,
+                            const glm::vec3& b, const glm::vec3& c) {
+  // The closest point is a corner, on an edge or inside, depending on the
+  // region of the triangle's plane p projects to
+  const glm::vec3 ab = b - a;
+  const glm::vec3 ac = c - a;
+  const glm::vec3 ap = p - a;
+  const float d1 = glm::dot(ab, ap);
+  const float d2 = glm::dot(ac, ap);
+  if (d1 <= 0.0f && d2 <= 0.0f) {
+    return glm::length(ap);
+  }
+  const glm::vec3 bp = p - b;
+  const float d3 = glm::dot(ab, bp);
+  const float d4 = glm::dot(ac, bp);
+  if (d3 >= 0.0f && d4 <= d3) {
+    return glm::length(bp);
+  }
+  const float vc = d1 * d4 - d3 * d2;
+  if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f && d1 - d3 > 0.0f) {
+    return glm::length(ap - ab * (d1 / (d1 - d3)));
+  }
+  const glm::vec3 cp = p - c;
+  const float d5 = glm::dot(ab, cp);
+  const float d6 = glm::dot(ac, cp);
+  if (d6 >= 0.0f && d5 <= d6) {
+    return glm::length(cp);
+  }
+  const float vb = d5 * d2 - d1 * d6;
+  if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f && d2 - d6 > 0.0f) {
+    return glm::length(ap - ac * (d2 / (d2 - d6)));
+  }
+  const float va = d3 * d6 - d5 * d4;
+  if (va <= 0.0f && d4 - d3 >= 0.0f && d5 - d6 >= 0.0f &&
+      (d4 - d3) + (d5 - d6) > 0.0f) {
+    return glm::length(bp - (c - b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6))));
+  }
+  const float sum = va + vb + vc;
+  if (!(sum > 0.0f)) {
+    // Degenerate: the nearest of the three edges
+    auto segment = [&](const glm::vec3& s0, const glm::vec3& s1) {
+      const glm::vec3 d = s1 - s0;
+      const float length2 = glm::dot(d, d);
+      float t = length2 > 0.0f ? glm::dot(p - s0, d) / length2 : 0.0f;
+      t = std::min(std::max(t, 0.0f), 1.0f);
+      return glm::length(p - (s0 + d * t));
+    };
+    return std::min({segment(a, b), segment(b, c), segment(c, a)});
+  }
+  const float v = vb / sum;
+  const float w = vc / sum;
+  return glm::length(ap - ab * v - ac * w);
+}
+
+}  // namespace GLOO
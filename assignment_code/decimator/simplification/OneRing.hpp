@@ -0,0 +1,97 @@
+#ifndef ONE_RING_H_
+#define ONE_RING_H_
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "SimplificationMesh.hpp"
+
+namespace GLOO {
+
+// List for the one-ring-sized scratch data of the simplifiers' validity
+// checks. Valences are small, so the items live in an inline buffer (moving
+// to the heap past kInlineCapacity) and the checks don't allocate.
+template <class T>
+class InlineList {
+ public:
+  static const size_t kInlineCapacity = 32;
+
+  InlineList() : data_(inline_) {}
+  InlineList(const InlineList&) = delete;
+  InlineList& operator=(const InlineList&) = delete;
+
+  void Clear() { size_ = 0; }
+  void Add(const T& item) {
+    if (size_ == capacity_) {
+      Grow();
+    }
+    data_[size_++] = item;
+  }
+  size_t Size() const { return size_; }
+  bool Empty() const { return size_ == 0; }
+  const T& operator[](size_t i) const { return data_[i]; }
+  const T* begin() const { return data_; }
+  const T* end() const { return data_ + size_; }
+
+  void Sort() { std::sort(data_, data_ + size_); }
+  void SortUnique() {
+    Sort();
+    size_ = std::unique(data_, data_ + size_) - data_;
+  }
+  // For sorted lists
+  bool Contains(const T& item) const {
+    return std::binary_search(data_, data_ + size_, item);
+  }
+
+ private:
+  T inline_[kInlineCapacity];
+  std::vector<T> heap_;
+  T* data_;
+  size_t size_ = 0;
+  size_t capacity_ = kInlineCapacity;
+
+  void Grow() {
+    if (data_ == inline_) {
+      heap_.assign(inline_, inline_ + size_);
+    }
+    heap_.resize(2 * capacity_);
+    data_ = heap_.data();
+    capacity_ = heap_.size();
+  }
+};
+
+typedef InlineList<int> VertexList;
+
+// The other corners of the given faces of center (skipping removed ones),
+// sorted and without duplicates
+void GatherRingVertices(const SimplificationMesh& mesh,
+                        const std::vector<int>& faces,
+                        const std::vector<uint8_t>& face_removed, int center,
+                        VertexList& ring);
+
+// The one-ring of center in winding order: each face (center, a, b) links
+// a to b. False unless center is a manifold vertex, i.e. its faces form a
+// single cycle (closed, an interior vertex) or a single fan (open, a border
+// vertex; ring starts and ends on the border) visiting each ring vertex
+// once.
+bool GatherOrderedRing(const SimplificationMesh& mesh,
+                       const std::vector<int>& faces,
+                       const std::vector<uint8_t>& face_removed, int center,
+                       VertexList& ring, bool& closed);
+
+// Normal of a vertex from its faces (skipping removed ones), area-weighted
+// and normalized as by SimplificationMesh::ComputeNormals, so simplifiers
+// can update the normals around a change instead of recomputing them all
+glm::vec3 ComputeVertexNormal(const SimplificationMesh& mesh,
+                              const std::vector<int>& faces,
+                              const std::vector<uint8_t>& face_removed);
+
+// Distance from p to the nearest point of the triangle (a, b, c), which
+// may lie on an edge or a corner; degenerate triangles act as segments
+float PointTriangleDistance(const glm::vec3& p, const glm::vec3& a,
+                            const glm::vec3& b, const glm::vec3& c);
+
+}  // namespace GLOO
+
+#endif
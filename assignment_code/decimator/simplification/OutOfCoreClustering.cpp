@@ -0,0 +1,414 @@
+#include "OutOfCoreClustering.hpp"
+#include "GeometryKernels.hpp"
+#include "helpers.hpp"
+#include "Profiler.hpp"
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <iostream>
+#include <limits>
+#include <queue>
+
+namespace GLOO {
+namespace {
+const int kCoordinateBits = 21;
+const uint64_t kCoordinateMask = (uint64_t(1) << kCoordinateBits) - 1;
+// Records read at a time from each run while merging
+const size_t kMergeBuffer = 1024;
+
+uint64_t PackCell(const glm::ivec3& cell) {
+  return (uint64_t(cell.x) << (2 * kCoordinateBits)) |
+         (uint64_t(cell.y) << kCoordinateBits) | uint64_t(cell.z);
+}
+
+glm::ivec3 UnpackCell(uint64_t key) {
+  return glm::ivec3(static_cast<int>(key >> (2 * kCoordinateBits)),
+                    static_cast<int>((key >> kCoordinateBits) &
+                                     kCoordinateMask),
+                    static_cast<int>(key & kCoordinateMask));
+}
+
+double QuadricError(const double (&q)[10], const glm::vec3& v) {
+  const double x = v.x, y = v.y, z = v.z;
+  double error = q[0] * x * x + 2.0 * q[1] * x * y + 2.0 * q[2] * x * z +
+                 2.0 * q[3] * x + q[4] * y * y + 2.0 * q[5] * y * z +
+                 2.0 * q[6] * y + q[7] * z * z + 2.0 * q[8] * z + q[9];
+  return std::max(0.0, error);
+}
+}  // namespace
+
+OutOfCoreClustering::CellData::CellData()
+    : quadric(), weight(0.0), position_sum(), corner_count(0.0) {}
+
+void OutOfCoreClustering::CellData::Add(const CellData& other) {
+  for (int i = 0; i < 10; i++) {
+    quadric[i] += other.quadric[i];
+  }
+  weight += other.weight;
+  for (int axis = 0; axis < 3; axis++) {
+    position_sum[axis] += other.position_sum[axis];
+  }
+  corner_count += other.corner_count;
+}
+
+OutOfCoreClustering::OutOfCoreClustering() {
+  // Constructor
+}
+
+OutOfCoreClustering::~OutOfCoreClustering() {
+  CloseRuns();
+}
+
+std::shared_ptr<SimplificationMesh> OutOfCoreClustering::Simplify(
+    TriangleSource& source, SimplificationReport* report) {
+  DECIMATOR_PROFILE_SCOPE("OutOfCoreClustering.Simplify");
+  glm::vec3 min_bounds = min_bounds_;
+  glm::vec3 max_bounds = max_bounds_;
+  if (!has_bounds_ && !ComputeBounds(source, min_bounds, max_bounds)) {
+    return nullptr;
+  }
+
+  // Cubic cells, grid_resolution_ of them along the longest side
+  const int resolution =
+      std::max(1, std::min(grid_resolution_, kMaxGridResolution));
+  const glm::vec3 extent = glm::max(max_bounds - min_bounds, glm::vec3(0.0f));
+  const float longest = std::max(extent.x, std::max(extent.y, extent.z));
+  const float cell_size = longest > 0.0f ? longest / resolution : 1.0f;
+  glm::ivec3 max_cell;
+  for (int axis = 0; axis < 3; axis++) {
+    max_cell[axis] = std::min(
+        kMaxGridResolution,
+        std::max(1, static_cast<int>(std::ceil(extent[axis] / cell_size)))) -
+        1;
+  }
+
+  CloseRuns();
+  cells_.clear();
+  faces_.clear();
+  unique_face_count_ = 0;
+
+  // Stream the triangles into the cell table and the face list
+  bool ok = source.Rewind();
+  size_t triangle_count = 0;
+  {
+    DECIMATOR_PROFILE_SCOPE("OutOfCoreClustering.Stream");
+    std::vector<glm::vec3> corners(3 * kReadBatch);
+    while (ok) {
+      const size_t count = source.Read(corners.data(), kReadBatch);
+      if (count == 0) {
+        break;
+      }
+      triangle_count += count;
+      for (size_t t = 0; t < count; t++) {
+        const glm::vec3* p = &corners[3 * t];
+        CellData plane;
+        glm::vec3 cross = glm::cross(p[1] - p[0], p[2] - p[0]);
+        float length = glm::length(cross);
+        if (length > 0.0f) {
+          // Area-weighted plane quadric
+          glm::vec3 normal = cross / length;
+          const double plane_coefficients[4] = {
+              normal.x, normal.y, normal.z, -glm::dot(normal, p[0])};
+          const double area = 0.5 * length;
+          int k = 0;
+          for (int i = 0; i < 4; i++) {
+            for (int j = i; j < 4; j++) {
+              plane.quadric[k++] =
+                  area * plane_coefficients[i] * plane_coefficients[j];
+            }
+          }
+          plane.weight = area;
+        }
+        plane.corner_count = 1.0;
+
+        uint64_t keys[3];
+        for (int k = 0; k < 3; k++) {
+          glm::ivec3 cell;
+          for (int axis = 0; axis < 3; axis++) {
+            float coordinate = (p[k][axis] - min_bounds[axis]) / cell_size;
+            coordinate = std::max(
+                0.0f, std::min(coordinate, static_cast<float>(max_cell[axis])));
+            cell[axis] = static_cast<int>(coordinate);
+          }
+          keys[k] = PackCell(cell);
+          for (int axis = 0; axis < 3; axis++) {
+            plane.position_sum[axis] = p[k][axis];
+          }
+          cells_[keys[k]].Add(plane);
+        }
+
+        if (keys[0] != keys[1] && keys[1] != keys[2] && keys[0] != keys[2]) {
+          // Rotated so the smallest key comes first, keeping the winding
+          int first = 0;
+          for (int k = 1; k < 3; k++) {
+            if (keys[k] < keys[first]) {
+              first = k;
+            }
+          }
+          CellFace face;
+          for (int k = 0; k < 3; k++) {
+            face.keys[k] = keys[(first + k) % 3];
+          }
+          faces_.push_back(face);
+        }
+      }
+
+      if (cells_.size() > max_resident_cells_) {
+        ok = SpillCells();
+      }
+      // Many triangles map to the same output face, so dropping duplicates
+      // keeps the list proportional to the output
+      if (faces_.size() >= 2 * std::max(unique_face_count_, kReadBatch)) {
+        CompactFaces();
+      }
+    }
+  }
+  ok = ok && !source.HasFailed();
+  DECIMATOR_COUNT("OutOfCoreClustering.triangles_read", triangle_count);
+
+  auto result = std::make_shared<SimplificationMesh>();
+  float max_error = 0.0f;
+  ok = ok && BuildResult(min_bounds, cell_size, *result, &max_error);
+  CloseRuns();
+  std::unordered_map<uint64_t, CellData>().swap(cells_);
+  std::vector<CellFace>().swap(faces_);
+  if (!ok) {
+    std::cerr << "Out-of-core clustering failed to read its input or to "
+                 "spill cells to disk"
+              << std::endl;
+    return nullptr;
+  }
+
+  if (report != nullptr) {
+    report->vertex_count = result->vertices.size();
+    report->face_count = result->faces.size();
+    report->max_error = max_error;
+  }
+  return result;
+}
+
+bool OutOfCoreClustering::ComputeBounds(TriangleSource& source,
+                                        glm::vec3& min_bounds,
+                                        glm::vec3& max_bounds) const {
+  DECIMATOR_PROFILE_SCOPE("OutOfCoreClustering.Bounds");
+  if (!source.Rewind()) {
+    return false;
+  }
+  min_bounds = glm::vec3(std::numeric_limits<float>::max());
+  max_bounds = glm::vec3(-std::numeric_limits<float>::max());
+  std::vector<glm::vec3> corners(3 * kReadBatch);
+  size_t count;
+  while ((count = source.Read(corners.data(), kReadBatch)) > 0) {
+    for (size_t i = 0; i < 3 * count; i++) {
+      min_bounds = glm::min(min_bounds, corners[i]);
+      max_bounds = glm::max(max_bounds, corners[i]);
+    }
+  }
+  if (min_bounds.x > max_bounds.x) {
+    // No triangles
+    min_bounds = max_bounds = glm::vec3(0.0f);
+  }
+  return !source.HasFailed();
+}
+
+bool OutOfCoreClustering::SpillCells() {
+  DECIMATOR_PROFILE_SCOPE("OutOfCoreClustering.Spill");
+  std::vector<CellRecord> records;
+  records.reserve(cells_.size());
+  for (const auto& pair : cells_) {
+    CellRecord record;
+    record.key = pair.first;
+    record.data = pair.second;
+    records.push_back(record);
+  }
+  std::sort(records.begin(), records.end(),
+            [](const CellRecord& a, const CellRecord& b) {
+              return a.key < b.key;
+            });
+  cells_.clear();
+
+  std::FILE* run = std::tmpfile();
+  if (run == nullptr) {
+    return false;
+  }
+  runs_.push_back(run);
+  DECIMATOR_COUNT("OutOfCoreClustering.spilled_cells", records.size());
+  return std::fwrite(records.data(), sizeof(CellRecord), records.size(),
+                     run) == records.size() &&
+         std::fflush(run) == 0;
+}
+
+void OutOfCoreClustering::CompactFaces() {
+  std::sort(faces_.begin(), faces_.end(),
+            [](const CellFace& a, const CellFace& b) {
+              return std::lexicographical_compare(a.keys, a.keys + 3, b.keys,
+                                                  b.keys + 3);
+            });
+  faces_.erase(std::unique(faces_.begin(), faces_.end(),
+                           [](const CellFace& a, const CellFace& b) {
+                             return std::equal(a.keys, a.keys + 3, b.keys);
+                           }),
+               faces_.end());
+  unique_face_count_ = faces_.size();
+}
+
+bool OutOfCoreClustering::BuildResult(const glm::vec3& min_bounds,
+                                      float cell_size,
+                                      SimplificationMesh& result,
+                                      float* max_error) {
+  DECIMATOR_PROFILE_SCOPE("OutOfCoreClustering.BuildResult");
+  CompactFaces();
+
+  // Cells used by faces, in key order; the others only held corners of
+  // triangles that collapsed
+  std::vector<uint64_t> used_keys;
+  used_keys.reserve(3 * faces_.size());
+  for (const CellFace& face : faces_) {
+    used_keys.insert(used_keys.end(), face.keys, face.keys + 3);
+  }
+  RadixSort(used_keys);
+  used_keys.erase(std::unique(used_keys.begin(), used_keys.end()),
+                  used_keys.end());
+
+  // Summed data of the used cells, from every run and the resident table
+  std::vector<CellData> used_cells(used_keys.size());
+  size_t next_used = 0;
+  auto emit = [&](uint64_t key, const CellData& data) {
+    while (next_used < used_keys.size() && used_keys[next_used] < key) {
+      next_used++;
+    }
+    if (next_used < used_keys.size() && used_keys[next_used] == key) {
+      used_cells[next_used].Add(data);
+    }
+  };
+  if (runs_.empty()) {
+    std::vector<uint64_t> keys;
+    keys.reserve(cells_.size());
+    for (const auto& pair : cells_) {
+      keys.push_back(pair.first);
+    }
+    RadixSort(keys);
+    for (uint64_t key : keys) {
+      emit(key, cells_[key]);
+    }
+  } else {
+    if (!cells_.empty() && !SpillCells()) {
+      return false;
+    }
+    // k-way merge of the sorted runs
+    struct RunReader {
+      std::FILE* file;
+      std::vector<CellRecord> buffer;
+      size_t next;
+    };
+    std::vector<RunReader> readers(runs_.size());
+    typedef std::pair<uint64_t, size_t> HeapEntry;
+    std::priority_queue<HeapEntry, std::vector<HeapEntry>,
+                        std::greater<HeapEntry>>
+        heap;
+    auto refill = [&](size_t r) {
+      RunReader& reader = readers[r];
+      reader.buffer.resize(kMergeBuffer);
+      reader.buffer.resize(std::fread(reader.buffer.data(), sizeof(CellRecord),
+                                      kMergeBuffer, reader.file));
+      reader.next = 0;
+      if (!reader.buffer.empty()) {
+        heap.push(HeapEntry(reader.buffer[0].key, r));
+      }
+    };
+    for (size_t r = 0; r < runs_.size(); r++) {
+      readers[r].file = runs_[r];
+      std::rewind(runs_[r]);
+      refill(r);
+    }
+    while (!heap.empty()) {
+      const size_t r = heap.top().second;
+      heap.pop();
+      RunReader& reader = readers[r];
+      const CellRecord& record = reader.buffer[reader.next++];
+      emit(record.key, record.data);
+      if (reader.next < reader.buffer.size()) {
+        heap.push(HeapEntry(reader.buffer[reader.next].key, r));
+      } else {
+        refill(r);
+      }
+    }
+    for (size_t r = 0; r < runs_.size(); r++) {
+      if (std::ferror(runs_[r])) {
+        return false;
+      }
+    }
+  }
+
+  // Each used cell becomes a vertex at its quadric's optimum, or at the
+  // mean of its corners if that is singular or outside the cell
+  const size_t vertex_count = used_keys.size();
+  result.vertices.resize(vertex_count);
+  const size_t kBatch = GeometryKernels::kQuadricBatch;
+  std::vector<float> errors(vertex_count, 0.0f);
+  ParallelChunks((vertex_count + kBatch - 1) / kBatch,
+                 [&](size_t, size_t begin, size_t end) {
+    GeometryKernels::QuadricBatch batch;
+    for (size_t b = begin; b < end; b++) {
+      const size_t first = b * kBatch;
+      for (size_t lane = 0; lane < kBatch; lane++) {
+        const CellData& cell =
+            used_cells[std::min(first + lane, vertex_count - 1)];
+        for (int i = 0; i < 10; i++) {
+          batch.quadric[i][lane] = cell.quadric[i];
+        }
+        for (int axis = 0; axis < 3; axis++) {
+          float mean = static_cast<float>(cell.position_sum[axis] /
+                                          cell.corner_count);
+          batch.first[axis][lane] = mean;
+          batch.second[axis][lane] = mean;
+        }
+      }
+      GeometryKernels::SolveQuadricBatch(batch, false);
+      for (size_t lane = 0; lane < kBatch && first + lane < vertex_count;
+           lane++) {
+        const size_t v = first + lane;
+        glm::vec3 cell_min =
+            min_bounds + glm::vec3(UnpackCell(used_keys[v])) * cell_size;
+        glm::vec3 position(batch.position[0][lane], batch.position[1][lane],
+                           batch.position[2][lane]);
+        if (glm::any(glm::lessThan(position, cell_min)) ||
+            glm::any(glm::greaterThan(position, cell_min + cell_size))) {
+          position = glm::vec3(batch.first[0][lane], batch.first[1][lane],
+                               batch.first[2][lane]);
+        }
+        result.vertices[v] = position;
+        const CellData& cell = used_cells[v];
+        if (cell.weight > 0.0) {
+          errors[v] = static_cast<float>(
+              std::sqrt(QuadricError(cell.quadric, position) / cell.weight));
+        }
+      }
+    }
+  }, 256);
+  for (float error : errors) {
+    *max_error = std::max(*max_error, error);
+  }
+
+  result.faces.reserve(faces_.size());
+  for (const CellFace& face : faces_) {
+    glm::uvec3 indices;
+    for (int k = 0; k < 3; k++) {
+      indices[k] = static_cast<unsigned int>(
+          std::lower_bound(used_keys.begin(), used_keys.end(), face.keys[k]) -
+          used_keys.begin());
+    }
+    result.faces.push_back(indices);
+  }
+  result.ComputeNormals();
+  return true;
+}
+
+void OutOfCoreClustering::CloseRuns() {
+  for (std::FILE* run : runs_) {
+    std::fclose(run);
+  }
+  runs_.clear();
+}
+
+}  // namespace GLOO
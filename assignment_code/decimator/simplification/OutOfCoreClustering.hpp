@@ -0,0 +1,105 @@
+#ifndef OUT_OF_CORE_CLUSTERING_H_
+#define OUT_OF_CORE_CLUSTERING_H_
+
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+#include <glm/glm.hpp>
+#include "SimplificationMesh.hpp"
+#include "SimplificationBudget.hpp"
+#include "TriangleSource.hpp"
+
+namespace GLOO {
+
+// Out-of-core vertex clustering with quadric representatives (OOCS)
+// Reference: "Out-of-Core Simplification of Large Polygonal Models" [L00]
+//
+// Streams the triangles of a source once to find the bounds (unless they
+// are given) and once to cluster them on a uniform grid, accumulating the
+// area-weighted plane quadric of every triangle in the cells of its three
+// corners. Each cell becomes one vertex at its quadric's optimum, and each
+// triangle whose corners fall in three different cells becomes a face.
+// Memory is proportional to the output: the cell table holds at most
+// SetMaxResidentCells() cells before it is spilled to a temporary file as
+// a sorted run, and the runs are merged at the end. The result is an
+// ordinary indexed mesh, so it can be saved and refined further in core
+// (e.g. with EdgeCollapse).
+class OutOfCoreClustering {
+ public:
+  OutOfCoreClustering();
+  ~OutOfCoreClustering();
+
+  // Returns nullptr if the source fails to read. The report's max_error is
+  // the largest RMS distance of a representative to its cell's planes.
+  std::shared_ptr<SimplificationMesh> Simplify(
+      TriangleSource& source, SimplificationReport* report = nullptr);
+
+  // Cells along the longest side of the bounds (cells are cubes)
+  void SetGridResolution(int resolution) { grid_resolution_ = resolution; }
+  void SetMaxResidentCells(size_t max_cells) {
+    max_resident_cells_ = max_cells;
+  }
+  // Clusters within these bounds instead of reading the source an extra
+  // time to find them; positions outside go to the nearest cell
+  void SetBounds(const glm::vec3& min_bounds, const glm::vec3& max_bounds) {
+    min_bounds_ = min_bounds;
+    max_bounds_ = max_bounds;
+    has_bounds_ = true;
+  }
+  void ClearBounds() { has_bounds_ = false; }
+
+ private:
+  static const size_t kReadBatch = 4096;  // Triangles per source read
+  // Coordinates are packed into 21 bits each
+  static const int kMaxGridResolution = (1 << 21) - 1;
+
+  // Summed quadric (upper triangle as in EdgeCollapse::QuadricMatrix),
+  // plane weight and corner positions of one cell
+  struct CellData {
+    double quadric[10];
+    double weight;
+    double position_sum[3];
+    double corner_count;
+
+    CellData();
+    void Add(const CellData& other);
+  };
+  struct CellRecord {
+    uint64_t key;
+    CellData data;
+  };
+  // Output face as the keys of its corner cells
+  struct CellFace {
+    uint64_t keys[3];
+  };
+
+  int grid_resolution_ = 256;
+  size_t max_resident_cells_ = size_t(1) << 20;
+  glm::vec3 min_bounds_;
+  glm::vec3 max_bounds_;
+  bool has_bounds_ = false;
+
+  // Per-run state, valid during Simplify
+  std::unordered_map<uint64_t, CellData> cells_;
+  std::vector<std::FILE*> runs_;  // Spilled sorted runs
+  std::vector<CellFace> faces_;
+  size_t unique_face_count_ = 0;  // faces_ prefix known to be unique
+
+  bool ComputeBounds(TriangleSource& source, glm::vec3& min_bounds,
+                     glm::vec3& max_bounds) const;
+  // Writes the cell table to a new run file, sorted by key
+  bool SpillCells();
+  // Sorts faces_, dropping duplicates
+  void CompactFaces();
+  // Merges the runs and the resident cells in key order and emits the
+  // cells used by faces as vertices
+  bool BuildResult(const glm::vec3& min_bounds, float cell_size,
+                   SimplificationMesh& result, float* max_error);
+  void CloseRuns();
+};
+
+}  // namespace GLOO
+
+#endif
@@ -0,0 +1,522 @@
+#include "PartitionedSimplifier.hpp"
+#include "helpers.hpp"
+#include "Profiler.hpp"
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+namespace GLOO {
+namespace {
+// Spreads the low 10 bits of x to every third bit
+uint32_t SpreadBits(uint32_t x) {
+  x &= 0x3ff;
+  x = (x | (x << 16)) & 0x030000ff;
+  x = (x | (x << 8)) & 0x0300f00f;
+  x = (x | (x << 4)) & 0x030c30c3;
+  x = (x | (x << 2)) & 0x09249249;
+  return x;
+}
+
+// Boundaries of block_count equal runs of [0, count), or with shifted, of
+// the runs starting half a run later (so block_count + 1 runs, the first
+// and last of half size)
+std::vector<size_t> CutRuns(size_t count, size_t block_count, bool shifted) {
+  std::vector<size_t> cuts(1, 0);
+  for (size_t b = 0; b < block_count; b++) {
+    if (shifted) {
+      cuts.push_back(count * (2 * b + 1) / (2 * block_count));
+    } else if (b > 0) {
+      cuts.push_back(count * b / block_count);
+    }
+  }
+  cuts.push_back(count);
+  return cuts;
+}
+}  // namespace
+
+PartitionedSimplifier::PartitionedSimplifier(Method method)
+    : method_(method) {}
+
+std::shared_ptr<SimplificationMesh> PartitionedSimplifier::Simplify(
+    const SimplificationMesh& original_mesh, int target_vertex_count) {
+  return Simplify(original_mesh,
+                  SimplificationBudget::Vertices(target_vertex_count));
+}
+
+std::shared_ptr<SimplificationMesh> PartitionedSimplifier::SimplifyByFactor(
+    const SimplificationMesh& original_mesh, float reduction_factor) {
+  int target_count = static_cast<int>(
+      original_mesh.vertices.size() * reduction_factor);
+  return Simplify(original_mesh, target_count);
+}
+
+std::shared_ptr<SimplificationMesh> PartitionedSimplifier::Simplify(
+    const SimplificationMesh& original_mesh,
+    const SimplificationBudget& budget, SimplificationReport* report) {
+  DECIMATOR_PROFILE_SCOPE("PartitionedSimplifier.Simplify");
+  const size_t vertex_count = original_mesh.vertices.size();
+  const size_t face_count = original_mesh.faces.size();
+  const size_t block_count = GetBlockCount(face_count);
+
+  if (original_mesh.IsEmpty() || block_count < 2) {
+    float error = 0.0f;
+    auto result = SimplifyBlock(SimplificationMesh(original_mesh), 0, budget,
+                                &error);
+    if (report != nullptr) {
+      report->vertex_count = result->vertices.size();
+      report->face_count = result->faces.size();
+      report->max_error = error;
+    }
+    return result;
+  }
+
+  // Fraction of the vertices to keep
+  double keep = 0.0;
+  if (budget.target_vertex_count > 0) {
+    keep = std::max(keep, budget.target_vertex_count /
+                              static_cast<double>(vertex_count));
+  }
+  if (budget.target_face_count > 0) {
+    keep = std::max(keep, budget.target_face_count /
+                              static_cast<double>(face_count));
+  }
+  keep = std::min(keep, 1.0);
+  const size_t target_count = static_cast<size_t>(keep * vertex_count);
+
+  // 1. Blocks of the whole mesh, each reduced to the kept fraction of its
+  //    unlocked vertices
+  PassResult pass;
+  {
+    DECIMATOR_PROFILE_SCOPE("PartitionedSimplifier.FirstPass");
+    std::vector<uint32_t> face_ids(face_count);
+    std::iota(face_ids.begin(), face_ids.end(), 0u);
+    Partition partition = BuildPartition(
+        original_mesh, SortAlongCurve(original_mesh, std::move(face_ids)),
+        CutRuns(face_count, block_count, false));
+    std::vector<size_t> remove_counts(block_count);
+    for (size_t b = 0; b < block_count; b++) {
+      remove_counts[b] = static_cast<size_t>(
+          (1.0 - keep) * partition.unlocked_counts[b] + 0.5);
+    }
+    pass = RunPass(original_mesh, partition, remove_counts, budget.max_error);
+  }
+  float max_error = pass.max_error;
+
+  // 2. The faces around the first pass seams, cut half a block off the
+  //    first pass cuts, take out what is still above the target. The seam
+  //    vertices are grown by two rings: the first covers their faces, the
+  //    second keeps them off the edge of the band
+  SimplificationMesh& mesh = pass.mesh;
+  if (mesh.vertices.size() > target_count) {
+    DECIMATOR_PROFILE_SCOPE("PartitionedSimplifier.SeamPass");
+    std::vector<uint8_t> in_band = pass.seam;
+    for (int ring = 0; ring < 2; ring++) {
+      std::vector<uint8_t> grown = in_band;
+      for (const glm::uvec3& face : mesh.faces) {
+        if (in_band[face[0]] || in_band[face[1]] || in_band[face[2]]) {
+          grown[face[0]] = grown[face[1]] = grown[face[2]] = 1;
+        }
+      }
+      in_band.swap(grown);
+    }
+    std::vector<uint32_t> band;
+    for (size_t f = 0; f < mesh.faces.size(); f++) {
+      const glm::uvec3& face = mesh.faces[f];
+      if (in_band[face[0]] && in_band[face[1]] && in_band[face[2]]) {
+        band.push_back(static_cast<uint32_t>(f));
+      }
+    }
+    DECIMATOR_COUNT("PartitionedSimplifier.band_faces", band.size());
+
+    const size_t band_blocks = std::min(
+        block_count, std::max<size_t>(1, band.size() / kMinBlockFaces));
+    const size_t band_size = band.size();
+    Partition partition =
+        BuildPartition(mesh, SortAlongCurve(mesh, std::move(band)),
+                       CutRuns(band_size, band_blocks, band_blocks > 1));
+    size_t unlocked = 0;
+    for (size_t count : partition.unlocked_counts) {
+      unlocked += count;
+    }
+    const size_t excess = mesh.vertices.size() - target_count;
+    std::vector<size_t> remove_counts(partition.unlocked_counts.size());
+    for (size_t b = 0; b < remove_counts.size() && unlocked > 0; b++) {
+      remove_counts[b] = std::min(
+          partition.unlocked_counts[b],
+          static_cast<size_t>(static_cast<double>(excess) *
+                                  partition.unlocked_counts[b] / unlocked +
+                              0.5));
+    }
+    PassResult seam_pass =
+        RunPass(mesh, partition, remove_counts, budget.max_error);
+    max_error = std::max(max_error, seam_pass.max_error);
+    pass = std::move(seam_pass);
+  }
+
+  auto result = std::make_shared<SimplificationMesh>(std::move(pass.mesh));
+  if (report != nullptr) {
+    report->vertex_count = result->vertices.size();
+    report->face_count = result->faces.size();
+    report->max_error = max_error;
+  }
+  return result;
+}
+
+size_t PartitionedSimplifier::GetBlockCount(size_t face_count) const {
+  size_t requested = block_count_ > 0
+                         ? static_cast<size_t>(block_count_)
+                         : kBlocksPerWorker * GetParallelWorkerCount();
+  return std::min(requested, face_count / kMinBlockFaces);
+}
+
+std::vector<uint32_t> PartitionedSimplifier::SortAlongCurve(
+    const SimplificationMesh& mesh, std::vector<uint32_t> face_ids) const {
+  DECIMATOR_PROFILE_SCOPE("PartitionedSimplifier.SortAlongCurve");
+  const size_t count = face_ids.size();
+  std::vector<glm::vec3> centroids(count);
+  ParallelFor(count, [&](size_t i) {
+    const glm::uvec3& face = mesh.faces[face_ids[i]];
+    centroids[i] = (mesh.vertices[face[0]] + mesh.vertices[face[1]] +
+                    mesh.vertices[face[2]]) /
+                   3.0f;
+  });
+
+  glm::vec3 min_bounds(0.0f), max_bounds(0.0f);
+  if (count > 0) {
+    min_bounds = max_bounds = centroids[0];
+    for (const glm::vec3& centroid : centroids) {
+      min_bounds = glm::min(min_bounds, centroid);
+      max_bounds = glm::max(max_bounds, centroid);
+    }
+  }
+  glm::vec3 extent = max_bounds - min_bounds;
+  glm::vec3 scale(0.0f);
+  for (int axis = 0; axis < 3; axis++) {
+    if (extent[axis] > 0.0f) {
+      scale[axis] = 1023.0f / extent[axis];
+    }
+  }
+
+  std::vector<uint32_t> keys(count);
+  ParallelFor(count, [&](size_t i) {
+    glm::vec3 cell = (centroids[i] - min_bounds) * scale;
+    keys[i] = SpreadBits(static_cast<uint32_t>(cell.x)) |
+              (SpreadBits(static_cast<uint32_t>(cell.y)) << 1) |
+              (SpreadBits(static_cast<uint32_t>(cell.z)) << 2);
+  });
+  RadixSortPairs(keys, face_ids);
+  return face_ids;
+}
+
+PartitionedSimplifier::Partition PartitionedSimplifier::BuildPartition(
+    const SimplificationMesh& mesh, std::vector<uint32_t> order,
+    std::vector<size_t> cuts) const {
+  DECIMATOR_PROFILE_SCOPE("PartitionedSimplifier.BuildPartition");
+  Partition partition;
+  const size_t block_count = cuts.size() - 1;
+  const size_t vertex_count = mesh.vertices.size();
+
+  // Block of every face, -1 outside the pass
+  std::vector<int> face_block(mesh.faces.size(), -1);
+  for (size_t b = 0; b < block_count; b++) {
+    for (size_t i = cuts[b]; i < cuts[b + 1]; i++) {
+      face_block[order[i]] = static_cast<int>(b);
+    }
+  }
+
+  // A vertex used by faces of two blocks, or by a face outside the pass,
+  // is locked; any other used vertex belongs to its block
+  const int kUnused = -1;
+  const int kShared = -2;
+  std::vector<int> vertex_block(vertex_count, kUnused);
+  for (size_t f = 0; f < mesh.faces.size(); f++) {
+    int block = face_block[f] < 0 ? kShared : face_block[f];
+    for (int k = 0; k < 3; k++) {
+      int& owner = vertex_block[mesh.faces[f][k]];
+      if (owner == kUnused) {
+        owner = block;
+      } else if (owner != block) {
+        owner = kShared;
+      }
+    }
+  }
+
+  partition.locked.assign(vertex_count, 0);
+  partition.unlocked_counts.assign(block_count, 0);
+  for (size_t v = 0; v < vertex_count; v++) {
+    if (vertex_block[v] == kShared) {
+      partition.locked[v] = 1;
+      vertex_block[v] = -1;
+    } else if (vertex_block[v] >= 0) {
+      partition.unlocked_counts[vertex_block[v]]++;
+    }
+  }
+  partition.order = std::move(order);
+  partition.cuts = std::move(cuts);
+  partition.vertex_block = std::move(vertex_block);
+  return partition;
+}
+
+PartitionedSimplifier::PassResult PartitionedSimplifier::RunPass(
+    const SimplificationMesh& mesh, const Partition& partition,
+    const std::vector<size_t>& remove_counts, float max_error) const {
+  const size_t block_count = partition.cuts.size() - 1;
+  const size_t vertex_count = mesh.vertices.size();
+  const bool has_normals = mesh.normals.size() == vertex_count;
+  const bool has_colors = mesh.colors.size() == vertex_count;
+  const bool has_texcoords = mesh.texcoords.size() == vertex_count;
+
+  // 1. Every block is extracted with its seam vertices first (sorted),
+  //    then its own vertices in order of first use, and simplified. Own
+  //    vertices belong to one block, so the blocks share one index array.
+  std::vector<std::vector<uint32_t>> block_seams(block_count);
+  std::vector<std::shared_ptr<SimplificationMesh>> block_results(block_count);
+  std::vector<float> block_errors(block_count, 0.0f);
+  std::vector<int> local_index(vertex_count, -1);
+  {
+    DECIMATOR_PROFILE_SCOPE("PartitionedSimplifier.Blocks");
+    ParallelFor(block_count, [&](size_t b) {
+      const size_t begin = partition.cuts[b];
+      const size_t end = partition.cuts[b + 1];
+      std::vector<uint32_t>& seams = block_seams[b];
+      std::vector<uint32_t> own;
+      for (size_t i = begin; i < end; i++) {
+        const glm::uvec3& face = mesh.faces[partition.order[i]];
+        for (int k = 0; k < 3; k++) {
+          uint32_t v = face[k];
+          if (partition.locked[v]) {
+            seams.push_back(v);
+          } else if (local_index[v] < 0) {
+            local_index[v] = static_cast<int>(own.size());
+            own.push_back(v);
+          }
+        }
+      }
+      std::sort(seams.begin(), seams.end());
+      seams.erase(std::unique(seams.begin(), seams.end()), seams.end());
+
+      SimplificationMesh block;
+      block.vertices.reserve(seams.size() + own.size());
+      for (uint32_t v : seams) {
+        block.vertices.push_back(mesh.vertices[v]);
+      }
+      for (uint32_t v : own) {
+        block.vertices.push_back(mesh.vertices[v]);
+      }
+      if (has_normals) {
+        for (uint32_t v : seams) {
+          block.normals.push_back(mesh.normals[v]);
+        }
+        for (uint32_t v : own) {
+          block.normals.push_back(mesh.normals[v]);
+        }
+      }
+      if (has_colors) {
+        for (uint32_t v : seams) {
+          block.colors.push_back(mesh.colors[v]);
+        }
+        for (uint32_t v : own) {
+          block.colors.push_back(mesh.colors[v]);
+        }
+      }
+      if (has_texcoords) {
+        for (uint32_t v : seams) {
+          block.texcoords.push_back(mesh.texcoords[v]);
+        }
+        for (uint32_t v : own) {
+          block.texcoords.push_back(mesh.texcoords[v]);
+        }
+      }
+      block.faces.reserve(end - begin);
+      for (size_t i = begin; i < end; i++) {
+        glm::uvec3 face = mesh.faces[partition.order[i]];
+        for (int k = 0; k < 3; k++) {
+          if (partition.locked[face[k]]) {
+            face[k] = static_cast<unsigned int>(
+                std::lower_bound(seams.begin(), seams.end(), face[k]) -
+                seams.begin());
+          } else {
+            face[k] = static_cast<unsigned int>(seams.size() +
+                                                local_index[face[k]]);
+          }
+        }
+        block.faces.push_back(face);
+      }
+
+      SimplificationBudget budget;
+      budget.target_vertex_count = static_cast<int>(
+          block.vertices.size() -
+          std::min(remove_counts[b], own.size()));
+      budget.max_error = max_error;
+      if (budget.target_vertex_count <
+          static_cast<int>(block.vertices.size())) {
+        block_results[b] = SimplifyBlock(std::move(block), seams.size(),
+                                         budget, &block_errors[b]);
+      } else {
+        block_results[b] =
+            std::make_shared<SimplificationMesh>(std::move(block));
+      }
+    }, 1);
+  }
+
+  // 2. Stitch: vertices no block owns keep their order, followed by the
+  //    simplified own vertices of every block in block order
+  DECIMATOR_PROFILE_SCOPE("PartitionedSimplifier.Stitch");
+  PassResult result;
+  std::vector<uint32_t> new_index(vertex_count);
+  for (size_t v = 0; v < vertex_count; v++) {
+    new_index[v] = partition.vertex_block[v] < 0 ? 1 : 0;
+  }
+  const uint32_t kept_count = ExclusiveScan(new_index, new_index);
+  std::vector<size_t> block_offsets(block_count + 1, kept_count);
+  bool keeps_normals = has_normals;
+  bool keeps_colors = has_colors;
+  bool keeps_texcoords = has_texcoords;
+  for (size_t b = 0; b < block_count; b++) {
+    const SimplificationMesh& block = *block_results[b];
+    block_offsets[b + 1] = block_offsets[b] + block.vertices.size() -
+                           block_seams[b].size();
+    keeps_normals = keeps_normals &&
+                    block.normals.size() == block.vertices.size();
+    keeps_colors = keeps_colors && block.colors.size() == block.vertices.size();
+    keeps_texcoords = keeps_texcoords &&
+                      block.texcoords.size() == block.vertices.size();
+    result.max_error = std::max(result.max_error, block_errors[b]);
+  }
+
+  SimplificationMesh& stitched = result.mesh;
+  const size_t stitched_count = block_offsets[block_count];
+  stitched.vertices.resize(stitched_count);
+  result.seam.assign(stitched_count, 0);
+  if (keeps_normals) {
+    stitched.normals.resize(stitched_count);
+  }
+  if (keeps_colors) {
+    stitched.colors.resize(stitched_count);
+  }
+  if (keeps_texcoords) {
+    stitched.texcoords.resize(stitched_count);
+  }
+  for (size_t v = 0; v < vertex_count; v++) {
+    if (partition.vertex_block[v] < 0) {
+      stitched.vertices[new_index[v]] = mesh.vertices[v];
+      result.seam[new_index[v]] = partition.locked[v];
+      if (keeps_normals) {
+        stitched.normals[new_index[v]] = mesh.normals[v];
+      }
+      if (keeps_colors) {
+        stitched.colors[new_index[v]] = mesh.colors[v];
+      }
+      if (keeps_texcoords) {
+        stitched.texcoords[new_index[v]] = mesh.texcoords[v];
+      }
+    }
+  }
+
+  std::vector<uint8_t> in_pass(mesh.faces.size(), 0);
+  for (uint32_t f : partition.order) {
+    in_pass[f] = 1;
+  }
+  for (size_t f = 0; f < mesh.faces.size(); f++) {
+    if (!in_pass[f]) {
+      const glm::uvec3& face = mesh.faces[f];
+      stitched.faces.emplace_back(new_index[face[0]], new_index[face[1]],
+                                  new_index[face[2]]);
+    }
+  }
+  for (size_t b = 0; b < block_count; b++) {
+    const SimplificationMesh& block = *block_results[b];
+    const std::vector<uint32_t>& seams = block_seams[b];
+    const size_t seam_count = seams.size();
+    for (size_t i = seam_count; i < block.vertices.size(); i++) {
+      size_t target = block_offsets[b] + i - seam_count;
+      stitched.vertices[target] = block.vertices[i];
+      if (keeps_normals) {
+        stitched.normals[target] = block.normals[i];
+      }
+      if (keeps_colors) {
+        stitched.colors[target] = block.colors[i];
+      }
+      if (keeps_texcoords) {
+        stitched.texcoords[target] = block.texcoords[i];
+      }
+    }
+    for (const glm::uvec3& face : block.faces) {
+      glm::uvec3 global_face;
+      for (int k = 0; k < 3; k++) {
+        global_face[k] = face[k] < seam_count
+                             ? new_index[seams[face[k]]]
+                             : static_cast<unsigned int>(
+                                   block_offsets[b] + face[k] - seam_count);
+      }
+      stitched.faces.push_back(global_face);
+    }
+  }
+  if (!keeps_normals) {
+    stitched.ComputeNormals();
+    return result;
+  }
+  // The blocks kept the normals of their own vertices up to date, and the
+  // faces of unowned vertices outside every block didn't change. That
+  // leaves the block seam vertices, whose faces are split up.
+  std::vector<uint8_t> resewn(stitched_count, 0);
+  for (const std::vector<uint32_t>& seams : block_seams) {
+    for (uint32_t v : seams) {
+      resewn[new_index[v]] = 1;
+    }
+  }
+  std::vector<glm::vec3> seam_sums(stitched_count, glm::vec3(0.0f));
+  for (const glm::uvec3& face : stitched.faces) {
+    if (!resewn[face.x] && !resewn[face.y] && !resewn[face.z]) {
+      continue;
+    }
+    const glm::vec3& p0 = stitched.vertices[face.x];
+    const glm::vec3 cross = glm::cross(stitched.vertices[face.y] - p0,
+                                       stitched.vertices[face.z] - p0);
+    for (int k = 0; k < 3; k++) {
+      seam_sums[face[k]] += cross;
+    }
+  }
+  for (size_t v = 0; v < stitched_count; v++) {
+    if (resewn[v]) {
+      const float squared = glm::dot(seam_sums[v], seam_sums[v]);
+      stitched.normals[v] = squared > 0.0f
+                                ? seam_sums[v] * (1.0f / std::sqrt(squared))
+                                : seam_sums[v];
+    }
+  }
+  return result;
+}
+
+std::shared_ptr<SimplificationMesh> PartitionedSimplifier::SimplifyBlock(
+    SimplificationMesh&& block, size_t seam_count,
+    const SimplificationBudget& budget, float* max_error) const {
+  std::vector<uint8_t> locked(block.vertices.size(), 0);
+  std::fill(locked.begin(), locked.begin() + seam_count, 1);
+  SimplificationReport report;
+  std::shared_ptr<SimplificationMesh> result;
+  switch (method_) {
+    case Method::EDGE_COLLAPSE: {
+      EdgeCollapse edge_collapse = edge_collapse_;
+      edge_collapse.SetLockedVertices(std::move(locked));
+      result = edge_collapse.Simplify(std::move(block), budget, &report);
+      break;
+    }
+    case Method::VERTEX_DECIMATION: {
+      VertexDecimation vertex_decimation = vertex_decimation_;
+      vertex_decimation.SetLockedVertices(std::move(locked));
+      result = vertex_decimation.Simplify(std::move(block), budget, &report);
+      break;
+    }
+    case Method::VERTEX_CLUSTERING: {
+      VertexClustering vertex_clustering = vertex_clustering_;
+      vertex_clustering.SetLockedVertices(std::move(locked));
+      result = vertex_clustering.Simplify(block, budget, &report);
+      break;
+    }
+  }
+  *max_error = report.max_error;
+  return result;
+}
+
+}  // namespace GLOO
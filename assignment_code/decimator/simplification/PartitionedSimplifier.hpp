@@ -0,0 +1,109 @@
+#ifndef PARTITIONED_SIMPLIFIER_H_
+#define PARTITIONED_SIMPLIFIER_H_
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "SimplificationMesh.hpp"
+#include "SimplificationBudget.hpp"
+#include "EdgeCollapse.hpp"
+#include "VertexDecimation.hpp"
+#include "VertexClustering.hpp"
+
+namespace GLOO {
+
+// Simplifies a mesh in spatial blocks across the parallel workers. Faces
+// are sorted along a Morton curve of their centroids and cut into runs of
+// equal size; every block is simplified on its own with one of the three
+// simplifiers while the vertices it shares with other blocks stay locked.
+// The blocks are stitched back together and a second pass over the band of
+// faces around those seams, cut half a block further along the curve,
+// removes the seam vertices the first pass had to keep.
+class PartitionedSimplifier {
+ public:
+  enum class Method { EDGE_COLLAPSE, VERTEX_DECIMATION, VERTEX_CLUSTERING };
+
+  explicit PartitionedSimplifier(Method method = Method::EDGE_COLLAPSE);
+
+  // Simplify mesh to target vertex count
+  std::shared_ptr<SimplificationMesh> Simplify(
+      const SimplificationMesh& original_mesh, int target_vertex_count);
+
+  // Simplify mesh by reduction factor (0.0 to 1.0), as
+  // EdgeCollapse::SimplifyByFactor
+  std::shared_ptr<SimplificationMesh> SimplifyByFactor(
+      const SimplificationMesh& original_mesh, float reduction_factor);
+
+  // The count targets become a fraction of the vertices to keep, which
+  // every block is simplified towards; max_error is passed on to the
+  // blocks. Each block stops on its own, so the result may end up a little
+  // above the target. The report holds the largest error of any block.
+  std::shared_ptr<SimplificationMesh> Simplify(
+      const SimplificationMesh& original_mesh,
+      const SimplificationBudget& budget,
+      SimplificationReport* report = nullptr);
+
+  void SetMethod(Method method) { method_ = method; }
+
+  // Number of blocks of the first pass; 0 picks kBlocksPerWorker per
+  // parallel worker. Either way blocks have at least kMinBlockFaces faces,
+  // and smaller meshes are simplified as one. The result depends on the
+  // block count, so fix it for output that is the same on every machine.
+  void SetBlockCount(int block_count) { block_count_ = block_count; }
+
+  // Settings of the simplifier each block runs (locked vertices set on
+  // these are replaced by the block seams)
+  EdgeCollapse& GetEdgeCollapse() { return edge_collapse_; }
+  VertexDecimation& GetVertexDecimation() { return vertex_decimation_; }
+  VertexClustering& GetVertexClustering() { return vertex_clustering_; }
+
+ private:
+  static const int kBlocksPerWorker = 4;
+  static const size_t kMinBlockFaces = 4096;
+
+  // Blocks of one pass: block b is the faces order[cuts[b], cuts[b + 1]).
+  // Vertices shared by blocks or used by faces outside order are locked.
+  struct Partition {
+    std::vector<uint32_t> order;
+    std::vector<size_t> cuts;
+    std::vector<int> vertex_block;  // Block of an unlocked vertex, else -1
+    std::vector<uint8_t> locked;
+    std::vector<size_t> unlocked_counts;  // Per block
+  };
+
+  // Outcome of one pass
+  struct PassResult {
+    SimplificationMesh mesh;
+    std::vector<uint8_t> seam;  // Per vertex of mesh: was locked
+    float max_error = 0.0f;
+  };
+
+  Method method_;
+  int block_count_ = 0;
+  EdgeCollapse edge_collapse_;
+  VertexDecimation vertex_decimation_;
+  VertexClustering vertex_clustering_;
+
+  size_t GetBlockCount(size_t face_count) const;
+  // The given faces in Morton order of their centroids
+  std::vector<uint32_t> SortAlongCurve(const SimplificationMesh& mesh,
+                                       std::vector<uint32_t> face_ids) const;
+  Partition BuildPartition(const SimplificationMesh& mesh,
+                           std::vector<uint32_t> order,
+                           std::vector<size_t> cuts) const;
+  // Simplifies every block concurrently, removing up to remove_counts[b]
+  // vertices from block b, and stitches the blocks back together
+  PassResult RunPass(const SimplificationMesh& mesh,
+                     const Partition& partition,
+                     const std::vector<size_t>& remove_counts,
+                     float max_error) const;
+  // Runs the chosen simplifier on one block with its first seam_count
+  // vertices locked
+  std::shared_ptr<SimplificationMesh> SimplifyBlock(
+      SimplificationMesh&& block, size_t seam_count,
+      const SimplificationBudget& budget, float* max_error) const;
+};
+
+}  // namespace GLOO
+
+#endif
@@ -0,0 +1,274 @@
+#ifndef PRIORITY_QUEUES_H_
+#define PRIORITY_QUEUES_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <queue>
+#include <utility>
+#include <vector>
+
+namespace GLOO {
+
+// Priority queues the simplifiers can run on (see SetQueueBackend). All
+// three have the same interface and pop in the same order (up to ties of
+// the order key); only their cost differs. An item type T provides:
+//   bool operator<(const T&) const  - lower priority, as in
+//                                     std::priority_queue (Top is the max)
+//   uint64_t GetOrderKey() const    - key with the same order, smallest
+//                                     first
+//   uint32_t GetQueueId() const     - stable id of what the item ranks (a
+//                                     vertex), or kNoQueueId
+enum class QueueBackend { BINARY_HEAP, DARY_HEAP, RADIX_HEAP };
+
+const uint32_t kNoQueueId = UINT32_MAX;
+
+// Binary heap with lazy deletion: updating an item pushes a new entry and
+// the caller skips the stale one when it surfaces.
+template <class T>
+class LazyBinaryHeap {
+ public:
+  // Replaces the contents, building the heap in linear time
+  void Assign(std::vector<T>&& items) {
+    heap_ = std::priority_queue<T>(std::less<T>(), std::move(items));
+  }
+  void Push(const T& item) { heap_.push(item); }
+  const T& Top() { return heap_.top(); }
+  void Pop() { heap_.pop(); }
+  bool Empty() const { return heap_.empty(); }
+  size_t Size() const { return heap_.size(); }
+
+ private:
+  std::priority_queue<T> heap_;
+};
+
+// 4-ary heap (half the depth of a binary one, with the children of a node
+// in one cache line for small items) that tracks where each id sits.
+// Pushing an item whose id is already queued re-keys that entry in place
+// (decrease- or increase-key), so ranked ids never leave stale entries.
+// Items without an id are queued as is, with lazy deletion.
+template <class T, int D = 4>
+class IndexedDaryHeap {
+ public:
+  // Replaces the contents, building the heap in linear time. Ids must be
+  // unique.
+  void Assign(std::vector<T>&& items) {
+    for (uint32_t& position : positions_) {
+      position = kNoPosition;
+    }
+    heap_ = std::move(items);
+    for (size_t i = 0; i < heap_.size(); i++) {
+      Place(i);
+    }
+    if (heap_.size() > 1) {
+      for (size_t i = (heap_.size() - 2) / D + 1; i-- > 0;) {
+        SiftDown(i);
+      }
+    }
+  }
+  void Push(const T& item) {
+    const uint32_t id = item.GetQueueId();
+    if (id != kNoQueueId && id < positions_.size() &&
+        positions_[id] != kNoPosition) {
+      const size_t i = positions_[id];
+      const bool raised = heap_[i] < item;
+      heap_[i] = item;
+      if (raised) {
+        SiftUp(i);
+      } else {
+        SiftDown(i);
+      }
+      return;
+    }
+    heap_.push_back(item);
+    Place(heap_.size() - 1);
+    SiftUp(heap_.size() - 1);
+  }
+  const T& Top() { return heap_.front(); }
+  void Pop() {
+    Forget(heap_.front());
+    if (heap_.size() > 1) {
+      heap_.front() = std::move(heap_.back());
+      heap_.pop_back();
+      Place(0);
+      SiftDown(0);
+    } else {
+      heap_.pop_back();
+    }
+  }
+  bool Empty() const { return heap_.empty(); }
+  size_t Size() const { return heap_.size(); }
+
+ private:
+  static const uint32_t kNoPosition = UINT32_MAX;
+
+  std::vector<T> heap_;
+  std::vector<uint32_t> positions_;  // Heap index of each id
+
+  void Place(size_t i) {
+    const uint32_t id = heap_[i].GetQueueId();
+    if (id == kNoQueueId) {
+      return;
+    }
+    if (id >= positions_.size()) {
+      positions_.resize(static_cast<size_t>(id) + 1,
+                        static_cast<uint32_t>(kNoPosition));
+    }
+    positions_[id] = static_cast<uint32_t>(i);
+  }
+  void Forget(const T& item) {
+    const uint32_t id = item.GetQueueId();
+    if (id != kNoQueueId) {
+      positions_[id] = kNoPosition;
+    }
+  }
+  void SiftUp(size_t i) {
+    T item = std::move(heap_[i]);
+    while (i > 0) {
+      const size_t parent = (i - 1) / D;
+      if (!(heap_[parent] < item)) {
+        break;
+      }
+      heap_[i] = std::move(heap_[parent]);
+      Place(i);
+      i = parent;
+    }
+    heap_[i] = std::move(item);
+    Place(i);
+  }
+  void SiftDown(size_t i) {
+    const size_t size = heap_.size();
+    T item = std::move(heap_[i]);
+    for (;;) {
+      const size_t first = D * i + 1;
+      if (first >= size) {
+        break;
+      }
+      const size_t last = first + D < size ? first + D : size;
+      size_t best = first;
+      for (size_t child = first + 1; child < last; child++) {
+        if (heap_[best] < heap_[child]) {
+          best = child;
+        }
+      }
+      if (!(item < heap_[best])) {
+        break;
+      }
+      heap_[i] = std::move(heap_[best]);
+      Place(i);
+      i = best;
+    }
+    heap_[i] = std::move(item);
+    Place(i);
+  }
+};
+
+// Monotone radix heap on the 64-bit order keys (for the simplifiers, the
+// float error's bits, which order like the floats and quantize them
+// logarithmically). Bucket b holds keys whose highest bit differing from
+// the last popped key is b - 1, so pushes are O(1) and every key moves
+// down at most 64 times before it pops. Keys below the last popped one
+// (a cost that dropped after a collapse) can't be bucketed; they go to a
+// small binary heap that is drained first, which keeps the exact order.
+// Lazy deletion as in LazyBinaryHeap.
+template <class T>
+class MonotoneRadixHeap {
+ public:
+  void Assign(std::vector<T>&& items) {
+    for (std::vector<Entry>& bucket : buckets_) {
+      bucket.clear();
+    }
+    late_ = std::priority_queue<Entry>();
+    last_key_ = 0;
+    size_ = 0;
+    for (T& item : items) {
+      Push(item);
+    }
+    std::vector<T>().swap(items);
+  }
+  void Push(const T& item) {
+    Entry entry;
+    entry.key = item.GetOrderKey();
+    entry.item = item;
+    if (entry.key < last_key_) {
+      late_.push(entry);
+    } else {
+      buckets_[GetBucket(entry.key)].push_back(entry);
+    }
+    size_++;
+  }
+  const T& Top() {
+    if (!late_.empty()) {
+      return late_.top().item;
+    }
+    Refill();
+    return buckets_[0].back().item;
+  }
+  void Pop() {
+    if (!late_.empty()) {
+      late_.pop();
+    } else {
+      Refill();
+      buckets_[0].pop_back();
+    }
+    size_--;
+  }
+  bool Empty() const { return size_ == 0; }
+  size_t Size() const { return size_; }
+
+ private:
+  struct Entry {
+    uint64_t key;
+    T item;
+
+    bool operator<(const Entry& other) const {
+      return key > other.key;  // Min heap
+    }
+  };
+
+  std::vector<Entry> buckets_[65];
+  std::priority_queue<Entry> late_;  // Keys below last_key_
+  uint64_t last_key_ = 0;
+  size_t size_ = 0;
+
+  int GetBucket(uint64_t key) const {
+    uint64_t diff = key ^ last_key_;
+    if (diff == 0) {
+      return 0;
+    }
+#if defined(__GNUC__) || defined(__clang__)
+    return 64 - __builtin_clzll(diff);
+#else
+    int bucket = 0;
+    for (; diff != 0; diff >>= 1) {
+      bucket++;
+    }
+    return bucket;
+#endif
+  }
+  // Makes bucket 0 hold the smallest key by redistributing the first
+  // non-empty bucket around its minimum
+  void Refill() {
+    if (!buckets_[0].empty()) {
+      return;
+    }
+    int b = 1;
+    while (buckets_[b].empty()) {
+      b++;
+    }
+    std::vector<Entry>& bucket = buckets_[b];
+    uint64_t min_key = bucket[0].key;
+    for (const Entry& entry : bucket) {
+      min_key = entry.key < min_key ? entry.key : min_key;
+    }
+    last_key_ = min_key;
+    for (Entry& entry : bucket) {
+      buckets_[GetBucket(entry.key)].push_back(std::move(entry));
+    }
+    bucket.clear();
+  }
+};
+
+}  // namespace GLOO
+
+#endif
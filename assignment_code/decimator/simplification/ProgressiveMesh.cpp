@@ -0,0 +1,181 @@
+#include "ProgressiveMesh.hpp"
+#include "Profiler.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace GLOO {
+
+ProgressiveMesh::ProgressiveMesh(SimplificationMesh mesh,
+                                 std::vector<VertexSplit> splits,
+                                 std::vector<unsigned int> corners)
+    : mesh_(std::move(mesh)),
+      splits_(std::move(splits)),
+      corners_(std::move(corners)),
+      vertex_count_(mesh_.vertices.size()),
+      face_count_(mesh_.faces.size()) {
+  mesh_.ComputeNormals();
+
+  const size_t vertex_count = mesh_.vertices.size();
+  face_offsets_.assign(vertex_count + 1, 0);
+  for (const glm::uvec3& face : mesh_.faces) {
+    for (int c = 0; c < 3; c++) {
+      face_offsets_[face[c] + 1]++;
+    }
+  }
+  for (size_t v = 0; v < vertex_count; v++) {
+    face_offsets_[v + 1] += face_offsets_[v];
+  }
+  vertex_faces_.resize(face_offsets_[vertex_count]);
+  std::vector<size_t> next(face_offsets_.begin(), face_offsets_.end() - 1);
+  for (size_t f = 0; f < mesh_.faces.size(); f++) {
+    for (int c = 0; c < 3; c++) {
+      vertex_faces_[next[mesh_.faces[f][c]]++] = static_cast<unsigned int>(f);
+    }
+  }
+
+  const unsigned int no_split = kNoSplit;
+  last_split_.assign(vertex_count, no_split);
+  previous_split_.resize(splits_.size());
+  for (size_t i = 0; i < splits_.size(); i++) {
+    previous_split_[i] = last_split_[splits_[i].vt];
+    last_split_[splits_[i].vt] = static_cast<unsigned int>(i);
+  }
+  // Nothing is collapsed yet
+  last_split_.assign(vertex_count, no_split);
+  normal_dirty_.assign(vertex_count, 0);
+}
+
+void ProgressiveMesh::SetVertexCount(size_t vertex_count) {
+  DECIMATOR_PROFILE_SCOPE("ProgressiveMesh.SetVertexCount");
+  vertex_count = std::max(GetMinVertexCount(),
+                          std::min(GetMaxVertexCount(), vertex_count));
+  const size_t max_count = GetMaxVertexCount();
+  // Vertices a collapse leaves without faces go with it, as in the
+  // EdgeCollapse run: stop below the records that drop them
+  while (vertex_count > GetMinVertexCount() &&
+         splits_[max_count - vertex_count].vt == vertex_count - 1) {
+    vertex_count--;
+  }
+
+  // Split i undoes collapse i, which took the mesh from max_count - i to
+  // max_count - i - 1 vertices
+  while (vertex_count_ > vertex_count) {
+    size_t i = max_count - vertex_count_;
+    Collapse(i);
+    vertex_count_--;
+    face_count_ = splits_[i].face_count;
+  }
+  while (vertex_count_ < vertex_count) {
+    size_t i = max_count - vertex_count_ - 1;
+    Split(i, static_cast<unsigned int>(vertex_count_));
+    vertex_count_++;
+    face_count_ = i == 0 ? mesh_.faces.size() : splits_[i - 1].face_count;
+  }
+  UpdateNormals();
+}
+
+SimplificationMesh ProgressiveMesh::Extract() const {
+  SimplificationMesh result;
+  result.vertices.assign(mesh_.vertices.begin(),
+                         mesh_.vertices.begin() + vertex_count_);
+  result.faces.assign(mesh_.faces.begin(), mesh_.faces.begin() + face_count_);
+  if (mesh_.colors.size() == mesh_.vertices.size()) {
+    result.colors.assign(mesh_.colors.begin(),
+                         mesh_.colors.begin() + vertex_count_);
+  }
+  if (mesh_.texcoords.size() == mesh_.vertices.size()) {
+    result.texcoords.assign(mesh_.texcoords.begin(),
+                            mesh_.texcoords.begin() + vertex_count_);
+  }
+  result.normals.assign(mesh_.normals.begin(),
+                        mesh_.normals.begin() + vertex_count_);
+  return result;
+}
+
+void ProgressiveMesh::Collapse(size_t index) {
+  const VertexSplit& split = splits_[index];
+  for (size_t c = split.corners_begin; c < split.corners_end; c++) {
+    unsigned int corner = corners_[c];
+    mesh_.faces[corner / 3][corner % 3] = split.vt;
+  }
+  mesh_.vertices[split.vt] = split.vt_position_after;
+  last_split_[split.vt] = static_cast<unsigned int>(index);
+  MarkNormalDirty(split.vt);
+}
+
+void ProgressiveMesh::Split(size_t index, unsigned int vs) {
+  const VertexSplit& split = splits_[index];
+  for (size_t c = split.corners_begin; c < split.corners_end; c++) {
+    unsigned int corner = corners_[c];
+    mesh_.faces[corner / 3][corner % 3] = vs;
+  }
+  mesh_.vertices[split.vt] = split.vt_position_before;
+  last_split_[split.vt] = previous_split_[index];
+  MarkNormalDirty(split.vt);
+  MarkNormalDirty(vs);
+}
+
+void ProgressiveMesh::MarkNormalDirty(unsigned int vertex) {
+  if (!normal_dirty_[vertex]) {
+    normal_dirty_[vertex] = 1;
+    dirty_vertices_.push_back(vertex);
+  }
+}
+
+void ProgressiveMesh::UpdateNormals() {
+  // Every face that changed has a moved or split vertex, so those vertices
+  // and their rings are all the normals that changed. Vertices that were
+  // collapsed away get theirs when they are split again.
+  std::vector<unsigned int> faces;
+  const size_t changed_count = dirty_vertices_.size();
+  for (size_t d = 0; d < changed_count; d++) {
+    const unsigned int vertex = dirty_vertices_[d];
+    if (vertex >= vertex_count_) continue;
+    GatherFaces(vertex, faces);
+    for (unsigned int f : faces) {
+      for (int c = 0; c < 3; c++) {
+        MarkNormalDirty(mesh_.faces[f][c]);
+      }
+    }
+  }
+  for (unsigned int vertex : dirty_vertices_) {
+    normal_dirty_[vertex] = 0;
+    if (vertex >= vertex_count_) continue;
+    GatherFaces(vertex, faces);
+    // Area-weighted, as in SimplificationMesh::ComputeNormals
+    glm::vec3 sum(0.0f);
+    for (unsigned int f : faces) {
+      const glm::uvec3& face = mesh_.faces[f];
+      const glm::vec3& p0 = mesh_.vertices[face.x];
+      sum += glm::cross(mesh_.vertices[face.y] - p0,
+                        mesh_.vertices[face.z] - p0);
+    }
+    const float squared = glm::dot(sum, sum);
+    mesh_.normals[vertex] =
+        squared > 0.0f ? sum * (1.0f / std::sqrt(squared)) : sum;
+  }
+  dirty_vertices_.clear();
+}
+
+void ProgressiveMesh::GatherFaces(unsigned int vertex,
+                                  std::vector<unsigned int>& faces) const {
+  // Faces past face_count_ are removed at this LOD
+  faces.clear();
+  for (size_t k = face_offsets_[vertex]; k < face_offsets_[vertex + 1]; k++) {
+    if (vertex_faces_[k] < face_count_) {
+      faces.push_back(vertex_faces_[k]);
+    }
+  }
+  for (unsigned int i = last_split_[vertex]; i != kNoSplit;
+       i = previous_split_[i]) {
+    const VertexSplit& split = splits_[i];
+    for (size_t c = split.corners_begin; c < split.corners_end; c++) {
+      const unsigned int face = corners_[c] / 3;
+      if (face < face_count_) {
+        faces.push_back(face);
+      }
+    }
+  }
+}
+
+}  // namespace GLOO
@@ -0,0 +1,92 @@
+#ifndef PROGRESSIVE_MESH_H_
+#define PROGRESSIVE_MESH_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+#include "SimplificationMesh.hpp"
+
+namespace GLOO {
+
+// One recorded edge collapse, replayable in both directions [Hoppe96].
+// The collapse merges vertex vs into vt, where vs is always the vertex
+// count after the collapse (vertices are ordered so the removed one is the
+// last live vertex). A vertex a collapse leaves without faces is dropped by
+// a record of its own, with vt == vs and no corners.
+struct VertexSplit {
+  unsigned int vt;                 // Vertex kept by the collapse
+  glm::vec3 vt_position_before;    // Position of vt before the collapse
+  glm::vec3 vt_position_after;     // Position of vt after the collapse
+  unsigned int face_count;         // Live faces after the collapse
+  size_t corners_begin;            // Range in ProgressiveMesh::corners_ of
+  size_t corners_end;              // the face corners rewritten vs -> vt
+};
+
+// Collapse sequence of an EdgeCollapse run (see
+// EdgeCollapse::BuildProgressiveMesh). Vertices and faces are stored in
+// removal order, so every LOD is a prefix of both arrays and moving between
+// LODs only replays or unwinds the records in between: O(k) for k collapses
+// instead of a new simplification run.
+//
+// Only positions are tracked per LOD; colors and texture coordinates keep
+// their full-resolution values. Normals are area-weighted and, after a
+// change of LOD, recomputed only around the vertices it moved or split.
+class ProgressiveMesh {
+ public:
+  // mesh must already be in removal order and splits in collapse order;
+  // corners are flat face-corner indices (3 * face + corner).
+  ProgressiveMesh(SimplificationMesh mesh,
+                  std::vector<VertexSplit> splits,
+                  std::vector<unsigned int> corners);
+
+  size_t GetMaxVertexCount() const { return mesh_.vertices.size(); }
+  size_t GetMinVertexCount() const {
+    return mesh_.vertices.size() - splits_.size();
+  }
+  size_t GetVertexCount() const { return vertex_count_; }
+  size_t GetFaceCount() const { return face_count_; }
+
+  // Collapses or splits vertices until vertex_count are live (clamped to
+  // [GetMinVertexCount(), GetMaxVertexCount()]), or a few less where the
+  // collapse that reaches vertex_count leaves other vertices without faces.
+  void SetVertexCount(size_t vertex_count);
+
+  // Copies the current LOD into a standalone mesh (with normals).
+  SimplificationMesh Extract() const;
+
+ private:
+  static const unsigned int kNoSplit = ~0u;
+
+  void Collapse(size_t index);
+  void Split(size_t index, unsigned int vs);
+  void MarkNormalDirty(unsigned int vertex);
+  // Recomputes the normals of the dirty vertices and their one-rings
+  void UpdateNormals();
+  // Live faces around a live vertex
+  void GatherFaces(unsigned int vertex,
+                   std::vector<unsigned int>& faces) const;
+
+  // Full-size arrays; only the first vertex_count_ vertices and face_count_
+  // faces are live, and faces are rewritten in place as LODs change.
+  SimplificationMesh mesh_;
+  std::vector<VertexSplit> splits_;
+  std::vector<unsigned int> corners_;
+  size_t vertex_count_;
+  size_t face_count_;
+
+  // Faces of each vertex at full resolution (offsets into vertex_faces_).
+  // A live vertex also has the faces of the corners moved onto it by the
+  // applied collapses into it, chained from last_split_ through
+  // previous_split_ (the previous collapse into the same vt).
+  std::vector<size_t> face_offsets_;
+  std::vector<unsigned int> vertex_faces_;
+  std::vector<unsigned int> previous_split_;
+  std::vector<unsigned int> last_split_;
+  std::vector<uint8_t> normal_dirty_;
+  std::vector<unsigned int> dirty_vertices_;
+};
+
+}  // namespace GLOO
+
+#endif
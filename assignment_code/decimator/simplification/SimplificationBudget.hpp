@@ -0,0 +1,41 @@
+#ifndef SIMPLIFICATION_BUDGET_H_
+#define SIMPLIFICATION_BUDGET_H_
+
+#include <cstddef>
+
+namespace GLOO {
+
+// Stopping criteria shared by the simplifiers. Simplification stops as soon
+// as either count target is reached, and never performs a step whose error
+// exceeds max_error. Each simplifier measures error as a distance in mesh
+// units (see the Simplify overloads taking a budget).
+struct SimplificationBudget {
+  int target_vertex_count = 0;  // 0: as few as possible
+  int target_face_count = 0;    // 0: as few as possible
+  float max_error = -1.0f;      // Negative: unlimited
+
+  static SimplificationBudget Vertices(int vertex_count) {
+    SimplificationBudget budget;
+    budget.target_vertex_count = vertex_count;
+    return budget;
+  }
+
+  bool IsReached(int vertex_count, int face_count) const {
+    return vertex_count <= target_vertex_count ||
+           face_count <= target_face_count;
+  }
+  bool AllowsError(float error) const {
+    return max_error < 0.0f || error <= max_error;
+  }
+};
+
+// Outcome of a budgeted simplification.
+struct SimplificationReport {
+  size_t vertex_count = 0;
+  size_t face_count = 0;
+  float max_error = 0.0f;  // Largest error of any step performed
+};
+
+}  // namespace GLOO
+
+#endif
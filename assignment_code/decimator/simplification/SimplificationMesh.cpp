@@ -1,102 +1,92 @@
 #include "SimplificationMesh.hpp"
+#include "GeometryKernels.hpp"
 #include "gloo/gl_wrapper/BindGuard.hpp"
+#include "helpers.hpp"
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
 #include <iostream>
 
 namespace GLOO {
 
+namespace {
+// Faces and index buffers hold the same unsigned ints, three per triangle,
+// so they convert with a single copy
+static_assert(sizeof(glm::uvec3) == 3 * sizeof(unsigned int),
+              "glm::uvec3 must be tightly packed");
+
+std::unique_ptr<IndexArray> FacesToIndices(
+    const std::vector<glm::uvec3>& faces) {
+  auto indices = make_unique<IndexArray>(faces.size() * 3);
+  if (!faces.empty()) {
+    std::memcpy(indices->data(), faces.data(),
+                faces.size() * sizeof(glm::uvec3));
+  }
+  return indices;
+}
+
+std::shared_ptr<VertexObject> MakeVertexObject(
+    std::unique_ptr<PositionArray> positions,
+    std::unique_ptr<IndexArray> indices,
+    std::unique_ptr<NormalArray> normals) {
+  auto vertex_obj = std::make_shared<VertexObject>();
+  vertex_obj->UpdatePositions(std::move(positions));
+  vertex_obj->UpdateIndices(std::move(indices));
+  // Create normal buffer if available
+  if (!normals->empty()) {
+    vertex_obj->UpdateNormals(std::move(normals));
+  }
+  return vertex_obj;
+}
+}  // namespace
+
 SimplificationMesh SimplificationMesh::FromVertexObject(const VertexObject& vertex_obj) {
   SimplificationMesh data;
   
   // Get positions
   const auto& positions = vertex_obj.GetPositions();
-  data.vertices.reserve(positions.size());
-  for (const auto& pos : positions) {
-    data.vertices.push_back(pos);
-  }
+  data.vertices.assign(positions.begin(), positions.end());
   
-  // Get indices and convert to faces (triangles)
+  // Get indices and convert to faces (triangles); a trailing partial
+  // triangle is dropped
   const auto& indices = vertex_obj.GetIndices();
-  if (indices.size() >= 3) {
-    data.faces.reserve(indices.size() / 3);
-    for (size_t i = 0; i + 2 < indices.size(); i += 3) {
-      data.faces.push_back(glm::uvec3(
-          indices[i],
-          indices[i + 1],
-          indices[i + 2]
-      ));
-    }
+  data.faces.resize(indices.size() / 3);
+  if (!data.faces.empty()) {
+    std::memcpy(data.faces.data(), indices.data(),
+                data.faces.size() * sizeof(glm::uvec3));
   }
   
   // Get normals if available
   const auto& normals = vertex_obj.GetNormals();
-  if (!normals.empty()) {
-    data.normals.reserve(normals.size());
-    for (const auto& norm : normals) {
-      data.normals.push_back(norm);
-    }
-  }
+  data.normals.assign(normals.begin(), normals.end());
   
   return data;
 }
 
-std::shared_ptr<VertexObject> SimplificationMesh::ToVertexObject() const {
+std::shared_ptr<VertexObject> SimplificationMesh::ToVertexObject() const& {
   // Convert SimplificationMesh to VertexObject for rendering
-  auto vertex_obj = std::make_shared<VertexObject>();
-  
-  // Create position buffer
-  auto positions = make_unique<PositionArray>();
-  for (const auto& v : vertices) {
-    positions->push_back(v);
-  }
-  vertex_obj->UpdatePositions(std::move(positions));
-  
-  // Create index buffer
-  auto indices = make_unique<IndexArray>();
-  for (const auto& f : faces) {
-    indices->push_back(f.x);
-    indices->push_back(f.y);
-    indices->push_back(f.z);
-  }
-  vertex_obj->UpdateIndices(std::move(indices));
-  
-  // Create normal buffer if available
-  if (!normals.empty()) {
-    auto normal_array = make_unique<NormalArray>();
-    for (const auto& n : normals) {
-      normal_array->push_back(n);
-    }
-    vertex_obj->UpdateNormals(std::move(normal_array));
-  }
-  
-  return vertex_obj;
+  return MakeVertexObject(make_unique<PositionArray>(vertices),
+                          FacesToIndices(faces),
+                          make_unique<NormalArray>(normals));
+}
+
+std::shared_ptr<VertexObject> SimplificationMesh::ToVertexObject() && {
+  auto indices = FacesToIndices(faces);
+  faces = std::vector<glm::uvec3>();
+  return MakeVertexObject(make_unique<PositionArray>(std::move(vertices)),
+                          std::move(indices),
+                          make_unique<NormalArray>(std::move(normals)));
 }
 
 void SimplificationMesh::ComputeNormals() {
   // Compute per-vertex normals from face data
   normals.clear();
   normals.resize(vertices.size(), glm::vec3(0.0f));
-  
-  // For each face, compute face normal and add to vertex normals
-  for (const auto& face : faces) {
-    const glm::vec3& v0 = vertices[face.x];
-    const glm::vec3& v1 = vertices[face.y];
-    const glm::vec3& v2 = vertices[face.z];
-    
-    glm::vec3 edge1 = v1 - v0;
-    glm::vec3 edge2 = v2 - v0;
-    glm::vec3 face_normal = glm::normalize(glm::cross(edge1, edge2));
-    
-    normals[face.x] += face_normal;
-    normals[face.y] += face_normal;
-    normals[face.z] += face_normal;
-  }
-  
-  // Normalize vertex normals
-  for (auto& normal : normals) {
-    if (glm::length(normal) > 0.0f) {
-      normal = glm::normalize(normal);
-    }
-  }
+
+  // Area-weighted: the sums of the faces' raw cross products
+  GeometryKernels::AccumulateVertexNormals(vertices.data(), faces.data(),
+                                           faces.size(), normals.data());
+  GeometryKernels::NormalizeVectors(normals.data(), normals.size());
 }
 
 bool SimplificationMesh::Validate() const {
@@ -119,5 +109,91 @@ bool SimplificationMesh::Validate() const {
   return true;
 }
 
-}  // namespace GLOO
+std::vector<MeshEdge> SimplificationMesh::GetUniqueEdges() const {
+  // Pack each half-edge as (min << 32 | max), radix sort the keys and keep
+  // the first of every run of equal keys.
+  std::vector<uint64_t> keys(faces.size() * 3);
+  ParallelFor(faces.size(), [&](size_t i) {
+    const glm::uvec3& face = faces[i];
+    auto key = [](unsigned int a, unsigned int b) {
+      if (a > b) std::swap(a, b);
+      return (static_cast<uint64_t>(a) << 32) | b;
+    };
+    keys[3 * i] = key(face.x, face.y);
+    keys[3 * i + 1] = key(face.y, face.z);
+    keys[3 * i + 2] = key(face.z, face.x);
+  });
+  RadixSort(keys);
 
+  std::vector<uint64_t> unique_keys;
+  CompactIf(keys, unique_keys, [&](size_t i) {
+    return i == 0 || keys[i] != keys[i - 1];
+  });
+
+  std::vector<MeshEdge> edges;
+  edges.reserve(unique_keys.size());
+  for (uint64_t key : unique_keys) {
+    edges.emplace_back(static_cast<int>(key >> 32),
+                       static_cast<int>(key & 0xFFFFFFFFu));
+  }
+  return edges;
+}
+
+void SimplificationMesh::RemoveFlagged(
+    const std::vector<uint8_t>& vertex_removed,
+    const std::vector<uint8_t>& face_removed) {
+  // New vertex indices are the exclusive prefix sum of the keep flags
+  const size_t vertex_count = vertices.size();
+  std::vector<unsigned int> remap(vertex_count);
+  ParallelFor(vertex_count, [&](size_t i) {
+    remap[i] = vertex_removed[i] ? 0u : 1u;
+  });
+  ExclusiveScan(remap, remap);
+
+  auto keep_vertex = [&](size_t i) { return !vertex_removed[i]; };
+  std::vector<glm::vec3> kept_vertices;
+  CompactIf(vertices, kept_vertices, keep_vertex);
+  vertices.swap(kept_vertices);
+  const bool keep_normals = normals.size() == vertex_count;
+  if (keep_normals) {
+    std::vector<glm::vec3> kept_normals;
+    CompactIf(normals, kept_normals, keep_vertex);
+    normals.swap(kept_normals);
+  }
+  if (colors.size() == vertex_count) {
+    std::vector<glm::vec3> kept_colors;
+    CompactIf(colors, kept_colors, keep_vertex);
+    colors.swap(kept_colors);
+  }
+  if (texcoords.size() == vertex_count) {
+    std::vector<glm::vec2> kept_texcoords;
+    CompactIf(texcoords, kept_texcoords, keep_vertex);
+    texcoords.swap(kept_texcoords);
+  }
+
+  std::vector<glm::uvec3> kept_faces;
+  CompactIf(faces, kept_faces, [&](size_t i) { return !face_removed[i]; });
+  ParallelFor(kept_faces.size(), [&](size_t i) {
+    kept_faces[i] = glm::uvec3(remap[kept_faces[i].x], remap[kept_faces[i].y],
+                               remap[kept_faces[i].z]);
+  });
+  faces.swap(kept_faces);
+
+  if (!keep_normals) {
+    ComputeNormals();
+  }
+}
+
+std::string GetFlagsKey(const std::vector<uint8_t>& flags) {
+  // 64-bit FNV-1a, stable across builds so disk cache keys stay valid
+  uint64_t hash = 14695981039346656037ull;
+  for (uint8_t flag : flags) {
+    hash = (hash ^ (flag != 0)) * 1099511628211ull;
+  }
+  char text[40];
+  std::snprintf(text, sizeof(text), "%zu:%016llx", flags.size(),
+                static_cast<unsigned long long>(hash));
+  return text;
+}
+
+}  // namespace GLOO
@@ -1,13 +1,33 @@
 #ifndef SIMPLIFICATION_MESH_H_
 #define SIMPLIFICATION_MESH_H_
 
+#include <algorithm>
+#include <cstdint>
 #include <vector>
 #include <glm/glm.hpp>
 #include <memory>
+#include <string>
 #include "gloo/VertexObject.hpp"
 
 namespace GLOO {
 
+// Edge structure for mesh operations
+struct MeshEdge {
+  int v1, v2;  // Vertex indices (v1 < v2)
+  
+  MeshEdge(int a, int b) : v1(std::min(a, b)), v2(std::max(a, b)) {}
+  
+  bool operator==(const MeshEdge& other) const {
+    return v1 == other.v1 && v2 == other.v2;
+  }
+  
+  struct Hash {
+    size_t operator()(const MeshEdge& e) const {
+      return std::hash<int>()(e.v1) ^ (std::hash<int>()(e.v2) << 1);
+    }
+  };
+};
+
 // Mesh data structure for simplification algorithms
 struct SimplificationMesh {
   // Vertex positions
@@ -28,12 +48,16 @@ struct SimplificationMesh {
   SimplificationMesh() = default;
   SimplificationMesh(const SimplificationMesh& other) = default;
   SimplificationMesh& operator=(const SimplificationMesh& other) = default;
+  SimplificationMesh(SimplificationMesh&& other) = default;
+  SimplificationMesh& operator=(SimplificationMesh&& other) = default;
 
   // Convert from VertexObject
   static SimplificationMesh FromVertexObject(const VertexObject& vertex_obj);
   
-  // Convert to VertexObject for rendering
-  std::shared_ptr<VertexObject> ToVertexObject() const;
+  // Convert to VertexObject for rendering. The rvalue version hands the
+  // position and normal arrays over instead of copying them.
+  std::shared_ptr<VertexObject> ToVertexObject() const&;
+  std::shared_ptr<VertexObject> ToVertexObject() &&;
   
   // Utility methods
   size_t GetVertexCount() const { return vertices.size(); }
@@ -50,30 +74,29 @@ struct SimplificationMesh {
   
   bool IsEmpty() const { return vertices.empty() || faces.empty(); }
   
-  // Compute normals from geometry
+  // Compute area-weighted normals from geometry
   void ComputeNormals();
   
   // Validate mesh (check for degenerate faces, etc.)
   bool Validate() const;
-};
 
-// Edge structure for mesh operations
-struct MeshEdge {
-  int v1, v2;  // Vertex indices (v1 < v2)
-  
-  MeshEdge(int a, int b) : v1(std::min(a, b)), v2(std::max(a, b)) {}
-  
-  bool operator==(const MeshEdge& other) const {
-    return v1 == other.v1 && v2 == other.v2;
-  }
-  
-  struct Hash {
-    size_t operator()(const MeshEdge& e) const {
-      return std::hash<int>()(e.v1) ^ (std::hash<int>()(e.v2) << 1);
-    }
-  };
+  // Unique undirected edges of all faces, sorted by (v1, v2)
+  std::vector<MeshEdge> GetUniqueEdges() const;
+
+  // Drops flagged (nonzero) vertices and faces, keeping the order of the
+  // rest, and remaps face indices. Byte flags rather than std::vector<bool>,
+  // so the simplifiers can set neighbouring flags from different threads.
+  // Per-vertex normals are compacted like the other attributes, as the
+  // simplifiers keep them up to date around every change; a mesh without
+  // them gets them computed.
+  void RemoveFlagged(const std::vector<uint8_t>& vertex_removed,
+                     const std::vector<uint8_t>& face_removed);
 };
 
+// Short text naming the content of a flag array (its length and a hash), so
+// the simplifiers' settings keys can cover locked vertices.
+std::string GetFlagsKey(const std::vector<uint8_t>& flags);
+
 }  // namespace GLOO
 
 #endif
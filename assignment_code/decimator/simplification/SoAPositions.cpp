@@ -0,0 +1,69 @@
+#include "SoAPositions.hpp"
+#include "GeometryKernels.hpp"
+#include "helpers.hpp"
+#include <algorithm>
+
+namespace GLOO {
+
+SoAPositions::SoAPositions(const std::vector<glm::vec3>& positions) {
+  Assign(positions);
+}
+
+void SoAPositions::Assign(const std::vector<glm::vec3>& positions) {
+  count_ = positions.size();
+  const size_t padded =
+      (count_ + kLaneCount - 1) / kLaneCount * kLaneCount;
+  x_.resize(padded);
+  y_.resize(padded);
+  z_.resize(padded);
+  if (count_ == 0) {
+    return;
+  }
+  ParallelFor(padded, [&](size_t i) {
+    const glm::vec3& p = positions[std::min(i, count_ - 1)];
+    x_[i] = p.x;
+    y_[i] = p.y;
+    z_[i] = p.z;
+  });
+}
+
+void SoAPositions::CopyTo(std::vector<glm::vec3>& positions) const {
+  positions.resize(count_);
+  ParallelFor(count_, [&](size_t i) {
+    positions[i] = glm::vec3(x_[i], y_[i], z_[i]);
+  });
+}
+
+void SoAPositions::ComputeBounds(glm::vec3& min_bounds,
+                                 glm::vec3& max_bounds) const {
+  if (count_ == 0) {
+    min_bounds = max_bounds = glm::vec3(0.0f);
+    return;
+  }
+
+  // Chunks are whole blocks, so each chunk's arrays stay aligned and padded
+  const size_t block_count = x_.size() / kLaneCount;
+  const size_t chunk_count = GetParallelChunkCount(block_count);
+  std::vector<glm::vec3> chunk_min(std::max<size_t>(chunk_count, 1),
+                                   Get(0));
+  std::vector<glm::vec3> chunk_max(chunk_min);
+  ParallelChunks(block_count, [&](size_t c, size_t begin, size_t end) {
+    if (begin == end) {
+      return;
+    }
+    const size_t first = begin * kLaneCount;
+    GeometryKernels::ComputeBounds(x_.data() + first, y_.data() + first,
+                                   z_.data() + first,
+                                   (end - begin) * kLaneCount, chunk_min[c],
+                                   chunk_max[c]);
+  });
+
+  min_bounds = chunk_min[0];
+  max_bounds = chunk_max[0];
+  for (size_t c = 1; c < chunk_min.size(); c++) {
+    min_bounds = glm::min(min_bounds, chunk_min[c]);
+    max_bounds = glm::max(max_bounds, chunk_max[c]);
+  }
+}
+
+}  // namespace GLOO
@@ -0,0 +1,126 @@
+#ifndef SOA_POSITIONS_H_
+#define SOA_POSITIONS_H_
+
+#include <cstddef>
+#include <cstdlib>
+#include <limits>
+#include <new>
+#include <vector>
+#include <glm/glm.hpp>
+
+namespace GLOO {
+
+// std::allocator with a minimum alignment (a power of two, at least
+// sizeof(void*)).
+template <typename T, size_t Alignment>
+class AlignedAllocator {
+ public:
+  typedef T value_type;
+
+  template <typename U>
+  struct rebind {
+    typedef AlignedAllocator<U, Alignment> other;
+  };
+
+  AlignedAllocator() = default;
+  template <typename U>
+  AlignedAllocator(const AlignedAllocator<U, Alignment>&) {}
+
+  T* allocate(size_t count) {
+    if (count > std::numeric_limits<size_t>::max() / sizeof(T)) {
+      throw std::bad_alloc();
+    }
+    void* memory = nullptr;
+#ifdef _WIN32
+    memory = _aligned_malloc(count * sizeof(T), Alignment);
+#else
+    if (posix_memalign(&memory, Alignment, count * sizeof(T)) != 0) {
+      memory = nullptr;
+    }
+#endif
+    if (memory == nullptr) {
+      throw std::bad_alloc();
+    }
+    return static_cast<T*>(memory);
+  }
+
+  void deallocate(T* memory, size_t) {
+#ifdef _WIN32
+    _aligned_free(memory);
+#else
+    free(memory);
+#endif
+  }
+};
+
+template <typename T, typename U, size_t Alignment>
+bool operator==(const AlignedAllocator<T, Alignment>&,
+                const AlignedAllocator<U, Alignment>&) {
+  return true;
+}
+
+template <typename T, typename U, size_t Alignment>
+bool operator!=(const AlignedAllocator<T, Alignment>&,
+                const AlignedAllocator<U, Alignment>&) {
+  return false;
+}
+
+// Vertex positions as separate x, y and z arrays (structure of arrays), the
+// layout SIMD kernels want: one 32-byte load gives the same coordinate of
+// kLaneCount consecutive vertices. SimplificationMesh keeps glm::vec3 (array
+// of structs) as its primary layout, since the simplifiers look vertices up
+// individually; hot loops over all positions convert once and run on this.
+//
+// Each array starts 32-byte aligned and is padded to a multiple of
+// kLaneCount with copies of the last position, so kernels can run over whole
+// blocks without a scalar tail. Padding lanes duplicate a real vertex:
+// harmless for min/max and per-vertex outputs, but sums must skip them.
+class SoAPositions {
+ public:
+  static const size_t kAlignment = 32;
+  static const size_t kLaneCount = kAlignment / sizeof(float);
+
+  typedef std::vector<float, AlignedAllocator<float, kAlignment>> FloatArray;
+
+  SoAPositions() = default;
+  explicit SoAPositions(const std::vector<glm::vec3>& positions);
+
+  // Transposes positions into the three arrays (in parallel), reusing the
+  // existing allocations when they are large enough.
+  void Assign(const std::vector<glm::vec3>& positions);
+  // Transposes back; positions is resized to GetCount().
+  void CopyTo(std::vector<glm::vec3>& positions) const;
+
+  size_t GetCount() const { return count_; }
+  // GetCount() rounded up to a multiple of kLaneCount
+  size_t GetPaddedCount() const { return x_.size(); }
+  bool IsEmpty() const { return count_ == 0; }
+
+  glm::vec3 Get(size_t i) const { return glm::vec3(x_[i], y_[i], z_[i]); }
+  // Writing the last position doesn't update its padding copies.
+  void Set(size_t i, const glm::vec3& position) {
+    x_[i] = position.x;
+    y_[i] = position.y;
+    z_[i] = position.z;
+  }
+
+  const float* GetX() const { return x_.data(); }
+  const float* GetY() const { return y_.data(); }
+  const float* GetZ() const { return z_.data(); }
+  float* GetX() { return x_.data(); }
+  float* GetY() { return y_.data(); }
+  float* GetZ() { return z_.data(); }
+
+  // Axis-aligned bounds of all positions; both are zero when empty.
+  void ComputeBounds(glm::vec3& min_bounds, glm::vec3& max_bounds) const;
+
+ private:
+  FloatArray x_;
+  FloatArray y_;
+  FloatArray z_;
+  size_t count_ = 0;
+};
+
+}  // namespace GLOO
+
+#endif
@@ -0,0 +1,85 @@
+#include "SpatialHash.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace GLOO {
+namespace {
+const int kCoordinateBits = 21;
+const uint64_t kCoordinateMask = (uint64_t(1) << kCoordinateBits) - 1;
+// Cell coordinates are clamped to this so the float-to-int conversion
+// can't overflow
+const float kMaxCoordinate = 1e9f;
+}  // namespace
+
+void SpatialHash::Reset(float cell_size) {
+  inverse_cell_size_ = 1.0f / cell_size;
+  cells_.clear();
+}
+
+void SpatialHash::Insert(int id, const glm::vec3& position) {
+  cells_[PackCell(GetCell(position))].push_back(id);
+}
+
+void SpatialHash::Remove(int id, const glm::vec3& position) {
+  auto it = cells_.find(PackCell(GetCell(position)));
+  if (it == cells_.end()) {
+    return;
+  }
+  std::vector<int>& ids = it->second;
+  auto found = std::find(ids.begin(), ids.end(), id);
+  if (found != ids.end()) {
+    *found = ids.back();
+    ids.pop_back();
+  }
+  if (ids.empty()) {
+    cells_.erase(it);
+  }
+}
+
+void SpatialHash::Move(int id, const glm::vec3& from, const glm::vec3& to) {
+  if (GetCell(from) == GetCell(to)) {
+    return;
+  }
+  Remove(id, from);
+  Insert(id, to);
+}
+
+void SpatialHash::FindNear(const glm::vec3& position, float radius,
+                           const std::vector<glm::vec3>& positions,
+                           int exclude_id, std::vector<int>& ids) const {
+  const glm::ivec3 center = GetCell(position);
+  const float radius2 = radius * radius;
+  for (int dx = -1; dx <= 1; dx++) {
+    for (int dy = -1; dy <= 1; dy++) {
+      for (int dz = -1; dz <= 1; dz++) {
+        auto it = cells_.find(PackCell(center + glm::ivec3(dx, dy, dz)));
+        if (it == cells_.end()) continue;
+        for (int id : it->second) {
+          if (id == exclude_id) continue;
+          const glm::vec3 offset = positions[id] - position;
+          if (glm::dot(offset, offset) <= radius2) {
+            ids.push_back(id);
+          }
+        }
+      }
+    }
+  }
+}
+
+glm::ivec3 SpatialHash::GetCell(const glm::vec3& position) const {
+  glm::ivec3 cell;
+  for (int c = 0; c < 3; c++) {
+    const float coordinate = std::floor(position[c] * inverse_cell_size_);
+    cell[c] = static_cast<int>(
+        std::max(-kMaxCoordinate, std::min(kMaxCoordinate, coordinate)));
+  }
+  return cell;
+}
+
+uint64_t SpatialHash::PackCell(const glm::ivec3& cell) {
+  return ((uint64_t(cell.x) & kCoordinateMask) << (2 * kCoordinateBits)) |
+         ((uint64_t(cell.y) & kCoordinateMask) << kCoordinateBits) |
+         (uint64_t(cell.z) & kCoordinateMask);
+}
+
+}  // namespace GLOO
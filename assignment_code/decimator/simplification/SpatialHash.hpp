@@ -0,0 +1,44 @@
+#ifndef SPATIAL_HASH_H_
+#define SPATIAL_HASH_H_
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+#include <glm/glm.hpp>
+
+namespace GLOO {
+
+// Uniform grid of point ids for fixed-radius neighbor queries. Cells are
+// cubes of the query radius, so a query visits the 27 cells around its
+// point, and only non-empty cells are stored. Points are kept up to date
+// with Move as they change, so with a bounded number of points per cell
+// every update and query is O(1) expected.
+class SpatialHash {
+ public:
+  // Clears the grid; cell_size must be > 0
+  void Reset(float cell_size);
+
+  void Insert(int id, const glm::vec3& position);
+  // position must be where id was inserted (or last moved to)
+  void Remove(int id, const glm::vec3& position);
+  void Move(int id, const glm::vec3& from, const glm::vec3& to);
+
+  // Appends the ids other than exclude_id within radius (at most the cell
+  // size) of position; positions[id] must be where each id sits
+  void FindNear(const glm::vec3& position, float radius,
+                const std::vector<glm::vec3>& positions, int exclude_id,
+                std::vector<int>& ids) const;
+
+ private:
+  float inverse_cell_size_ = 1.0f;
+  std::unordered_map<uint64_t, std::vector<int>> cells_;
+
+  glm::ivec3 GetCell(const glm::vec3& position) const;
+  // Cell coordinates wrap at 2^21; the distance test of FindNear makes
+  // the aliased far cells harmless
+  static uint64_t PackCell(const glm::ivec3& cell);
+};
+
+}  // namespace GLOO
+
+#endif
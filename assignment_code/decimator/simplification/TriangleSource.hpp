@@ -0,0 +1,54 @@
+#ifndef TRIANGLE_SOURCE_H_
+#define TRIANGLE_SOURCE_H_
+
+#include <cstddef>
+#include <glm/glm.hpp>
+#include "SimplificationMesh.hpp"
+
+namespace GLOO {
+
+// Sequential reader of a mesh's triangles as corner positions, for
+// algorithms that stream meshes too large to hold in memory (see
+// MeshIO::OpenTriangleStream for the file-backed ones).
+class TriangleSource {
+ public:
+  virtual ~TriangleSource() {}
+
+  // Restarts at the first triangle; false if the source can't be read
+  virtual bool Rewind() = 0;
+  // Reads up to max_triangles triangles into corners (three positions
+  // each) and returns how many were read; 0 at the end or on a read error
+  virtual size_t Read(glm::vec3* corners, size_t max_triangles) = 0;
+  // Whether the source stopped early because of a read error
+  virtual bool HasFailed() const { return false; }
+};
+
+// Triangles of a mesh already in memory
+class MeshTriangleSource : public TriangleSource {
+ public:
+  explicit MeshTriangleSource(const SimplificationMesh& mesh) : mesh_(mesh) {}
+
+  bool Rewind() override {
+    next_face_ = 0;
+    return true;
+  }
+  size_t Read(glm::vec3* corners, size_t max_triangles) override {
+    size_t count = 0;
+    for (; count < max_triangles && next_face_ < mesh_.faces.size();
+         count++, next_face_++) {
+      const glm::uvec3& face = mesh_.faces[next_face_];
+      for (int k = 0; k < 3; k++) {
+        corners[3 * count + k] = mesh_.vertices[face[k]];
+      }
+    }
+    return count;
+  }
+
+ private:
+  const SimplificationMesh& mesh_;
+  size_t next_face_ = 0;
+};
+
+}  // namespace GLOO
+
+#endif
@@ -1,4 +1,6 @@
 #include "VertexClustering.hpp"
+#include "helpers.hpp"
+#include "Profiler.hpp"
 #include <algorithm>
 #include <cmath>
 
@@ -15,18 +17,87 @@ VertexClustering::~VertexClustering() {
 std::shared_ptr<SimplificationMesh> VertexClustering::Simplify(
     const SimplificationMesh& original_mesh, 
     int grid_resolution) {
+  return Cluster(original_mesh, grid_resolution, nullptr);
+}
+
+std::shared_ptr<SimplificationMesh> VertexClustering::Simplify(
+    const SimplificationMesh& original_mesh,
+    const SimplificationBudget& budget, SimplificationReport* report) {
+  // Enough cells for every vertex of a surface-like mesh to get its own
+  int max_resolution = std::max(
+      2, static_cast<int>(std::ceil(2.0 * std::sqrt(
+             static_cast<double>(original_mesh.vertices.size())))));
+
+  // Finest resolution that reaches a count target (1 if none is reachable)
+  int low = 1;
+  int high = max_resolution;
+  while (low < high) {
+    int mid = (low + high + 1) / 2;
+    auto mesh = Cluster(original_mesh, mid, nullptr);
+    if (budget.IsReached(static_cast<int>(mesh->vertices.size()),
+                         static_cast<int>(mesh->faces.size()))) {
+      low = mid;
+    } else {
+      high = mid - 1;
+    }
+  }
+  int resolution = low;
+
+  // Coarsest resolution within the error bound, if that is finer
+  float error = 0.0f;
+  auto result = Cluster(original_mesh, resolution, &error);
+  if (!budget.AllowsError(error)) {
+    low = resolution + 1;
+    high = max_resolution;
+    while (low < high) {
+      int mid = (low + high) / 2;
+      float mid_error = 0.0f;
+      Cluster(original_mesh, mid, &mid_error);
+      if (budget.AllowsError(mid_error)) {
+        high = mid;
+      } else {
+        low = mid + 1;
+      }
+    }
+    resolution = low;
+    result = Cluster(original_mesh, resolution, &error);
+  }
+
+  grid_resolution_ = resolution;
+  if (report != nullptr) {
+    report->vertex_count = result->vertices.size();
+    report->face_count = result->faces.size();
+    report->max_error = error;
+  }
+  return result;
+}
+
+std::shared_ptr<SimplificationMesh> VertexClustering::Cluster(
+    const SimplificationMesh& original_mesh, int grid_resolution,
+    float* max_error) {
   // Rossignac-Borrel vertex clustering algorithm
   // Strategy: Divide space into uniform grid, merge vertices within same cell
   
+  if (max_error != nullptr) {
+    *max_error = 0.0f;
+  }
   if (original_mesh.IsEmpty()) {
     return std::make_shared<SimplificationMesh>(original_mesh);
   }
   
   grid_resolution_ = grid_resolution;
+  has_locks_ = locked_vertices_.size() == original_mesh.vertices.size();
   
-  // 1. Compute bounding box
+  // 1. Compute bounding box. Positions are streamed twice (bounds, then
+  //    cells), so transpose them once into SoA form for both passes.
+  SoAPositions positions;
   glm::vec3 min_bounds, max_bounds;
-  glm::vec3 grid_size = ComputeBoundingBox(original_mesh, min_bounds, max_bounds);
+  glm::vec3 grid_size;
+  {
+    DECIMATOR_PROFILE_SCOPE("VertexClustering.BoundingBox");
+    positions.Assign(original_mesh.vertices);
+    grid_size = ComputeBoundingBox(positions, min_bounds, max_bounds);
+  }
   
   if (grid_size.x <= 0.0f || grid_size.y <= 0.0f || grid_size.z <= 0.0f) {
     return std::make_shared<SimplificationMesh>(original_mesh);
@@ -34,12 +105,26 @@ std::shared_ptr<SimplificationMesh> VertexClustering::Simplify(
   
   // 2. Assign vertices to grid cells
   std::unordered_map<glm::ivec3, GridCell, GridCell::Hash> grid;
-  AssignVerticesToCells(original_mesh, grid);
+  {
+    DECIMATOR_PROFILE_SCOPE("VertexClustering.AssignCells");
+    AssignVerticesToCells(positions, min_bounds, grid_size, grid);
+  }
+  DECIMATOR_COUNT("VertexClustering.cells", grid.size());
   
   // 3. Compute representative vertices for each cell
-  for (auto& pair : grid) {
-    GridCell& cell = pair.second;
-    cell.representative_pos = ComputeRepresentative(cell, original_mesh);
+  {
+    DECIMATOR_PROFILE_SCOPE("VertexClustering.Representatives");
+    for (auto& pair : grid) {
+      GridCell& cell = pair.second;
+      cell.representative_pos = ComputeRepresentative(cell, original_mesh);
+      if (max_error != nullptr) {
+        for (int vertex_idx : cell.vertex_indices) {
+          *max_error = std::max(
+              *max_error, glm::length(original_mesh.vertices[vertex_idx] -
+                                      cell.representative_pos));
+        }
+      }
+    }
   }
   
   // 4. Merge clusters and create new mesh
@@ -61,28 +146,22 @@ std::shared_ptr<SimplificationMesh> VertexClustering::SimplifyByFactor(
   return Simplify(original_mesh, estimated_resolution);
 }
 
+std::string VertexClustering::GetSettingsKey() const {
+  // Every Simplify overload sets the grid resolution itself
+  return "locked=" + GetFlagsKey(locked_vertices_);
+}
+
 glm::vec3 VertexClustering::ComputeBoundingBox(
-    const SimplificationMesh& mesh, 
+    const SoAPositions& positions,
     glm::vec3& min_bounds, 
     glm::vec3& max_bounds) const {
   // Compute axis-aligned bounding box of all vertices
-  if (mesh.vertices.empty()) {
+  if (positions.IsEmpty()) {
     min_bounds = max_bounds = glm::vec3(0.0f);
     return glm::vec3(0.0f);
   }
   
-  min_bounds = max_bounds = mesh.vertices[0];
-  
-  // Find min/max for each axis
-  for (const auto& vertex : mesh.vertices) {
-    min_bounds.x = std::min(min_bounds.x, vertex.x);
-    min_bounds.y = std::min(min_bounds.y, vertex.y);
-    min_bounds.z = std::min(min_bounds.z, vertex.z);
-    
-    max_bounds.x = std::max(max_bounds.x, vertex.x);
-    max_bounds.y = std::max(max_bounds.y, vertex.y);
-    max_bounds.z = std::max(max_bounds.z, vertex.z);
-  }
+  positions.ComputeBounds(min_bounds, max_bounds);
   
   // Add small epsilon to avoid division by zero
   glm::vec3 size = max_bounds - min_bounds;
@@ -94,42 +173,60 @@ glm::vec3 VertexClustering::ComputeBoundingBox(
   return size;
 }
 
-glm::ivec3 VertexClustering::GetGridCell(
-    const glm::vec3& position, 
-    const glm::vec3& min_bounds, 
-    const glm::vec3& grid_size) const {
-  // Compute which grid cell a vertex belongs to
-  // Normalize position to [0, 1] range within bounding box
-  glm::vec3 normalized = (position - min_bounds) / grid_size;
-  
-  // Clamp to [0, 1] to handle floating point errors
-  normalized.x = std::max(0.0f, std::min(1.0f, normalized.x));
-  normalized.y = std::max(0.0f, std::min(1.0f, normalized.y));
-  normalized.z = std::max(0.0f, std::min(1.0f, normalized.z));
-  
-  // Convert to grid coordinates [0, grid_resolution_-1]
-  int cell_x = static_cast<int>(normalized.x * grid_resolution_);
-  int cell_y = static_cast<int>(normalized.y * grid_resolution_);
-  int cell_z = static_cast<int>(normalized.z * grid_resolution_);
-  
-  // Clamp to valid grid range (handle edge case where normalized = 1.0)
-  cell_x = std::min(cell_x, grid_resolution_ - 1);
-  cell_y = std::min(cell_y, grid_resolution_ - 1);
-  cell_z = std::min(cell_z, grid_resolution_ - 1);
-  
-  return glm::ivec3(cell_x, cell_y, cell_z);
+void VertexClustering::ComputeGridCells(
+    const SoAPositions& positions,
+    const glm::vec3& min_bounds,
+    const glm::vec3& grid_size,
+    std::vector<glm::ivec3>& cells) const {
+  // Compute which grid cell each vertex belongs to, one coordinate array at
+  // a time so the inner loop is a straight vectorizable stream
+  const float* axes[3] = {positions.GetX(), positions.GetY(), positions.GetZ()};
+  const size_t count = positions.GetCount();
+  const size_t lane_count = SoAPositions::kLaneCount;
+  const int max_cell = grid_resolution_ - 1;
+  cells.resize(count);
+  ParallelChunks(positions.GetPaddedCount() / lane_count,
+                 [&](size_t, size_t begin, size_t end) {
+    int cell[SoAPositions::kLaneCount];
+    for (int axis = 0; axis < 3; axis++) {
+      const float* values = axes[axis];
+      const float lower = min_bounds[axis];
+      const float size = grid_size[axis];
+      for (size_t b = begin; b < end; b++) {
+        const size_t first = b * lane_count;
+        const size_t lanes = std::min(lane_count, count - first);
+        for (size_t lane = 0; lane < lane_count; lane++) {
+          // Normalize position to [0, 1] range within bounding box, clamped
+          // to handle floating point errors
+          float normalized = (values[first + lane] - lower) / size;
+          normalized = std::max(0.0f, std::min(1.0f, normalized));
+          // Convert to grid coordinates [0, grid_resolution_-1] (the clamp
+          // handles normalized = 1.0)
+          cell[lane] = std::min(
+              static_cast<int>(normalized * grid_resolution_), max_cell);
+        }
+        for (size_t lane = 0; lane < lanes; lane++) {
+          cells[first + lane][axis] = cell[lane];
+        }
+      }
+    }
+  });
 }
 
 void VertexClustering::AssignVerticesToCells(
-    const SimplificationMesh& mesh, 
+    const SoAPositions& positions,
+    const glm::vec3& min_bounds,
+    const glm::vec3& grid_size,
     std::unordered_map<glm::ivec3, GridCell, GridCell::Hash>& grid) {
-  // Compute bounding box first
-  glm::vec3 min_bounds, max_bounds;
-  glm::vec3 grid_size = ComputeBoundingBox(mesh, min_bounds, max_bounds);
+  std::vector<glm::ivec3> cells;
+  ComputeGridCells(positions, min_bounds, grid_size, cells);
   
   // Assign each vertex to its corresponding grid cell
-  for (size_t i = 0; i < mesh.vertices.size(); i++) {
-    glm::ivec3 cell_coords = GetGridCell(mesh.vertices[i], min_bounds, grid_size);
+  for (size_t i = 0; i < cells.size(); i++) {
+    if (has_locks_ && locked_vertices_[i]) {
+      continue;  // Kept as is by MergeClusters
+    }
+    const glm::ivec3& cell_coords = cells[i];
     
     // Get or create the grid cell
     auto it = grid.find(cell_coords);
@@ -167,6 +264,7 @@ void VertexClustering::MergeClusters(
     const SimplificationMesh& original_mesh, 
     const std::unordered_map<glm::ivec3, GridCell, GridCell::Hash>& grid,
     SimplificationMesh& result) {
+  DECIMATOR_PROFILE_SCOPE("VertexClustering.MergeClusters");
   
   result.Clear();
   
@@ -175,6 +273,16 @@ void VertexClustering::MergeClusters(
   std::unordered_map<glm::ivec3, int, GridCell::Hash> cell_to_new_index;
   
   int new_vertex_index = 0;
+
+  // Locked vertices first, in order
+  if (has_locks_) {
+    for (size_t i = 0; i < original_mesh.vertices.size(); i++) {
+      if (locked_vertices_[i]) {
+        result.vertices.push_back(original_mesh.vertices[i]);
+        vertex_to_representative[i] = new_vertex_index++;
+      }
+    }
+  }
   
   // For each grid cell, create one new vertex (the representative)
   for (const auto& pair : grid) {
@@ -194,30 +302,28 @@ void VertexClustering::MergeClusters(
     new_vertex_index++;
   }
   
-  // 2. Remap face indices and remove degenerate faces
-  for (const auto& face : original_mesh.faces) {
-    // Get new indices for this face's vertices
-    int new_idx0 = vertex_to_representative[face.x];
-    int new_idx1 = vertex_to_representative[face.y];
-    int new_idx2 = vertex_to_representative[face.z];
-    
-    // Skip if any vertex wasn't mapped (shouldn't happen, but safety check)
-    if (new_idx0 < 0 || new_idx1 < 0 || new_idx2 < 0) {
-      continue;
-    }
-    
-    // Skip degenerate faces (where all three vertices map to same representative)
-    if (new_idx0 == new_idx1 && new_idx1 == new_idx2) {
-      continue;
+  // 2. Remap face indices in parallel, then compact away the faces that
+  //    collapsed to a single representative (or weren't mapped at all,
+  //    which shouldn't happen, but is a cheap safety check)
+  std::vector<glm::uvec3> remapped(original_mesh.faces.size());
+  ParallelFor(original_mesh.faces.size(), [&](size_t i) {
+    const glm::uvec3& face = original_mesh.faces[i];
+    remapped[i] = glm::uvec3(
+        static_cast<unsigned int>(vertex_to_representative[face.x]),
+        static_cast<unsigned int>(vertex_to_representative[face.y]),
+        static_cast<unsigned int>(vertex_to_representative[face.z]));
+  });
+  
+  const unsigned int unmapped = static_cast<unsigned int>(-1);
+  CompactIf(remapped, result.faces, [&](size_t i) {
+    const glm::uvec3& face = remapped[i];
+    if (face.x == unmapped || face.y == unmapped || face.z == unmapped) {
+      return false;
     }
-    
-    // Add face with remapped indices
-    result.faces.push_back(glm::uvec3(
-        static_cast<unsigned int>(new_idx0),
-        static_cast<unsigned int>(new_idx1),
-        static_cast<unsigned int>(new_idx2)
-    ));
-  }
+    return !(face.x == face.y && face.y == face.z);
+  });
+  DECIMATOR_COUNT("VertexClustering.faces_dropped",
+                  original_mesh.faces.size() - result.faces.size());
   
   // 3. Compute normals for the simplified mesh
   result.ComputeNormals();
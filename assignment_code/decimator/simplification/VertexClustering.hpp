@@ -2,10 +2,13 @@
 #define VERTEX_CLUSTERING_H_
 
 #include <memory>
+#include <string>
 #include <vector>
 #include <unordered_map>
 #include <glm/glm.hpp>
 #include "SimplificationMesh.hpp"
+#include "SimplificationBudget.hpp"
+#include "SoAPositions.hpp"
 
 namespace GLOO {
 
@@ -24,11 +27,34 @@ class VertexClustering {
   std::shared_ptr<SimplificationMesh> SimplifyByFactor(const SimplificationMesh& original_mesh, 
                                                float reduction_factor);
 
+  // Picks the grid resolution for the budget: the finest grid that reaches
+  // a count target, refined further if needed until every vertex is within
+  // budget.max_error of its cluster representative. Binary searches the
+  // resolution, so it assumes counts and error change monotonically with it
+  // (true up to grid alignment effects).
+  std::shared_ptr<SimplificationMesh> Simplify(
+      const SimplificationMesh& original_mesh,
+      const SimplificationBudget& budget,
+      SimplificationReport* report = nullptr);
+
   // Set grid resolution explicitly
   void SetGridResolution(int resolution) { grid_resolution_ = resolution; }
 
+  // Vertices flagged nonzero keep their own cluster at their own position.
+  // They come first in the result, in their original order. Ignored unless
+  // there is one flag per mesh vertex.
+  void SetLockedVertices(std::vector<uint8_t> locked) {
+    locked_vertices_ = std::move(locked);
+  }
+
+  // Every setting above as text, for result cache keys
+  // (SimplificationCache::MakeKey)
+  std::string GetSettingsKey() const;
+
  private:
   int grid_resolution_ = 16;  // Default grid resolution
+  std::vector<uint8_t> locked_vertices_;
+  bool has_locks_ = false;  // locked_vertices_ matches the mesh being clustered
 
   struct GridCell {
     glm::ivec3 cell_coords;
@@ -46,13 +72,23 @@ class VertexClustering {
     };
   };
 
-  glm::vec3 ComputeBoundingBox(const SimplificationMesh& mesh, 
+  // Simplify at one resolution; optionally reports the largest distance of
+  // a vertex from its cluster representative
+  std::shared_ptr<SimplificationMesh> Cluster(
+      const SimplificationMesh& original_mesh, int grid_resolution,
+      float* max_error);
+  glm::vec3 ComputeBoundingBox(const SoAPositions& positions,
                                 glm::vec3& min_bounds, 
                                 glm::vec3& max_bounds) const;
-  glm::ivec3 GetGridCell(const glm::vec3& position, 
-                          const glm::vec3& min_bounds, 
-                          const glm::vec3& grid_size) const;
-  void AssignVerticesToCells(const SimplificationMesh& mesh, 
+  // Cell of every position (a block-wise loop over the SoA arrays, so it
+  // vectorizes)
+  void ComputeGridCells(const SoAPositions& positions,
+                        const glm::vec3& min_bounds,
+                        const glm::vec3& grid_size,
+                        std::vector<glm::ivec3>& cells) const;
+  void AssignVerticesToCells(const SoAPositions& positions,
+                              const glm::vec3& min_bounds,
+                              const glm::vec3& grid_size,
                               std::unordered_map<glm::ivec3, GridCell, 
                                                  GridCell::Hash>& grid);
   glm::vec3 ComputeRepresentative(const GridCell& cell, 
@@ -1,9 +1,14 @@
 #include "VertexDecimation.hpp"
+#include "GeometryKernels.hpp"
+#include "OneRing.hpp"
+#include "helpers.hpp"
+#include "Profiler.hpp"
 #include <algorithm>
 #include <cmath>
-#include <map>
-#include <set>
+#include <cstring>
+#include <iomanip>
 #include <limits>
+#include <sstream>
 
 namespace GLOO {
 
@@ -18,61 +23,221 @@ VertexDecimation::~VertexDecimation() {
 std::shared_ptr<SimplificationMesh> VertexDecimation::Simplify(
     const SimplificationMesh& original_mesh, 
     int target_vertex_count) {
-  // Implement Schroeder-Zarge-Lorensen vertex decimation
-  // 1. Classify vertices (feature, boundary, interior)
-  // 2. Compute distance error for each vertex
-  // 3. Sort vertices by suitability for removal
-  // 4. Iteratively remove vertices and retriangulate
-  // 5. Continue until target vertex count is reached
+  return Simplify(original_mesh,
+                  SimplificationBudget::Vertices(target_vertex_count));
+}
 
+std::shared_ptr<SimplificationMesh> VertexDecimation::Simplify(
+    const SimplificationMesh& original_mesh,
+    const SimplificationBudget& budget, SimplificationReport* report) {
   // Work on a copy since we'll be modifying the mesh
   auto result = std::make_shared<SimplificationMesh>(original_mesh);
-  
-  // Continue until we reach target vertex count
-  while (static_cast<int>(result->vertices.size()) > target_vertex_count) {
-    // Classify all vertices
-    std::vector<VertexInfo> vertex_info;
-    ClassifyVertices(*result, vertex_info);
-    
-    // Sort by distance error (lowest error = easiest to remove)
-    std::sort(vertex_info.begin(), vertex_info.end(), 
-              [](const VertexInfo& a, const VertexInfo& b) {
-                return a.distance_error < b.distance_error;
-              });
-    
-    // Try to remove vertices starting with lowest error
-    bool removed_any = false;
-    for (const auto& info : vertex_info) {
-      if (static_cast<int>(result->vertices.size()) <= target_vertex_count) {
-        break;
-      }
-      
-      if (CanRemoveVertex(*result, info)) {
-        std::vector<int> boundary_vertices = CollectBoundaryVertices(*result, info.index);
-        
-        RemoveVertex(*result, info.index);
-        // Update boundary vertex indices after removal
-        for (int& v : boundary_vertices) {
-          if (v > info.index) {
-            v--;
-          }
-        }
-        
-        if (boundary_vertices.size() >= 3) {
-          RetriangulateHole(*result, boundary_vertices);
-        }
-        
-        removed_any = true;
-        break;
-      }
+  SimplifyInPlace(*result, budget, report);
+  return result;
+}
+
+std::shared_ptr<SimplificationMesh> VertexDecimation::Simplify(
+    SimplificationMesh&& mesh, int target_vertex_count) {
+  return Simplify(std::move(mesh),
+                  SimplificationBudget::Vertices(target_vertex_count));
+}
+
+std::shared_ptr<SimplificationMesh> VertexDecimation::Simplify(
+    SimplificationMesh&& mesh, const SimplificationBudget& budget,
+    SimplificationReport* report) {
+  auto result = std::make_shared<SimplificationMesh>(std::move(mesh));
+  SimplifyInPlace(*result, budget, report);
+  return result;
+}
+
+void VertexDecimation::SimplifyInPlace(SimplificationMesh& mesh,
+                                       const SimplificationBudget& budget,
+                                       SimplificationReport* report) {
+  float max_error = 0.0f;
+  if (!mesh.IsEmpty() &&
+      !budget.IsReached(static_cast<int>(mesh.vertices.size()),
+                        static_cast<int>(mesh.faces.size()))) {
+    DecimationRun run;
+    BeginRemovals(mesh, run);
+    ContinueRemovals(mesh, run, budget);
+    UpdateNormals(mesh);
+    mesh.RemoveFlagged(vertex_removed_, face_removed_);
+    max_error = run.max_error;
+  }
+  if (report != nullptr) {
+    report->vertex_count = mesh.vertices.size();
+    report->face_count = mesh.faces.size();
+    report->max_error = max_error;
+  }
+}
+
+std::unique_ptr<VertexDecimation::Session> VertexDecimation::BeginSession(
+    const SimplificationMesh& original_mesh, int target_vertex_count) const {
+  return BeginSession(original_mesh,
+                      SimplificationBudget::Vertices(target_vertex_count));
+}
+
+std::unique_ptr<VertexDecimation::Session> VertexDecimation::BeginSession(
+    const SimplificationMesh& original_mesh,
+    const SimplificationBudget& budget) const {
+  return std::unique_ptr<Session>(new Session(*this, original_mesh, budget));
+}
+
+std::unique_ptr<VertexDecimation::Session> VertexDecimation::BeginSession(
+    SimplificationMesh&& mesh, const SimplificationBudget& budget) const {
+  return std::unique_ptr<Session>(
+      new Session(*this, std::move(mesh), budget));
+}
+
+VertexDecimation::Session::Session(const VertexDecimation& simplifier,
+                                   SimplificationMesh mesh,
+                                   const SimplificationBudget& budget)
+    : simplifier_(simplifier), mesh_(std::move(mesh)), budget_(budget) {
+  run_.vertex_count = static_cast<int>(mesh_.vertices.size());
+  run_.face_count = static_cast<int>(mesh_.faces.size());
+  run_.max_error = 0.0f;
+  done_ = mesh_.IsEmpty() ||
+          budget_.IsReached(run_.vertex_count, run_.face_count);
+}
+
+bool VertexDecimation::Session::Step(
+    std::chrono::steady_clock::time_point deadline) {
+  if (done_) {
+    return true;
+  }
+  DECIMATOR_PROFILE_SCOPE("VertexDecimation.SessionStep");
+  if (!started_) {
+    simplifier_.BeginRemovals(mesh_, run_);
+    started_ = true;
+  }
+  done_ = simplifier_.ContinueRemovals(mesh_, run_, budget_, deadline);
+  simplifier_.UpdateNormals(mesh_);
+  return done_;
+}
+
+int VertexDecimation::Session::GetVertexCount() const {
+  return run_.vertex_count;
+}
+
+float VertexDecimation::Session::GetMaxError() const {
+  return run_.max_error;
+}
+
+std::shared_ptr<SimplificationMesh> VertexDecimation::Session::GetResult()
+    const {
+  auto result = std::make_shared<SimplificationMesh>(mesh_);
+  if (started_) {
+    result->RemoveFlagged(simplifier_.vertex_removed_,
+                          simplifier_.face_removed_);
+  }
+  return result;
+}
+
+void VertexDecimation::BeginRemovals(const SimplificationMesh& mesh,
+                                     DecimationRun& run) {
+  BuildAdjacency(mesh);
+  run.vertex_count = static_cast<int>(mesh.vertices.size());
+  run.face_count = static_cast<int>(mesh.faces.size());
+  run.max_error = 0.0f;
+
+  std::vector<VertexInfo> vertex_info;
+  ClassifyVertices(mesh, vertex_info);
+  switch (queue_backend_) {
+    case QueueBackend::DARY_HEAP:
+      run.dary_queue.Assign(std::move(vertex_info));
+      break;
+    case QueueBackend::RADIX_HEAP:
+      run.radix_queue.Assign(std::move(vertex_info));
+      break;
+    default:
+      run.binary_queue.Assign(std::move(vertex_info));
+      break;
+  }
+}
+
+bool VertexDecimation::ContinueRemovals(
+    SimplificationMesh& mesh, DecimationRun& run,
+    const SimplificationBudget& budget,
+    std::chrono::steady_clock::time_point deadline) {
+  switch (queue_backend_) {
+    case QueueBackend::DARY_HEAP:
+      return RunRemovalLoop(mesh, run, run.dary_queue, budget, deadline);
+    case QueueBackend::RADIX_HEAP:
+      return RunRemovalLoop(mesh, run, run.radix_queue, budget, deadline);
+    default:
+      return RunRemovalLoop(mesh, run, run.binary_queue, budget, deadline);
+  }
+}
+
+template <class Queue>
+bool VertexDecimation::RunRemovalLoop(
+    SimplificationMesh& mesh, DecimationRun& run, Queue& queue,
+    const SimplificationBudget& budget,
+    std::chrono::steady_clock::time_point deadline) {
+  DECIMATOR_PROFILE_SCOPE("VertexDecimation.RemovalLoop");
+  const bool has_deadline =
+      deadline != std::chrono::steady_clock::time_point::max();
+  size_t pops = 0;
+  VertexList ring;  // Of the candidate, reused across removals
+  bool closed = false;
+  FanErrors fan_errors;
+  // Lowest bound first; a candidate that can't be removed stays out of the
+  // queue until one of its neighbors is removed
+  while (!budget.IsReached(run.vertex_count, run.face_count) &&
+         !queue.Empty()) {
+    if (has_deadline && (++pops & 15) == 0 &&
+        std::chrono::steady_clock::now() >= deadline) {
+      return false;
+    }
+    VertexInfo info = queue.Top();
+    queue.Pop();
+    if (vertex_removed_[info.index] ||
+        vertex_version_[info.index] != info.version) {
+      continue;
     }
-    
-    if (!removed_any) {
+    if (!budget.AllowsError(info.distance_error)) {
+      // Every remaining candidate has at least this error
       break;
     }
+    size_t anchor = 0;
+    float error = 0.0f;
+    if (!CanRemoveVertex(mesh, info, ring, closed, anchor, fan_errors,
+                         error)) {
+      continue;
+    }
+
+    const int removed_faces = static_cast<int>(vertex_faces_[info.index].size());
+    const size_t face_total = mesh.faces.size();
+    RemoveVertex(mesh, info.index);
+    run.vertex_count--;
+    DECIMATOR_COUNT("VertexDecimation.vertices_removed", 1);
+
+    RetriangulateHole(mesh, ring, closed, anchor, fan_errors);
+    run.face_count += static_cast<int>(mesh.faces.size() - face_total) -
+                      removed_faces;
+    run.max_error = std::max(run.max_error, error);
+
+    // The one-ring changed, so the neighbors' classification and normals
+    // did too
+    for (int v : ring) {
+      vertex_version_[v]++;
+      queue.Push(ClassifyVertex(mesh, v));
+      if (updates_normals_) {
+        normal_dirty_[v] = 1;
+      }
+    }
   }
-  
-  return result;
+  return true;
+}
+
+uint64_t VertexDecimation::VertexInfo::GetOrderKey() const {
+  // Non-negative floats order like their bit patterns; -0 maps to 0
+  uint32_t error_bits = 0;
+  if (distance_error > 0.0f) {
+    std::memcpy(&error_bits, &distance_error, sizeof(error_bits));
+  }
+  return static_cast<uint64_t>(error_bits) << 32 |
+         static_cast<uint32_t>(index);
 }
 
 std::shared_ptr<SimplificationMesh> VertexDecimation::SimplifyByFactor(
@@ -83,42 +248,44 @@ std::shared_ptr<SimplificationMesh> VertexDecimation::SimplifyByFactor(
   return Simplify(original_mesh, target_count);
 }
 
+std::string VertexDecimation::GetSettingsKey() const {
+  std::ostringstream key;
+  key << std::setprecision(9) << "feature=" << feature_angle_
+      << " aspect=" << aspect_ratio_ << " distance=" << max_distance_
+      << " queue=" << static_cast<int>(queue_backend_)
+      << " locked=" << GetFlagsKey(locked_vertices_);
+  return key.str();
+}
+
 bool VertexDecimation::IsFeatureVertex(const SimplificationMesh& mesh, 
                                         int vertex_index) const {
+  DECIMATOR_COUNT("VertexDecimation.faces_scanned",
+                  vertex_faces_[vertex_index].size());
   // For this vertex, check if any pair of adjacent faces have a dihedral angle > feature_angle_
   // 1. For each face adjacent to vertex_index, get its face normal
   // 2. For each pair of adjacent faces that share an edge at the vertex,
   //    compute the dihedral angle between their normals.
   // 3. If the angle > feature_angle_, classify as a feature vertex.
 
-  // Find all faces adjacent to this vertex
-  std::vector<int> adjacent_faces;
-  for (size_t i = 0; i < mesh.faces.size(); ++i) {
-    const auto& face = mesh.faces[i];
-    if (face.x == vertex_index || face.y == vertex_index || face.z == vertex_index) {
-      adjacent_faces.push_back(static_cast<int>(i));
-    }
-  }
-
+  const std::vector<int>& adjacent_faces = vertex_faces_[vertex_index];
   if (adjacent_faces.size() < 2) {
     return false;
   }
 
-  // Compute normals for all adjacent faces
-  std::vector<glm::vec3> normals(adjacent_faces.size());
-  for (size_t i = 0; i < adjacent_faces.size(); ++i) {
-    const auto& face = mesh.faces[adjacent_faces[i]];
-    const glm::vec3& v0 = mesh.vertices[face.x];
-    const glm::vec3& v1 = mesh.vertices[face.y];
-    const glm::vec3& v2 = mesh.vertices[face.z];
-    normals[i] = glm::normalize(glm::cross(v1 - v0, v2 - v0));
-  }
-
-  // Check dihedral angle between each pair of adjacent faces
+  // Check dihedral angle between each pair of adjacent faces. Degenerate
+  // faces have no orientation (zero normal) and are skipped.
   float cos_thresh = std::cos(glm::radians(feature_angle_));
-  for (size_t i = 0; i < normals.size(); ++i) {
-    for (size_t j = i + 1; j < normals.size(); ++j) {
-      float cosine = glm::dot(normals[i], normals[j]);
+  for (size_t i = 0; i < adjacent_faces.size(); ++i) {
+    const glm::vec3& normal_i = face_normals_[adjacent_faces[i]];
+    if (normal_i == glm::vec3(0.0f)) {
+      continue;
+    }
+    for (size_t j = i + 1; j < adjacent_faces.size(); ++j) {
+      const glm::vec3& normal_j = face_normals_[adjacent_faces[j]];
+      if (normal_j == glm::vec3(0.0f)) {
+        continue;
+      }
+      float cosine = glm::dot(normal_i, normal_j);
       // Clamp for numerical stability
       cosine = std::max(-1.0f, std::min(1.0f, cosine));
       if (cosine < cos_thresh) {
@@ -131,80 +298,127 @@ bool VertexDecimation::IsFeatureVertex(const SimplificationMesh& mesh,
 
 bool VertexDecimation::IsBoundaryVertex(const SimplificationMesh& mesh, 
                                          int vertex_index) const {
+  DECIMATOR_COUNT("VertexDecimation.faces_scanned",
+                  vertex_faces_[vertex_index].size());
   
-  std::map<std::pair<int, int>, int> edge_face_count;
-  
-  for (size_t i = 0; i < mesh.faces.size(); ++i) {
+  // The other endpoint of every face edge at the vertex; an edge used by
+  // one face only shows up once after sorting
+  VertexList neighbors;
+  for (int i : vertex_faces_[vertex_index]) {
     const auto& face = mesh.faces[i];
-    
-    // Check each edge of the face
-    auto check_edge = [&](int v1, int v2) {
-      if (v1 == vertex_index || v2 == vertex_index) {
-        // Ensure consistent ordering (smaller index first)
-        int e1 = std::min(v1, v2);
-        int e2 = std::max(v1, v2);
-        edge_face_count[{e1, e2}]++;
+    for (int c = 0; c < 3; c++) {
+      const int v1 = face[c];
+      const int v2 = face[(c + 1) % 3];
+      if (v1 == vertex_index) {
+        neighbors.Add(v2);
+      } else if (v2 == vertex_index) {
+        neighbors.Add(v1);
       }
-    };
-    
-    check_edge(face.x, face.y);
-    check_edge(face.y, face.z);
-    check_edge(face.z, face.x);
+    }
   }
+  neighbors.Sort();
   
-  for (const auto& pair : edge_face_count) {
-    if (pair.second == 1) {
+  for (size_t i = 0; i < neighbors.Size();) {
+    size_t run = i + 1;
+    while (run < neighbors.Size() && neighbors[run] == neighbors[i]) {
+      run++;
+    }
+    if (run - i == 1) {
       return true;
     }
+    i = run;
   }
   
   return false;
 }
 
-float VertexDecimation::ComputeDistanceError(const SimplificationMesh& mesh, 
-                                              int vertex_index) const {
-  // 1. Find all adjacent faces
-  // 2. Compute average plane
-  // 3. Compute distance from vertex to plane
-  std::vector<int> adjacent_faces;
-  for (size_t i = 0; i < mesh.faces.size(); ++i) {
-    const auto& face = mesh.faces[i];
-    if (face.x == vertex_index || face.y == vertex_index || face.z == vertex_index) {
-      adjacent_faces.push_back(static_cast<int>(i));
-    }
+float VertexDecimation::ComputeInheritedError(int vertex_index) const {
+  float error = 0.0f;
+  for (int f : vertex_faces_[vertex_index]) {
+    error = std::max(error, face_errors_[f]);
   }
+  return error;
+}
 
-  if (adjacent_faces.empty()) {
-    return 0.0f;
+bool VertexDecimation::PlanFan(const SimplificationMesh& mesh,
+                               int vertex_index, VertexList& ring,
+                               bool& closed, size_t& anchor) const {
+  DECIMATOR_COUNT("VertexDecimation.faces_scanned",
+                  vertex_faces_[vertex_index].size());
+  if (!GatherOrderedRing(mesh, vertex_faces_[vertex_index], face_removed_,
+                         vertex_index, ring, closed) ||
+      ring.Size() < 3) {
+    return false;
   }
-
-  // Compute average normal of adjacent faces
-  glm::vec3 average_normal = glm::vec3(0.0f);
-  for (size_t i = 0; i < adjacent_faces.size(); ++i) {
-    const auto& face = mesh.faces[adjacent_faces[i]];
-    const glm::vec3& v0 = mesh.vertices[face.x];
-    const glm::vec3& v1 = mesh.vertices[face.y];
-    const glm::vec3& v2 = mesh.vertices[face.z];
-    average_normal += glm::normalize(glm::cross(v1 - v0, v2 - v0));
-  }
-  average_normal = glm::normalize(average_normal);
-
-  // Find a point on the plane (use a neighbor vertex from the first adjacent face)
-  // Get a vertex from the first face that's not the current vertex
-  const auto& first_face = mesh.faces[adjacent_faces[0]];
-  int point_on_plane_idx = first_face.x;
-  if (point_on_plane_idx == vertex_index) {
-    point_on_plane_idx = first_face.y;
-    if (point_on_plane_idx == vertex_index) {
-      point_on_plane_idx = first_face.z;
+  // The hole is fanned from the ring vertex nearest to the removed one
+  // (an end of the ring on the border, where the fan must not span the
+  // border edge)
+  const glm::vec3& position = mesh.vertices[vertex_index];
+  anchor = 0;
+  if (closed) {
+    float nearest = std::numeric_limits<float>::max();
+    for (size_t i = 0; i < ring.Size(); i++) {
+      const glm::vec3 offset = mesh.vertices[ring[i]] - position;
+      const float distance2 = glm::dot(offset, offset);
+      if (distance2 < nearest) {
+        nearest = distance2;
+        anchor = i;
+      }
+    }
+  } else {
+    const glm::vec3 first = mesh.vertices[ring[0]] - position;
+    const glm::vec3 last = mesh.vertices[ring[ring.Size() - 1]] - position;
+    if (glm::dot(last, last) < glm::dot(first, first)) {
+      anchor = ring.Size() - 1;
     }
   }
-  const glm::vec3& point_on_plane = mesh.vertices[point_on_plane_idx];
+  return true;
+}
 
-  // Compute distance from vertex to plane
-  // |dot(normal, (vertex - point_on_plane))|
-  const glm::vec3& v = mesh.vertices[vertex_index];
-  return std::abs(glm::dot(average_normal, v - point_on_plane));
+float VertexDecimation::ComputeFanErrors(const SimplificationMesh& mesh,
+                                         int vertex_index,
+                                         const VertexList& ring, bool closed,
+                                         size_t anchor,
+                                         FanErrors* errors) const {
+  const size_t n = ring.Size();
+  const size_t pairs = closed ? n : n - 1;
+  const glm::vec3& position = mesh.vertices[vertex_index];
+  const glm::vec3& center = mesh.vertices[ring[anchor]];
+  // Where the vertex lies over a crease of the fan (or outside the new
+  // border edge), it projects onto no fan face and the face planes pass
+  // closer than the fan does, so no bound is below its distance to the fan
+  float fan_distance = std::numeric_limits<float>::max();
+  for (size_t i = 0; i < pairs; i++) {
+    const size_t j = (i + 1) % n;
+    if (i == anchor || j == anchor) continue;
+    fan_distance = std::min(
+        fan_distance,
+        PointTriangleDistance(position, center, mesh.vertices[ring[i]],
+                              mesh.vertices[ring[j]]));
+  }
+  const float inherited = ComputeInheritedError(vertex_index);
+  if (errors != nullptr) {
+    errors->Clear();
+  }
+  float largest = 0.0f;
+  for (size_t i = 0; i < pairs; i++) {
+    const size_t j = (i + 1) % n;
+    if (i == anchor || j == anchor) continue;
+    const glm::vec3 normal =
+        glm::cross(mesh.vertices[ring[i]] - center,
+                   mesh.vertices[ring[j]] - center);
+    const float length = glm::length(normal);
+    // A degenerate fan face has no plane; CausesFoldOver rejects it
+    const float plane_distance =
+        length > 0.0f ? std::abs(glm::dot(normal, position - center)) / length
+                      : fan_distance;
+    const float error = std::max(plane_distance, fan_distance) + inherited;
+    if (errors != nullptr) {
+      errors->Add(error);
+    }
+    largest = std::max(largest, error);
+  }
+  return largest;
 }
 
 float VertexDecimation::ComputeTriangleAspectRatio(
@@ -225,34 +439,17 @@ float VertexDecimation::ComputeTriangleAspectRatio(
 }
 
 bool VertexDecimation::CheckResultingTrianglesAspectRatio(
-    const SimplificationMesh& mesh, int vertex_index) const {
-  // Find all neighbor vertices
-  std::set<int> neighbor_vertices;
-  
-  for (const auto& face : mesh.faces) {
-    if (face.x == vertex_index) {
-      neighbor_vertices.insert(face.y);
-      neighbor_vertices.insert(face.z);
-    } else if (face.y == vertex_index) {
-      neighbor_vertices.insert(face.x);
-      neighbor_vertices.insert(face.z);
-    } else if (face.z == vertex_index) {
-      neighbor_vertices.insert(face.x);
-      neighbor_vertices.insert(face.y);
-    }
-  }
-  
-  if (neighbor_vertices.size() < 3) {
-    return false;
-  }
-  
-  // Convert set to vector for easier iteration
-  std::vector<int> neighbors(neighbor_vertices.begin(), neighbor_vertices.end());
-  for (size_t i = 1; i + 1 < neighbors.size(); ++i) {
-    const glm::vec3& v0 = mesh.vertices[neighbors[0]];
-    const glm::vec3& v1 = mesh.vertices[neighbors[i]];
-    const glm::vec3& v2 = mesh.vertices[neighbors[i + 1]];
-    
+    const SimplificationMesh& mesh, const VertexList& ring, bool closed,
+    size_t anchor) const {
+  const size_t n = ring.Size();
+  const size_t pairs = closed ? n : n - 1;
+  const glm::vec3& v0 = mesh.vertices[ring[anchor]];
+  for (size_t i = 0; i < pairs; ++i) {
+    const size_t j = (i + 1) % n;
+    if (i == anchor || j == anchor) continue;
+    const glm::vec3& v1 = mesh.vertices[ring[i]];
+    const glm::vec3& v2 = mesh.vertices[ring[j]];
+
     float aspect_ratio = ComputeTriangleAspectRatio(v0, v1, v2);
     if (aspect_ratio > aspect_ratio_) {
       return false;
@@ -262,103 +459,255 @@ bool VertexDecimation::CheckResultingTrianglesAspectRatio(
   return true;
 }
 
+bool VertexDecimation::SatisfiesLinkCondition(const SimplificationMesh& mesh,
+                                              const VertexList& ring,
+                                              bool closed,
+                                              size_t anchor) const {
+  // The fan adds an edge from the anchor to every other ring vertex; none
+  // may exist already, or the surface would pinch there. Between two locked
+  // vertices it may exist in faces the mesh doesn't include, so none is
+  // added there either.
+  const size_t n = ring.Size();
+  const bool locked_anchor = has_locks_ && locked_vertices_[ring[anchor]];
+  VertexList anchor_ring;
+  GatherRingVertices(mesh, vertex_faces_[ring[anchor]], face_removed_,
+                     ring[anchor], anchor_ring);
+  for (size_t i = 0; i < n; i++) {
+    // Edges to the anchor's ring neighbors are kept, not added
+    const bool adjacent =
+        i + 1 == anchor || anchor + 1 == i ||
+        (closed && ((i + 1) % n == anchor || (anchor + 1) % n == i));
+    if (i == anchor || adjacent) continue;
+    if (anchor_ring.Contains(ring[i]) ||
+        (locked_anchor && locked_vertices_[ring[i]])) {
+      return false;
+    }
+  }
+  return true;
+}
+
 void VertexDecimation::ClassifyVertices(
     const SimplificationMesh& mesh, 
     std::vector<VertexInfo>& vertex_info) {
+  DECIMATOR_PROFILE_SCOPE("VertexDecimation.Classify");
   vertex_info.resize(mesh.vertices.size());
-  for (size_t i = 0; i < mesh.vertices.size(); i++) {
-    vertex_info[i].index = i;
-    vertex_info[i].is_feature_vertex = IsFeatureVertex(mesh, i);
-    vertex_info[i].is_boundary_vertex = IsBoundaryVertex(mesh, i);
-    vertex_info[i].distance_error = ComputeDistanceError(mesh, i);
+  // Each classification only reads the vertex's own faces
+  ParallelFor(mesh.vertices.size(), [&](size_t i) {
+    vertex_info[i] = ClassifyVertex(mesh, static_cast<int>(i));
+  });
+}
+
+VertexDecimation::VertexInfo VertexDecimation::ClassifyVertex(
+    const SimplificationMesh& mesh, int vertex_index) const {
+  VertexInfo info;
+  info.index = vertex_index;
+  info.is_feature_vertex = IsFeatureVertex(mesh, vertex_index);
+  info.is_boundary_vertex = IsBoundaryVertex(mesh, vertex_index);
+  // Vertices without a fan can't be removed until their ring changes
+  VertexList ring;
+  bool closed = false;
+  size_t anchor = 0;
+  info.distance_error =
+      PlanFan(mesh, vertex_index, ring, closed, anchor)
+          ? ComputeFanErrors(mesh, vertex_index, ring, closed, anchor,
+                             nullptr)
+          : std::numeric_limits<float>::max();
+  info.version = vertex_version_[vertex_index];
+  return info;
+}
+
+void VertexDecimation::BuildAdjacency(const SimplificationMesh& mesh) {
+  vertex_faces_.assign(mesh.vertices.size(), std::vector<int>());
+  for (size_t i = 0; i < mesh.faces.size(); i++) {
+    const glm::uvec3& face = mesh.faces[i];
+    for (int c = 0; c < 3; c++) {
+      // Degenerate faces repeat a vertex; list them once
+      std::vector<int>& faces = vertex_faces_[face[c]];
+      if (faces.empty() || faces.back() != static_cast<int>(i)) {
+        faces.push_back(static_cast<int>(i));
+      }
+    }
+  }
+  face_removed_.assign(mesh.faces.size(), false);
+  face_errors_.assign(mesh.faces.size(), 0.0f);
+  face_normals_.resize(mesh.faces.size());
+  GeometryKernels::ComputeFacePlanes(mesh.vertices.data(), mesh.faces.data(),
+                                     mesh.faces.size(), face_normals_.data(),
+                                     nullptr, nullptr);
+  vertex_removed_.assign(mesh.vertices.size(), false);
+  vertex_version_.assign(mesh.vertices.size(), 0);
+  has_locks_ = locked_vertices_.size() == mesh.vertices.size();
+  updates_normals_ = mesh.normals.size() == mesh.vertices.size();
+  normal_dirty_.assign(updates_normals_ ? mesh.vertices.size() : 0, 0);
+}
+
+void VertexDecimation::UpdateNormals(SimplificationMesh& mesh) {
+  if (!updates_normals_) {
+    return;
   }
+  DECIMATOR_PROFILE_SCOPE("VertexDecimation.UpdateNormals");
+  ParallelFor(normal_dirty_.size(), [&](size_t v) {
+    if (!normal_dirty_[v]) return;
+    normal_dirty_[v] = 0;
+    if (!vertex_removed_[v]) {
+      mesh.normals[v] =
+          ComputeVertexNormal(mesh, vertex_faces_[v], face_removed_);
+    }
+  });
 }
 
-bool VertexDecimation::CanRemoveVertex(const SimplificationMesh& mesh, const VertexInfo& info) const {
+bool VertexDecimation::CanRemoveVertex(const SimplificationMesh& mesh,
+                                       const VertexInfo& info,
+                                       VertexList& ring, bool& closed,
+                                       size_t& anchor, FanErrors& errors,
+                                       float& error) const {
+  if (has_locks_ && locked_vertices_[info.index]) {
+    DECIMATOR_COUNT("VertexDecimation.rejected_locked", 1);
+    return false;
+  }
+  if (!PlanFan(mesh, info.index, ring, closed, anchor)) {
+    DECIMATOR_COUNT("VertexDecimation.rejected_non_manifold", 1);
+    return false;
+  }
   // Allow boundary vertices if distance error is very small
   if (info.is_boundary_vertex && info.distance_error > max_distance_ * 0.5f) {
+    DECIMATOR_COUNT("VertexDecimation.rejected_boundary", 1);
     return false;
   }
   if (info.is_feature_vertex) {
+    DECIMATOR_COUNT("VertexDecimation.rejected_feature", 1);
     return false;
   }
   if (info.distance_error > max_distance_) {
+    DECIMATOR_COUNT("VertexDecimation.rejected_distance", 1);
     return false;
   }
-  if (!CheckResultingTrianglesAspectRatio(mesh, info.index)) {
+
+  // The same bounds the vertex was queued with, as its faces haven't
+  // changed since
+  error = ComputeFanErrors(mesh, info.index, ring, closed, anchor, &errors);
+  if (!closed) {
+    // The fan replaces the border edges at the vertex with the one between
+    // the ring's ends, so the border moves by the vertex's distance to it
+    const glm::vec3& position = mesh.vertices[info.index];
+    const glm::vec3& first = mesh.vertices[ring[0]];
+    const glm::vec3 edge = mesh.vertices[ring[ring.Size() - 1]] - first;
+    const float length2 = glm::dot(edge, edge);
+    glm::vec3 offset = position - first;
+    if (length2 > 0.0f) {
+      offset -= edge * (glm::dot(offset, edge) / length2);
+    }
+    const float border_error =
+        glm::length(offset) + ComputeInheritedError(info.index);
+    if (border_error > max_distance_ * 0.5f) {
+      DECIMATOR_COUNT("VertexDecimation.rejected_boundary", 1);
+      return false;
+    }
+  }
+  if (!SatisfiesLinkCondition(mesh, ring, closed, anchor)) {
+    DECIMATOR_COUNT("VertexDecimation.rejected_link_condition", 1);
+    return false;
+  }
+  if (CausesFoldOver(mesh, info.index, ring, closed, anchor)) {
+    DECIMATOR_COUNT("VertexDecimation.rejected_fold_over", 1);
+    return false;
+  }
+  if (!CheckResultingTrianglesAspectRatio(mesh, ring, closed, anchor)) {
+    DECIMATOR_COUNT("VertexDecimation.rejected_aspect_ratio", 1);
     return false;
   }
   
   return true;
 }
 
-std::vector<int> VertexDecimation::CollectBoundaryVertices(
-    const SimplificationMesh& mesh, int vertex_index) const {
-  std::set<int> neighbors;
-  
-  for (const auto& face : mesh.faces) {
-    if (face.x == vertex_index || face.y == vertex_index || face.z == vertex_index) {
-      if (face.x != vertex_index) neighbors.insert(face.x);
-      if (face.y != vertex_index) neighbors.insert(face.y);
-      if (face.z != vertex_index) neighbors.insert(face.z);
+bool VertexDecimation::CausesFoldOver(const SimplificationMesh& mesh,
+                                      int vertex_index, const VertexList& ring,
+                                      bool closed, size_t anchor) const {
+  // Each fan triangle is a face (vertex, r_i, r_i+1) with the vertex moved
+  // onto the anchor; the flip kernel takes them a batch at a time
+  const size_t n = ring.Size();
+  const size_t pairs = closed ? n : n - 1;
+  const glm::vec3& position = mesh.vertices[vertex_index];
+  const glm::vec3& target = mesh.vertices[ring[anchor]];
+  GeometryKernels::FlipBatch batch;
+  for (int c = 0; c < 3; c++) {
+    for (size_t lane = 0; lane < GeometryKernels::kFlipBatch; lane++) {
+      batch.corners[0][c][lane] = position[c];
+      batch.target[c][lane] = target[c];
     }
   }
-  
-  return std::vector<int>(neighbors.begin(), neighbors.end());
+  size_t count = 0;
+  for (size_t i = 0; i < pairs; i++) {
+    const size_t j = (i + 1) % n;
+    if (i == anchor || j == anchor) continue;
+    const glm::vec3& p1 = mesh.vertices[ring[i]];
+    const glm::vec3& p2 = mesh.vertices[ring[j]];
+    for (int c = 0; c < 3; c++) {
+      batch.corners[1][c][count] = p1[c];
+      batch.corners[2][c][count] = p2[c];
+    }
+    batch.moved[count] = 0;
+    if (++count == GeometryKernels::kFlipBatch) {
+      if (GeometryKernels::HasFlippedFaces(batch, count)) {
+        return true;
+      }
+      count = 0;
+    }
+  }
+  return count > 0 && GeometryKernels::HasFlippedFaces(batch, count);
 }
 
 void VertexDecimation::RemoveVertex(SimplificationMesh& mesh, int vertex_index) {
-  // Remove all faces that contain this vertex (creates a hole)
-  for (size_t i = 0; i < mesh.faces.size(); ) {
-    const auto& face = mesh.faces[i];
-    if (face.x == vertex_index || face.y == vertex_index || face.z == vertex_index) {
-      mesh.faces.erase(mesh.faces.begin() + i);
-    } else {
-      i++;
+  DECIMATOR_PROFILE_SCOPE("VertexDecimation.RemoveVertex");
+  // Remove all faces that contain this vertex (creates a hole). Removed
+  // elements are only flagged and compacted away at the end.
+  for (int f : vertex_faces_[vertex_index]) {
+    face_removed_[f] = true;
+    const glm::uvec3& face = mesh.faces[f];
+    for (int c = 0; c < 3; c++) {
+      int v = static_cast<int>(face[c]);
+      if (v == vertex_index) {
+        continue;
+      }
+      std::vector<int>& faces = vertex_faces_[v];
+      faces.erase(std::remove(faces.begin(), faces.end(), f), faces.end());
     }
   }
-  
-  // Update all face indices that reference vertices after the removed one
-  for (auto& face : mesh.faces) {
-    if (face.x > vertex_index) face.x--;
-    if (face.y > vertex_index) face.y--;
-    if (face.z > vertex_index) face.z--;
-  }
-  
-  // Remove the vertex itself
-  mesh.vertices.erase(mesh.vertices.begin() + vertex_index);
-  
-  // Update normals if they exist
-  if (!mesh.normals.empty() && mesh.normals.size() == mesh.vertices.size() + 1) {
-    mesh.normals.erase(mesh.normals.begin() + vertex_index);
-  }
+  std::vector<int>().swap(vertex_faces_[vertex_index]);
+  vertex_removed_[vertex_index] = true;
+  vertex_version_[vertex_index]++;
 }
 
-void VertexDecimation::RetriangulateHole(
-    SimplificationMesh& mesh, 
-    const std::vector<int>& boundary_vertices) {
-  // Simple fan triangulation: connect all boundary vertices to the first one
-  if (boundary_vertices.size() < 3) {
-    return;
-  }
-  
-  // Remove duplicates
-  std::vector<int> unique_vertices;
-  for (int v : boundary_vertices) {
-    if (unique_vertices.empty() || unique_vertices.back() != v) {
-      unique_vertices.push_back(v);
-    }
-  }
-  
-  unsigned int anchor = static_cast<unsigned int>(unique_vertices[0]);
-  for (size_t i = 1; i + 1 < unique_vertices.size(); ++i) {
-    glm::uvec3 new_face(
-        anchor,
-        static_cast<unsigned int>(unique_vertices[i]),
-        static_cast<unsigned int>(unique_vertices[i + 1])
-    );
+void VertexDecimation::RetriangulateHole(SimplificationMesh& mesh,
+                                         const VertexList& ring, bool closed,
+                                         size_t anchor,
+                                         const FanErrors& errors) {
+  DECIMATOR_PROFILE_SCOPE("VertexDecimation.Retriangulate");
+  // Fan triangulation from the anchor, in the ring's winding order
+  const size_t n = ring.Size();
+  const size_t pairs = closed ? n : n - 1;
+  const size_t first_new_face = mesh.faces.size();
+  const unsigned int center = static_cast<unsigned int>(ring[anchor]);
+  size_t fan_face = 0;
+  for (size_t i = 0; i < pairs; ++i) {
+    const size_t j = (i + 1) % n;
+    if (i == anchor || j == anchor) continue;
+    glm::uvec3 new_face(center, static_cast<unsigned int>(ring[i]),
+                        static_cast<unsigned int>(ring[j]));
+    // New faces have the highest index, so face lists stay sorted
+    int face_index = static_cast<int>(mesh.faces.size());
     mesh.faces.push_back(new_face);
+    face_removed_.push_back(false);
+    face_errors_.push_back(errors[fan_face++]);
+    vertex_faces_[new_face.x].push_back(face_index);
+    vertex_faces_[new_face.y].push_back(face_index);
+    vertex_faces_[new_face.z].push_back(face_index);
   }
+  face_normals_.resize(mesh.faces.size());
+  GeometryKernels::ComputeFacePlanes(
+      mesh.vertices.data(), mesh.faces.data() + first_new_face,
+      mesh.faces.size() - first_new_face,
+      face_normals_.data() + first_new_face, nullptr, nullptr);
 }
 
 }  // namespace GLOO
@@ -1,16 +1,23 @@
 #ifndef VERTEX_DECIMATION_H_
 #define VERTEX_DECIMATION_H_
 
+#include <chrono>
 #include <memory>
+#include <string>
 #include <vector>
 #include <glm/glm.hpp>
 #include "SimplificationMesh.hpp"
+#include "SimplificationBudget.hpp"
+#include "PriorityQueues.hpp"
+#include "OneRing.hpp"
 
 namespace GLOO {
 
 // Vertex Decimation using Schroeder-Zarge-Lorensen algorithm
 class VertexDecimation {
  public:
+  class Session;
+
   VertexDecimation();
   ~VertexDecimation();
 
@@ -22,38 +29,211 @@ class VertexDecimation {
   std::shared_ptr<SimplificationMesh> SimplifyByFactor(const SimplificationMesh& original_mesh, 
                                                float reduction_factor);
 
+  // Simplify until a count target of the budget is reached. The error of a
+  // removal is its accumulated bound (see SetMaxDistance); decimation stops
+  // at the first candidate above budget.max_error (candidates come in
+  // increasing error order). SetMaxDistance still applies as well.
+  std::shared_ptr<SimplificationMesh> Simplify(
+      const SimplificationMesh& original_mesh,
+      const SimplificationBudget& budget,
+      SimplificationReport* report = nullptr);
+
+  // Same as above, but decimate the given mesh without copying it first,
+  // so peak memory is one mesh (plus adjacency) instead of two
+  std::shared_ptr<SimplificationMesh> Simplify(SimplificationMesh&& mesh,
+                                               int target_vertex_count);
+  std::shared_ptr<SimplificationMesh> Simplify(
+      SimplificationMesh&& mesh, const SimplificationBudget& budget,
+      SimplificationReport* report = nullptr);
+  void SimplifyInPlace(SimplificationMesh& mesh,
+                       const SimplificationBudget& budget,
+                       SimplificationReport* report = nullptr);
+
+  // Starts a resumable decimation towards target_vertex_count (or a budget)
+  // that is advanced with Session::Step. The session copies this
+  // simplifier's settings, so later setter calls don't affect it.
+  std::unique_ptr<Session> BeginSession(const SimplificationMesh& original_mesh,
+                                        int target_vertex_count) const;
+  std::unique_ptr<Session> BeginSession(const SimplificationMesh& original_mesh,
+                                        const SimplificationBudget& budget) const;
+  // Takes over the mesh instead of copying it
+  std::unique_ptr<Session> BeginSession(SimplificationMesh&& mesh,
+                                        const SimplificationBudget& budget) const;
+
   // Set decimation criteria parameters
   void SetFeatureAngle(float angle) { feature_angle_ = angle; }
   void SetAspectRatio(float ratio) { aspect_ratio_ = ratio; }
+  // Tolerance on the accumulated error [SZL92]: every face carries a bound
+  // on its distance from the input, and a removal gives each face of its
+  // fan the vertex's distance to that face's plane (or to the fan, if
+  // farther) plus the largest bound of the faces around it. Bounds only
+  // grow, so the tolerance holds for the whole run rather than per removal.
   void SetMaxDistance(float dist) { max_distance_ = dist; }
 
+  // Vertices flagged nonzero are never removed, and no new edge joins two
+  // of them, as they may border faces the mesh doesn't include (the blocks
+  // of PartitionedSimplifier) that already have it. Compaction keeps the
+  // vertex order, so locked vertices placed first stay first. Ignored
+  // unless there is one flag per mesh vertex.
+  void SetLockedVertices(std::vector<uint8_t> locked) {
+    locked_vertices_ = std::move(locked);
+  }
+
+  // Queue the removal loop runs on (see PriorityQueues.hpp). Candidates
+  // are ranked per vertex, so with DARY_HEAP a reclassified neighbor is
+  // re-keyed in place instead of queued again.
+  void SetQueueBackend(QueueBackend backend) { queue_backend_ = backend; }
+
+  // Every setting above as text, for result cache keys
+  // (SimplificationCache::MakeKey)
+  std::string GetSettingsKey() const;
+
  private:
   float feature_angle_ = 90.0f;   // Feature angle threshold (degrees)
   float aspect_ratio_ = 20.0f;    // Maximum aspect ratio for triangles
-  float max_distance_ = 0.1f;     // Maximum distance from vertex to average plane
+  float max_distance_ = 0.1f;     // Maximum accumulated error of a face
+  std::vector<uint8_t> locked_vertices_;
+  QueueBackend queue_backend_ = QueueBackend::BINARY_HEAP;
 
   struct VertexInfo {
     int index;
     bool is_feature_vertex;
     bool is_boundary_vertex;
-    float distance_error;
-    std::vector<int> neighbor_vertices;
-    std::vector<int> adjacent_faces;
+    float distance_error;  // Largest bound the fan's faces would get
+    unsigned int version;  // vertex_version_ when classified
+
+    bool operator<(const VertexInfo& other) const {
+      if (distance_error != other.distance_error) {
+        return distance_error > other.distance_error;  // Min heap
+      }
+      return index > other.index;
+    }
+    // Same order as operator< as an unsigned key (cheapest first)
+    uint64_t GetOrderKey() const;
+    uint32_t GetQueueId() const { return static_cast<uint32_t>(index); }
+  };
+
+  typedef InlineList<float> FanErrors;
+
+  // Candidates ordered by distance error. Entries go stale (version
+  // mismatch) when a neighbor is removed, and the neighbors are re-queued
+  // with their new classification, so each removal costs O(valence log n)
+  // instead of reclassifying the whole mesh.
+  struct DecimationRun {
+    // Only the queue of the backend in use is filled
+    LazyBinaryHeap<VertexInfo> binary_queue;
+    IndexedDaryHeap<VertexInfo> dary_queue;
+    MonotoneRadixHeap<VertexInfo> radix_queue;
+    int vertex_count;
+    int face_count;
+    float max_error;  // Largest bound of the removals so far
   };
 
+  // Per-run connectivity, valid during Simplify. Face lists stay in
+  // ascending face order.
+  std::vector<std::vector<int>> vertex_faces_;
+  std::vector<uint8_t> face_removed_;
+  // Unit normal of every face, zero for degenerate ones. Vertices never
+  // move and faces are only added, so each is computed once.
+  std::vector<glm::vec3> face_normals_;
+  // Accumulated error bound of every face, zero for the input's
+  std::vector<float> face_errors_;
+  std::vector<uint8_t> vertex_removed_;
+  std::vector<unsigned int> vertex_version_;
+  bool has_locks_ = false;  // locked_vertices_ matches the mesh
+  // The mesh has normals, so each removal flags its ring's for
+  // UpdateNormals (positions don't move, so no others change)
+  bool updates_normals_ = false;
+  std::vector<uint8_t> normal_dirty_;
+
   // Helper methods
   bool IsFeatureVertex(const SimplificationMesh& mesh, int vertex_index) const;
   bool IsBoundaryVertex(const SimplificationMesh& mesh, int vertex_index) const;
-  float ComputeDistanceError(const SimplificationMesh& mesh, int vertex_index) const;
+  // Largest bound of the vertex's faces
+  float ComputeInheritedError(int vertex_index) const;
   float ComputeTriangleAspectRatio(const glm::vec3& v0, const glm::vec3& v1, const glm::vec3& v2) const;
-  bool CheckResultingTrianglesAspectRatio(const SimplificationMesh& mesh, int vertex_index) const;
+  // The fan that would fill the hole of a removed vertex: the triangles
+  // (anchor, r_i, r_i+1) of its ordered one-ring r (see RetriangulateHole).
+  // False unless the vertex is manifold with at least three ring vertices.
+  bool PlanFan(const SimplificationMesh& mesh, int vertex_index,
+               VertexList& ring, bool& closed, size_t& anchor) const;
+  // Bound of every fan face, in the order RetriangulateHole adds them: the
+  // vertex's distance to the face's plane (or to the fan, if farther) plus
+  // the largest bound of the faces it replaces, so input points near those
+  // stay within the bound. Returns the largest.
+  float ComputeFanErrors(const SimplificationMesh& mesh, int vertex_index,
+                         const VertexList& ring, bool closed, size_t anchor,
+                         FanErrors* errors) const;
+  // Checks on the fan. Each is O(valence) and allocation free.
+  bool CheckResultingTrianglesAspectRatio(const SimplificationMesh& mesh,
+                                          const VertexList& ring, bool closed,
+                                          size_t anchor) const;
+  // Rejects fans that would add an edge the mesh already has
+  bool SatisfiesLinkCondition(const SimplificationMesh& mesh,
+                              const VertexList& ring, bool closed,
+                              size_t anchor) const;
+  // Rejects fans that flip or degenerate a triangle relative to the face
+  // it replaces
+  bool CausesFoldOver(const SimplificationMesh& mesh, int vertex_index,
+                      const VertexList& ring, bool closed,
+                      size_t anchor) const;
+  void BuildAdjacency(const SimplificationMesh& mesh);
+  VertexInfo ClassifyVertex(const SimplificationMesh& mesh,
+                            int vertex_index) const;
   void ClassifyVertices(const SimplificationMesh& mesh, 
                         std::vector<VertexInfo>& vertex_info);
-  bool CanRemoveVertex(const SimplificationMesh& mesh, const VertexInfo& info) const;
-  std::vector<int> CollectBoundaryVertices(const SimplificationMesh& mesh, int vertex_index) const;
+  void BeginRemovals(const SimplificationMesh& mesh, DecimationRun& run);
+  // Removes vertices until the budget is reached or none can be removed;
+  // returns false if it stopped at the deadline first.
+  bool ContinueRemovals(SimplificationMesh& mesh, DecimationRun& run,
+                        const SimplificationBudget& budget,
+                        std::chrono::steady_clock::time_point deadline =
+                            std::chrono::steady_clock::time_point::max());
+  // ContinueRemovals on the queue of the chosen backend
+  template <class Queue>
+  bool RunRemovalLoop(SimplificationMesh& mesh, DecimationRun& run,
+                      Queue& queue, const SimplificationBudget& budget,
+                      std::chrono::steady_clock::time_point deadline);
+  // On success, ring is the vertex's ordered one-ring (closed unless it is
+  // a border vertex), anchor the ring slot the hole is fanned from and
+  // errors the bounds of the fan's faces, the largest being error
+  bool CanRemoveVertex(const SimplificationMesh& mesh, const VertexInfo& info,
+                       VertexList& ring, bool& closed, size_t& anchor,
+                       FanErrors& errors, float& error) const;
   void RemoveVertex(SimplificationMesh& mesh, int vertex_index);
-  void RetriangulateHole(SimplificationMesh& mesh, 
-                         const std::vector<int>& boundary_vertices);
+  void RetriangulateHole(SimplificationMesh& mesh, const VertexList& ring,
+                         bool closed, size_t anchor, const FanErrors& errors);
+  // Recomputes the normals flagged by the removals since the last call;
+  // called before the mesh is compacted or a session step returns
+  void UpdateNormals(SimplificationMesh& mesh);
+};
+
+// Vertex decimation that can be spread over several calls, e.g. a few
+// milliseconds per frame. The working mesh only flags removed elements, so
+// any intermediate state can be compacted for display.
+class VertexDecimation::Session {
+ public:
+  // Removes vertices until the target is reached, none can be removed or
+  // the deadline passes; returns IsDone(). The first call also classifies
+  // every vertex, which is not interruptible.
+  bool Step(std::chrono::steady_clock::time_point deadline);
+  bool IsDone() const { return done_; }
+  int GetVertexCount() const;
+  float GetMaxError() const;
+  // Compacted copy of the current (possibly partial) result
+  std::shared_ptr<SimplificationMesh> GetResult() const;
+
+ private:
+  friend class VertexDecimation;
+  Session(const VertexDecimation& simplifier, SimplificationMesh mesh,
+          const SimplificationBudget& budget);
+
+  VertexDecimation simplifier_;  // Own copy: holds the per-run connectivity
+  SimplificationMesh mesh_;
+  DecimationRun run_;
+  SimplificationBudget budget_;
+  bool started_ = false;
+  bool done_ = false;
 };
 
 }  // namespace GLOO
@@ -4,6 +4,7 @@
 
 #include "gloo/utils.hpp"
 #include "gloo/InputManager.hpp"
+#include "gloo/debug/Tracer.hpp"
 
 namespace GLOO {
 Application::Application(std::string app_name, glm::ivec2 window_size)
@@ -106,17 +107,25 @@ void Application::DestroyGUI() {
 }
 
 void Application::Tick(double delta_time, double current_time) {
+  GLOO_TRACE_SCOPE("Application::Tick");
   // Process window events.
   glfwPollEvents();
   UpdateGUI();
 
   // Logic update before rendering.
-  scene_->Update(delta_time);
+  {
+    GLOO_TRACE_SCOPE("Scene::Update");
+    scene_->Update(delta_time);
+  }
 
   // Rendering scene and GUI.
   renderer_->Render(*scene_);
-  RenderGUI();
+  {
+    GLOO_TRACE_SCOPE("Application::RenderGUI");
+    RenderGUI();
+  }
 
+  GLOO_TRACE_SCOPE("glfwSwapBuffers");
   glfwSwapBuffers(window_handle_);
 }
 
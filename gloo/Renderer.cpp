@@ -12,6 +12,7 @@
 #include "components/ShadingComponent.hpp"
 #include "components/CameraComponent.hpp"
 #include "debug/PrimitiveFactory.hpp"
+#include "debug/Tracer.hpp"
 
 namespace GLOO {
 Renderer::Renderer(Application& application) : application_(application) {
@@ -31,6 +32,7 @@ void Renderer::SetRenderingOptions() const {
 }
 
 void Renderer::Render(const Scene& scene) const {
+  GLOO_TRACE_SCOPE("Renderer::Render");
   SetRenderingOptions();
   RenderScene(scene);
 }
@@ -6,9 +6,11 @@
 
 #include "gloo/gl_wrapper/BindGuard.hpp"
 #include "gloo/SceneNode.hpp"
+#include "gloo/debug/Tracer.hpp"
 
 namespace GLOO {
 void VertexObject::UpdatePositions(std::unique_ptr<PositionArray> positions) {
+  GLOO_TRACE_SCOPE("VertexObject::UpdatePositions");
   if (positions_ == nullptr) {
     vertex_array_->CreatePositionBuffer();
   }
@@ -17,6 +19,7 @@ void VertexObject::UpdatePositions(std::unique_ptr<PositionArray> positions) {
 }
 
 void VertexObject::UpdateIndices(std::unique_ptr<IndexArray> indices) {
+  GLOO_TRACE_SCOPE("VertexObject::UpdateIndices");
   if (indices_ == nullptr) {
     vertex_array_->CreateIndexBuffer();
   }
@@ -25,6 +28,7 @@ void VertexObject::UpdateIndices(std::unique_ptr<IndexArray> indices) {
 }
 
 void VertexObject::UpdateNormals(std::unique_ptr<NormalArray> normals) {
+  GLOO_TRACE_SCOPE("VertexObject::UpdateNormals");
   if (normals_ == nullptr) {
     vertex_array_->CreateNormalBuffer();
   }
@@ -33,6 +37,7 @@ void VertexObject::UpdateNormals(std::unique_ptr<NormalArray> normals) {
 }
 
 void VertexObject::UpdateColors(std::unique_ptr<ColorArray> colors) {
+  GLOO_TRACE_SCOPE("VertexObject::UpdateColors");
   if (colors_ == nullptr) {
     vertex_array_->CreateColorBuffer();
   }
@@ -41,6 +46,7 @@ void VertexObject::UpdateColors(std::unique_ptr<ColorArray> colors) {
 }
 
 void VertexObject::UpdateTexCoord(std::unique_ptr<TexCoordArray> tex_coords) {
+  GLOO_TRACE_SCOPE("VertexObject::UpdateTexCoord");
   if (tex_coords_ == nullptr) {
     vertex_array_->CreateTexCoordBuffer();
   }
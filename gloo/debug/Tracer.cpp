@@ -0,0 +1,221 @@
+#include "Tracer.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <vector>
+
+namespace GLOO {
+namespace {
+// Written only by the owning thread. The end flag is packed into the low
+// bit of the timestamp so an event is two word-sized atomics.
+struct TraceEvent {
+  std::atomic<const char*> name;
+  std::atomic<uint64_t> stamp;
+};
+
+struct ThreadBuffer {
+  int tid;
+  std::string thread_name;  // Guarded by the registry mutex
+  // Number of events ever recorded; slot = index % kEventsPerThread
+  std::atomic<uint64_t> head;
+  // Events before this index were dropped by Clear()
+  std::atomic<uint64_t> first;
+  std::unique_ptr<TraceEvent[]> events;
+
+  explicit ThreadBuffer(int id)
+      : tid(id), head(0), first(0),
+        events(new TraceEvent[Tracer::kEventsPerThread]) {}
+};
+
+struct Registry {
+  std::mutex mutex;
+  std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+  std::vector<ThreadBuffer*> free_buffers;
+};
+
+// Intentionally leaked so thread-exit handlers can run after static
+// destruction has started.
+Registry& GetRegistry() {
+  static Registry* registry = new Registry();
+  return *registry;
+}
+
+std::atomic<bool> recording(false);
+const std::chrono::steady_clock::time_point trace_epoch =
+    std::chrono::steady_clock::now();
+
+// Hands the thread's buffer back to the registry when the thread exits.
+struct BufferHandle {
+  ThreadBuffer* buffer = nullptr;
+
+  ~BufferHandle() {
+    if (buffer != nullptr) {
+      Registry& registry = GetRegistry();
+      std::lock_guard<std::mutex> lock(registry.mutex);
+      registry.free_buffers.push_back(buffer);
+    }
+  }
+};
+
+thread_local BufferHandle local_buffer;
+
+ThreadBuffer& LocalBuffer() {
+  if (local_buffer.buffer == nullptr) {
+    Registry& registry = GetRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    if (!registry.free_buffers.empty()) {
+      local_buffer.buffer = registry.free_buffers.back();
+      local_buffer.buffer->thread_name.clear();
+      registry.free_buffers.pop_back();
+    } else {
+      int tid = static_cast<int>(registry.buffers.size()) + 1;
+      registry.buffers.emplace_back(new ThreadBuffer(tid));
+      local_buffer.buffer = registry.buffers.back().get();
+    }
+  }
+  return *local_buffer.buffer;
+}
+
+void Record(const char* name, bool is_end) {
+  if (!recording.load(std::memory_order_relaxed)) {
+    return;
+  }
+  ThreadBuffer& buffer = LocalBuffer();
+  uint64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now() - trace_epoch)
+                    .count();
+  uint64_t head = buffer.head.load(std::memory_order_relaxed);
+  TraceEvent& event = buffer.events[head % Tracer::kEventsPerThread];
+  event.name.store(name, std::memory_order_relaxed);
+  event.stamp.store((ns << 1) | (is_end ? 1u : 0u), std::memory_order_relaxed);
+  buffer.head.store(head + 1, std::memory_order_release);
+}
+
+void WriteEscaped(std::ostream& os, const std::string& text) {
+  for (char c : text) {
+    if (c == '"' || c == '\\') {
+      os << '\\';
+    }
+    os << c;
+  }
+}
+}  // namespace
+
+void Tracer::Start() {
+  recording.store(true, std::memory_order_relaxed);
+}
+
+void Tracer::Stop() {
+  recording.store(false, std::memory_order_relaxed);
+}
+
+bool Tracer::IsRecording() {
+  return recording.load(std::memory_order_relaxed);
+}
+
+void Tracer::Clear() {
+  Registry& registry = GetRegistry();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+  for (const auto& buffer : registry.buffers) {
+    buffer->first.store(buffer->head.load(std::memory_order_acquire),
+                        std::memory_order_relaxed);
+  }
+}
+
+void Tracer::Begin(const char* name) {
+  Record(name, false);
+}
+
+void Tracer::End(const char* name) {
+  Record(name, true);
+}
+
+void Tracer::SetThreadName(const std::string& name) {
+  ThreadBuffer& buffer = LocalBuffer();
+  std::lock_guard<std::mutex> lock(GetRegistry().mutex);
+  buffer.thread_name = name;
+}
+
+std::string Tracer::ToJson() {
+  Registry& registry = GetRegistry();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+
+  std::ostringstream os;
+  os.precision(3);
+  os << std::fixed;
+  os << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [";
+  bool first_event = true;
+  auto separator = [&]() {
+    os << (first_event ? "\n" : ",\n");
+    first_event = false;
+  };
+
+  struct Copied {
+    const char* name;
+    uint64_t stamp;
+  };
+  std::vector<Copied> copied;
+  for (const auto& buffer : registry.buffers) {
+    if (!buffer->thread_name.empty()) {
+      separator();
+      os << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, "
+         << "\"tid\": " << buffer->tid << ", \"args\": {\"name\": \"";
+      WriteEscaped(os, buffer->thread_name);
+      os << "\"}}";
+    }
+
+    // Copy the live window, then drop whatever the owner may have
+    // overwritten meanwhile (including the slot it may be writing now).
+    uint64_t head = buffer->head.load(std::memory_order_acquire);
+    uint64_t begin = buffer->first.load(std::memory_order_relaxed);
+    if (head > kEventsPerThread) {
+      begin = std::max<uint64_t>(begin, head - kEventsPerThread);
+    }
+    copied.clear();
+    for (uint64_t i = begin; i < head; i++) {
+      const TraceEvent& event = buffer->events[i % kEventsPerThread];
+      copied.push_back({event.name.load(std::memory_order_relaxed),
+                        event.stamp.load(std::memory_order_relaxed)});
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+    uint64_t head_after = buffer->head.load(std::memory_order_relaxed);
+    uint64_t valid_from = begin;
+    if (head_after + 1 > kEventsPerThread) {
+      valid_from = std::max<uint64_t>(valid_from,
+                                      head_after + 1 - kEventsPerThread);
+    }
+
+    for (uint64_t i = valid_from; i < head; i++) {
+      const Copied& event = copied[i - begin];
+      if (event.name == nullptr) {
+        continue;
+      }
+      separator();
+      os << "{\"name\": \"";
+      WriteEscaped(os, event.name);
+      os << "\", \"ph\": \"" << ((event.stamp & 1) ? 'E' : 'B')
+         << "\", \"ts\": " << (event.stamp >> 1) / 1000.0
+         << ", \"pid\": 1, \"tid\": " << buffer->tid << "}";
+    }
+  }
+  os << "\n]}\n";
+  return os.str();
+}
+
+bool Tracer::WriteJson(const std::string& filepath) {
+  std::ofstream file(filepath);
+  if (!file.is_open()) {
+    std::cerr << "Failed to open file for writing: " << filepath << std::endl;
+    return false;
+  }
+  file << ToJson();
+  return true;
+}
+}  // namespace GLOO
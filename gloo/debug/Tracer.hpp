@@ -0,0 +1,62 @@
+#ifndef GLOO_TRACER_H_
+#define GLOO_TRACER_H_
+
+#include <string>
+
+namespace GLOO {
+// Timeline tracing in the Chrome trace-event format (chrome://tracing,
+// https://ui.perfetto.dev).
+//
+// Every thread records begin/end events into its own fixed-size ring buffer;
+// recording is a couple of relaxed stores and a release store, with no locks.
+// When a buffer is full the oldest events are overwritten. Buffers of exited
+// threads are kept for the dump and handed to the next new thread, so the
+// short-lived parallel workers share a few timeline rows instead of growing
+// memory without bound.
+//
+// Recording is off until Start() is called. Names must be string literals
+// (or otherwise outlive the dump); only the pointer is stored.
+class Tracer {
+ public:
+  static const size_t kEventsPerThread = 1 << 16;
+
+  static void Start();
+  static void Stop();
+  static bool IsRecording();
+  // Drops all recorded events.
+  static void Clear();
+
+  static void Begin(const char* name);
+  static void End(const char* name);
+
+  // Labels the calling thread's row in the viewer.
+  static void SetThreadName(const std::string& name);
+
+  static std::string ToJson();
+  static bool WriteJson(const std::string& filepath);
+};
+
+class TraceScope {
+ public:
+  explicit TraceScope(const char* name) : name_(name) {
+    Tracer::Begin(name_);
+  }
+  ~TraceScope() {
+    Tracer::End(name_);
+  }
+
+  TraceScope(const TraceScope&) = delete;
+  TraceScope& operator=(const TraceScope&) = delete;
+
+ private:
+  const char* name_;
+};
+}  // namespace GLOO
+
+#define GLOO_TRACE_CONCAT_INNER(a, b) a##b
+#define GLOO_TRACE_CONCAT(a, b) GLOO_TRACE_CONCAT_INNER(a, b)
+// Records the rest of the enclosing scope as a slice named `name`.
+#define GLOO_TRACE_SCOPE(name) \
+  ::GLOO::TraceScope GLOO_TRACE_CONCAT(trace_scope_, __LINE__)(name)
+
+#endif